@@ -25,6 +25,7 @@ import pytriqs.utility.mpi as mpi
 from itertools import *
 import inspect
 import copy,numpy
+from sumk_engine import sumk
 
 class SumkDiscrete:
     """
@@ -131,6 +132,11 @@ class SumkDiscrete:
         assert self.bz_weights.shape[0] == self.n_kpts(), "Internal Error"
         no = list(set([g.N1 for i,g in G]))[0]
 
+        # Fast path: the sum over k is done in C++ (threads on frequencies, MPI on k)
+        if not Sigma_fnt and field == None and epsilon_hat == None and all(isinstance(g, GfImFreq) for i,g in Sigma):
+            for i,g in G: g << sumk(self.hopping, self.bz_weights, Sigma[i], mu)
+            return G
+
         # Initialize
         G.zero()
         tmp,tmp2 = G.copy(),G.copy()
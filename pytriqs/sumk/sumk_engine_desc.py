@@ -0,0 +1,39 @@
+from wrap_generator import *
+
+module = module_(full_name = "pytriqs.sumk.sumk_engine", doc = "C++ engine for the lattice sums")
+module.use_module('gf')
+module.use_module('lattice_tools')
+module.add_include("<triqs/lattice/sumk.hpp>")
+module.add_include("<triqs/python_tools/converters/arrays.hpp>")
+
+module.add_using("namespace triqs::lattice")
+module.add_using("namespace triqs::arrays")
+module.add_using("namespace triqs::gfs")
+
+module.add_function(name = "sumk",
+                    signature = "gf<imfreq>(array_const_view<dcomplex, 3> eps_k, array_const_view<double, 1> weights, gf_view<imfreq> sigma, double mu)",
+                    doc = """
+    Computes :math:`G(i\omega_n) = \sum_k w_k (i\omega_n + \mu - \epsilon_k - \Sigma(i\omega_n))^{-1}`
+
+    The k points are distributed over the MPI nodes, the frequencies over the threads.
+
+    :param eps_k: eps_k[n,:,:] is the matrix t(k) for the n-th k point
+    :param weights: weights[n] is the weight of the n-th k point
+    :param sigma: the self-energy, a GfImFreq
+    :param mu: the chemical potential
+    """)
+
+module.add_function(name = "sumk",
+                    signature = "gf<imfreq>(tight_binding TB, array_const_view<double, 2> k_points, array_const_view<double, 1> weights, gf_view<imfreq> sigma, double mu)",
+                    doc = """
+    Same as above, with t(k) the Fourier transform of a TightBinding, computed on the fly.
+
+    :param k_points: k_points[n,:] is the n-th k point, in the basis of the reciprocal lattice
+    """)
+
+########################
+##   Code generation
+########################
+
+if __name__ == '__main__' :
+   module.generate_code()
@@ -0,0 +1,54 @@
+################################################################################
+#
+# TRIQS: a Toolbox for Research in Interacting Quantum Systems
+#
+# Copyright (C) 2015 by O. Parcollet
+#
+# TRIQS is free software: you can redistribute it and/or modify it under the
+# terms of the GNU General Public License as published by the Free Software
+# Foundation, either version 3 of the License, or (at your option) any later
+# version.
+#
+# TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+# WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License along with
+# TRIQS. If not, see <http://www.gnu.org/licenses/>.
+#
+################################################################################
+# The sum over k of SumkDiscrete : the C++ fast path against the python loop on k
+from pytriqs.gf.local import *
+from pytriqs.sumk.sumk_discrete import SumkDiscrete
+import numpy as np
+from math import pi, cos, sin
+
+beta, precision = 20, 1.e-10
+
+def max_abs(a) :
+    return np.amax(np.abs(a))
+
+# two orbitals on a 1d chain of nk sites, with an inter orbital hopping
+nk = 64
+SK = SumkDiscrete(dim = 1, gf_struct = [1,2])
+SK.resize_arrays(nk)
+for k in range(nk) :
+    x = 2*pi*k/nk
+    SK.bz_points[k,0] = float(k)/nk
+    SK.hopping[k] = np.array([[-2*cos(x), 0.3*sin(x)], [0.3*sin(x), 0.5 - cos(2*x)]])
+
+g = GfImFreq(indices = [1,2], beta = beta, n_points = 100)
+Sigma = BlockGf(name_list = ('up','down'), block_list = (g,g), make_copies = True)
+Sigma['up'] << 0.4 * inverse(iOmega_n + 1.0)
+Sigma['down'] << 0.2 * inverse(iOmega_n - 0.5)
+
+# the fast path is taken for a BlockGf of GfImFreq, without field and epsilon_hat
+G_fast = SK(Sigma = Sigma, mu = 0.3)
+# an epsilon_hat returning t(k) itself is the same sum, by the loop on k in python
+G_slow = SK(Sigma = Sigma, mu = 0.3, epsilon_hat = lambda eps : eps)
+
+for n, g in G_fast :
+    assert max_abs(g.data - G_slow[n].data) < precision, "G(iw) of the block %s"%n
+    # the orders -1 to 3 of the tail
+    assert max_abs(g.tail.data[0:5] - G_slow[n].tail.data[0:5]) < precision, "tail of the block %s"%n
@@ -0,0 +1,127 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "./common.hpp"
+#include <triqs/utility/parallel.hpp>
+#include <cstdint>
+
+using namespace triqs::arrays;
+namespace st = triqs::arrays::storages;
+
+template <typename A> bool is_aligned(A const &a) { return reinterpret_cast<std::uintptr_t>(a.data_start()) % st::memory_alignment == 0; }
+
+int main(int argc, char **argv) {
+ try {
+  auto s0 = st::get_memory_stats();
+
+  // all blocks are aligned, small and large
+  for (int n : {1, 3, 17, 100, 5000, 100000}) {
+   array<double, 1> a(n);
+   matrix<std::complex<double>> m(n % 50 + 1, 3);
+   TEST_ASSERT(is_aligned(a));
+   TEST_ASSERT(is_aligned(m));
+  }
+
+  // the small blocks are recycled
+  auto s1 = st::get_memory_stats();
+  for (int i = 0; i < 1000; ++i) {
+   matrix<double> m(4, 4);
+   m() = i;
+   matrix<double> m2 = m * m;
+   TEST_ASSERT(m2(0, 0) == double(i) * i); // m is i * identity
+  }
+  auto s2 = st::get_memory_stats();
+  TEST_ASSERT(s2.n_allocations - s1.n_allocations >= 2000);
+  TEST_ASSERT(s2.n_pool_hits - s1.n_pool_hits >= s2.n_allocations - s1.n_allocations - 2);
+  TEST_ASSERT(s2.bytes_in_use == s0.bytes_in_use);
+  TEST_ASSERT(s2.n_allocations - s0.n_allocations == s2.n_deallocations - s0.n_deallocations);
+
+  // without pool
+  auto p = st::get_allocation_policy();
+  p.use_pool = false;
+  st::set_allocation_policy(p);
+  st::release_memory_pool();
+  {
+   matrix<double> m(4, 4);
+   auto s3 = st::get_memory_stats();
+   matrix<double> m2(4, 4);
+   TEST_ASSERT(st::get_memory_stats().n_pool_hits == s3.n_pool_hits);
+  }
+
+  // first touch of large blocks
+  p.use_pool = true;
+  p.numa_first_touch = true;
+  st::set_allocation_policy(p);
+  {
+   array<double, 2> a(1000, 1000);
+   a() = 1;
+   TEST_ASSERT(sum(a) == 1.e6);
+  }
+
+  // non pod elements are constructed and destroyed
+  {
+   array<std::string, 1> a(10);
+   a() = std::string("a long string to avoid the small string optimisation");
+   auto b = a;
+   TEST_ASSERT(b(9) == a(0));
+   array<array<double, 1>, 1> c(3);
+   for (int i = 0; i < 3; ++i) c(i) = array<double, 1>{1, 2, 3};
+   TEST_ASSERT(c(2)(1) == 2);
+  }
+
+  // the copy of a block is exact
+  {
+   array<std::complex<double>, 1> a{1, 2, 3};
+   auto b = a;
+   assert_all_close(a, b, 1.e-15);
+  }
+
+  // without initialization of the elements : complex are not zeroed, the other types are still constructed
+  {
+   {
+    matrix<std::complex<double>> m(5, 5);
+    m() = 7;
+   }
+   matrix<std::complex<double>> m0(5, 5); // on the recycled block
+   TEST_ASSERT(max_element(abs(m0)) == 0);
+   matrix<std::complex<double>> m(5, 5, no_init), mf(make_shape(5, 5), no_init, FORTRAN_LAYOUT);
+   m() = 2;
+   mf = m;
+   TEST_ASSERT(mf(1, 1) == 2.0 && mf(0, 1) == 0.0);
+   array<std::complex<double>, 3> a(make_shape(2, 3, 4), no_init);
+   a() = 1;
+   TEST_ASSERT(sum(a) == 24.0);
+   vector<double> v(10, no_init), v3(10, 3.0);
+   v() = 1;
+   TEST_ASSERT(v(9) + v3(9) == 4);
+   array<std::string, 1> s(make_shape(3), no_init);
+   TEST_ASSERT(s(2).empty());
+  }
+
+  // from several threads
+  triqs::utility::parallel_for(1000, [](long i) {
+   vector<double> v(i % 20 + 1);
+   v() = i;
+  }, 1);
+
+  TEST_ASSERT(st::get_memory_stats().bytes_in_use == s0.bytes_in_use);
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
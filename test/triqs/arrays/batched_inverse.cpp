@@ -0,0 +1,90 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "./common.hpp"
+#include <triqs/arrays.hpp>
+
+using namespace triqs::arrays;
+using namespace triqs::clef;
+using dcomplex = std::complex<double>;
+
+// compare the batched inversion to the inversion matrix by matrix
+template <typename T> void check(int n, int dim, memory_layout<3> ml) {
+ placeholder<0> n_;
+ placeholder<1> i_;
+ placeholder<2> j_;
+ array<T, 3> A(n, dim, dim, ml);
+ A(n_, i_, j_) << 1.0 / (1 + i_ + 2 * j_ + 0.1 * n_);
+ for (int u = 0; u < n; ++u)
+  for (int i = 0; i < dim; ++i) A(u, i, i) += 2.0 + u;
+ auto B = A;
+ batched_inverse_in_place(B);
+ for (int u = 0; u < n; ++u) {
+  matrix<T> M = A(u, range(), range());
+  assert_all_close(matrix<T>(inverse(M)), make_matrix_view(B(u, range(), range())), 1.e-12);
+ }
+}
+
+int main() {
+
+ try {
+  for (int dim : {1, 2, 3, 4, 7}) {
+   check<double>(100, dim, memory_layout<3>{});
+   check<dcomplex>(100, dim, memory_layout<3>{});
+   // Fortran order matrices
+   check<dcomplex>(100, dim, make_memory_layout(0, 2, 1));
+   // matrices are not contiguous
+   check<dcomplex>(100, dim, make_memory_layout(1, 2, 0));
+  }
+
+  { // higher rank : the first indices are flattened
+   array<dcomplex, 4> A(3, 5, 4, 4);
+   placeholder<0> k_;
+   placeholder<1> n_;
+   placeholder<2> i_;
+   placeholder<3> j_;
+   A(k_, n_, i_, j_) << 0.5 / (1 + i_ + j_) + 0.1 * k_ - 0.2 * n_;
+   for (int i = 0; i < 4; ++i) A(range(), range(), i, i) += 2.0;
+   auto B = A;
+   batched_inverse_in_place(B);
+   for (int k = 0; k < 3; ++k)
+    for (int n = 0; n < 5; ++n) {
+     matrix<dcomplex> M = A(k, n, range(), range());
+     assert_all_close(matrix<dcomplex>(inverse(M)), make_matrix_view(B(k, n, range(), range())), 1.e-12);
+    }
+  }
+
+  { // singular matrices
+   for (int dim : {2, 5}) {
+    array<double, 3> A(10, dim, dim);
+    A() = 1;
+    bool caught = false;
+    try {
+     batched_inverse_in_place(A);
+    }
+    catch (triqs::runtime_error const &e) {
+     caught = true;
+    }
+    if (!caught) TRIQS_RUNTIME_ERROR << "singular matrix not detected";
+   }
+  }
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
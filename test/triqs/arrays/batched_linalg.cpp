@@ -0,0 +1,144 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "./common.hpp"
+#include <triqs/arrays.hpp>
+
+using namespace triqs::arrays;
+using dcomplex = std::complex<double>;
+
+template <typename T> T make(double x, double y);
+template <> double make<double>(double x, double) { return x; }
+template <> dcomplex make<dcomplex>(double x, double y) { return {x, y}; }
+double cc(double x) { return x; }
+dcomplex cc(dcomplex x) { return std::conj(x); }
+
+template <typename T> array<T, 3> random_stack(int n, int d0, int d1, memory_layout<3> ml, double shift = 0) {
+ array<T, 3> A(n, d0, d1, ml);
+ for (int u = 0; u < n; ++u)
+  for (int i = 0; i < d0; ++i)
+   for (int j = 0; j < d1; ++j) A(u, i, j) = make<T>(std::sin(1 + u + 3 * i + 7 * j), std::cos(2 + u * i - j)) + (i == j ? shift : 0);
+ return A;
+}
+
+template <typename T> matrix<T> mat(array<T, 3> const &A, int u) { return A(u, range(), range()); }
+
+// compare the batched operations to the same operations matrix by matrix
+template <typename T> void check(int n, int dim, memory_layout<3> ml) {
+
+ { // gemm
+  auto A = random_stack<T>(n, dim, dim + 1, ml), B = random_stack<T>(n, dim + 1, 2, ml), C = random_stack<T>(n, dim, 2, ml);
+  auto C0 = C;
+  batched_gemm(T(2), A, B, T(-0.5), C);
+  for (int u = 0; u < n; ++u) assert_all_close(mat(C, u), matrix<T>(T(2) * mat(A, u) * mat(B, u) - T(0.5) * mat(C0, u)), 1.e-12);
+  // beta = 0 on uninitialized data, into a view
+  array<T, 3> D(n, dim, 2, ml);
+  batched_gemm(T(1), A, B, T(0), D());
+  for (int u = 0; u < n; ++u) assert_all_close(mat(D, u), matrix<T>(mat(A, u) * mat(B, u)), 1.e-12);
+ }
+
+ { // gesv, with one or several right hand sides
+  auto A = random_stack<T>(n, dim, dim, ml, 3.0);
+  for (int nrhs : {1, 3}) {
+   auto B = random_stack<T>(n, dim, nrhs, ml), A1 = A, X = B;
+   batched_gesv(A1, X);
+   for (int u = 0; u < n; ++u) assert_all_close(matrix<T>(mat(A, u) * mat(X, u)), mat(B, u), 1.e-10);
+  }
+ }
+
+ { // eigenelements of hermitian matrices
+  auto A0 = random_stack<T>(n, dim, dim, ml), A = A0;
+  for (int u = 0; u < n; ++u)
+   for (int i = 0; i < dim; ++i)
+    for (int j = 0; j < dim; ++j) A(u, i, j) = A0(u, i, j) + cc(A0(u, j, i));
+  auto V = A, W = A;
+  array<double, 2> ev(n, dim), ev2(n, dim);
+  batched_eigenelements(V, ev);
+  batched_eigenvalues(W, ev2());
+  for (int u = 0; u < n; ++u) {
+   auto M = mat(A, u);
+   assert_all_close(ev(u, range()), linalg::eigenvalues(make_clone(M)), 1.e-10);
+   assert_all_close(ev2(u, range()), ev(u, range()), 1.e-10);
+   // the eigenvectors are the rows of V(u)
+   matrix<T> tV = mat(V, u).transpose();
+   matrix<T> D(dim, dim);
+   D() = 0;
+   for (int k = 0; k < dim; ++k) D(k, k) = ev(u, k);
+   assert_all_close(matrix<T>(M * tV), matrix<T>(tV * D), 1.e-10);
+  }
+ }
+}
+
+int main() {
+
+ try {
+  for (int dim : {1, 2, 3, 5}) {
+   check<double>(100, dim, memory_layout<3>{});
+   check<dcomplex>(100, dim, memory_layout<3>{});
+   // Fortran order matrices
+   check<dcomplex>(100, dim, make_memory_layout(0, 2, 1));
+   check<double>(100, dim, make_memory_layout(0, 2, 1));
+   // matrices are not contiguous
+   check<dcomplex>(100, dim, make_memory_layout(1, 2, 0));
+  }
+
+  { // higher rank, with strided views : the first indices are flattened
+   array<double, 4> A(3, 5, 8, 4), B(3, 5, 4, 4), C(3, 5, 4, 4);
+   A() = 0;
+   for (int k = 0; k < 3; ++k)
+    for (int n = 0; n < 5; ++n)
+     for (int i = 0; i < 4; ++i)
+      for (int j = 0; j < 4; ++j) {
+       A(k, n, 2 * i, j) = std::sin(1 + k + 2 * n + 3 * i + 5 * j);
+       B(k, n, i, j) = std::cos(k - n + i * j);
+      }
+   auto A4 = A(range(), range(), range(0, 8, 2), range());
+   batched_gemm(1.0, A4, B, 0.0, C);
+   for (int k = 0; k < 3; ++k)
+    for (int n = 0; n < 5; ++n) {
+     matrix<double> M = A4(k, n, range(), range()), N = B(k, n, range(), range());
+     assert_all_close(make_matrix_view(C(k, n, range(), range())), matrix<double>(M * N), 1.e-12);
+    }
+  }
+
+  { // singular matrices and dimension mismatch
+   array<double, 3> A(10, 3, 3), B(10, 3, 1), C(9, 3, 3);
+   A() = 1;
+   B() = 1;
+   bool caught = false;
+   try {
+    batched_gesv(A, B);
+   }
+   catch (triqs::runtime_error const &e) {
+    caught = true;
+   }
+   if (!caught) TRIQS_RUNTIME_ERROR << "singular matrix not detected";
+   caught = false;
+   try {
+    batched_gemm(1.0, A, A, 0.0, C);
+   }
+   catch (triqs::runtime_error const &e) {
+    caught = true;
+   }
+   if (!caught) TRIQS_RUNTIME_ERROR << "mismatch of the number of matrices not detected";
+  }
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
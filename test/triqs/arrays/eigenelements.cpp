@@ -37,6 +37,41 @@ template <typename T> void check_eig(matrix<T> M, matrix<T> vectors, array<doubl
  }
 }
 
+double make(double x, double) { return x; }
+dcomplex make(dcomplex x, double y) { return {real(x), y}; }
+double cc(double x) { return x; }
+dcomplex cc(dcomplex x) { return std::conj(x); }
+
+// compare the lapack drivers, on a larger matrix
+template <typename T> void test_algorithms(int dim, memory_layout<2> ml) {
+ matrix<T> A(dim, dim, ml);
+ for (int i = 0; i < dim; ++i)
+  for (int j = 0; j <= i; ++j) {
+   A(i, j) = make(T(std::sin(1 + i + 3 * j)), (i == j ? 0 : 0.5 * std::cos(i - 2 * j)));
+   A(j, i) = cc(A(i, j));
+  }
+ auto ev = eigenvalues(make_clone(A));
+ eigenelements_worker<T> w;
+ for (auto algo : {eigen_algorithm::qr, eigen_algorithm::divide_and_conquer, eigen_algorithm::mrrr})
+  for (int n = 0; n < 2; ++n) { // the second time, the worker reuses its workspace
+   auto B = make_clone(A);
+   auto r = w.eigenelements(B, algo);
+   assert_all_close(r.first, ev, 1.e-10);
+   for (int i = 0; i < dim; ++i) assert_all_close(A * r.second(i, range()), ev(i) * r.second(i, range()), 1.e-10);
+   B = A;
+   assert_all_close(w.eigenvalues(B, algo), ev, 1.e-10);
+  }
+
+ // a part of the spectrum
+ auto C = make_clone(A);
+ auto r = eigenelements(C, eigen_subset::by_index(0, 4));
+ assert_all_close(r.first, ev(range(0, 5)), 1.e-10);
+ for (int i = 0; i < 5; ++i) assert_all_close(A * r.second(i, range()), ev(i) * r.second(i, range()), 1.e-10);
+ C = A;
+ auto ew = eigenvalues(C, eigen_subset::in_window(ev(2) + 1.e-6, ev(dim - 3) + 1.e-6));
+ assert_all_close(ew, ev(range(3, dim - 2)), 1.e-10);
+}
+
 template <typename M> void test(M A) {
  auto w = eigenelements(make_clone(A));
  std::cerr << "A = " << A << std::endl;
@@ -97,6 +132,11 @@ int main(int argc, char **argv) {
   test(M);
  }
 
+ for (auto ml : {memory_layout<2>{}, memory_layout<2>{FORTRAN_LAYOUT}}) {
+  test_algorithms<double>(40, ml);
+  test_algorithms<dcomplex>(40, ml);
+ }
+
  return 0;
 }
 
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "./common.hpp"
+#include <triqs/arrays.hpp>
+
+using namespace triqs::arrays;
+using namespace triqs::clef;
+using dcomplex = std::complex<double>;
+
+placeholder<0> i_;
+placeholder<1> j_;
+placeholder<2> k_;
+
+// the flat loops must give the same result as foreach, which is used for the non contiguous or Fortran LHS
+template <typename T> void check(memory_layout<3> ml) {
+ array<T, 3> B(4, 5, 6), C(4, 5, 6), A(4, 5, 6, ml);
+ B(i_, j_, k_) << i_ + 0.1 * j_ - 0.3 * k_;
+ C(i_, j_, k_) << 1 + i_ * j_ + 0.2 * k_;
+
+ auto ref = [&](auto f) {
+  array<T, 3> r(4, 5, 6);
+  for (int i = 0; i < 4; ++i)
+   for (int j = 0; j < 5; ++j)
+    for (int k = 0; k < 6; ++k) r(i, j, k) = f(i, j, k);
+  return r;
+ };
+
+ A = B + 2.0 * C;
+ assert_all_close(A, ref([&](int i, int j, int k) { return B(i, j, k) + 2.0 * C(i, j, k); }), 1.e-14);
+ A = -B * C / 3.0 - C;
+ assert_all_close(A, ref([&](int i, int j, int k) { return -B(i, j, k) * C(i, j, k) / 3.0 - C(i, j, k); }), 1.e-14);
+ A += B;
+ A -= 2.0 * C;
+ A *= 2.0;
+ A /= 4.0;
+ assert_all_close(A, ref([&](int i, int j, int k) { return (-B(i, j, k) * C(i, j, k) / 3.0 - 3.0 * C(i, j, k) + B(i, j, k)) / 2.0; }),
+                  1.e-13);
+ A() = 3.0;
+ assert_all_close(A, ref([&](int i, int j, int k) { return T(3); }), 0);
+
+ // math functions
+ A = exp(B / 10.0) + abs(C) + real(conj(B));
+ assert_all_close(A, ref([&](int i, int j, int k) { return std::exp(B(i, j, k) / 10.0) + std::abs(C(i, j, k)) + std::real(conj(B(i, j, k))); }),
+                  1.e-13);
+ A = map([](T const &x) { return x * x; })(B);
+ assert_all_close(A, ref([&](int i, int j, int k) { return B(i, j, k) * B(i, j, k); }), 1.e-14);
+
+ // lhs in the rhs
+ A = B;
+ A = A + A * C;
+ assert_all_close(A, ref([&](int i, int j, int k) { return B(i, j, k) + B(i, j, k) * C(i, j, k); }), 1.e-13);
+
+ // non contiguous lhs or rhs
+ array<T, 3> D(4, 5, 12);
+ D() = 0;
+ auto V = D(range(), range(), range(0, 12, 2));
+ V = B + C;
+ assert_all_close(V, ref([&](int i, int j, int k) { return B(i, j, k) + C(i, j, k); }), 1.e-14);
+ A = V - C;
+ assert_all_close(A, B, 1.e-14);
+}
+
+int main() {
+ try {
+  check<double>(memory_layout<3>{});
+  check<dcomplex>(memory_layout<3>{});
+  check<double>(memory_layout<3>(FORTRAN_LAYOUT));
+  check<dcomplex>(make_memory_layout(1, 0, 2));
+
+  // overlapping views : the elements are computed in the order of the traversal, as foreach
+  {
+   array<double, 1> v(10), w(10);
+   v() = 1;
+   w() = 1;
+   v(range(1, 10)) = 2.0 * v(range(0, 9));
+   for (int i = 1; i < 10; ++i) w(i) = 2.0 * w(i - 1);
+   assert_all_close(v, w, 0);
+  }
+
+  // matrices : the scalar is the identity in + and -
+  {
+   matrix<double> M(3, 3), N(3, 3);
+   M(i_, j_) << i_ + 3 * j_;
+   N = M + 2.0;
+   for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j)
+     if (N(i, j) != M(i, j) + (i == j ? 2 : 0)) TRIQS_RUNTIME_ERROR << "matrix + scalar";
+   N = 2.0 * M - M;
+   assert_all_close(N, M, 0);
+   N() = 4;
+   for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j)
+     if (N(i, j) != (i == j ? 4 : 0)) TRIQS_RUNTIME_ERROR << "matrix = scalar";
+  }
+
+  // vectors
+  {
+   vector<dcomplex> a(7), b(7);
+   for (int i = 0; i < 7; ++i) a(i) = dcomplex(i, 1 - i);
+   b = 2.0 * a - a;
+   assert_all_close(b, a, 0);
+  }
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
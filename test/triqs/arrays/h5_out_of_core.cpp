@@ -0,0 +1,76 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "./common.hpp"
+#include <triqs/arrays/h5/array_out_of_core.hpp>
+#include <triqs/arrays/asserts.hpp>
+
+using namespace triqs::arrays;
+using namespace triqs;
+
+template <class T> void test(std::string filename, T init) {
+
+ const size_t N = 11, d = 2;
+ array<T, 3> A(N, d, d + 1);
+ for (int i = 0; i < N; ++i)
+  for (int j = 0; j < d; ++j)
+   for (int k = 0; k < d + 1; ++k) A(i, j, k) = double(i + 10 * j + 100 * k) * init;
+
+ // an array written by h5_write, read slice by slice
+ {
+  h5::file file(filename.c_str(), H5F_ACC_TRUNC);
+  h5_write(file, "A", A);
+  array_out_of_core<T, 3> B(file, "A", 3, 2);
+  for (int i = 0; i < N; ++i) assert_all_close(B(i), A(i, ellipsis()), 1.e-13);
+  if (B.n_chunk_reads() != 4) TRIQS_RUNTIME_ERROR << "wrong number of chunks read " << B.n_chunk_reads();
+
+  // the 2 last chunks are in the cache, the first one has been evicted
+  B(10);
+  B(7);
+  if (B.n_chunk_reads() != 4) TRIQS_RUNTIME_ERROR << "cached chunks read again";
+  B(0);
+  if (B.n_chunk_reads() != 5) TRIQS_RUNTIME_ERROR << "evicted chunk not read again";
+
+  // modified slices are written back when leaving the cache and at destruction
+  for (int i = 0; i < N; ++i) B.write(i, 2.0 * A(i, ellipsis()));
+ }
+ {
+  h5::file file(filename.c_str(), H5F_ACC_RDWR);
+  array<T, 3> C;
+  h5_read(file, "A", C);
+  assert_all_close(C, 2.0 * A, 1.e-13);
+
+  // a new chunked dataset, initialized to 0
+  array_out_of_core<T, 3> D(file, "D", A.shape(), 4, 1);
+  for (int i = 0; i < N; i += 2) D.write(i, A(i, ellipsis()));
+ }
+ h5::file file(filename.c_str(), H5F_ACC_RDONLY);
+ array<T, 3> D;
+ h5_read(file, "D", D);
+ for (int i = 0; i < N; ++i) assert_all_close(D(i, ellipsis()), (i % 2 == 0 ? 1.0 : 0.0) * A(i, ellipsis()), 1.e-13);
+}
+
+int main(int argc, char **argv) {
+ try {
+  test("out_of_core_d.h5", 1.0);
+  test("out_of_core_c.h5", std::complex<double>(1, 2));
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
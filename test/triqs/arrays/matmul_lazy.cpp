@@ -0,0 +1,146 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "./common.hpp"
+#include <triqs/arrays.hpp>
+
+using namespace triqs::arrays;
+using namespace triqs::clef;
+using dcomplex = std::complex<double>;
+
+placeholder<0> i_;
+placeholder<1> j_;
+
+template <typename T> matrix<T> prod(matrix<T> const &a, matrix<T> const &b) {
+ matrix<T> r(first_dim(a), second_dim(b));
+ r() = 0;
+ for (int i = 0; i < first_dim(a); ++i)
+  for (int j = 0; j < second_dim(b); ++j)
+   for (int k = 0; k < second_dim(a); ++k) r(i, j) += a(i, k) * b(k, j);
+ return r;
+}
+
+// a product of local matrices, returned lazily
+auto local_product(int n) {
+ matrix<double> A(n, n), B(n, n);
+ A() = 2; // 2 * identity
+ B() = 3;
+ return A * B;
+}
+
+// f must not allocate any temporary
+template <typename F> void no_alloc(F f) {
+ long n0 = storages::get_memory_stats().n_allocations;
+ f();
+ if (storages::get_memory_stats().n_allocations != n0) TRIQS_RUNTIME_ERROR << "temporaries in the assignment of a product";
+}
+
+template <typename T> void check(memory_layout<2> ml) {
+ int n = 5;
+ matrix<T> A(n, n, ml), B(n, n), C(n, n), M(n, n, ml);
+ A(i_, j_) << i_ + 2.0 * j_;
+ B(i_, j_) << 1.0 / (1 + i_ + j_);
+ C(i_, j_) << i_ - j_;
+ auto AB = prod<T>(A, B);
+
+ // gemm into the destination, no temporary
+ no_alloc([&] { M = A * B; });
+ assert_all_close(M, AB, 1.e-12);
+ no_alloc([&] { M += A * B; });
+ assert_all_close(M, 2.0 * AB, 1.e-12);
+ no_alloc([&] { M -= 2.0 * A * B; });
+ assert_all_close(M, matrix<T>(0.0 * AB), 1.e-12);
+ no_alloc([&] { M = 3.0 * (A * B) - 2.0 * C; });
+ assert_all_close(M, matrix<T>(3.0 * AB - 2.0 * C), 1.e-12);
+ no_alloc([&] { M = C + A * B / 2.0; });
+ assert_all_close(M, matrix<T>(0.5 * AB + C), 1.e-12);
+ no_alloc([&] { M = C - A * (2.0 * B); });
+ assert_all_close(M, matrix<T>(C - 2.0 * AB), 1.e-12);
+ no_alloc([&] { M += -(A * B) + C; });
+ assert_all_close(M, matrix<T>(2.0 * C - 3.0 * AB), 1.e-12);
+
+ // the lhs is an operand : computed in a temporary
+ M = A;
+ M = M * B;
+ assert_all_close(M, AB, 1.e-12);
+ M = A;
+ M = A * B + M;
+ assert_all_close(M, matrix<T>(AB + A), 1.e-12);
+ M = B;
+ M = A * M - 2.0 * C;
+ assert_all_close(M, matrix<T>(AB - 2.0 * C), 1.e-12);
+ M = A;
+ M += M * M;
+ assert_all_close(M, matrix<T>(A + prod<T>(A, A)), 1.e-10);
+
+ // the lhs is used in an expression operand
+ M = A;
+ M = (2.0 * M + C) * B;
+ assert_all_close(M, prod<T>(2.0 * A + C, B), 1.e-12);
+
+ // matrix_view as lhs
+ matrix<T> D(n + 2, n + 2);
+ D() = 0;
+ D(range(1, n + 1), range(1, n + 1)) = A * B;
+ assert_all_close(D(range(1, n + 1), range(1, n + 1)), AB, 1.e-12);
+ D(range(1, n + 1), range(1, n + 1)) += A * B;
+ assert_all_close(D(range(1, n + 1), range(1, n + 1)), matrix<T>(2.0 * AB), 1.e-12);
+
+ // lazy object
+ auto P = A * B;
+ if (std::abs(P(1, 2) - AB(1, 2)) > 1.e-12) TRIQS_RUNTIME_ERROR << "element of the product";
+ assert_all_close(matrix<T>(A * B * C), prod<T>(AB, C), 1.e-10);
+ assert_all_close(matrix<T>(P + C), matrix<T>(AB + C), 1.e-12);
+}
+
+int main() {
+ try {
+  check<double>(memory_layout<2>{});
+  check<dcomplex>(memory_layout<2>{});
+  check<double>(memory_layout<2>(FORTRAN_LAYOUT));
+  check<dcomplex>(memory_layout<2>(FORTRAN_LAYOUT));
+
+  // the lazy product outlives its operands
+  auto P = local_product(3);
+  if ((P(1, 1) != 6) || (P(1, 2) != 0)) TRIQS_RUNTIME_ERROR << "product of local matrices : " << P;
+
+  // make_regular, and sums of products (clef::sum accumulates in make_regular of the first term)
+  {
+   matrix<double> A(2, 2), B(2, 2);
+   A(i_, j_) << i_ + 1;
+   B(i_, j_) << j_ - 1;
+   matrix<double> R = make_regular(A * B);
+   assert_all_close(R, prod<double>(A, B), 1.e-14);
+   std::vector<matrix<double>> Ms = {A, B, matrix<double>(A + B)};
+   auto S = triqs::clef::sum_f_domain_impl([&](int k) { return A * Ms[k]; }, std::vector<int>{0, 1, 2});
+   static_assert(std::is_same<decltype(S), matrix<double>>::value, "sum of products is a matrix");
+   matrix<double> S_ref = prod<double>(A, A) + prod<double>(A, B) + prod<double>(A, Ms[2]);
+   assert_all_close(S, S_ref, 1.e-13);
+  }
+
+  // non square
+  matrix<double> A(2, 3), B(3, 4), M;
+  A(i_, j_) << i_ + j_;
+  B(i_, j_) << i_ - j_;
+  M = A * B;
+  assert_all_close(M, prod<double>(A, B), 1.e-14);
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
@@ -0,0 +1,120 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "./common.hpp"
+#include <triqs/arrays.hpp>
+
+using namespace triqs::arrays;
+using namespace triqs::clef;
+using dcomplex = std::complex<double>;
+
+template <typename T, int N> using smatrix = matrix<T, static_shape<N, N>>;
+
+// compare the product, inverse and determinant of static matrices to the dynamic ones
+template <typename T, int N> void check() {
+ placeholder<0> i_;
+ placeholder<1> j_;
+ smatrix<T, N> A, B;
+ A(i_, j_) << 1.0 / (1 + i_ + 2 * j_);
+ B(i_, j_) << i_ - 0.5 * j_;
+ for (int i = 0; i < N; ++i) A(i, i) += 2.0;
+ matrix<T> a = A, b = B;
+
+ assert_all_close(matrix<T>(A * B), matrix<T>(a * b), 1.e-12);
+ assert_all_close(matrix<T>(inverse(A)), matrix<T>(inverse(a)), 1.e-10);
+ if (std::abs(determinant(A) - determinant(a)) > 1.e-10 * std::abs(determinant(a))) TRIQS_RUNTIME_ERROR << "determinant, N = " << N;
+
+ // expressions
+ smatrix<T, N> C = 2.0 * A - B + 1.0;
+ assert_all_close(matrix<T>(C), matrix<T>(2.0 * a - b + 1.0), 1.e-14);
+ C += A;
+ C -= 3.0 * A;
+ C *= 2.0;
+ assert_all_close(matrix<T>(C), matrix<T>(2.0 * (1.0 - b)), 1.e-14);
+
+ // mixed static / dynamic
+ assert_all_close(matrix<T>(A * b), matrix<T>(a * b), 1.e-12);
+ matrix<T> d(N + 2, N + 2);
+ d() = 0;
+ d(range(1, N + 1), range(1, N + 1)) = A;
+ smatrix<T, N> D = d(range(1, N + 1), range(1, N + 1));
+ if (D != A) TRIQS_RUNTIME_ERROR << "assignment from a view, N = " << N;
+}
+
+template <int N> void check_all() {
+ check<double, N>();
+ check<dcomplex, N>();
+}
+
+int main() {
+ try {
+  check_all<1>();
+  check_all<2>();
+  check_all<3>();
+  check_all<4>();
+  check_all<5>();
+  check_all<8>();
+
+  // rectangular
+  matrix<double, static_shape<2, 3>> A = {{1, 2, 3}, {4, 5, 6}};
+  auto At = A.transpose();
+  matrix<double> a = A;
+  assert_all_close(matrix<double>(A * At), matrix<double>(a * a.transpose()), 1.e-14);
+
+  // size mismatch
+  bool caught = false;
+  try {
+   matrix<double, static_shape<2, 2>> B = a;
+  }
+  catch (triqs::runtime_error const &e) {
+   caught = true;
+  }
+  if (!caught) TRIQS_RUNTIME_ERROR << "size mismatch not detected";
+
+  // singular
+  caught = false;
+  try {
+   smatrix<double, 4> S;
+   S = 1.0;
+   S(3, 3) = 0;
+   inverse(S);
+  }
+  catch (triqs::runtime_error const &e) {
+   caught = true;
+  }
+  if (!caught) TRIQS_RUNTIME_ERROR << "singular matrix not detected";
+
+  // h5
+  {
+   triqs::h5::file file("static_matrix.h5", H5F_ACC_TRUNC);
+   h5_write(file, "A", A);
+  }
+  {
+   triqs::h5::file file("static_matrix.h5", H5F_ACC_RDONLY);
+   matrix<double, static_shape<2, 3>> B;
+   h5_read(file, "A", B);
+   if (A != B) TRIQS_RUNTIME_ERROR << "h5";
+   matrix<double> b;
+   h5_read(file, "A", b);
+   assert_all_close(b, a, 0);
+  }
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
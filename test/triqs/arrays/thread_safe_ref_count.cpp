@@ -0,0 +1,75 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "./common.hpp"
+#include <triqs/arrays.hpp>
+#include <triqs/utility/parallel.hpp>
+#include <vector>
+
+using namespace triqs::arrays;
+using triqs::utility::parallel_for;
+
+int main() {
+
+ try {
+  array<double, 2> A(10, 10);
+  for (int i = 0; i < 10; ++i)
+   for (int j = 0; j < 10; ++j) A(i, j) = i + 10 * j;
+  if (A.storage().is_thread_safe() != triqs::arrays::storages::thread_safe_ref_count_by_default) TRIQS_RUNTIME_ERROR << "default";
+
+  // the threads make and destroy views of A, which are counted
+  make_thread_safe(A);
+  if (!A.storage().is_thread_safe()) TRIQS_RUNTIME_ERROR << "set_thread_safe";
+  std::vector<double> sums(10000);
+  parallel_for(10000, [&](long n) {
+   array_view<double, 2> v = A;
+   auto w = v(n % 10, range());
+   std::vector<array_view<double, 1>> vs(10, w);
+   sums[n] = sum(vs[n % 7]);
+  }, 1);
+  for (long n = 0; n < 10000; ++n)
+   if (sums[n] != 10 * (n % 10) + 450) TRIQS_RUNTIME_ERROR << "sum in thread";
+  if (!A.storage().is_unique()) TRIQS_RUNTIME_ERROR << "reference count after the threads";
+
+  // the last view out deletes the block
+  array_view<double, 2> V = A;
+  {
+   array<double, 2> B = A;
+   V.rebind(B);
+  }
+  A = array<double, 2>(3, 3);
+  if (!V.storage().is_unique() || (V(2, 3) != 32)) TRIQS_RUNTIME_ERROR << "last owner";
+
+  // a weak const view does not touch the count
+  array<double, 1> C(1000);
+  for (int i = 0; i < 1000; ++i) C(i) = i;
+  auto c = make_weak_const_view(C);
+  if (!C.storage().is_unique()) TRIQS_RUNTIME_ERROR << "weak view counted";
+  std::vector<double> partial(100);
+  parallel_for(100, [&](long n) {
+   auto cc = c(range(10 * n, 10 * n + 10));
+   partial[n] = sum(cc);
+  }, 1);
+  for (long n = 0; n < 100; ++n)
+   if (partial[n] != 100 * n + 45) TRIQS_RUNTIME_ERROR << "weak view in thread";
+  if (!C.storage().is_unique()) TRIQS_RUNTIME_ERROR << "weak view counted";
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
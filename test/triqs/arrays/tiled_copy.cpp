@@ -0,0 +1,114 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "./common.hpp"
+#include <triqs/arrays.hpp>
+#include <triqs/arrays/cache.hpp>
+
+using namespace triqs::arrays;
+using dcomplex = std::complex<double>;
+
+double f(long i, long j, long k = 0, long l = 0) { return 1 + i + 1000.0 * j + 1.e6 * k + 1.e9 * l; }
+
+template <typename A> void check(A const &a, int n0, int n1, int n2) {
+ for (int i = 0; i < n0; ++i)
+  for (int j = 0; j < n1; ++j)
+   for (int k = 0; k < n2; ++k)
+    if (a(i, j, k) != f(i, j, k)) TRIQS_RUNTIME_ERROR << "tiled copy : error at " << i << " " << j << " " << k;
+}
+
+int main() {
+
+ try {
+  // C <-> Fortran matrices, with lengths which are not multiples of the block size, and some below the threshold
+  for (int n0 : {3, 37, 100, 300})
+   for (int n1 : {1, 5, 64, 257}) {
+    matrix<dcomplex> A(n0, n1), B(n0, n1, FORTRAN_LAYOUT);
+    for (int i = 0; i < n0; ++i)
+     for (int j = 0; j < n1; ++j) A(i, j) = dcomplex(f(i, j), -i);
+    B = A;
+    assert_all_close(B, A, 0);
+    matrix<dcomplex> C(n1, n0);
+    C = A.transpose();
+    for (int i = 0; i < n0; ++i)
+     for (int j = 0; j < n1; ++j)
+      if (C(j, i) != A(i, j)) TRIQS_RUNTIME_ERROR << "transpose " << n0 << " " << n1;
+    // compound operations
+    C += A.transpose();
+    C *= 0.5;
+    C -= B.transpose();
+    if (max_element(abs(C)) != 0) TRIQS_RUNTIME_ERROR << "compound ops";
+   }
+
+  // rank 3, all the permutations of the memory layout, large enough to be threaded
+  int n0 = 45, n1 = 33, n2 = 70;
+  array<double, 3> A(n0, n1, n2);
+  for (int i = 0; i < n0; ++i)
+   for (int j = 0; j < n1; ++j)
+    for (int k = 0; k < n2; ++k) A(i, j, k) = f(i, j, k);
+  for (auto ml : {make_memory_layout(0, 1, 2), make_memory_layout(0, 2, 1), make_memory_layout(1, 0, 2), make_memory_layout(1, 2, 0),
+                  make_memory_layout(2, 0, 1), make_memory_layout(2, 1, 0)}) {
+   array<double, 3> B(A, ml);
+   check(B, n0, n1, n2);
+   array<double, 3> C(n0, n1, n2);
+   C = B;
+   check(C, n0, n1, n2);
+   // into a strided view
+   array<double, 3> D(n0, 2 * n1, n2, ml);
+   D() = -1;
+   auto V = D(range(), range(0, 2 * n1, 2), range());
+   V = A;
+   check(V, n0, n1, n2);
+   if (D(3, 1, 5) != -1) TRIQS_RUNTIME_ERROR << "strided view";
+   // the copies made by the caches, and back
+   auto c = make_const_cache(A, ml);
+   check(c.view(), n0, n1, n2);
+   {
+    auto c2 = make_cache(C, ml);
+    c2.view() *= 2;
+   }
+   C /= 2;
+   check(C, n0, n1, n2);
+  }
+
+  // rank 4 transposed view : index u of E is index perm[u] of F
+  array<double, 4> E(20, 7, 9, 40);
+  for (int i = 0; i < 20; ++i)
+   for (int j = 0; j < 7; ++j)
+    for (int k = 0; k < 9; ++k)
+     for (int l = 0; l < 40; ++l) E(i, j, k, l) = f(i, j, k, l);
+  array<double, 4> F = transposed_view(E, 3, 1, 0, 2);
+  for (int i = 0; i < 20; ++i)
+   for (int j = 0; j < 7; ++j)
+    for (int k = 0; k < 9; ++k)
+     for (int l = 0; l < 40; ++l)
+      if (F(k, j, l, i) != E(i, j, k, l)) TRIQS_RUNTIME_ERROR << "rank 4 transposed view";
+
+  // aliasing : in place symmetrization is still done element by element
+  matrix<double> S(50, 50);
+  for (int i = 0; i < 50; ++i)
+   for (int j = 0; j < 50; ++j) S(i, j) = (i <= j ? f(i, j) : 0);
+  S(range(), range()) += S.transpose();
+  for (int i = 0; i < 50; ++i)
+   for (int j = 0; j < 50; ++j)
+    if (S(i, j) != S(j, i)) TRIQS_RUNTIME_ERROR << "aliasing";
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
@@ -0,0 +1,108 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "./common.hpp"
+using namespace triqs::gfs;
+using namespace triqs::arrays;
+using triqs::clef::placeholder;
+
+using mat_t = matrix<dcomplex>;
+using mp_t = gf_mesh<imfreq>::mesh_point_t;
+
+// compare the data of g to f(w), point by point, and the tail to t
+template <typename G, typename F> void check(G const &g, F const &f, tail_const_view t, std::string mess) {
+ for (auto const &w : g.mesh()) assert_equal_array(mat_t(g[w]), mat_t(f(w)), mess);
+ assert_equal(t.order_max(), g.singularity().order_max(), mess + " : tail order_max");
+ for (int n = t.order_min(); n <= t.order_max(); ++n) assert_equal_array(g.singularity()(n), t(n), mess + " : tail");
+}
+
+int main() {
+ try {
+  double beta = 10;
+  placeholder<0> w_;
+  auto g1 = gf<imfreq>{{beta, Fermion, 200}, {2, 2}};
+  auto g2 = g1, g3 = g1;
+  matrix<double> e = {{0.5, 0.1}, {0.1, -0.5}};
+  g1(w_) << 1 / (w_ - e(0, 0));
+  g2(w_) << w_ - 2.0 * e;
+  g3(w_) << 1 / (w_ + 1) + 0.5 * e;
+  // copies of the points, to compute the expected results with plain matrices
+  auto m = [](gf<imfreq> const &g) {
+   return [&g](mp_t const &w) { return mat_t(g[w]); };
+  };
+  auto m1 = m(g1), m2 = m(g2), m3 = m(g3);
+  auto t1 = g1.singularity(), t2 = g2.singularity(), t3 = g3.singularity();
+
+  // products evaluated on the whole mesh (batched gemm)
+  gf<imfreq> g = g1 * g2;
+  check(g, [&](mp_t const &w) { return mat_t(m1(w) * m2(w)); }, t1 * t2, "g1 * g2");
+  g = 2.0 * g1 * g2 + g3;
+  check(g, [&](mp_t const &w) { return mat_t(2.0 * m1(w) * m2(w) + m3(w)); }, 2.0 * t1 * t2 + t3, "2 g1 g2 + g3");
+  g() = g3 - g1 * g2 / 4.0;
+  check(g, [&](mp_t const &w) { return mat_t(m3(w) - m1(w) * m2(w) / 4.0); }, t3 - t1 * t2 / 4.0, "g3 - g1 g2 /4 in a view");
+  g() = g1 * g2 * (-1.0) - g;
+  check(g, [&](mp_t const &w) { return mat_t(-m1(w) * m2(w) - m3(w) + m1(w) * m2(w) / 4.0); }, dcomplex(-1) * (t1 * t2) - t3 + t1 * t2 / 4.0,
+        "C = -1 * g1 g2 - C");
+
+  // aliasing : the destination is an operand of the product, point by point evaluation
+  g = g1;
+  g = g * g2 + g3;
+  check(g, [&](mp_t const &w) { return mat_t(m1(w) * m2(w) + m3(w)); }, t1 * t2 + t3, "g = g g2 + g3");
+
+  // in place operators
+  g = g1;
+  g *= g2;
+  check(g, [&](mp_t const &w) { return mat_t(m1(w) * m2(w)); }, t1 * t2, "g *= g2");
+  g += g3;
+  check(g, [&](mp_t const &w) { return mat_t(m1(w) * m2(w) + m3(w)); }, t1 * t2 + t3, "g += g3");
+  g() -= g1 * g2;
+  tail tg = t1 * t2 + t3 - t1 * t2;
+  check(g, m3, tg, "g -= g1 * g2");
+  g *= g;
+  check(g, [&](mp_t const &w) { return mat_t(m3(w) * m3(w)); }, tg * tg, "g *= g");
+  g = g3;
+  g += 2;
+  check(g, [&](mp_t const &w) { return mat_t(m3(w) + 2); }, t3 + 2, "g += 2");
+  g() *= dcomplex(0, 3);
+  check(g, [&](mp_t const &w) { return mat_t(dcomplex(0, 3) * (m3(w) + 2)); }, dcomplex(0, 3) * (t3 + 2), "g *= 3i");
+  g /= 3.0;
+  g -= 2.0 * g3;
+  check(g, [&](mp_t const &w) { return mat_t(dcomplex(0, 1) * (m3(w) + 2) - 2.0 * m3(w)); }, dcomplex(0, 1) * (t3 + 2) - 2.0 * t3,
+        "g /= 3, g -= 2 g3");
+
+  // tails, in place
+  tail t = t1;
+  t += t2;
+  t -= t3;
+  t *= t2;
+  t *= dcomplex(2, 1);
+  t *= mat_t(e);
+  t += mat_t(e);
+  tail t_ref = ((t1 + t2 - t3) * t2 * dcomplex(2, 1)) * mat_t(e) + mat_t(e);
+  for (int n = t_ref.order_min(); n <= t_ref.order_max(); ++n) assert_equal_array(t(n), t_ref(n), "tail in place");
+  assert_equal(t.order_max(), t_ref.order_max(), "tail in place : order_max");
+  t = t3;
+  t *= t;
+  t_ref = t3 * t3;
+  for (int n = t_ref.order_min(); n <= t_ref.order_max(); ++n) assert_equal_array(t(n), t_ref(n), "tail t *= t");
+  assert_equal(t.order_max(), t_ref.order_max(), "tail t *= t : order_max");
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
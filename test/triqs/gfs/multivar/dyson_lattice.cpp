@@ -0,0 +1,111 @@
+#define TRIQS_ARRAYS_ENFORCE_BOUNDCHECK
+#include <triqs/gfs.hpp>
+#include <triqs/gfs/bz.hpp>
+#include <triqs/gfs/m_tail.hpp>
+#include <triqs/gfs/dyson.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs::clef;
+using namespace triqs::arrays;
+using namespace triqs::lattice;
+
+template <typename T1, typename T2> void assert_close(T1 const &x, T2 const &y, std::string mess) {
+ if (std::abs(x - y) > 1.e-12) TRIQS_RUNTIME_ERROR << mess << " : " << x << " " << y;
+}
+
+// compare the batched Dyson equation and k-sum to the clef expressions
+int main() {
+ try {
+  double beta = 5, mu = 0.2;
+  int n_bz = 20;
+  auto bz = brillouin_zone{bravais_lattice{make_unit_matrix<double>(2)}};
+
+  placeholder<0> k_;
+
+  for (int dim : {1, 2, 4}) {
+
+   auto t_hop = matrix<dcomplex>(dim, dim);
+   auto s_loc = matrix<dcomplex>(dim, dim);
+   for (int i = 0; i < dim; ++i)
+    for (int j = 0; j < dim; ++j) {
+     t_hop(i, j) = (i == j ? 1.0 : 0.2 / (1 + i + j));
+     s_loc(i, j) = (i == j ? 0.5 : 0.1);
+    }
+
+   auto eps_k = gf<brillouin_zone>{{bz, n_bz}, {dim, dim}};
+   eps_k(k_) << -2 * (cos(k_(0)) + cos(k_(1))) * t_hop;
+
+   auto sigma = gf<imfreq>{{beta, Fermion, 50}, {dim, dim}};
+   std::vector<dcomplex> z;
+   for (auto const &w : sigma.mesh()) {
+    sigma[w] = s_loc / (dcomplex(w) + 1);
+    z.push_back(dcomplex(w) + mu);
+   }
+   sigma.singularity() = s_loc * inverse(tail_omega(sigma.singularity()) + 1);
+   int n_k = eps_k.mesh().size(), n_w = z.size();
+
+   // G(k, iw)
+   auto G = gf<cartesian_product<brillouin_zone, imfreq>, matrix_valued, m_tail<brillouin_zone>>{{{bz, n_bz}, {beta, Fermion, 50}},
+                                                                                                  {dim, dim}};
+   lattice_dyson(G, eps_k, sigma, mu);
+
+   auto dyson_matrix = [&](int k, int n) {
+    matrix<dcomplex> m = -eps_k.data()(k, range(), range()) - sigma.data()(n, range(), range());
+    for (int i = 0; i < dim; ++i) m(i, i) += z[n];
+    return m;
+   };
+
+   for (int k = 0; k < n_k; ++k)
+    for (int n = 0; n < n_w; ++n) {
+     matrix<dcomplex> a = G.data()(k, n, range(), range()), b = inverse(dyson_matrix(k, n));
+     for (int i = 0; i < dim; ++i)
+      for (int j = 0; j < dim; ++j) assert_close(a(i, j), b(i, j), "lattice_dyson");
+    }
+   auto gt = G.singularity();
+   for (int k = 0; k < n_k; ++k) {
+    auto t = gt.get_from_linear_index(k);
+    matrix<dcomplex> e = eps_k.data()(k, range(), range());
+    for (int i = 0; i < dim; ++i) {
+     assert_close(t(1)(i, i), 1.0, "tail of order 1");
+     for (int j = 0; j < dim; ++j) assert_close(t(2)(i, j), e(i, j) - (i == j ? mu : 0.0), "tail of order 2");
+    }
+   }
+
+   // Local G : sum over k
+   auto G_loc = sum_k_dyson(eps_k, sigma, mu);
+   for (int n = 0; n < n_w; ++n) {
+    matrix<dcomplex> s = matrix<dcomplex>(dim, dim);
+    s() = 0;
+    for (int k = 0; k < n_k; ++k) s += inverse(dyson_matrix(k, n));
+    for (int i = 0; i < dim; ++i)
+     for (int j = 0; j < dim; ++j) assert_close(G_loc.data()(n, i, j), s(i, j) / double(n_k), "sum_k_dyson");
+   }
+   // sum_k_dyson does not depend on the number of threads (test run with OMP_NUM_THREADS > 1).
+   auto G_loc2 = sum_k_dyson(eps_k, sigma, mu);
+   if (max_element(abs(G_loc.data() - G_loc2.data())) != 0) TRIQS_RUNTIME_ERROR << "sum_k_dyson is not deterministic";
+   for (int i = 0; i < dim; ++i) assert_close(G_loc.singularity()(1)(i, i), 1.0, "local tail of order 1");
+
+   // inversion of the data of G(k, iw)
+   _gf_invert_data_in_place(G.data());
+   for (int k = 0; k < n_k; ++k)
+    for (int n = 0; n < n_w; ++n) {
+     matrix<dcomplex> a = G.data()(k, n, range(), range()), b = dyson_matrix(k, n);
+     for (int i = 0; i < dim; ++i)
+      for (int j = 0; j < dim; ++j) assert_close(a(i, j), b(i, j), "invert G(k, iw)");
+    }
+  }
+
+  // eps on a k grid of the same size, but not the same : 16 points of a chain, 4 x 4 for G
+  {
+   auto eps_chain = gf<brillouin_zone>{{brillouin_zone{bravais_lattice{make_unit_matrix<double>(1)}}, 16}, {1, 1}};
+   auto sigma = gf<imfreq>{{beta, Fermion, 50}, {1, 1}};
+   auto G = gf<cartesian_product<brillouin_zone, imfreq>, matrix_valued, m_tail<brillouin_zone>>{{{bz, 4}, {beta, Fermion, 50}}, {1, 1}};
+   bool thrown = false;
+   try {
+    lattice_dyson(G, eps_chain, sigma, mu);
+   } catch (triqs::runtime_error const &) { thrown = true; }
+   if (!thrown) TRIQS_RUNTIME_ERROR << "lattice_dyson : the k meshes do not match";
+  }
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
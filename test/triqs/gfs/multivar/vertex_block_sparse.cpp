@@ -0,0 +1,116 @@
+#define TRIQS_ARRAYS_ENFORCE_BOUNDCHECK
+#include <triqs/gfs.hpp>
+
+using namespace triqs;
+using namespace triqs::gfs;
+using namespace triqs::arrays;
+namespace h5 = triqs::h5;
+
+void assert_close(dcomplex x, dcomplex y, std::string mess) {
+ if (std::abs(x - y) > 1.e-12) TRIQS_RUNTIME_ERROR << mess << " : " << x << " " << y;
+}
+
+// a vertex with spin conservation, stored as a block sparse gf, compared to the dense one
+int main(int argc, char *argv[]) {
+
+ mpi::environment env(argc, argv);
+ mpi::communicator world;
+
+ try {
+  double beta = 10;
+  int n_w = 4, n_orb = 2;
+  auto m = gf_mesh<imfreq>{beta, Fermion, n_w};
+
+  // indices are (orbital, spin) -> 2 * orb + spin. The spin is conserved.
+  auto spin = [](int a) { return a % 2; };
+  auto conserved = [&](mini_vector<int, 4> const &i) { return spin(i[0]) + spin(i[1]) == spin(i[2]) + spin(i[3]); };
+  int n = 2 * n_orb;
+  auto p = make_block_sparse_pattern(mini_vector<int, 4>{n, n, n, n}, conserved);
+  if (p.size() != 6 * n_orb * n_orb * n_orb * n_orb) TRIQS_RUNTIME_ERROR << "wrong size of the pattern " << p.size();
+
+  using vertex_t = gf<cartesian_product<imfreq, imfreq, imfreq>, block_sparse_valued<4>>;
+  using dense_vertex_t = gf<cartesian_product<imfreq, imfreq, imfreq>, tensor_valued<4>>;
+
+  auto V = vertex_t{{m, m, m}, p};
+  auto Vd = dense_vertex_t{{m, m, m}, {n, n, n, n}};
+
+  auto value = [&](dcomplex w0, dcomplex w1, dcomplex w2, mini_vector<int, 4> const &i) {
+   return conserved(i) ? w0 + 2.3 * w1 + 3.1 * w2 + double(i[0] + 10 * i[1] + 100 * i[2] + 1000 * i[3]) : 0;
+  };
+  for (auto const &x : V.mesh()) {
+   auto v = V[x];
+   auto vd = Vd[x];
+   auto w = x.components_tuple();
+   dcomplex w0 = std::get<0>(w), w1 = std::get<1>(w), w2 = std::get<2>(w);
+   for (auto const &i : p.non_zeros()) v(i[0], i[1], i[2], i[3]) = value(w0, w1, w2, i);
+   for (int a = 0; a < n; ++a)
+    for (int b = 0; b < n; ++b)
+     for (int c = 0; c < n; ++c)
+      for (int d = 0; d < n; ++d) vd(a, b, c, d) = value(w0, w1, w2, {a, b, c, d});
+  }
+
+  // compare to the dense version, including the structural zeros
+  auto check = [&](vertex_t const &v, dense_vertex_t const &vd, std::string mess) {
+   for (auto const &x : v.mesh())
+    for (int a = 0; a < n; ++a)
+     for (int b = 0; b < n; ++b)
+      for (int c = 0; c < n; ++c)
+       for (int d = 0; d < n; ++d) assert_close(v[x](a, b, c, d), vd[x](a, b, c, d), mess);
+  };
+  check(V, Vd, "filling");
+
+  // one cannot write a structural zero
+  bool caught = false;
+  try {
+   V[{0, 0, 0}](0, 0, 0, 1) = 1;
+  }
+  catch (triqs::runtime_error const &e) {
+   caught = true;
+  }
+  if (!caught) TRIQS_RUNTIME_ERROR << "writing a structural zero is not detected";
+
+  // arithmetic
+  vertex_t V2 = 2.0 * V - V / 2.0;
+  dense_vertex_t Vd2 = 2.0 * Vd - Vd / 2.0;
+  check(V2, Vd2, "arithmetic");
+  V2 += V;
+  check(V2, Vd2 + Vd, "+=");
+
+  // views
+  auto v2 = V2();
+  v2 = V;
+  check(V2, Vd, "view assignment");
+
+  // a different pattern
+  auto V3 = vertex_t{{m, m, m}, make_block_sparse_pattern(mini_vector<int, 4>{n, n, n, n}, [](mini_vector<int, 4> const &) { return true; })};
+  caught = false;
+  try {
+   V3 = V + V3;
+  }
+  catch (triqs::runtime_error const &e) {
+   caught = true;
+  }
+  if (!caught) TRIQS_RUNTIME_ERROR << "different patterns are not detected";
+
+  // hdf5
+  if (world.rank() == 0) {
+   {
+    h5::file file("vertex_block_sparse.h5", H5F_ACC_TRUNC);
+    h5_write(file, "V", V);
+   }
+   h5::file file("vertex_block_sparse.h5", H5F_ACC_RDONLY);
+   auto V4 = vertex_t{};
+   h5_read(file, "V", V4);
+   if (get_pattern(V4) != p) TRIQS_RUNTIME_ERROR << "h5 : wrong pattern";
+   check(V4, Vd, "h5");
+  }
+
+  // mpi
+  auto V5 = V;
+  mpi::all_reduce_in_place(V5, world);
+  check(V5, world.size() * Vd, "mpi::all_reduce_in_place");
+  V5 = mpi::reduce(V, world);
+  if (world.rank() == 0) check(V5, world.size() * Vd, "mpi::reduce");
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
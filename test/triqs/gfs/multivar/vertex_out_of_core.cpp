@@ -0,0 +1,71 @@
+#define TRIQS_ARRAYS_ENFORCE_BOUNDCHECK
+#include <triqs/gfs.hpp>
+
+using namespace triqs;
+using namespace triqs::gfs;
+using namespace triqs::arrays;
+namespace h5 = triqs::h5;
+
+// a vertex stored in a file, and read one bosonic frequency at a time
+int main() {
+ try {
+  double beta = 10;
+  int n_w = 3, n = 2;
+  auto m_b = gf_mesh<imfreq>{beta, Boson, n_w};
+  auto m_f = gf_mesh<imfreq>{beta, Fermion, n_w};
+
+  using vertex_t = gf<cartesian_product<imfreq, imfreq, imfreq>, tensor_valued<4>>;
+  using vertex_ooc_t = gf_out_of_core<cartesian_product<imfreq, imfreq, imfreq>, tensor_valued<4>>;
+
+  auto V = vertex_t{{m_b, m_f, m_f}, {n, n, n, n}};
+  for (auto const &x : V.mesh()) {
+   auto w = x.components_tuple();
+   dcomplex W = std::get<0>(w), w1 = std::get<1>(w), w2 = std::get<2>(w);
+   for (int a = 0; a < n; ++a)
+    for (int b = 0; b < n; ++b)
+     for (int c = 0; c < n; ++c)
+      for (int d = 0; d < n; ++d) V[x](a, b, c, d) = W + 2.3 * w1 + 3.1 * w2 + double(a + 10 * b + 100 * c + 1000 * d);
+  }
+  long n_W = m_b.size();
+
+  {
+   h5::file file("vertex_out_of_core.h5", H5F_ACC_TRUNC);
+   h5_write(file, "V", V);
+
+   // write it slice by slice in a new gf
+   auto V2 = vertex_ooc_t{file, "V2", V.mesh(), {n, n, n, n}, 2, 2};
+   for (long i = 0; i < n_W; ++i) {
+    auto g = V2.slice(i);
+    g.data() = V.data()(i, ellipsis());
+    V2.set_slice(i, g);
+   }
+  }
+
+  h5::file file("vertex_out_of_core.h5", H5F_ACC_RDONLY);
+
+  // read as a whole
+  auto V3 = vertex_t{};
+  h5_read(file, "V2", V3);
+  if (max_element(abs(V3.data() - V.data())) > 1.e-12) TRIQS_RUNTIME_ERROR << "set_slice";
+
+  // read slice by slice, with 2 chunks of one frequency in memory
+  auto V4 = vertex_ooc_t{file, "V", 1, 2};
+  if (!(V4.mesh() == V.mesh())) TRIQS_RUNTIME_ERROR << "wrong mesh";
+  for (long i = 0; i < n_W; ++i) {
+   auto g = V4.slice(i);
+   if (max_element(abs(g.data() - V.data()(i, ellipsis()))) > 1.e-12) TRIQS_RUNTIME_ERROR << "slice " << i;
+  }
+  if (V4.n_chunk_reads() != n_W) TRIQS_RUNTIME_ERROR << "wrong number of reads " << V4.n_chunk_reads();
+  V4.slice(n_W - 2);
+  if (V4.n_chunk_reads() != n_W) TRIQS_RUNTIME_ERROR << "a cached slice is read again";
+  V4.slice(0);
+  if (V4.n_chunk_reads() != n_W + 1) TRIQS_RUNTIME_ERROR << "an evicted slice is not read again";
+
+  // the slice is a gf on the fermionic frequencies
+  auto g = V4.slice(1);
+  auto W = std::get<0>(V.mesh().components())[1];
+  auto w = std::get<1>(V.mesh().components())[2];
+  if (std::abs(g(w, w)(1, 0, 1, 1) - V(W, w, w)(1, 0, 1, 1)) > 1.e-12) TRIQS_RUNTIME_ERROR << "evaluation of the slice";
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
@@ -0,0 +1,127 @@
+#define TRIQS_ARRAYS_ENFORCE_BOUNDCHECK
+#include <triqs/gfs.hpp>
+#include <triqs/gfs/local/functions.hpp>
+#include <triqs/gfs/bz.hpp>
+using namespace triqs::gfs;
+using namespace triqs::arrays;
+using triqs::clef::placeholder;
+
+template <typename T> void assert_equal(T const& x, T const& y, std::string mess = "") {
+ if (std::abs(x - y) > 1.e-13) TRIQS_RUNTIME_ERROR << mess << " " << x << " " << y;
+}
+
+// f() must give exactly the same result with 1 thread and with several threads
+template <typename F> void check_same_on_1_and_n_threads(F f, std::string mess) {
+#ifdef TRIQS_WITH_OPENMP
+ int n = omp_get_max_threads();
+ omp_set_num_threads(1);
+ auto r1 = f();
+ omp_set_num_threads(std::max(n, 4));
+ auto rn = f();
+ omp_set_num_threads(n);
+#else
+ auto r1 = f();
+ auto rn = f();
+#endif
+ if (!(r1 == rn)) TRIQS_RUNTIME_ERROR << mess << " : the result depends on the number of threads";
+}
+
+// m.begin() + k is the point reached after k increments
+template <typename M> void check_advance(M const& m, std::string mess) {
+ long N = m.size();
+ for (long k : {0l, 1l, 7l, N / 2, N - 1}) {
+  auto it = m.begin();
+  for (long i = 0; i < k; ++i) ++it;
+  auto it2 = m.begin() + k;
+  if (!(it2->linear_index() == it->linear_index())) TRIQS_RUNTIME_ERROR << mess << " : begin() + " << k;
+ }
+ auto it = m.begin() + 3;
+ it += N - 3;
+ if (!(it == m.end())) TRIQS_RUNTIME_ERROR << mess << " : end";
+}
+
+// The loops over the mesh must give the same result whether they are run serially or with threads.
+int main() {
+ try {
+  double beta = 10, mu = 0.3;
+  placeholder<0> w_;
+  placeholder<1> t_;
+
+  // clef assignment on a large mesh
+  auto G = gf<imfreq>{{beta, Fermion, 5000}, {2, 2}};
+  matrix<double> eps = {{0.5, 0.1}, {0.1, -0.5}};
+  G(w_) << 1 / (w_ + mu - eps(0, 0));
+  for (auto const& w : G.mesh()) assert_equal(G[w](1, 1), dcomplex(1 / (dcomplex(w) + mu - 0.5)), "clef assignment");
+
+  // assignment of a gf expression
+  auto G2 = gf<imfreq>{{beta, Fermion, 5000}, {2, 2}};
+  G2(w_) << 1 / (w_ - 2);
+  gf<imfreq> G3 = G + 2 * G2;
+  for (auto const& w : G.mesh()) assert_equal(G3[w](0, 1), dcomplex(G[w](0, 1) + 2.0 * G2[w](0, 1)), "gf expression");
+
+  // same in a view
+  G3() = G2 - G;
+  for (auto const& w : G.mesh()) assert_equal(G3[w](1, 0), dcomplex(G2[w](1, 0) - G[w](1, 0)), "gf expression in a view");
+
+  // product mesh
+  auto g2 = gf<cartesian_product<imfreq, imtime>, scalar_valued>{{{beta, Fermion, 100}, {beta, Boson, 201}}};
+  g2(w_, t_) << exp(-t_) / (w_ + mu);
+  for (auto const& p : g2.mesh()) {
+   dcomplex w = std::get<0>(p.components_tuple());
+   double t = std::get<1>(p.components_tuple());
+   assert_equal(g2[p], std::exp(-t) / (w + mu), "product mesh");
+  }
+
+  // deterministic reduction : compare to the serial sum
+  auto r = parallel_reduce(G.mesh(), dcomplex(0), [&G](gf_mesh<imfreq>::mesh_point_t const& w, dcomplex& acc) { acc += G[w](0, 0); });
+  dcomplex s = 0;
+  for (auto const& w : G.mesh()) s += G[w](0, 0);
+  assert_equal(r, s, "reduction");
+  auto r2 = parallel_reduce(G.mesh(), dcomplex(0), [&G](gf_mesh<imfreq>::mesh_point_t const& w, dcomplex& acc) { acc += G[w](0, 0); });
+  if (r != r2) TRIQS_RUNTIME_ERROR << "reduction is not deterministic";
+
+  // ... and independent of the number of threads
+  check_same_on_1_and_n_threads([&G]() {
+   return parallel_reduce(G.mesh(), dcomplex(0), [&G](gf_mesh<imfreq>::mesh_point_t const& w, dcomplex& acc) { acc += G[w](0, 0); });
+  }, "mesh reduction");
+  check_same_on_1_and_n_threads([]() {
+   return triqs::utility::parallel_reduce(100000, 0.0, [](long first, long last, double& acc) {
+    for (long i = first; i < last; ++i) acc += 1 / (1.0 + i);
+   });
+  }, "reduction");
+  check_same_on_1_and_n_threads([&]() {
+   gf<imfreq> g = G + 2 * G2;
+   g(w_) << g(w_) / (w_ + 1);
+   return g.data();
+  }, "gf expression");
+  check_same_on_1_and_n_threads([&]() {
+   auto g = gf<cartesian_product<imfreq, imtime>, scalar_valued>{{{beta, Fermion, 100}, {beta, Boson, 201}}};
+   g(w_, t_) << exp(-t_) / (w_ + mu);
+   return g.data();
+  }, "product mesh");
+
+  // jumping in the meshes, as the threads do
+  check_advance(G.mesh(), "imfreq");
+  check_advance(gf_mesh<imtime>{beta, Fermion, 101}, "imtime");
+  check_advance(g2.mesh(), "product mesh");
+  auto bz = triqs::lattice::brillouin_zone{triqs::lattice::bravais_lattice{make_unit_matrix<double>(2)}};
+  check_advance(gf_mesh<cartesian_product<brillouin_zone, imfreq>>{{bz, 6}, {beta, Fermion, 10}}, "bz x imfreq");
+
+  // density
+  G(w_) << 1 / (w_ + mu);
+  if (std::abs(density(G)(0, 0) - 1 / (1 + std::exp(-beta * mu))) > 1.e-6) TRIQS_RUNTIME_ERROR << "density";
+
+  // exceptions in the loop are transmitted
+  bool caught = false;
+  try {
+   triqs::utility::parallel_for(1000, [](long i) {
+    if (i == 500) TRIQS_RUNTIME_ERROR << "error in loop";
+   });
+  }
+  catch (triqs::runtime_error const& e) {
+   caught = true;
+  }
+  if (!caught) TRIQS_RUNTIME_ERROR << "exception lost";
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
@@ -0,0 +1,77 @@
+#define TRIQS_ARRAYS_ENFORCE_BOUNDCHECK
+#include <triqs/gfs.hpp>
+#include <triqs/lattice/sumk.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs::arrays;
+using namespace triqs::lattice;
+
+void assert_close(dcomplex x, dcomplex y, std::string mess) {
+ if (std::abs(x - y) > 1.e-12) TRIQS_RUNTIME_ERROR << mess << " : " << x << " " << y;
+}
+
+// Compare the lattice sums to a simple loop on k
+int main(int argc, char *argv[]) {
+ triqs::mpi::environment env(argc, argv);
+ try {
+  double beta = 10, mu = 0.3;
+  int n_bz = 40; // more k points than in one chunk
+  int nb = 2;
+
+  // two bands on the square lattice
+  auto bl = bravais_lattice{make_unit_matrix<double>(2), std::vector<r_t>{r_t{0.0, 0.0, 0.0}, r_t{0.5, 0.5, 0.0}}};
+  matrix<dcomplex> t1 = matrix<double>{{1.0, 0.2}, {0.2, -0.5}}, t2 = matrix<double>{{0.3, 0.0}, {0.0, 0.1}};
+  auto tb = tight_binding{bl, std::vector<std::vector<long>>{{1, 0}, {-1, 0}, {0, 1}, {0, -1}}, std::vector<matrix<dcomplex>>{t1, t1, t2, t2}};
+
+  int n_k = n_bz * n_bz;
+  array<double, 2> k_points(n_k, 2);
+  array<double, 1> weights(n_k);
+  array<dcomplex, 3> eps_k(n_k, nb, nb);
+  for (int i = 0; i < n_bz; ++i)
+   for (int j = 0; j < n_bz; ++j) {
+    int n = i * n_bz + j;
+    k_points(n, 0) = double(i) / n_bz;
+    k_points(n, 1) = double(j) / n_bz;
+    weights(n) = (1 + 0.5 * std::cos(n)) / n_k;
+    double cx = std::cos(2 * M_PI * k_points(n, 0)), cy = std::cos(2 * M_PI * k_points(n, 1));
+    eps_k(n, range(), range()) = 2 * cx * t1 + 2 * cy * t2;
+   }
+  double sum_w = sum(weights);
+
+  auto sigma = gf<imfreq>{{beta, Fermion, 100}, {nb, nb}};
+  matrix<dcomplex> s_loc = matrix<double>{{0.4, 0.1}, {0.1, 0.2}};
+  for (auto const &w : sigma.mesh()) sigma[w] = s_loc / (dcomplex(w) + 2);
+  sigma.singularity() = s_loc * inverse(tail_omega(sigma.singularity()) + 2);
+
+  auto G1 = sumk(tb, k_points, weights, sigma, mu);
+  auto G2 = sumk(eps_k, weights, sigma, mu);
+
+  for (auto const &w : sigma.mesh()) {
+   matrix<dcomplex> g = matrix<dcomplex>(nb, nb);
+   g() = 0;
+   for (int n = 0; n < n_k; ++n) {
+    matrix<dcomplex> m = eps_k(n, range(), range());
+    m = -m - sigma[w];
+    for (int a = 0; a < nb; ++a) m(a, a) += dcomplex(w) + mu;
+    g += weights(n) * matrix<dcomplex>(inverse(m));
+   }
+   for (int a = 0; a < nb; ++a)
+    for (int b = 0; b < nb; ++b) {
+     assert_close(G1[w](a, b), g(a, b), "sumk with tight_binding");
+     assert_close(G2[w](a, b), g(a, b), "sumk with eps_k");
+    }
+  }
+  for (int a = 0; a < nb; ++a) {
+   assert_close(G1.singularity()(1)(a, a), sum_w, "tail of order 1");
+   for (int b = 0; b < nb; ++b) assert_close(G1.singularity()(2)(a, b), G2.singularity()(2)(a, b), "tail of order 2");
+  }
+
+  // no k point
+  bool thrown = false;
+  try {
+   sumk(array<dcomplex, 3>(0, nb, nb), array<double, 1>(0), sigma, mu);
+  } catch (triqs::runtime_error const &) { thrown = true; }
+  if (!thrown) TRIQS_RUNTIME_ERROR << "sumk without k point";
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
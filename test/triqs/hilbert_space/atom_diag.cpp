@@ -0,0 +1,138 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include <triqs/utility/first_include.hpp>
+#include <triqs/hilbert_space/atom_diag.hpp>
+
+using namespace triqs::hilbert_space;
+using namespace triqs::arrays;
+using triqs::utility::c;
+using triqs::utility::c_dag;
+using triqs::utility::n;
+using op_t = triqs::utility::many_body_operator<double>;
+
+void check_close(double x, double y, std::string mess) {
+ if (std::abs(x - y) > 1.e-10) TRIQS_RUNTIME_ERROR << mess << " : " << x << " != " << y;
+}
+
+// The operator as a dense matrix on the full space
+matrix<double> full_matrix(op_t const& op, fundamental_operator_set const& fops, hilbert_space const& hs) {
+ imperative_operator<hilbert_space, double, false> O(op, fops);
+ O.compile(hs);
+ matrix<double> m(hs.size(), hs.size());
+ m() = 0;
+ O.foreach_matrix_element(hs, [&m](long i, long j, double v) { m(j, i) += v; });
+ return m;
+}
+
+int main() {
+ try {
+  // 3 sites Hubbard ring, with a field on the first site
+  int n_sites = 3;
+  double U = 2, t = 1, mu = 0.7, beta = 3;
+  fundamental_operator_set fops;
+  for (int s = 0; s < n_sites; ++s) {
+   fops.insert("up", s);
+   fops.insert("dn", s);
+  }
+  op_t h = 0.2 * (n("up", 0) - n("dn", 0));
+  for (int s = 0; s < n_sites; ++s) {
+   h += U * n("up", s) * n("dn", s) - mu * (n("up", s) + n("dn", s));
+   for (std::string sp : {"up", "dn"}) h += -t * (c_dag(sp, s) * c(sp, (s + 1) % n_sites) + c_dag(sp, (s + 1) % n_sites) * c(sp, s));
+  }
+  atom_diag<double> ad(h, fops);
+
+  // the blocks : H is block diagonal, the eigenvectors are orthonormal
+  hilbert_space hs(fops);
+  int dim = hs.size(), total_dim = 0;
+  for (int b = 0; b < ad.n_blocks(); ++b) {
+   auto const& es = ad.get_eigensystem(b);
+   total_dim += ad.get_block_dim(b);
+   auto u = es.unitary_matrix;
+   matrix<double> id = u.transpose() * u;
+   for (int k = 0; k < ad.get_block_dim(b); ++k)
+    for (int l = 0; l < ad.get_block_dim(b); ++l) check_close(id(k, l), (k == l ? 1 : 0), "orthonormal eigenvectors");
+  }
+  if (total_dim != dim) TRIQS_RUNTIME_ERROR << "dimension of the blocks";
+  if (ad.n_blocks() < 16) TRIQS_RUNTIME_ERROR << "N_up, N_dn should give 16 blocks at least";
+
+  // the energies, to the full diagonalization
+  auto H = full_matrix(h, fops, hs);
+  auto eig = linalg::eigenelements(make_clone(H)); // eigenvectors in rows
+  std::vector<double> energies;
+  for (auto const& es : ad.get_eigensystems()) energies.insert(energies.end(), es.energies.begin(), es.energies.end());
+  std::sort(energies.begin(), energies.end());
+  for (int k = 0; k < dim; ++k) check_close(energies[k], eig.first(k), "energy");
+  check_close(ad.get_gs_energy(), eig.first(0), "ground state energy");
+
+  // Z and the thermal averages
+  double E0 = eig.first(0), z = 0;
+  for (int k = 0; k < dim; ++k) z += std::exp(-beta * (eig.first(k) - E0));
+  check_close(ad.partition_function(beta), z, "Z");
+  auto thermal_average = [&](op_t const& op) {
+   auto O = full_matrix(op, fops, hs);
+   double r = 0;
+   for (int k = 0; k < dim; ++k) {
+    auto v = eig.second(k, range());
+    r += std::exp(-beta * (eig.first(k) - E0)) * dot(v, O * v);
+   }
+   return r / z;
+  };
+  auto n_up0 = ad.get_op_mat(n("up", 0));
+  auto double_occ = ad.get_op_mat(n("up", 1) * n("dn", 1));
+  check_close(ad.thermal_trace({&n_up0}, beta), thermal_average(n("up", 0)), "<n_up0>");
+  check_close(ad.thermal_trace({&double_occ}, beta), thermal_average(n("up", 1) * n("dn", 1)), "<n_up1 n_dn1>");
+  check_close(ad.thermal_trace({}, beta), 1, "<1>");
+
+  // C, C^+ in the eigenbasis
+  for (auto const& x : fops) {
+   auto const& C = ad.c_matrix(x.linear_index);
+   auto const& Cd = ad.c_dag_matrix(x.linear_index);
+   auto nx = op_t::make_canonical(true, x.index) * op_t::make_canonical(false, x.index);
+   check_close(ad.thermal_trace({&Cd, &C}, beta), thermal_average(nx), "<c^+ c>");
+   check_close(ad.thermal_trace({&Cd, &C}, beta) + ad.thermal_trace({&C, &Cd}, beta), 1, "anticommutator");
+   check_close(ad.thermal_trace({&C}, beta), 0, "<c>");
+  }
+  auto const& Cd0 = ad.c_dag_matrix(0);
+  auto const& C1 = ad.c_matrix(1);
+  if (fops[{"dn", 0}] != 0 || fops[{"dn", 1}] != 1) TRIQS_RUNTIME_ERROR << "order of the fops";
+  check_close(ad.thermal_trace({&Cd0, &C1}, beta), thermal_average(c_dag("dn", 0) * c("dn", 1)), "<c^+_0 c_1>");
+
+  // energy truncation : the cutoff 0 keeps the ground states
+  check_close(ad.partition_function(beta, 100), z, "Z, large cutoff");
+  int n_gs = 0;
+  for (int k = 0; k < dim; ++k) n_gs += (eig.first(k) - E0 < 1.e-10);
+  check_close(ad.partition_function(beta, 1.e-10), n_gs, "Z, ground states");
+  double n_gs_avg = 0;
+  for (int k = 0; k < n_gs; ++k) {
+   auto v = eig.second(k, range());
+   n_gs_avg += dot(v, full_matrix(n("up", 0), fops, hs) * v) / n_gs;
+  }
+  check_close(ad.thermal_trace({&n_up0}, beta, 1.e-10), n_gs_avg, "<n_up0>, ground states");
+
+  // an operator which connects a block to several blocks
+  bool thrown = false;
+  try {
+   ad.get_op_mat(c("up", 0) + c_dag("up", 0));
+  } catch (triqs::runtime_error const&) { thrown = true; }
+  if (!thrown) TRIQS_RUNTIME_ERROR << "c + c^+ is not block sparse";
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
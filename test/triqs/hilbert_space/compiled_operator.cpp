@@ -0,0 +1,121 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "../arrays/common.hpp"
+#include <triqs/hilbert_space/imperative_operator.hpp>
+
+using namespace triqs::hilbert_space;
+using namespace triqs::arrays;
+using triqs::utility::c;
+using triqs::utility::c_dag;
+using triqs::utility::n;
+
+int main() {
+ try {
+  // Hubbard ring of 5 sites
+  int n_sites = 5;
+  fundamental_operator_set fops;
+  for (int i = 0; i < n_sites; ++i) {
+   fops.insert("up", i);
+   fops.insert("down", i);
+  }
+  triqs::utility::many_body_operator<double> h;
+  for (std::string s : {"up", "down"})
+   for (int i = 0; i < n_sites; ++i) {
+    int j = (i + 1) % n_sites;
+    h += -1.0 * (c_dag(s, i) * c(s, j) + c_dag(s, j) * c(s, i)) + 0.1 * (i + 1) * n(s, i);
+   }
+  for (int i = 0; i < n_sites; ++i) h += 2.0 * n("up", i) * n("down", i);
+
+  // full space : compiled vs direct action
+  {
+   using state_t = state<hilbert_space, double, false>;
+   hilbert_space hs(fops);
+   auto H = imperative_operator<hilbert_space>(h, fops);
+   auto Hc = H;
+   Hc.compile(hs);
+   if (!Hc.is_compiled(hs) || H.is_compiled(hs)) TRIQS_RUNTIME_ERROR << "is_compiled";
+   if (Hc.n_nonzeros(hs) == 0) TRIQS_RUNTIME_ERROR << "n_nonzeros";
+   state_t psi(hs);
+   for (int i = 0; i < hs.size(); ++i) psi(i) = std::cos(0.3 * i);
+   assert_all_close(Hc(psi).amplitudes(), H(psi).amplitudes(), 1.e-13);
+
+   // the coefficients are not compiled in
+   H.update_coeffs([](double &x) { x *= 2; });
+   Hc.update_coeffs([](double &x) { x *= 2; });
+   assert_all_close(Hc(psi).amplitudes(), H(psi).amplitudes(), 1.e-13);
+
+   // several states at once, in both memory layouts
+   int k = 3;
+   matrix<double> X(hs.size(), k), XF(hs.size(), k, FORTRAN_LAYOUT);
+   for (int i = 0; i < hs.size(); ++i)
+    for (int j = 0; j < k; ++j) X(i, j) = std::sin(i + 0.7 * j);
+   XF = X;
+   auto Y = Hc.apply_to_columns(hs, X), YF = Hc.apply_to_columns(hs, XF);
+   for (int j = 0; j < k; ++j) {
+    state_t x(hs);
+    x.amplitudes() = X(range(), j);
+    assert_all_close(Y(range(), j), H(x).amplitudes(), 1.e-13);
+   }
+   assert_all_close(YF, Y, 0);
+
+   // the compiled form follows the basis, not the address of the space
+   hilbert_space hs_copy = hs;
+   if (!Hc.is_compiled(hs_copy)) TRIQS_RUNTIME_ERROR << "copy of the space";
+   hs = hilbert_space(fops); // a new space at the same address
+   if (Hc.is_compiled(hs)) TRIQS_RUNTIME_ERROR << "compiled form of a previous space at the same address";
+  }
+
+  // blocks of given particle number, and c^+_up,0 which maps block N to block N+1
+  {
+   using state_t = state<sub_hilbert_space, double, false>;
+   hilbert_space full(fops);
+   int n_orb = fops.size();
+   std::vector<sub_hilbert_space> blocks;
+   for (int N = 0; N <= n_orb; ++N) blocks.emplace_back(N);
+   for (int i = 0; i < full.size(); ++i) {
+    auto f = full.get_fock_state(i);
+    blocks[popcount(f)].add_fock_state(f);
+   }
+   std::vector<int> hmap(n_orb + 1);
+   for (int N = 0; N <= n_orb; ++N) hmap[N] = (N < n_orb ? N + 1 : -1);
+   auto cdag = c_dag("up", 0) + 0.5 * c_dag("down", 3) * n("up", 1);
+   auto op = imperative_operator<sub_hilbert_space, double, true>(cdag, fops, hmap, &blocks);
+   auto opc = op;
+   opc.compile();
+   for (auto const &b : blocks) {
+    state_t psi(b);
+    for (int i = 0; i < b.size(); ++i) psi(i) = 1.0 / (1 + i);
+    auto r = opc(psi), r_ref = op(psi);
+    if (hmap[b.get_index()] == -1) {
+     if (!r.amplitudes().is_empty() || !r_ref.amplitudes().is_empty()) TRIQS_RUNTIME_ERROR << "block mapped to nothing";
+     continue;
+    }
+    if (&r.get_hilbert() != &blocks[hmap[b.get_index()]]) TRIQS_RUNTIME_ERROR << "target block";
+    assert_all_close(r.amplitudes(), r_ref.amplitudes(), 1.e-14);
+   }
+   sub_hilbert_space b2 = blocks[2];
+   if (!opc.is_compiled(b2)) TRIQS_RUNTIME_ERROR << "copy of a block";
+   b2.add_fock_state(0);
+   if (opc.is_compiled(b2)) TRIQS_RUNTIME_ERROR << "compiled form of a modified block";
+  }
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include <triqs/utility/first_include.hpp>
+#include <triqs/hilbert_space/hilbert_space.hpp>
+#include <triqs/utility/parallel.hpp>
+#include <algorithm>
+#include <random>
+
+using namespace triqs::hilbert_space;
+using strategy_t = fock_index::strategy_t;
+
+// all the states of the space are found at their position, the others are not found
+void check(sub_hilbert_space const &hs, strategy_t strategy, int n_orb, std::string mess) {
+ if (hs.get_fock_index().get_strategy() != strategy) TRIQS_RUNTIME_ERROR << mess << " : strategy";
+ for (int i = 0; i < hs.size(); ++i)
+  if (hs.get_state_index(hs.get_fock_state(i)) != i) TRIQS_RUNTIME_ERROR << mess << " : index of state " << i;
+ int n_found = 0;
+ for (uint64_t f = 0; f < (uint64_t(1) << n_orb); ++f)
+  if (hs.has_state(f)) {
+   ++n_found;
+   if (hs.get_fock_state(hs.get_state_index(f)) != f) TRIQS_RUNTIME_ERROR << mess << " : state " << f;
+  } else if (hs.get_state_index(f) != -1)
+   TRIQS_RUNTIME_ERROR << mess << " : state " << f << " should not be found";
+ if (n_found != hs.size()) TRIQS_RUNTIME_ERROR << mess << " : number of states";
+}
+
+int main() {
+ try {
+  int n_orb = 12; // orbitals (up,i) = 2i and (down,i) = 2i+1
+  uint64_t up = 0;
+  for (int i = 0; i < n_orb; i += 2) up |= uint64_t(1) << i;
+  auto pop = [](uint64_t f) { return __builtin_popcountll(f); };
+
+  // blocks of given number of particles
+  for (int N : {0, 1, 5, 12}) {
+   sub_hilbert_space hs(N);
+   for (uint64_t f = 0; f < (1 << n_orb); ++f)
+    if (pop(f) == N) hs.add_fock_state(f);
+   check(hs, strategy_t::combinadic, n_orb, "N = " + std::to_string(N));
+  }
+
+  // blocks of given numbers of up and down particles, in the reverse order, with the orbital 2 always occupied
+  {
+   sub_hilbert_space hs(0);
+   for (uint64_t f = (1 << n_orb) - 1; f != uint64_t(-1); --f)
+    if ((pop(f & up) == 3) && (pop(f & ~up) == 2) && (f & 4)) hs.add_fock_state(f);
+   check(hs, strategy_t::combinadic, n_orb, "N_up, N_down");
+   // the copy shares the index
+   auto hs2 = hs;
+   check(hs2, strategy_t::combinadic, n_orb, "copy");
+   // the index is rebuilt when the basis changes
+   hs2.add_fock_state(1);
+   check(hs2, strategy_t::perfect_hash, n_orb, "add a state");
+   check(hs, strategy_t::combinadic, n_orb, "original");
+  }
+
+  // a random subset, looked up from several threads
+  {
+   std::mt19937 gen(12);
+   sub_hilbert_space hs(0);
+   for (uint64_t f = 0; f < (1 << n_orb); ++f)
+    if (gen() % 3 == 0) hs.add_fock_state(f);
+   std::vector<int> found(hs.size());
+   triqs::utility::parallel_for(hs.size(), [&](long i) { found[i] = hs.get_state_index(hs.get_fock_state(i)); }, 1);
+   for (int i = 0; i < hs.size(); ++i)
+    if (found[i] != i) TRIQS_RUNTIME_ERROR << "parallel lookup";
+   check(hs, strategy_t::perfect_hash, n_orb, "random");
+  }
+
+  // a duplicated state keeps its first position
+  {
+   sub_hilbert_space hs(0);
+   for (uint64_t f : {3, 5, 3, 9}) hs.add_fock_state(f);
+   if ((hs.get_state_index(3) != 0) || (hs.get_state_index(9) != 3)) TRIQS_RUNTIME_ERROR << "duplicate";
+  }
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
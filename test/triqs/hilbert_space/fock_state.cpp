@@ -0,0 +1,116 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include <triqs/utility/first_include.hpp>
+#include <triqs/hilbert_space/imperative_operator.hpp>
+#include <bitset>
+#include <random>
+
+using namespace triqs::hilbert_space;
+using triqs::utility::c;
+using triqs::utility::c_dag;
+
+using bits4 = fock_bitset<4>;
+using ref_t = std::bitset<256>;
+
+bool same(bits4 const &x, ref_t const &r) {
+ for (int i = 0; i < 256; ++i)
+  if (test_bit(x, i) != r[i]) return false;
+ return true;
+}
+
+int main() {
+ try {
+  // fock_bitset against std::bitset
+  std::mt19937_64 gen(3);
+  for (int trial = 0; trial < 100; ++trial) {
+   bits4 x, y;
+   ref_t rx, ry;
+   for (int i = 0; i < 256; ++i) {
+    if (gen() % 3 == 0) x |= bits4(1) << i, rx.set(i);
+    if (gen() % 5 == 0) y |= bits4(1) << i, ry.set(i);
+   }
+   if (!same(x & y, rx & ry) || !same(x | y, rx | ry) || !same(x ^ ~y, rx ^ ~ry)) TRIQS_RUNTIME_ERROR << "bit operations";
+   int n = gen() % 256;
+   if (!same(x << n, rx << n) || !same(x >> n, rx >> n)) TRIQS_RUNTIME_ERROR << "shift by " << n;
+   if ((popcount(x) != rx.count()) || (parity(x) != rx.count() % 2)) TRIQS_RUNTIME_ERROR << "popcount";
+   if (popcount_below(x, n) != (rx << (256 - n)).count() - (n == 0 ? rx.count() : 0)) TRIQS_RUNTIME_ERROR << "popcount_below " << n;
+   auto z = clear_lowest_bit(x);
+   ref_t rz = rx;
+   rz.reset(lowest_bit(x));
+   if (!rx[lowest_bit(x)] || (popcount_below(x, lowest_bit(x)) != 0) || !same(z, rz)) TRIQS_RUNTIME_ERROR << "lowest bit";
+   if (((x < y) == (y < x)) != (x == y)) TRIQS_RUNTIME_ERROR << "order";
+  }
+
+  // fermionic sign beyond 16 orbitals : c^+_20 c_0 |0, 17> = - |17, 20>
+  {
+   fundamental_operator_set fops;
+   for (int i = 0; i < 21; ++i) fops.insert(i);
+   hilbert_space hs(fops);
+   state<hilbert_space, double, true> st(hs);
+   st(hs.get_state_index((fock_state_t(1) << 17) | fock_state_t(1))) = 1;
+   auto r = imperative_operator<hilbert_space>(c_dag(20) * c(0), fops)(st);
+   if (r(hs.get_state_index((fock_state_t(1) << 17) | (fock_state_t(1) << 20))) != -1) TRIQS_RUNTIME_ERROR << "sign with 21 orbitals";
+  }
+
+  // more than 64 orbitals, if the Fock states are large enough (cmake option HILBERT_SPACE_MAX_ORBITALS)
+  {
+   int n_orb = 100;
+   fundamental_operator_set fops;
+   for (int i = 0; i < n_orb; ++i) fops.insert(i);
+   triqs::utility::many_body_operator<double> h;
+   for (int i = 0; i < n_orb - 1; ++i) h += -1.0 * (c_dag(i + 1) * c(i) + c_dag(i) * c(i + 1));
+   if (fock_state_n_bits < n_orb) {
+    bool raised = false;
+    try {
+     imperative_operator<sub_hilbert_space, double, true>(h, fops, {0}, nullptr);
+    }
+    catch (triqs::runtime_error const &) {
+     raised = true;
+    }
+    if (!raised) TRIQS_RUNTIME_ERROR << "too many orbitals should raise";
+    return 0;
+   }
+   // the block of 2 particles
+   std::vector<sub_hilbert_space> blocks(1, sub_hilbert_space(0));
+   for (int i = 0; i < n_orb; ++i)
+    for (int j = i + 1; j < n_orb; ++j) blocks[0].add_fock_state((fock_state_t(1) << i) | (fock_state_t(1) << j));
+   if (blocks[0].get_fock_index().get_strategy() != fock_index::strategy_t::combinadic) TRIQS_RUNTIME_ERROR << "combinadic";
+   auto H = imperative_operator<sub_hilbert_space, double, true>(h, fops, {0}, &blocks);
+   state<sub_hilbert_space, double, false> psi(blocks[0]);
+   for (int i = 0; i < psi.size(); ++i) psi(i) = std::cos(i);
+   auto r = H(psi);
+   auto idx = [&](int i, int j) { return blocks[0].get_state_index((fock_state_t(1) << i) | (fock_state_t(1) << j)); };
+   if (std::abs(r(idx(0, 70)) + psi(idx(1, 70)) + psi(idx(0, 69)) + psi(idx(0, 71))) > 1.e-14) TRIQS_RUNTIME_ERROR << "hopping";
+   // c^+_99 c_0 |0, 70> = - |70, 99>
+   auto op = imperative_operator<sub_hilbert_space, double, true>(c_dag(99) * c(0), fops, {0}, &blocks);
+   psi.amplitudes()() = 0;
+   psi(idx(0, 70)) = 1;
+   if (op(psi)(idx(70, 99)) != -1) TRIQS_RUNTIME_ERROR << "sign with 100 orbitals";
+   psi = state<sub_hilbert_space, double, false>(blocks[0]);
+   for (int i = 0; i < psi.size(); ++i) psi(i) = std::cos(i);
+   H.compile();
+   auto rc = H(psi);
+   for (int i = 0; i < psi.size(); ++i)
+    if (std::abs(rc(i) - r(i)) > 1.e-14) TRIQS_RUNTIME_ERROR << "compiled";
+  }
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
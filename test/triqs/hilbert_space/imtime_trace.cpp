@@ -0,0 +1,140 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include <triqs/utility/first_include.hpp>
+#include <triqs/hilbert_space/imtime_trace.hpp>
+#include <map>
+
+using namespace triqs::hilbert_space;
+using namespace triqs::arrays;
+using triqs::utility::c;
+using triqs::utility::c_dag;
+using triqs::utility::n;
+using op_t = triqs::utility::many_body_operator<double>;
+
+// The operator as a dense matrix on the full space
+matrix<double> full_matrix(op_t const& op, fundamental_operator_set const& fops, hilbert_space const& hs) {
+ imperative_operator<hilbert_space, double, false> O(op, fops);
+ O.compile(hs);
+ matrix<double> m(hs.size(), hs.size());
+ m() = 0;
+ O.foreach_matrix_element(hs, [&m](long i, long j, double v) { m(j, i) += v; });
+ return m;
+}
+
+int main() {
+ try {
+  // Hubbard dimer
+  double U = 3, t = 0.8, mu = 1.2, beta = 4;
+  fundamental_operator_set fops;
+  for (int s = 0; s < 2; ++s) {
+   fops.insert("up", s);
+   fops.insert("dn", s);
+  }
+  op_t h = 0.3 * n("up", 0);
+  for (int s = 0; s < 2; ++s) h += U * n("up", s) * n("dn", s) - mu * (n("up", s) + n("dn", s));
+  for (std::string sp : {"up", "dn"}) h += -t * (c_dag(sp, 0) * c(sp, 1) + c_dag(sp, 1) * c(sp, 0));
+  atom_diag<double> ad(h, fops);
+
+  // the reference : dense matrices on the full space, exp(-tau (H - E0)) = V^T exp(-tau (E - E0)) V
+  hilbert_space hs(fops);
+  int dim = hs.size();
+  auto eig = linalg::eigenelements(make_clone(full_matrix(h, fops, hs))); // eigenvectors in rows
+  matrix<double> V = eig.second;
+  auto evolution = [&](double tau) {
+   matrix<double> D(dim, dim);
+   D() = 0;
+   for (int k = 0; k < dim; ++k) D(k, k) = std::exp(-tau * (eig.first(k) - eig.first(0)));
+   return matrix<double>(V.transpose() * D * V);
+  };
+  std::vector<matrix<double>> c_full, c_dag_full;
+  for (auto const& x : fops) {
+   c_full.push_back(full_matrix(op_t::make_canonical(false, x.index), fops, hs));
+   c_dag_full.push_back(full_matrix(op_t::make_canonical(true, x.index), fops, hs));
+  }
+
+  imtime_trace<double> tr(ad, beta);
+  std::map<double, std::pair<int, bool>> ops; // tau -> (operator, dagger)
+  auto check = [&](std::string mess) {
+   matrix<double> P = evolution(0);
+   double tau_prev = 0;
+   for (auto const& x : ops) {
+    auto const& O = (x.second.second ? c_dag_full : c_full)[x.second.first];
+    P = matrix<double>(O * evolution(x.first - tau_prev) * P);
+    tau_prev = x.first;
+   }
+   P = matrix<double>(evolution(beta - tau_prev) * P);
+   double ref = trace(P);
+   if (std::abs(tr.trace() - ref) > 1.e-10 * std::max(1.0, std::abs(ref)))
+    TRIQS_RUNTIME_ERROR << mess << " : trace " << tr.trace() << " != " << ref;
+   if (tr.size() != int(ops.size())) TRIQS_RUNTIME_ERROR << mess << " : size";
+  };
+  auto insert = [&](double tau, int a, bool dagger) {
+   tr.insert(tau, dagger ? ad.c_dag_matrix(a) : ad.c_matrix(a));
+   ops[tau] = {a, dagger};
+  };
+  auto remove = [&](double tau) {
+   tr.remove(tau);
+   ops.erase(tau);
+  };
+
+  // no operator : Z
+  check("empty");
+  if (std::abs(tr.trace() - ad.partition_function(beta)) > 1.e-10) TRIQS_RUNTIME_ERROR << "Z";
+
+  // insertions and removals of pairs c^+(tau) c(tau'), as in a Monte Carlo
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> uni(0, beta);
+  std::vector<std::pair<double, double>> pairs;
+  for (int step = 0; step < 60; ++step) {
+   if ((step % 3 == 2) && !pairs.empty()) {
+    int k = rng() % pairs.size();
+    remove(pairs[k].first);
+    remove(pairs[k].second);
+    pairs.erase(pairs.begin() + k);
+    check("remove at step " + std::to_string(step));
+   } else {
+    int a = rng() % fops.size();
+    double t1 = uni(rng), t2 = uni(rng);
+    insert(t1, a, true);
+    insert(t2, a, false);
+    pairs.push_back({t1, t2});
+    check("insert at step " + std::to_string(step));
+   }
+  }
+  if (ops.size() < 20) TRIQS_RUNTIME_ERROR << "the test should go to higher orders";
+
+  // a single operator changes the number of particles : 0
+  tr.clear();
+  ops.clear();
+  insert(1.0, 0, true);
+  check("c^+");
+  if (tr.trace() != 0) TRIQS_RUNTIME_ERROR << "<c^+>";
+
+  // no two operators at the same time
+  bool thrown = false;
+  try {
+   tr.insert(1.0, ad.c_matrix(0));
+  } catch (triqs::runtime_error const&) { thrown = true; }
+  if (!thrown) TRIQS_RUNTIME_ERROR << "two operators at the same tau";
+  check("after the failed insertion");
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
@@ -0,0 +1,112 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "../arrays/common.hpp"
+#include <triqs/hilbert_space/imperative_operator.hpp>
+#include <triqs/hilbert_space/lanczos.hpp>
+#include <triqs/arrays/linalg/eigenelements.hpp>
+
+using namespace triqs::hilbert_space;
+using namespace triqs::arrays;
+using triqs::utility::c;
+using triqs::utility::c_dag;
+using triqs::utility::n;
+
+using state_t = state<hilbert_space, double, false>;
+
+int main() {
+ try {
+  // Hubbard ring of 5 sites (dimension 1024 : H|psi> is computed in parallel), with a site dependent potential
+  int n_sites = 5;
+  fundamental_operator_set fops;
+  for (int i = 0; i < n_sites; ++i) {
+   fops.insert("up", i);
+   fops.insert("down", i);
+  }
+  triqs::utility::many_body_operator<double> h;
+  for (std::string s : {"up", "down"})
+   for (int i = 0; i < n_sites; ++i) {
+    int j = (i + 1) % n_sites;
+    h += -1.0 * (c_dag(s, i) * c(s, j) + c_dag(s, j) * c(s, i)) + 0.1 * (i + 1) * n(s, i);
+   }
+  for (int i = 0; i < n_sites; ++i) h += 2.0 * n("up", i) * n("down", i);
+
+  hilbert_space hs(fops);
+  auto H = imperative_operator<hilbert_space>(h, fops);
+  int dim = hs.size();
+
+  // the dense matrix, column by column
+  matrix<double> M(dim, dim);
+  state_t e(hs);
+  for (int i = 0; i < dim; ++i) {
+   e.amplitudes()() = 0;
+   e(i) = 1;
+   M(range(), i) = H(e).amplitudes();
+  }
+  assert_all_close(M, matrix<double>(M.transpose()), 1.e-14);
+  auto ev = linalg::eigenvalues(make_clone(M));
+
+  state_t psi0(hs);
+  for (int i = 0; i < dim; ++i) psi0(i) = 1.0 / (1 + i);
+
+  // H|psi> computed in parallel is the matrix product
+  assert_all_close(H(psi0).amplitudes(), vector<double>(M * psi0.amplitudes()), 1.e-13);
+
+  // the lowest eigenpairs, with restarts
+  for (bool reorth : {true, false})
+   for (int period : {1, 5, 7}) {
+    lanczos_parameters p;
+    p.n_eigen = 3;
+    p.krylov_dim = 30;
+    p.full_reorthogonalization = reorth;
+    p.check_period = period;
+    auto res = lanczos(H, psi0, p);
+    for (int k = 0; k < p.n_eigen; ++k) {
+     if (std::abs(res.eigenvalues[k] - ev(k)) > 1.e-9) TRIQS_RUNTIME_ERROR << "eigenvalue " << k << " : " << res.eigenvalues[k] << " vs " << ev(k);
+     auto const &x = res.eigenvectors[k];
+     auto r = H(x) - x * res.eigenvalues[k];
+     if (std::sqrt(dot_product(r, r)) > 1.e-8) TRIQS_RUNTIME_ERROR << "residue of the eigenvector " << k;
+    }
+   }
+
+  // exp(-tau H) psi, compared to the dense computation
+  auto eig = linalg::eigenelements(make_clone(M)); // eigenvectors in rows
+  for (double tau : {0.1, 1.0, 5.0}) {
+   lanczos_parameters p;
+   p.krylov_dim = 15;
+   auto x = krylov_exp(H, psi0, tau, p);
+   vector<double> c = eig.second * psi0.amplitudes();
+   for (int k = 0; k < dim; ++k) c(k) *= std::exp(-tau * eig.first(k));
+   vector<double> expected = eig.second.transpose() * c;
+   assert_all_close(x.amplitudes(), expected, 1.e-8 * max_element(abs(expected)));
+  }
+
+  // an unreachable tolerance is reported, not silently ignored
+  bool thrown = false;
+  try {
+   lanczos_parameters p;
+   p.krylov_dim = 2;
+   p.tolerance = 1.e-30;
+   krylov_exp(H, psi0, 1.0, p);
+  } catch (triqs::runtime_error const &) { thrown = true; }
+  if (!thrown) TRIQS_RUNTIME_ERROR << "krylov_exp : no convergence";
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
@@ -0,0 +1,119 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include <triqs/utility/first_include.hpp>
+#include <triqs/hilbert_space/quadratic_diag.hpp>
+#include <triqs/hilbert_space/atom_diag.hpp>
+
+using namespace triqs::hilbert_space;
+using triqs::utility::c;
+using triqs::utility::c_dag;
+using triqs::utility::n;
+using op_t = triqs::utility::many_body_operator<double>;
+using state_t = state<hilbert_space, double, false>;
+
+void check_close(double x, double y, std::string mess) {
+ if (std::abs(x - y) > 1.e-10) TRIQS_RUNTIME_ERROR << mess << " : " << x << " != " << y;
+}
+
+int main() {
+ try {
+  // a 4 sites ring, with spin, a field, and a bath like orbital (n_sites) hybridized to site 0
+  int n_sites = 4;
+  fundamental_operator_set fops;
+  for (std::string sp : {"up", "dn"}) {
+   for (int s = 0; s < n_sites; ++s) fops.insert(sp, s);
+   fops.insert(sp, n_sites);
+  }
+  op_t h0(1.5);
+  for (std::string sp : {"up", "dn"}) {
+   for (int s = 0; s < n_sites; ++s) {
+    h0 += -0.3 * n(sp, s) + (sp == "up" ? 0.1 : -0.1) * s * n(sp, s);
+    h0 += -1.0 * (c_dag(sp, s) * c(sp, (s + 1) % n_sites) + c_dag(sp, (s + 1) % n_sites) * c(sp, s));
+   }
+   h0 += 0.7 * n(sp, n_sites) + 0.4 * (c_dag(sp, 0) * c(sp, n_sites) + c_dag(sp, n_sites) * c(sp, 0));
+  }
+
+  // the one body part
+  op_t interaction = 2.0 * n("up", 0) * n("dn", 0) + 0.5 * c_dag("up", 1) * c_dag("dn", 1);
+  auto d = extract_one_body(h0 + interaction, fops);
+  check_close(d.constant, 1.5, "constant");
+  if (!(d.rest - interaction).is_zero()) TRIQS_RUNTIME_ERROR << "rest : " << d.rest;
+  check_close(d.h(fops[{"up", n_sites}], fops[{"up", 0}]), 0.4, "h");
+  check_close(d.h(fops[{"dn", 2}], fops[{"dn", 2}]), -0.5, "h");
+  bool thrown = false;
+  try {
+   quadratic_diag<double> qd(h0 + interaction, fops);
+  } catch (triqs::runtime_error const&) { thrown = true; }
+  if (!thrown) TRIQS_RUNTIME_ERROR << "H is not quadratic";
+
+  // the energies : to the block diagonalization in the Fock space
+  quadratic_diag<double> qd(h0, fops);
+  atom_diag<double> ad(h0, fops);
+  auto E = qd.fock_energies();
+  std::vector<double> E_ad;
+  for (auto const& es : ad.get_eigensystems()) E_ad.insert(E_ad.end(), es.energies.begin(), es.energies.end());
+  auto E_sorted = E;
+  std::sort(E_sorted.begin(), E_sorted.end());
+  std::sort(E_ad.begin(), E_ad.end());
+  if (E_sorted.size() != E_ad.size()) TRIQS_RUNTIME_ERROR << "number of states";
+  for (int k = 0; k < E_ad.size(); ++k) check_close(E_sorted[k], E_ad[k], "energy");
+  for (uint64_t s = 0; s < E.size(); s += 37) check_close(E[s], qd.energy(s), "energy of an occupation");
+  check_close(qd.get_gs_energy(), ad.get_gs_energy(), "ground state energy");
+  for (double beta : {0.5, 10.0}) check_close(qd.partition_function(beta), ad.partition_function(beta), "Z");
+
+  // the Slater determinants are normalized eigenstates of H
+  hilbert_space hs(fops);
+  imperative_operator<hilbert_space, double, false> H(h0, fops);
+  std::vector<uint64_t> occupations = {0, 1, 6, qd.get_gs_occupation(), 0x5a, 0x3ff};
+  std::vector<state_t> slater;
+  for (auto occ : occupations) {
+   auto st = qd.slater_state(hs, occ);
+   check_close(dot_product(st, st), 1, "norm");
+   auto Hst = H(st);
+   auto r = Hst - qd.energy(occ) * st;
+   check_close(dot_product(r, r), 0, "eigenstate");
+   slater.push_back(st);
+  }
+  check_close(dot_product(slater[1], slater[2]), 0, "orthogonality");
+
+  // the matrix elements of C, C^+ from the single particle orbitals
+  std::vector<std::pair<uint64_t, uint64_t>> pairs = {{1, 0}, {3, 1}, {0x7, 0x3}, {0x7, 0x6}, {0x5b, 0x5a}, {0x5a, 0x5a}, {0x7, 0x1}};
+  for (auto const& p : pairs) {
+   auto st_to = qd.slater_state(hs, p.first), st_from = qd.slater_state(hs, p.second);
+   for (auto const& x : fops) {
+    imperative_operator<hilbert_space, double, false> Cd(op_t::make_canonical(true, x.index), fops);
+    imperative_operator<hilbert_space, double, false> C(op_t::make_canonical(false, x.index), fops);
+    check_close(qd.c_dag_element(x.linear_index, p.first, p.second), dot_product(st_to, Cd(st_from)), "<to|C^+|from>");
+    check_close(qd.c_element(x.linear_index, p.second, p.first), dot_product(st_from, C(st_to)), "<from|C|to>");
+   }
+  }
+
+  // the eigen-orbitals : [H, D^+_a] = eps_a D^+_a
+  for (int a = 0; a < qd.n_orbitals(); ++a) {
+   auto Dd = qd.d_dag(a);
+   auto x = h0 * Dd - Dd * h0 - qd.get_single_particle_energies()[a] * Dd;
+   for (auto const& m : x)
+    if (std::abs(m.coef) > 1.e-10) TRIQS_RUNTIME_ERROR << "[H, D^+] : " << x;
+   if (!(dagger(Dd) - qd.d(a)).is_zero()) TRIQS_RUNTIME_ERROR << "D";
+  }
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
@@ -0,0 +1,110 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include <triqs/utility/first_include.hpp>
+#include <triqs/hilbert_space/imperative_operator.hpp>
+#include <triqs/hilbert_space/space_partition.hpp>
+#include <atomic>
+
+using namespace triqs::hilbert_space;
+using triqs::utility::c;
+using triqs::utility::c_dag;
+using triqs::utility::n;
+
+using op_t = imperative_operator<hilbert_space, double, false>;
+template <typename S> using sp_t = space_partition<S, op_t>;
+
+// same blocks, with the same numbering
+template <typename SP1, typename SP2> void check_same_partition(SP1 &sp1, SP2 &sp2, int dim, std::string mess) {
+ if (sp1.n_subspaces() != sp2.n_subspaces()) TRIQS_RUNTIME_ERROR << mess << " : number of subspaces";
+ for (int i = 0; i < dim; ++i)
+  if (sp1.lookup_basis_state(i) != sp2.lookup_basis_state(i)) TRIQS_RUNTIME_ERROR << mess << " : subspace of state " << i;
+}
+
+template <typename M> void check_same_elements(M const &m1, M const &m2, std::string mess) {
+ if (m1.size() != m2.size()) TRIQS_RUNTIME_ERROR << mess << " : number of matrix elements";
+ for (auto const &x : m1) {
+  auto it = m2.find(x.first);
+  if ((it == m2.end()) || (std::abs(it->second - x.second) > 1.e-12)) TRIQS_RUNTIME_ERROR << mess << " : matrix element";
+ }
+}
+
+int main() {
+ try {
+  // 4 bands Kanamori (dimension 256, distributed over the threads)
+  int n_orb = 4;
+  double U = 3, J = 0.3;
+  fundamental_operator_set fops;
+  for (int o = 0; o < n_orb; ++o) {
+   fops.insert("up", o);
+   fops.insert("dn", o);
+  }
+  triqs::utility::many_body_operator<double> h;
+  for (int o = 0; o < n_orb; ++o) h += -0.5 * (n("up", o) + n("dn", o)) + U * n("up", o) * n("dn", o);
+  for (int o1 = 0; o1 < n_orb; ++o1)
+   for (int o2 = 0; o2 < n_orb; ++o2) {
+    if (o1 == o2) continue;
+    h += (U - 2 * J) * n("up", o1) * n("dn", o2);
+    if (o2 < o1) h += (U - 3 * J) * (n("up", o1) * n("up", o2) + n("dn", o1) * n("dn", o2));
+    h += -J * c_dag("up", o1) * c_dag("dn", o1) * c("up", o2) * c("dn", o2);
+    h += -J * c_dag("up", o1) * c_dag("dn", o2) * c("up", o2) * c("dn", o1);
+   }
+
+  hilbert_space hs(fops);
+  int dim = hs.size();
+  op_t H(h, fops), Hc(h, fops);
+  Hc.compile(hs);
+
+  // H applied on the states, or read from the compiled matrix
+  state<hilbert_space, double, true> st(hs);
+  state<hilbert_space, double, false> stv(hs);
+  sp_t<state<hilbert_space, double, true>> SP(st, H);
+  sp_t<state<hilbert_space, double, false>> SPc(stv, Hc);
+  check_same_partition(SP, SPc, dim, "compiled H");
+  check_same_elements(SP.get_matrix_elements(), SPc.get_matrix_elements(), "compiled H");
+  auto const &sorted = SPc.get_sorted_matrix_elements();
+  if (sorted.size() != SP.get_matrix_elements().size()) TRIQS_RUNTIME_ERROR << "sorted elements";
+  for (int k = 1; k < sorted.size(); ++k)
+   if (!(sorted[k - 1] < sorted[k])) TRIQS_RUNTIME_ERROR << "elements not sorted";
+
+  // the matrix elements streamed to a callback
+  std::atomic<long> n_elements(0);
+  sp_t<state<hilbert_space, double, false>> SPs(stv, Hc, [&n_elements](uint32_t, uint32_t, double) { ++n_elements; });
+  check_same_partition(SP, SPs, dim, "callback");
+  if ((n_elements != sorted.size()) || !SPs.get_matrix_elements().empty()) TRIQS_RUNTIME_ERROR << "callback";
+
+  // merge with C, C^+ : blocks of given quantum numbers
+  for (int o = 0; o < n_orb; ++o)
+   for (auto spin : {"up", "dn"}) {
+    op_t Cd(c_dag(spin, o), fops), C(c(spin, o), fops);
+    auto r = SP.merge_subspaces(Cd, C);
+    Cd.compile(hs);
+    C.compile(hs);
+    auto rc = SPc.merge_subspaces(Cd, C);
+    check_same_partition(SP, SPc, dim, "merge");
+    check_same_elements(r.first, rc.first, "merge : C^+");
+    check_same_elements(r.second, rc.second, "merge : C");
+    if (SP.find_mappings(Cd) != SPc.find_mappings(Cd)) TRIQS_RUNTIME_ERROR << "find_mappings";
+    if (SP.find_mappings(H, true) != SPc.find_mappings(Hc, true)) TRIQS_RUNTIME_ERROR << "find_mappings of H";
+   }
+  if (SP.n_subspaces() < 10) TRIQS_RUNTIME_ERROR << "number of subspaces " << SP.n_subspaces();
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
@@ -0,0 +1,116 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include <triqs/utility/first_include.hpp>
+#include <triqs/hilbert_space/imperative_operator.hpp>
+#include <triqs/hilbert_space/state.hpp>
+
+using namespace triqs::hilbert_space;
+using triqs::utility::c;
+using triqs::utility::c_dag;
+
+using sparse_t = state<hilbert_space, double, true>;
+using dense_t = state<hilbert_space, double, false>;
+
+// the sparse state and the dense one have the same amplitudes
+void check(sparse_t const& s, dense_t const& d, std::string mess) {
+ for (int i = 0; i < d.size(); ++i)
+  if (std::abs(s(i) - d(i)) > 1.e-12) TRIQS_RUNTIME_ERROR << mess << " : amplitude " << i << " " << s(i) << " " << d(i);
+ int last = -1;
+ foreach(s, [&](int i, double a) {
+  if ((i <= last) || (a == 0)) TRIQS_RUNTIME_ERROR << mess << " : foreach";
+  last = i;
+ });
+}
+
+int main() {
+ try {
+  // Hubbard ring, 6 sites
+  int n_sites = 6;
+  fundamental_operator_set fops;
+  for (int s = 0; s < 2; ++s)
+   for (int i = 0; i < n_sites; ++i) fops.insert(s ? "dn" : "up", i);
+  triqs::utility::many_body_operator<double> h;
+  for (int s = 0; s < 2; ++s)
+   for (int i = 0; i < n_sites; ++i) {
+    auto sp = (s ? "dn" : "up");
+    h += -1.0 * (c_dag(sp, i) * c(sp, (i + 1) % n_sites) + c_dag(sp, (i + 1) % n_sites) * c(sp, i));
+   }
+  for (int i = 0; i < n_sites; ++i) h += 2.0 * c_dag("up", i) * c("up", i) * c_dag("dn", i) * c("dn", i);
+  hilbert_space hs(fops);
+  int dim = hs.size();
+
+  // two states, with some common basis states
+  sparse_t s1(hs), s2(hs);
+  dense_t d1(hs), d2(hs);
+  for (int i = 0; i < dim; i += 37) {
+   s1(i) = d1(i) = 1.0 + i % 5;
+   s2(dim - 1 - i) = d2(dim - 1 - i) = 0.5 - i % 3;
+  }
+  check(s1, d1, "fill");
+
+  // arithmetic and scalar product
+  check(s1 + s2, d1 + d2, "+");
+  check(s1 - 2.0 * s2, d1 - 2.0 * d2, "-");
+  check((s1 - s1) * 3.0, 0.0 * d1, "s - s");
+  if (std::abs(dot_product(s1, s2) - dot_product(d1, d2)) > 1.e-12) TRIQS_RUNTIME_ERROR << "dot_product";
+  if (std::abs(dot_product(s1, s1) - dot_product(d1, d1)) > 1.e-12) TRIQS_RUNTIME_ERROR << "norm";
+  auto s3 = s1;
+  s3 += s2;
+  s3 -= s1;
+  s3 /= 2.0;
+  check(s3, d2 / 2.0, "in place operators");
+  if (s3.n_amplitudes() != s2.n_amplitudes()) TRIQS_RUNTIME_ERROR << "zeros not removed by the sums";
+
+  // amplitudes added in any order, with repetitions
+  std::vector<std::pair<std::size_t, double>> x;
+  dense_t d4 = d1;
+  for (int n = 0; n < 500; ++n) {
+   int i = (n * 7919) % dim;
+   x.emplace_back(i, 0.25 * n);
+   d4(i) += 0.25 * n;
+  }
+  auto s4 = s1;
+  s4.add_amplitudes(x);
+  check(s4, d4, "add_amplitudes");
+
+  // the zeros written by operator() are removed lazily
+  sparse_t s5(hs);
+  for (int i = 0; i < dim; ++i) {
+   s5(i) = 1.0;
+   s5(i) = 0.0;
+  }
+  if (s5.n_amplitudes() > 40) TRIQS_RUNTIME_ERROR << "lazy removal of the zeros : " << s5.n_amplitudes();
+
+  // operator acting on the sparse states : from the monomials, or compiled (dense copy if the state is not too sparse)
+  imperative_operator<hilbert_space, double, false> H(h, fops), Hc(h, fops);
+  Hc.compile(hs);
+  dense_t d_all(hs);
+  sparse_t s_all(hs);
+  for (int i = 0; i < dim; ++i) s_all(i) = d_all(i) = std::cos(i);
+  for (auto const& op : {H, Hc}) {
+   check(op(s1), H(d1), "H s1");
+   check(op(s4), H(d4), "H s4");
+   check(op(s_all), H(d_all), "H s_all");
+   check(op(op(s1)), H(H(d1)), "H^2 s1");
+  }
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
@@ -0,0 +1,109 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include <triqs/utility/first_include.hpp>
+#include <triqs/operators/many_body_operator.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/archive/text_iarchive.hpp>
+#include <sstream>
+#include <complex>
+
+using namespace triqs::utility;
+using op_t = many_body_operator<double>;
+
+void check_zero(op_t const& x, std::string mess) {
+ if (!x.is_zero()) TRIQS_RUNTIME_ERROR << mess << " : " << x;
+}
+
+int main() {
+ try {
+  std::vector<op_t> C, Cd;
+  for (int s = 0; s < 2; ++s)
+   for (int o = 0; o < 3; ++o) {
+    C.push_back(c(s ? "dn" : "up", o));
+    Cd.push_back(c_dag(s ? "dn" : "up", o));
+   }
+  int n_ops = C.size();
+
+  // canonical anticommutation relations
+  for (int i = 0; i < n_ops; ++i)
+   for (int j = 0; j < n_ops; ++j) {
+    check_zero(Cd[i] * C[j] + C[j] * Cd[i] - (i == j ? 1.0 : 0.0), "{C^+, C}");
+    check_zero(C[i] * C[j] + C[j] * C[i], "{C, C}");
+    check_zero(Cd[i] * Cd[j] + Cd[j] * Cd[i], "{C^+, C^+}");
+   }
+
+  // products with several contractions : C_0 C_1 C^+_1 C^+_0 = (1 - n_0)(1 - n_1)
+  auto n0 = Cd[0] * C[0], n1 = Cd[1] * C[1];
+  check_zero(C[0] * C[1] * Cd[1] * Cd[0] - (1 - n0) * (1 - n1), "contractions");
+  check_zero(n0 * n0 - n0, "n^2 = n");
+  check_zero(C[2] * Cd[3] * C[2], "C_i X C_i = 0");
+
+  // associativity and dagger of long products
+  auto A = Cd[0] * C[1] + 2.0 * n1 - 0.5 * Cd[4] * Cd[2] * C[3];
+  auto B = C[4] * Cd[1] + n0 * C[5] + 1.5;
+  auto D = Cd[3] * C[0] * C[4] - Cd[5];
+  check_zero((A * B) * D - A * (B * D), "associativity");
+  check_zero(dagger(A * B * D) - dagger(D) * dagger(B) * dagger(A), "dagger");
+
+  // many monomials added and removed : the hash table grows, the erased monomials are removed from the arena
+  op_t H;
+  for (int i = 0; i < n_ops; ++i)
+   for (int j = 0; j < n_ops; ++j)
+    for (int k = 0; k < n_ops; ++k)
+     for (int l = 0; l < n_ops; ++l) H += double((i + 1) * (j + 3) * (k + 2) * (2 * l + 1)) * Cd[i] * Cd[j] * C[k] * C[l];
+  auto H2 = H;
+  for (int i = 0; i < n_ops; ++i)
+   for (int j = 0; j < n_ops; ++j)
+    for (int k = 0; k < n_ops; ++k)
+     for (int l = 0; l < n_ops; ++l) H2 -= double((i + 1) * (j + 3) * (k + 2) * (2 * l + 1)) * Cd[i] * Cd[j] * C[k] * C[l];
+  check_zero(H2, "H - H");
+  H2 = H - 0.5 * H;
+  check_zero(H2 + H2 - H, "H/2 + H/2 - H");
+
+  // the iteration is in the order of the monomials
+  int last_size = -1, n_monomials = 0;
+  for (auto const& m : H) {
+   if (int(m.monomial.size()) < last_size) TRIQS_RUNTIME_ERROR << "order of the monomials";
+   last_size = m.monomial.size();
+   ++n_monomials;
+  }
+  if (n_monomials != 225) TRIQS_RUNTIME_ERROR << "number of monomials " << n_monomials;
+
+  // serialization
+  std::stringstream ss;
+  {
+   boost::archive::text_oarchive oa(ss);
+   oa& H;
+  }
+  op_t H3;
+  {
+   boost::archive::text_iarchive ia(ss);
+   ia& H3;
+  }
+  check_zero(H3 - H, "serialization");
+
+  // conversion to complex
+  many_body_operator<std::complex<double>> Hc = H;
+  many_body_operator<std::complex<double>> Hc2 = dagger(Hc) * std::complex<double>(0, 1);
+  if (Hc2.is_zero()) TRIQS_RUNTIME_ERROR << "complex";
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
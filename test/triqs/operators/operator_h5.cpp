@@ -0,0 +1,133 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include <triqs/utility/first_include.hpp>
+#include <triqs/operators/many_body_operator.hpp>
+#include <triqs/h5.hpp>
+#include <triqs/arrays.hpp>
+
+using namespace triqs::utility;
+using triqs::hilbert_space::fundamental_operator_set;
+namespace h5 = triqs::h5;
+using op_t = many_body_operator<double>;
+using triqs::arrays::array;
+
+void check_equal(op_t const& x, op_t const& y, std::string mess) {
+ if (!(x - y).is_zero()) TRIQS_RUNTIME_ERROR << mess << " : " << x << " != " << y;
+}
+
+int main() {
+ try {
+  auto f = h5::file("operator_h5.h5", 'w');
+
+  // monomials of more than 4 operators : a three body term, and longer
+  op_t V = 0.5 * c_dag("up", 0) * c_dag("up", 1) * c_dag("dn", 2) * c("dn", 2) * c("up", 1) * c("up", 0) + 2 * n("up", 0) - 1.5;
+  V += 0.25 * c_dag("up", 0) * c_dag("up", 1) * c_dag("up", 2) * c_dag("dn", 0) * c("dn", 1) * c("dn", 2) * c("up", 3) * c("up", 4);
+  h5_write(f, "V", V);
+  check_equal(h5::h5_read<op_t>(f, "V"), V, "three body term");
+
+  // a large operator, with an imposed fundamental_operator_set
+  op_t H;
+  fundamental_operator_set fops;
+  for (int i = 0; i < 20; ++i) fops.insert("b", i);
+  for (int i = 0; i < 20; ++i)
+   for (int j = 0; j < 20; ++j)
+    for (int k = 0; k < 20; k += 3) H += (1 + i + 0.1 * j - 0.01 * k) * c_dag("b", i) * c_dag("b", j) * c("b", k) * c("b", (i + j + k) % 20);
+  if (H.is_zero()) TRIQS_RUNTIME_ERROR << "H is 0";
+  h5_write(f, "H", H, fops);
+  op_t H2;
+  fundamental_operator_set fops2;
+  h5_read(f, "H", H2, fops2);
+  check_equal(H2, H, "large operator");
+  if (fops2.size() != fops.size()) TRIQS_RUNTIME_ERROR << "fundamental_operator_set";
+
+  // the 0 operator
+  h5_write(f, "zero", op_t{});
+  if (!h5::h5_read<op_t>(f, "zero").is_zero()) TRIQS_RUNTIME_ERROR << "0";
+
+  // an operator of the fundamental_operator_set is missing
+  bool thrown = false;
+  try {
+   fundamental_operator_set small;
+   small.insert("up", 0);
+   h5_write(f, "V_small", V, small);
+  } catch (triqs::runtime_error const&) { thrown = true; }
+  if (!thrown) TRIQS_RUNTIME_ERROR << "missing operator in the fundamental_operator_set";
+
+  // the old format : a dataset of compound monomials of at most 4 C, C^+, read then written in the new format
+  {
+   op_t O = 0.5 * c_dag("up", 0) * c("dn", 1) + 2 * n("up", 0) * n("dn", 1) - 1.5 + c("up", 1);
+   auto fops_O = O.make_fundamental_operator_set();
+   struct legacy_monomial {
+    double scalar;
+    long op_indices[4]; // +(n + 1) for C^+_n, -(n + 1) for C_n, 0 after the last one
+   };
+   std::vector<legacy_monomial> data;
+   for (auto const& m : O) {
+    legacy_monomial x = {m.coef, {0, 0, 0, 0}};
+    int k = 0;
+    for (auto const& op : m.monomial) x.op_indices[k++] = (op.dagger ? 1 : -1) * (fops_O[op.indices] + 1);
+    data.push_back(x);
+   }
+   h5::h5_object t = H5Tcreate(H5T_COMPOUND, sizeof(legacy_monomial));
+   H5Tinsert(t, "scalar", HOFFSET(legacy_monomial, scalar), H5T_NATIVE_DOUBLE);
+   hsize_t array_dim[] = {4};
+   h5::h5_object array_t = H5Tarray_create(H5T_NATIVE_LONG, 1, array_dim);
+   H5Tinsert(t, "op_indices", HOFFSET(legacy_monomial, op_indices), array_t);
+   hsize_t dim[] = {data.size()};
+   h5::h5_object space = H5Screate_simple(1, dim, NULL);
+   h5::dataset ds = h5::group(f).create_dataset("O_legacy", t, space);
+   if (H5Dwrite(ds, t, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data()) < 0) TRIQS_RUNTIME_ERROR << "writing the old format";
+   h5_write_attribute(ds, "fundamental_operator_set", fops_O);
+
+   auto O2 = h5::h5_read<op_t>(f, "O_legacy");
+   check_equal(O2, O, "old format");
+   h5_write(f, "O_new", O2);
+   op_t O3 = V; // the content of O3 is replaced
+   h5_read(f, "O_new", O3);
+   check_equal(O3, O, "old format written back");
+  }
+
+  // the offsets must start at 0 and not decrease
+  {
+   fundamental_operator_set fops1;
+   fops1.insert("up", 0);
+   auto write_csr = [&](std::string name, array<double, 1> const& coefs, array<long, 1> const& offsets) {
+    auto gr = h5::group(f).create_group(name);
+    h5_write(gr, "coefficients", coefs);
+    h5_write(gr, "offsets", offsets);
+    h5_write(gr, "operators", array<int, 1>{1, -1});
+    h5_write_attribute(gr, "fundamental_operator_set", fops1);
+   };
+   write_csr("csr_ok", array<double, 1>{1}, array<long, 1>{0, 2});
+   check_equal(h5::h5_read<op_t>(f, "csr_ok"), n("up", 0), "hand made CSR");
+   write_csr("csr_first_offset", array<double, 1>{1}, array<long, 1>{1, 2});
+   write_csr("csr_decreasing", array<double, 1>{1, 2, 3}, array<long, 1>{0, 2, 1, 2});
+   for (std::string name : {"csr_first_offset", "csr_decreasing"}) {
+    bool thrown = false;
+    try {
+     h5::h5_read<op_t>(f, name);
+    } catch (triqs::runtime_error const&) { thrown = true; }
+    if (!thrown) TRIQS_RUNTIME_ERROR << "invalid offsets in " << name;
+   }
+  }
+ }
+ TRIQS_CATCH_AND_ABORT;
+}
@@ -43,6 +43,11 @@
 
 // Linear algebra ?? Keep here ?
 #include <triqs/arrays/linalg/det_and_inverse.hpp>
+#include <triqs/arrays/linalg/batched_inverse.hpp>
+#include <triqs/arrays/linalg/batched_linalg.hpp>
+
+// Small matrices of size known at compile time
+#include <triqs/arrays/static_matrix.hpp>
 
 #include <triqs/mpi/arrays.hpp>
 
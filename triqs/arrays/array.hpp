@@ -136,6 +136,10 @@ namespace triqs { namespace arrays {
   explicit array(typename indexmap_type::domain_type const& dom, memory_layout<Rank> ml = memory_layout<Rank>{})
      : IMPL_TYPE(indexmap_type(dom, ml)) {}
 
+  /// From a domain, without initializing the elements (cf no_init)
+  array(typename indexmap_type::domain_type const& dom, no_init_t, memory_layout<Rank> ml = memory_layout<Rank>{})
+     : IMPL_TYPE(indexmap_type(dom, ml), no_init) {}
+
 #ifdef TRIQS_DOXYGEN
     /// Construction from the dimensions. NB : the number of parameters must be exactly rank (checked at compile time). 
     array (size_t I_1, .... , size_t I_rank);
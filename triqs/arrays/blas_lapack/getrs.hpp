@@ -0,0 +1,47 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef TRIQS_ARRAYS_BLAS_LAPACK_GETRS_H
+#define TRIQS_ARRAYS_BLAS_LAPACK_GETRS_H
+#include <complex>
+#include "./tools.hpp"
+
+namespace triqs { namespace arrays { namespace lapack {
+
+ using namespace blas_lapack_tools;
+ namespace f77 { // overload
+
+  extern "C" {
+   void TRIQS_FORTRAN_MANGLING(dgetrs) (char *, const int &, const int &, const double *, const int &, const int *, double *, const int &, int &);
+   void TRIQS_FORTRAN_MANGLING(zgetrs) (char *, const int &, const int &, const std::complex<double> *, const int &, const int *, std::complex<double> *, const int &, int &);
+  }
+
+  inline void getrs (char trans, const int & N, const int & NRHS, const double* A, const int & LDA, const int * ipiv, double* B, const int & LDB, int & info) {
+   TRIQS_FORTRAN_MANGLING(dgetrs)(&trans,N,NRHS,A,LDA,ipiv,B,LDB,info);
+  }
+  inline void getrs (char trans, const int & N, const int & NRHS, const std::complex<double>* A, const int & LDA, const int * ipiv, std::complex<double>* B, const int & LDB, int & info) {
+   TRIQS_FORTRAN_MANGLING(zgetrs)(&trans,N,NRHS,A,LDA,ipiv,B,LDB,info);
+  }
+ }
+
+}}}// namespace
+
+#endif
+
@@ -38,6 +38,13 @@ namespace triqs { namespace arrays { namespace blas_lapack_tools {
   */
  template<typename A, typename Enable=void> class const_qcache;
 
+ /**
+  * Objects with the matrix concept which can present their data as a matrix_view, without copy
+  * (e.g. the proxies of the matrices of the data of a gf, cf matrix_tensor_proxy.hpp).
+  * Specializations are true_type and provide : type, the view, and static type invoke(A const &).
+  */
+ template <typename A, typename Enable = void> struct as_matrix_view : std::false_type {};
+
  template <class T> struct guarantee_no_copy : boost::mpl::or_< is_amv_value_class<T>, is_vector_view<T> > {};
  template <class T> struct may_need_copy : boost::mpl::or_< is_matrix_view<T> > {};
 
@@ -52,7 +59,7 @@ namespace triqs { namespace arrays { namespace blas_lapack_tools {
  };
 
  // For any expression with matrix concept : we need to copy it into a matrix before using blas/lapack
- template<typename A> class const_qcache< A, ENABLE_IF(mpl::and_<ImmutableMatrix<A>, mpl::not_<is_matrix_or_view<A> > >) > {
+ template<typename A> class const_qcache< A, ENABLE_IFC(ImmutableMatrix<A>::value && !is_matrix_or_view<A>::value && !as_matrix_view<A>::value) > {
   typedef matrix<typename A::value_type> X;
   X x;
   public:
@@ -62,6 +69,18 @@ namespace triqs { namespace arrays { namespace blas_lapack_tools {
   exposed_type operator()() const {return x;}
  };
 
+ // For the objects which are a matrix view in disguise : no copy, except if the view itself requires it
+ template<typename A> class const_qcache< A, ENABLE_IF(as_matrix_view<A>) > {
+  typedef typename as_matrix_view<A>::type V;
+  V v;
+  const_qcache<V> c;
+  public:
+  const_qcache(A const & x_):v(as_matrix_view<A>::invoke(x_)), c(v){}
+  const_qcache(const_qcache const &) = delete;
+  typedef typename const_qcache<V>::exposed_type exposed_type;
+  exposed_type operator()() const {return c();}
+ };
+
  // For any expression with vector concept : we need to copy it into a matrix before using blas/lapack
  template<typename A> class const_qcache< A, ENABLE_IF(mpl::and_<ImmutableVector<A>, mpl::not_<is_vector_or_view<A> > >) > {
   typedef vector<typename A::value_type> X;
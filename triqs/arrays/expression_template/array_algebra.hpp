@@ -81,6 +81,9 @@ namespace triqs { namespace arrays {
   template <typename T> void operator-=(T &&x) = delete; // can not -= into an expression template !
   };
 
+ template<typename Tag, typename L, typename R> struct flat_eval<array_expr<Tag,L,R>> : flat_eval_binary_node<Tag, array_expr<Tag,L,R>, L, R> {};
+ template<typename L> struct flat_eval<array_unary_m_expr<L>> : flat_eval_unary_m_node<array_unary_m_expr<L>, L> {};
+
  // Now we can define all the C++ operators ...
 #define DEFINE_OPERATOR(TAG, OP, TRAIT1, TRAIT2) \
  template<typename A1, typename A2>\
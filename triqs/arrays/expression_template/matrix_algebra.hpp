@@ -36,15 +36,73 @@ namespace triqs { namespace arrays {
   typedef matrix<typename std::decay<decltype( V1{} * V2{})>::type> type;
  };
 
- template<typename A, typename B> 
-  typename _matmul_rvalue<A,B>::type
-  operator * (A const & a, B const & b) { 
-   if (second_dim(a) != first_dim(b)) TRIQS_RUNTIME_ERROR<< "Matrix product : dimension mismatch in A*B "<< a<<" "<< b; 
-   auto R = typename _matmul_rvalue<A,B>::type( first_dim(a), second_dim(b));
-   blas::gemm(1.0,a, b, 0.0, R);
-   return R;
+ // an operand of matmul_lazy : a const view for the matrices and matrix_views, as node_t otherwise
+ template <typename T, bool IsMatrixOrView = is_matrix_or_view<typename std::decay<T>::type>::value> struct matmul_node_t : node_t<T, false> {};
+ template <typename T> struct matmul_node_t<T, true> {
+  typedef typename std::decay<T>::type::const_view_type type;
+ };
+
+ /**
+  * Lazy result of A * B, where A, B are matrices or matrix expressions.
+  *
+  * It keeps a const view of A and B if they are matrices or matrix_views (so it can outlive them),
+  * a copy if they are formal expressions (which keep references, as the other expression templates).
+  * Assigned to a matrix or a matrix_view (=, +=, -=), alone or in M = alpha * A * B + C, it calls gemm
+  * directly into the destination, with no temporary (cf assignment below).
+  * The element access and make_regular compute the product once, into an internal matrix : as for a view,
+  * a modification of A or B before the first access is seen.
+  */
+ template <typename A, typename B> struct matmul_lazy : TRIQS_CONCEPT_TAG_NAME(ImmutableMatrix) {
+  typedef typename std::remove_reference<A>::type A_t;
+  typedef typename std::remove_reference<B>::type B_t;
+  typedef typename _matmul_rvalue<A_t, B_t>::type M_type;
+  typedef typename M_type::value_type value_type;
+  typedef indexmaps::cuboid::domain_t<2> domain_type;
+
+  A a;
+  B b;
+
+  template <typename AA, typename BB> matmul_lazy(AA &&a_, BB &&b_) : a(std::forward<AA>(a_)), b(std::forward<BB>(b_)) {
+   if (second_dim(a) != first_dim(b)) TRIQS_RUNTIME_ERROR << "Matrix product : dimension mismatch in A*B " << a << " " << b;
+  }
+
+  domain_type domain() const { return domain_type(make_shape(first_dim(a), second_dim(b))); }
+
+  template <typename K0, typename K1> value_type const &operator()(K0 const &k0, K1 const &k1) const {
+   activate();
+   return M(k0, k1);
   }
 
+  M_type const &operator()() const {
+   activate();
+   return M;
+  }
+
+  friend std::ostream &operator<<(std::ostream &out, matmul_lazy const &x) { return out << "(" << x.a << " * " << x.b << ")"; }
+
+  friend M_type make_regular(matmul_lazy const &x) { return x(); }
+  friend matrix_const_view<value_type> make_const_view(matmul_lazy const &x) { return x(); }
+
+  private:
+  mutable M_type M;
+  mutable bool computed = false;
+
+  void activate() const {
+   if (computed) return;
+   M.resize(first_dim(a), second_dim(b));
+   blas::gemm(1.0, a, b, 0.0, M);
+   computed = true;
+  }
+ };
+
+ template <typename A, typename B>
+ typename std::enable_if<ImmutableMatrix<typename std::decay<A>::type>::value && ImmutableMatrix<typename std::decay<B>::type>::value &&
+                             !(is_static_matrix<typename std::decay<A>::type>::value && is_static_matrix<typename std::decay<B>::type>::value),
+                         matmul_lazy<typename matmul_node_t<A>::type, typename matmul_node_t<B>::type>>::type
+ operator*(A &&a, B &&b) {
+  return {std::forward<A>(a), std::forward<B>(b)};
+ }
+
  // matrix * vector
  template<typename M, typename V, typename Enable = void>  struct _mat_vec_mul_rvalue {};
 
@@ -112,6 +170,9 @@ namespace triqs { namespace arrays {
    template <typename T> void operator-=(T &&x) = delete;// can not -= into an expression template !
    };
 
+ template<typename Tag, typename L, typename R> struct flat_eval<matrix_expr<Tag,L,R>> : flat_eval_binary_node<Tag, matrix_expr<Tag,L,R>, L, R> {};
+ template<typename L> struct flat_eval<matrix_unary_m_expr<L>> : flat_eval_unary_m_node<matrix_unary_m_expr<L>, L> {};
+
  // Now we can define all the C++ operators ...
 #define DEFINE_OPERATOR(TAG, OP, TRAIT1, TRAIT2) \
  template<typename A1, typename A2>\
@@ -162,6 +223,196 @@ namespace triqs { namespace arrays {
  // -> typename std::enable_if< ImmutableMatrix<M>::value, decltype(std::forward<A>(a) * inverse(std::forward<M>(m)))>::type 
   //{ return std::forward<A>(a) * inverse(std::forward<M>(m));}
 
+ // ------------------  Assignment of matrix products : gemm into the destination ----------------------------
+ //
+ // M op= P, M op= P + C, M op= C + P, M op= P - C, M op= C - P with op in =, +=, -=
+ // where P = A * B, s * (A * B), (A * B) * s, (A * B) / s or -(A * B), and C is any matrix expression.
+ // M is a matrix, a matrix_view, or an object seen as a matrix_view (e.g. the matrix proxy g[w] of a gf, cf qcache.hpp).
+ // Scalar factors of A or B (e.g. in alpha * A * B) go into the alpha of gemm.
+ // C is first assigned/added to M, then P is added by gemm with beta = 1.
+ // If M shares its memory with A or B, the product is computed in a temporary, since gemm can not work in place.
+
+ namespace matmul_impl {
+
+  using utility::tags::plus;
+  using utility::tags::minus;
+  using utility::tags::multiplies;
+  using utility::tags::divides;
+
+  template <typename X> struct is_matmul_lazy : std::false_type {};
+  template <typename A, typename B> struct is_matmul_lazy<matmul_lazy<A, B>> : std::true_type {};
+
+  // an operand of the product, and its scalar factor
+  template <typename X> struct operand {
+   typedef X type;
+   static X const &get(X const &x) { return x; }
+   template <typename V> static V factor(X const &) { return V(1); }
+  };
+  template <typename S, typename Y> struct operand<matrix_expr<multiplies, _scalar_wrap<S, false>, Y>> {
+   typedef typename std::decay<Y>::type type;
+   static type const &get(matrix_expr<multiplies, _scalar_wrap<S, false>, Y> const &x) { return x.r; }
+   template <typename V> static V factor(matrix_expr<multiplies, _scalar_wrap<S, false>, Y> const &x) { return x.l.s; }
+  };
+  template <typename S, typename Y> struct operand<matrix_expr<multiplies, Y, _scalar_wrap<S, false>>> {
+   typedef typename std::decay<Y>::type type;
+   static type const &get(matrix_expr<multiplies, Y, _scalar_wrap<S, false>> const &x) { return x.l; }
+   template <typename V> static V factor(matrix_expr<multiplies, Y, _scalar_wrap<S, false>> const &x) { return x.r.s; }
+  };
+
+  // a term s * (A * B). X is a node, possibly a reference.
+  template <typename X, typename Enable = void> struct term : std::false_type {};
+
+  template <typename X> struct term<X, ENABLE_IF(is_matmul_lazy<typename std::decay<X>::type>)> : std::true_type {
+   typedef typename std::decay<X>::type X_t;
+   typedef X_t P;
+   static P const &prod(X_t const &x) { return x; }
+   template <typename V> static V alpha(X_t const &) { return V(1); }
+  };
+
+  template <typename S, typename R> struct term<matrix_expr<multiplies, _scalar_wrap<S, false>, R>, ENABLE_IF(is_matmul_lazy<typename std::decay<R>::type>)> : std::true_type {
+   typedef matrix_expr<multiplies, _scalar_wrap<S, false>, R> X_t;
+   typedef typename std::decay<R>::type P;
+   static P const &prod(X_t const &x) { return x.r; }
+   template <typename V> static V alpha(X_t const &x) { return x.l.s; }
+  };
+
+  template <typename S, typename L> struct term<matrix_expr<multiplies, L, _scalar_wrap<S, false>>, ENABLE_IF(is_matmul_lazy<typename std::decay<L>::type>)> : std::true_type {
+   typedef matrix_expr<multiplies, L, _scalar_wrap<S, false>> X_t;
+   typedef typename std::decay<L>::type P;
+   static P const &prod(X_t const &x) { return x.l; }
+   template <typename V> static V alpha(X_t const &x) { return x.r.s; }
+  };
+
+  template <typename S, typename L> struct term<matrix_expr<divides, L, _scalar_wrap<S, false>>, ENABLE_IF(is_matmul_lazy<typename std::decay<L>::type>)> : std::true_type {
+   typedef matrix_expr<divides, L, _scalar_wrap<S, false>> X_t;
+   typedef typename std::decay<L>::type P;
+   static P const &prod(X_t const &x) { return x.l; }
+   template <typename V> static V alpha(X_t const &x) { return V(1) / x.r.s; }
+  };
+
+  template <typename L> struct term<matrix_unary_m_expr<L>, ENABLE_IF(is_matmul_lazy<typename std::decay<L>::type>)> : std::true_type {
+   typedef matrix_unary_m_expr<L> X_t;
+   typedef typename std::decay<L>::type P;
+   static P const &prod(X_t const &x) { return x.l; }
+   template <typename V> static V alpha(X_t const &) { return V(-1); }
+  };
+
+  // may x and the matrix m share their memory ?
+  template <typename M, typename X> TYPE_ENABLE_IFC(bool, std::is_base_of<Tag::indexmap_storage_pair, X>::value) may_alias(M const &m, X const &x) {
+   return (m.storage().size() != 0) && (x.storage().size() != 0) && (static_cast<const void *>(&m.storage()[0]) == static_cast<const void *>(&x.storage()[0]));
+  }
+  template <typename M, typename X> TYPE_ENABLE_IFC(bool, !std::is_base_of<Tag::indexmap_storage_pair, X>::value) may_alias(M const &, X const &) {
+   return false;
+  }
+
+  // lhs = alpha * p + c_sign * C (add = false) or lhs += alpha * p + c_sign * C (add = true). No C if c is null.
+  template <typename MT, typename A, typename B, typename C>
+  void gemm_assign(MT &lhs, bool add, typename matmul_lazy<A, B>::value_type alpha, matmul_lazy<A, B> const &p, int c_sign, C const *c) {
+   typedef typename matmul_lazy<A, B>::value_type V;
+   typedef operand<typename std::decay<A>::type> OA;
+   typedef operand<typename std::decay<B>::type> OB;
+   alpha = alpha * OA::template factor<V>(p.a) * OB::template factor<V>(p.b);
+   // the operands are evaluated first (if they are expressions) : they may use lhs
+   blas_lapack_tools::const_qcache<typename OA::type> ca(OA::get(p.a));
+   blas_lapack_tools::const_qcache<typename OB::type> cb(OB::get(p.b));
+   if (may_alias(lhs, ca()) || may_alias(lhs, cb())) {
+    matrix<V> r(first_dim(ca()), second_dim(cb()));
+    blas::gemm(alpha, ca(), cb(), V(0), r);
+    if (c) {
+     if (c_sign > 0)
+      r += *c;
+     else
+      r -= *c;
+    }
+    if (add)
+     lhs += r;
+    else
+     lhs = r;
+    return;
+   }
+   V beta = V(add ? 1 : 0);
+   if (c) {
+    if (!add) { // NB : not lhs = *c, which reallocates lhs when C is a matrix
+     resize_or_check_if_view(lhs, make_shape(first_dim(*c), second_dim(*c)));
+     triqs_arrays_assign_delegation(lhs, *c);
+     beta = V(c_sign);
+    } else if (c_sign > 0)
+     lhs += *c;
+    else
+     lhs -= *c;
+   }
+   blas::gemm(alpha, ca(), cb(), beta, lhs);
+  }
+
+  // the patterns
+  template <typename X> struct is_c : ImmutableMatrix<typename std::decay<X>::type> {};
+
+  template <typename X> struct pattern : term<X> {
+   template <typename MT> static void invoke(MT &lhs, X const &x, bool add, int sign) {
+    typedef typename term<X>::P P;
+    typedef typename P::value_type V;
+    gemm_assign(lhs, add, V(sign) * term<X>::template alpha<V>(x), term<X>::prod(x), 0,
+                static_cast<matrix<typename P::value_type> const *>(nullptr));
+   }
+  };
+
+  // P + C, C + P, P - C, C - P
+  template <typename Tag, typename L, typename R> struct pattern_sum {
+   static constexpr bool is_plus = std::is_same<Tag, plus>::value;
+   static constexpr bool left = term<typename std::decay<L>::type>::value && is_c<R>::value;
+   static constexpr bool right = !left && term<typename std::decay<R>::type>::value && is_c<L>::value;
+   static constexpr bool value = (is_plus || std::is_same<Tag, minus>::value) && (left || right);
+
+   template <typename MT, typename X> static void invoke(MT &lhs, X const &x, bool add, int sign) {
+    _invoke(lhs, x, add, sign, std::integral_constant<bool, left>{});
+   }
+
+   private:
+   template <typename MT, typename X> static void _invoke(MT &lhs, X const &x, bool add, int sign, std::true_type) {
+    typedef typename std::decay<L>::type L_t;
+    typedef typename term<L_t>::P::value_type V;
+    gemm_assign(lhs, add, V(sign) * term<L_t>::template alpha<V>(x.l), term<L_t>::prod(x.l), (is_plus ? sign : -sign), &x.r);
+   }
+   template <typename MT, typename X> static void _invoke(MT &lhs, X const &x, bool add, int sign, std::false_type) {
+    typedef typename std::decay<R>::type R_t;
+    typedef typename term<R_t>::P::value_type V;
+    gemm_assign(lhs, add, V(is_plus ? sign : -sign) * term<R_t>::template alpha<V>(x.r), term<R_t>::prod(x.r), sign, &x.l);
+   }
+  };
+
+  template <typename L, typename R> struct pattern<matrix_expr<plus, L, R>> : pattern_sum<plus, L, R> {};
+  template <typename L, typename R> struct pattern<matrix_expr<minus, L, R>> : pattern_sum<minus, L, R> {};
+ }
+
+ namespace assignment {
+
+  template <typename LHS>
+  struct is_gemm_lhs : std::integral_constant<bool, is_matrix_or_view<LHS>::value || blas_lapack_tools::as_matrix_view<LHS>::value> {};
+
+  template <typename LHS, typename A, typename B> struct is_special<LHS, matmul_lazy<A, B>> : is_gemm_lhs<LHS> {};
+  template <typename LHS, typename Tag, typename L, typename R>
+  struct is_special<LHS, matrix_expr<Tag, L, R>>
+      : std::integral_constant<bool, is_gemm_lhs<LHS>::value && matmul_impl::pattern<matrix_expr<Tag, L, R>>::value> {};
+  template <typename LHS, typename L>
+  struct is_special<LHS, matrix_unary_m_expr<L>>
+      : std::integral_constant<bool, is_gemm_lhs<LHS>::value && matmul_impl::pattern<matrix_unary_m_expr<L>>::value> {};
+
+  template <typename LHS, typename RHS, char OP>
+  struct impl<LHS, RHS, OP, ENABLE_IFC(is_gemm_lhs<LHS>::value && (!is_scalar_for<RHS, LHS>::value) && matmul_impl::pattern<RHS>::value)> {
+   static_assert(OP == 'E' || OP == 'A' || OP == 'S', "*= and /= by a matrix product are not defined");
+   LHS &lhs;
+   RHS const &rhs;
+   impl(LHS &lhs_, RHS const &rhs_) : lhs(lhs_), rhs(rhs_) {}
+   void invoke() { _invoke(std::integral_constant<bool, blas_lapack_tools::as_matrix_view<LHS>::value>{}); }
+
+   private:
+   void _invoke(std::false_type) { matmul_impl::pattern<RHS>::invoke(lhs, rhs, OP != 'E', (OP == 'S' ? -1 : 1)); }
+   void _invoke(std::true_type) {
+    auto v = blas_lapack_tools::as_matrix_view<LHS>::invoke(lhs);
+    matmul_impl::pattern<RHS>::invoke(v, rhs, OP != 'E', (OP == 'S' ? -1 : 1));
+   }
+  };
+ }
+
 }}//namespace triqs::arrays
 #endif
-
@@ -22,6 +22,7 @@
 #define TRIQS_ARRAYS_EXPRESSION_TOOLS_H
 #include <type_traits>
 #include <triqs/utility/expression_template_tools.hpp>
+#include "../impl/flat_evaluation.hpp"
 namespace triqs { namespace arrays {
  using utility::is_in_ZRC;
 
@@ -101,6 +102,36 @@ namespace triqs { namespace arrays {
   template<typename S, bool IsMatrix, typename L> auto operator() (L const & l, _scalar_wrap<S,IsMatrix> const & w) const -> decltype(l.domain()) { return l.domain();}
  };
 
-  
+
+ // ------------ flat evaluation of the nodes (cf impl/flat_evaluation.hpp) -------------------
+
+ // the scalar of an array expression is the same at all positions.
+ // the scalar of a matrix expression (i.e. scalar * identity) can not be evaluated flat.
+ template<typename S> struct flat_eval<_scalar_wrap<S,false>> {
+  static constexpr bool possible = true;
+  template<typename IM> static bool compatible(_scalar_wrap<S,false> const &, IM const &, const char *, const char *) { return true;}
+  static S at(_scalar_wrap<S,false> const & x, size_t) { return x.s;}
+ };
+
+ // node with the children l, r, combined by operation<Tag>
+ template<typename Tag, typename Node, typename L, typename R> struct flat_eval_binary_node {
+  static constexpr bool possible = flat_eval<L>::possible && flat_eval<R>::possible;
+  template<typename IM> static bool compatible(Node const & x, IM const & im, const char * b, const char * e) {
+   return flat_eval<L>::compatible(x.l, im, b, e) && flat_eval<R>::compatible(x.r, im, b, e);
+  }
+  static typename Node::value_type at(Node const & x, size_t k) {
+   return utility::operation<Tag>()(flat_eval<L>::at(x.l, k), flat_eval<R>::at(x.r, k));
+  }
+ };
+
+ // node -l
+ template<typename Node, typename L> struct flat_eval_unary_m_node {
+  static constexpr bool possible = flat_eval<L>::possible;
+  template<typename IM> static bool compatible(Node const & x, IM const & im, const char * b, const char * e) {
+   return flat_eval<L>::compatible(x.l, im, b, e);
+  }
+  static typename Node::value_type at(Node const & x, size_t k) { return -flat_eval<L>::at(x.l, k);}
+ };
+
 }}//namespace triqs::arrays
 #endif
@@ -66,6 +66,9 @@ namespace triqs { namespace arrays {
    friend arrays::vector<value_type> make_vector(vector_unary_m_expr const & e) { return e;}
   };
 
+ template<typename Tag, typename L, typename R> struct flat_eval<vector_expr<Tag,L,R>> : flat_eval_binary_node<Tag, vector_expr<Tag,L,R>, L, R> {};
+ template<typename L> struct flat_eval<vector_unary_m_expr<L>> : flat_eval_unary_m_node<vector_unary_m_expr<L>, L> {};
+
  // Now we can define all the C++ operators ...
 #define DEFINE_OPERATOR(TAG, OP, TRAIT1, TRAIT2) \
  template<typename A1, typename A2>\
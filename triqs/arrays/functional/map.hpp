@@ -21,6 +21,7 @@
 #ifndef TRIQS_ARRAYS_EXPRESSION_MAP_H
 #define TRIQS_ARRAYS_EXPRESSION_MAP_H
 #include "../impl/common.hpp"
+#include "../impl/flat_evaluation.hpp"
 #include <functional>
 //#include "../../utility/function_arg_ret_type.hpp"
 
@@ -73,6 +74,25 @@ namespace triqs { namespace arrays {
    TYPE_ENABLE_IFC(value_type,vec) operator[] (Args && args) const { return f(a[std::forward<Args>(args)],b[std::forward<Args>(args)]);}
  };
 
+ // flat evaluation (cf impl/flat_evaluation.hpp)
+ template<typename F, bool is_vec, typename A> struct flat_eval<map_impl_result<F,1,is_vec,A>> {
+  using node_t = map_impl_result<F,1,is_vec,A>;
+  static constexpr bool possible = flat_eval<A>::possible;
+  template<typename IM> static bool compatible(node_t const & x, IM const & im, const char * b, const char * e) {
+   return flat_eval<A>::compatible(x.a, im, b, e);
+  }
+  static typename node_t::value_type at(node_t const & x, size_t k) { return x.f(flat_eval<A>::at(x.a, k));}
+ };
+
+ template<typename F, bool is_vec, typename A, typename B> struct flat_eval<map_impl_result<F,2,is_vec,A,B>> {
+  using node_t = map_impl_result<F,2,is_vec,A,B>;
+  static constexpr bool possible = flat_eval<A>::possible && flat_eval<B>::possible;
+  template<typename IM> static bool compatible(node_t const & x, IM const & im, const char * b, const char * e) {
+   return flat_eval<A>::compatible(x.a, im, b, e) && flat_eval<B>::compatible(x.b, im, b, e);
+  }
+  static typename node_t::value_type at(node_t const & x, size_t k) { return x.f(flat_eval<A>::at(x.a, k), flat_eval<B>::at(x.b, k));}
+ };
+
  /* already defined in traist
  template<typename ... T> struct _and; 
  template<typename T0, typename ... T> struct _and<T0, T...> : std::integral_constant<bool, T0::value && _and<T...>::value>{}; 
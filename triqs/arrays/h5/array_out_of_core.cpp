@@ -0,0 +1,84 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "./array_out_of_core.hpp"
+#include "./../../h5/base.hpp"
+
+using dcomplex = std::complex<double>;
+namespace triqs {
+namespace arrays {
+ namespace h5_impl {
+
+  template <typename T>
+  void create_chunked_dataset(h5::group g, std::string const &name, int R, size_t const *lengths, size_t chunk_length) {
+   bool is_complex = triqs::is_complex<T>::value;
+   int rank = R + (is_complex ? 1 : 0);
+   hsize_t dims[rank], chunk_dims[rank];
+   for (int u = 0; u < R; ++u) dims[u] = chunk_dims[u] = lengths[u];
+   chunk_dims[0] = std::max(hsize_t(1), std::min(hsize_t(chunk_length), dims[0]));
+   if (is_complex) dims[R] = chunk_dims[R] = 2;
+
+   h5::dataspace d_space = H5Screate_simple(rank, dims, NULL);
+   h5::proplist cparms = H5Pcreate(H5P_DATASET_CREATE);
+   if (H5Pset_chunk(cparms, rank, chunk_dims) < 0) TRIQS_RUNTIME_ERROR << "Cannot set the chunks of the dataset " << name;
+   h5::dataset ds = g.create_dataset(name, h5::data_type_file<T>(), d_space, cparms);
+
+   // if complex, to be python compatible, we add the __complex__ attribute
+   if (is_complex) h5::write_string_attribute(ds, "__complex__", "1");
+  }
+
+  // the dataspaces of the slab in the file and in memory (a C ordered buffer of the slab only)
+  static std::pair<h5::dataspace, h5::dataspace> slab_spaces(int R, bool is_complex, size_t const *lengths, size_t first, size_t n) {
+   hsize_t Ltot[R], L[R], S[R], offset[R];
+   for (int u = 0; u < R; ++u) {
+    Ltot[u] = L[u] = lengths[u];
+    S[u] = 1;
+    offset[u] = 0;
+   }
+   L[0] = n;
+   offset[0] = first;
+   auto f_space = h5::dataspace_from_LS(R, is_complex, Ltot, L, S, offset);
+   auto m_space = h5::dataspace_from_LS(R, is_complex, L, L, S);
+   return {f_space, m_space};
+  }
+
+  template <typename T> void read_slab(h5::dataset ds, int R, size_t const *lengths, size_t first, size_t n, T *buf) {
+   auto sp = slab_spaces(R, triqs::is_complex<T>::value, lengths, first, n);
+   herr_t err = H5Dread(ds, h5::data_type_memory<T>(), sp.second, sp.first, H5P_DEFAULT, h5::get_data_ptr(buf));
+   if (err < 0) TRIQS_RUNTIME_ERROR << "Error reading the slab [" << first << ", " << first + n << ") of a dataset";
+  }
+
+  template <typename T> void write_slab(h5::dataset ds, int R, size_t const *lengths, size_t first, size_t n, T const *buf) {
+   auto sp = slab_spaces(R, triqs::is_complex<T>::value, lengths, first, n);
+   herr_t err = H5Dwrite(ds, h5::data_type_memory<T>(), sp.second, sp.first, H5P_DEFAULT, h5::get_data_ptr(buf));
+   if (err < 0) TRIQS_RUNTIME_ERROR << "Error writing the slab [" << first << ", " << first + n << ") of a dataset";
+  }
+
+#define TRIQS_INSTANTIATE(T)                                                                                                     \
+ template void create_chunked_dataset<T>(h5::group g, std::string const &name, int R, size_t const *lengths, size_t chunk_length); \
+ template void read_slab<T>(h5::dataset ds, int R, size_t const *lengths, size_t first, size_t n, T * buf);                      \
+ template void write_slab<T>(h5::dataset ds, int R, size_t const *lengths, size_t first, size_t n, T const *buf);
+
+  TRIQS_INSTANTIATE(double);
+  TRIQS_INSTANTIATE(dcomplex);
+#undef TRIQS_INSTANTIATE
+ }
+}
+}
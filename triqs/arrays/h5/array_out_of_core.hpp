@@ -0,0 +1,168 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include "../array.hpp"
+#include "./simple_read_write.hpp"
+#include <triqs/h5.hpp>
+#include <iostream>
+#include <list>
+#include <unordered_map>
+
+namespace triqs {
+namespace arrays {
+
+ namespace h5_impl {
+  // Implemented in array_out_of_core.cpp for double and dcomplex.
+  // Create a dataset of the given lengths, chunked by slabs of chunk_length along the first dimension.
+  template <typename T> void create_chunked_dataset(h5::group g, std::string const &name, int R, size_t const *lengths, size_t chunk_length);
+
+  // Read/write the slab [first, first + n) of the first dimension of the dataset from/to a C ordered buffer.
+  template <typename T> void read_slab(h5::dataset ds, int R, size_t const *lengths, size_t first, size_t n, T *buf);
+  template <typename T> void write_slab(h5::dataset ds, int R, size_t const *lengths, size_t first, size_t n, T const *buf);
+ }
+
+ /**
+  * An array<T, R> stored in a dataset of an HDF5 file, of which only a few chunks are kept in memory.
+  *
+  * A chunk is the slab [n * chunk_length, (n + 1) * chunk_length) of the first index.
+  * The cache_size last used chunks are kept in memory. Modified chunks are written back to the file
+  * when they leave the cache, with flush(), or at destruction.
+  * The destructor does not throw : an error while writing back is only reported on std::cerr.
+  * Call flush() explicitly before the destruction to get the write errors as exceptions.
+  *
+  * The dataset is the same as the one of h5_write(g, name, array<T,R>), it can be read as a whole by h5_read.
+  */
+ template <typename T, int R> class array_out_of_core {
+  static_assert(R > 1, "array_out_of_core : rank must be > 1");
+
+  h5::dataset _ds;
+  mini_vector<size_t, R> _lengths;
+  long _chunk_length;
+  size_t _cache_size;
+  long _n_chunk_reads = 0;
+
+  struct chunk_t {
+   array<T, R> data;
+   bool dirty;
+   std::list<long>::iterator lru_pos;
+  };
+  std::list<long> _lru; // chunks in memory, most recently used first
+  std::unordered_map<long, chunk_t> _chunks;
+
+  long _first(long c) const { return c * _chunk_length; }
+  long _size(long c) const { return std::min(_chunk_length, long(_lengths[0]) - _first(c)); }
+
+  void _write_back(long c, chunk_t &ch) {
+   if (!ch.dirty) return;
+   h5_impl::write_slab(_ds, R, _lengths.ptr(), _first(c), _size(c), ch.data.data_start());
+   ch.dirty = false;
+  }
+
+  // the chunk containing the first index i, loaded from the file if necessary
+  chunk_t &_get_chunk(long i) {
+   if ((i < 0) || (i >= long(_lengths[0]))) TRIQS_RUNTIME_ERROR << "array_out_of_core : index " << i << " out of range " << _lengths[0];
+   long c = i / _chunk_length;
+   auto it = _chunks.find(c);
+   if (it != _chunks.end()) { // move it to the front of the LRU list
+    _lru.splice(_lru.begin(), _lru, it->second.lru_pos);
+    return it->second;
+   }
+   if (_chunks.size() >= _cache_size) { // evict the least recently used chunk
+    long c_old = _lru.back();
+    _write_back(c_old, _chunks.at(c_old));
+    _chunks.erase(c_old);
+    _lru.pop_back();
+   }
+   auto sh = _lengths;
+   sh[0] = _size(c);
+   auto ch = chunk_t{array<T, R>(sh), false, {}};
+   h5_impl::read_slab(_ds, R, _lengths.ptr(), _first(c), _size(c), ch.data.data_start());
+   ++_n_chunk_reads;
+   _lru.push_front(c);
+   ch.lru_pos = _lru.begin();
+   return _chunks.emplace(c, std::move(ch)).first->second;
+  }
+
+  public:
+  /**
+   * Create a new dataset name in g, initialized to 0.
+   * @param lengths : shape of the array
+   * @param chunk_length : number of values of the first index in a chunk
+   * @param cache_size : maximal number of chunks in memory
+   */
+  array_out_of_core(h5::group g, std::string const &name, mini_vector<size_t, R> const &lengths, long chunk_length, size_t cache_size)
+     : _lengths(lengths), _chunk_length(chunk_length), _cache_size(cache_size) {
+   if ((chunk_length <= 0) || (cache_size == 0)) TRIQS_RUNTIME_ERROR << "array_out_of_core : chunk_length and cache_size must be > 0";
+   h5_impl::create_chunked_dataset<T>(g, name, R, lengths.ptr(), chunk_length);
+   _ds = g.open_dataset(name);
+  }
+
+  /// Open the existing dataset name in g (chunked or not). Only the slabs of the chunks are read from the file.
+  array_out_of_core(h5::group g, std::string const &name, long chunk_length, size_t cache_size)
+     : _lengths(h5_impl::get_array_lengths(R, g, name, triqs::is_complex<T>::value)),
+       _chunk_length(chunk_length),
+       _cache_size(cache_size) {
+   if ((chunk_length <= 0) || (cache_size == 0)) TRIQS_RUNTIME_ERROR << "array_out_of_core : chunk_length and cache_size must be > 0";
+   _ds = g.open_dataset(name);
+  }
+
+  array_out_of_core(array_out_of_core const &) = delete;
+  array_out_of_core(array_out_of_core &&) = default;
+  array_out_of_core &operator=(array_out_of_core const &) = delete;
+
+  ~array_out_of_core() {
+   try {
+    flush();
+   }
+   catch (std::exception const &e) {
+    std::cerr << "array_out_of_core : write back failed at destruction : " << e.what() << std::endl;
+   }
+   catch (...) {
+    std::cerr << "array_out_of_core : write back failed at destruction" << std::endl;
+   }
+  }
+
+  /// Shape of the whole array
+  mini_vector<size_t, R> const &shape() const { return _lengths; }
+
+  /// Number of chunks read from the file so far
+  long n_chunk_reads() const { return _n_chunk_reads; }
+
+  /// a(i, ...). The view remains valid when the chunk leaves the cache, but does not see later write.
+  array_const_view<T, R - 1> operator()(long i) {
+   auto &ch = _get_chunk(i);
+   return ch.data(i - _first(i / _chunk_length), ellipsis());
+  }
+
+  /// a(i, ...) = x
+  template <typename A> void write(long i, A const &x) {
+   auto &ch = _get_chunk(i);
+   ch.data(i - _first(i / _chunk_length), ellipsis()) = x;
+   ch.dirty = true;
+  }
+
+  /// Write all modified chunks to the file. Throws if the write fails.
+  void flush() {
+   for (auto &x : _chunks) _write_back(x.first, x.second);
+  }
+ };
+}
+}
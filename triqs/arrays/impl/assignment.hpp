@@ -23,11 +23,11 @@
 #include "iterator_adapter.hpp"
 #include "../indexmaps/cuboid/foreach.hpp"
 #include "../storages/memcopy.hpp"
+#include "./flat_evaluation.hpp"
+#include "./tiled_copy.hpp"
 
 namespace triqs { namespace arrays {
 
- namespace Tag {struct indexmap_storage_pair{}; }// defined here since needed below...
- 
  namespace assignment { template<typename LHS, typename RHS, char OP, typename Enable = void>  struct impl; }
 
  // puts the contents of RHS into LHS. LHS must be an indexmap_storage_pair
@@ -75,6 +75,71 @@ namespace triqs { namespace arrays {
   /// RHS is special type that defines its own specialization of assign
   template<class RHS,class LHS> struct is_special : std::false_type {};
 
+  // -----------------    flat assignment (cf flat_evaluation.hpp) --------------------------------------------------
+  // invoke returns false if the flat loop is not possible : the caller then uses foreach.
+  template <typename LHS, typename RHS, char OP, typename Enable = void> struct flat_impl {
+   static bool invoke(LHS&, RHS const&) { return false; }
+  };
+
+  template <typename LHS> struct is_flat_lhs
+      : std::integral_constant<bool, std::is_base_of<Tag::indexmap_storage_pair, LHS>::value &&
+                                         is_scalar<typename std::remove_cv<typename LHS::value_type>::type>::value> {};
+
+  // RHS is an array or an expression which can be evaluated flat
+  template <typename LHS, typename RHS, char OP>
+  struct flat_impl<LHS, RHS, OP, ENABLE_IFC(is_flat_lhs<LHS>::value && flat_eval<RHS>::possible && (!is_scalar_for<RHS, LHS>::value))> {
+   static bool invoke(LHS& lhs, RHS const& rhs) {
+    using v_t = typename std::remove_cv<typename LHS::value_type>::type;
+    auto const& im = lhs.indexmap();
+    if (!im.is_contiguous()) return false;
+    size_t n = im.domain().number_of_elements();
+    v_t* p = lhs.data_start();
+    if (!flat_eval<RHS>::compatible(rhs, im, reinterpret_cast<const char*>(p), reinterpret_cast<const char*>(p + n))) return false;
+    TRIQS_ARRAYS_SIMD_LOOP
+    for (size_t k = 0; k < n; ++k) _ops_<v_t, typename RHS::value_type, OP>::invoke(p[k], flat_eval<RHS>::at(rhs, k));
+    return true;
+   }
+  };
+
+  // RHS is a scalar
+  template <typename LHS, typename RHS, char OP>
+  struct flat_impl<LHS, RHS, OP, ENABLE_IFC(is_flat_lhs<LHS>::value&& is_scalar_for<RHS, LHS>::value)> {
+   static bool invoke(LHS& lhs, RHS const& rhs) {
+    using v_t = typename std::remove_cv<typename LHS::value_type>::type;
+    auto const& im = lhs.indexmap();
+    if (!im.is_contiguous()) return false;
+    size_t n = im.domain().number_of_elements();
+    v_t* p = lhs.data_start();
+    TRIQS_ARRAYS_SIMD_LOOP
+    for (size_t k = 0; k < n; ++k) _ops_<v_t, RHS, OP>::invoke(p[k], rhs);
+    return true;
+   }
+  };
+
+  // -----------------    tiled copy between different memory layouts (cf tiled_copy.hpp) ---------------------------------
+  // invoke returns false if the tiled traversal is not useful (same fastest index, small array) : the caller then uses foreach.
+  template <typename LHS, typename RHS, char OP, typename Enable = void> struct tiled_impl {
+   static bool invoke(LHS&, RHS const&) { return false; }
+  };
+
+  template <typename LHS, typename RHS, char OP>
+  struct tiled_impl<LHS, RHS, OP, ENABLE_IFC(is_flat_lhs<LHS>::value&& is_isp<RHS, LHS>::value && (LHS::rank > 1) && (LHS::rank == RHS::rank) &&
+                                             is_scalar<typename std::remove_cv<typename RHS::value_type>::type>::value)> {
+   static bool invoke(LHS& lhs, RHS const& rhs) {
+    using v_t = typename std::remove_cv<typename LHS::value_type>::type;
+    auto const& iml = lhs.indexmap();
+    auto const& imr = rhs.indexmap();
+    if (!tiled_copy::useful(iml.lengths(), iml.strides(), imr.strides())) return false;
+    v_t* p = lhs.data_start();
+    auto q = rhs.data_start();
+    // aliasing (e.g. A = A.transpose()) : keep the element by element order of foreach
+    if (tiled_copy::overlap(p, iml.strides(), q, imr.strides(), iml.lengths())) return false;
+    tiled_copy::run(iml.lengths(), iml.strides(), imr.strides(),
+                    [p, q](std::ptrdiff_t i, std::ptrdiff_t j) { _ops_<v_t, typename RHS::value_type, OP>::invoke(p[i], q[j]); });
+    return true;
+   }
+  };
+
 #define TRIQS_REJECT_ASSIGN_TO_CONST \
   static_assert( (!std::is_const<typename LHS::value_type>::value ), "Assignment : The value type of the LHS is const and cannot be assigned to !");
 #define TRIQS_REJECT_MATRIX_COMPOUND_MUL_DIV_NON_SCALAR\
@@ -103,7 +168,7 @@ namespace triqs { namespace arrays {
       if (( (OP=='E') && indexmaps::raw_copy_possible(lhs.indexmap(), rhs.indexmap()))) {
        storages::memcopy(lhs.data_start(), rhs.data_start(), rhs.indexmap().domain().number_of_elements());
       }
-      else { foreach(lhs,*this); }
+      else if (!flat_impl<LHS, RHS, OP>::invoke(lhs, rhs) && !tiled_impl<LHS, RHS, OP>::invoke(lhs, rhs)) { foreach(lhs,*this); }
      }
     };
 
@@ -116,7 +181,9 @@ namespace triqs { namespace arrays {
       LHS & lhs; const RHS & rhs; 
       impl(LHS & lhs_, const RHS & rhs_): lhs(lhs_), rhs(rhs_) {}
       template<typename ... Args> void operator()(Args const & ... args) const { _ops_<value_type, typename RHS::value_type, OP>::invoke(lhs(args...),rhs(args...));}
-      FORCEINLINE void invoke() { foreach(lhs,*this); }
+      FORCEINLINE void invoke() {
+       if (!flat_impl<LHS, RHS, OP>::invoke(lhs, rhs)) foreach(lhs, *this);
+      }
      };
 
      // help compiler : in the most common case, less things to inline..
@@ -126,7 +193,9 @@ namespace triqs { namespace arrays {
       typedef typename LHS::value_type value_type;
       LHS & lhs; const RHS & rhs;
       impl(LHS & lhs_, const RHS & rhs_): lhs(lhs_), rhs(rhs_) {}
-      FORCEINLINE void invoke() { assign_foreach(lhs, rhs); }
+      FORCEINLINE void invoke() {
+       if (!flat_impl<LHS, RHS, 'E'>::invoke(lhs, rhs)) assign_foreach(lhs, rhs);
+      }
      };
 
     // -----------------   assignment for scalar RHS, except some matrix case --------------------------------------------------
@@ -137,7 +206,9 @@ namespace triqs { namespace arrays {
       LHS & lhs; const RHS & rhs; 
       impl(LHS & lhs_, const RHS & rhs_): lhs(lhs_), rhs(rhs_){}
       template<typename ... Args> void operator()(Args const & ...args) const {_ops_<value_type, RHS, OP>::invoke(lhs(args...), rhs);}
-      void invoke() { foreach(lhs,*this);  }
+      void invoke() {
+       if (!flat_impl<LHS, RHS, OP>::invoke(lhs, rhs)) foreach(lhs, *this);
+      }
      };
 
     // -----------------   assignment for scalar RHS for Matrices --------------------------------------------------
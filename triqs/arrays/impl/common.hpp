@@ -72,6 +72,21 @@ namespace triqs {
  namespace arrays {
   using triqs::make_clone;
 
+  /**
+   * Tag of the constructors of array, matrix, vector which do not initialize the elements : e.g.
+   *   array<dcomplex, 3> a(make_shape(n1, n2, n3), no_init);
+   * The elements of the scalar types, including complex, are left uninitialized (complex is otherwise set to 0).
+   * The other types are default constructed as usual. Use it when all the elements are written right after the construction.
+   */
+  struct no_init_t {};
+  constexpr no_init_t no_init = {};
+
+  /// Makes a const view which does not touch the reference counting : it can be given to other threads, as long as x outlives it.
+  template<typename A> auto make_weak_const_view(A const & x) -> decltype(x()) { return x();}
+
+  /// Atomic reference counting of the memory of x (cf arrays/storages/mem_block.hpp) : the views of x can then be made and destroyed in several threads.
+  template<typename A> void make_thread_safe(A const & x) { x.storage().set_thread_safe(true);}
+
   /// Is the data contiguous
   template<typename A> TYPE_DISABLE_IFC(bool, is_amv_value_or_view_class<A>::value) has_contiguous_data(A const &) {return false;}
   template<typename A> TYPE_ENABLE_IFC(bool, is_amv_value_class<A>::value) has_contiguous_data(A const &) {return true;}
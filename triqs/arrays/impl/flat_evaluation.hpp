@@ -0,0 +1,81 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include "../indexmaps/cuboid/map.hpp"
+#include <triqs/utility/c14.hpp>
+#include <type_traits>
+
+// Hint for the vectorization of the flat loops
+#if defined(TRIQS_WITH_OPENMP) && defined(_OPENMP) && (_OPENMP >= 201307)
+#define TRIQS_ARRAYS_SIMD_LOOP _Pragma("omp simd")
+#elif defined(__clang__)
+#define TRIQS_ARRAYS_SIMD_LOOP _Pragma("clang loop vectorize(enable)")
+#elif defined(__GNUC__)
+#define TRIQS_ARRAYS_SIMD_LOOP _Pragma("GCC ivdep")
+#else
+#define TRIQS_ARRAYS_SIMD_LOOP
+#endif
+
+namespace triqs {
+namespace arrays {
+
+ namespace Tag {
+  struct indexmap_storage_pair {};
+ }
+
+ /**
+  * Flat evaluation of an array expression.
+  *
+  * When the LHS of an assignment and all the arrays in the RHS expression are contiguous, with the same lengths and memory layout,
+  * the element at position k in memory of the LHS is computed from the elements at position k of the arrays : the assignment
+  * is a simple 1d loop, which the compiler can vectorize (instead of the nested loops of foreach, with the full index computation).
+  *
+  * flat_eval<X> is specialized for the arrays and for each node of the expressions (in the file of the node), with
+  *   static constexpr bool possible = true;
+  *   // can x be evaluated flat, with the memory layout of the indexmap im ?
+  *   // [lhs_begin, lhs_end) : the memory of the LHS. A partial overlap with an array of x prevents the flat evaluation.
+  *   template <typename IM> static bool compatible(X const &x, IM const &im, const char *lhs_begin, const char *lhs_end);
+  *   static value_type at(X const &x, size_t k); // the element at position k in memory
+  * X may be a reference.
+  */
+ template <typename X, typename Enable = void> struct flat_eval {
+  static constexpr bool possible = false;
+ };
+
+ template <typename X> struct flat_eval<X &, void> : flat_eval<X> {};
+ template <typename X> struct flat_eval<X const, void> : flat_eval<X> {};
+
+ // an array, matrix, vector or view
+ template <typename X>
+ struct flat_eval<X, std14::enable_if_t<std::is_base_of<Tag::indexmap_storage_pair, X>::value && !std::is_const<X>::value>> {
+  static constexpr bool possible = true;
+  template <typename IM> static bool compatible(X const &x, IM const &im, const char *lhs_begin, const char *lhs_end) {
+   auto const &xim = x.indexmap();
+   if (!((xim.lengths() == im.lengths()) && indexmaps::raw_copy_possible(xim, im))) return false;
+   auto b = static_cast<const char *>(static_cast<const void *>(x.data_start()));
+   auto e = static_cast<const char *>(static_cast<const void *>(x.data_start() + xim.domain().number_of_elements()));
+   // the same memory as the LHS (e.g. A = A + B) is fine, a shifted one is not
+   return (b == lhs_begin) || (e <= lhs_begin) || (b >= lhs_end);
+  }
+  static auto at(X const &x, size_t k) -> decltype(x.data_start()[k]) { return x.data_start()[k]; }
+ };
+}
+}
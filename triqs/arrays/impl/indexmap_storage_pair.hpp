@@ -86,6 +86,11 @@ namespace triqs { namespace arrays {
       storage_ = StorageType(indexmap_.domain().number_of_elements());
      }
 
+     /// Idem, without initializing the elements (cf no_init)
+     indexmap_storage_pair(const indexmap_type &IM, no_init_t) : indexmap_(IM), storage_() {
+      storage_ = StorageType(indexmap_.domain().number_of_elements(), no_init);
+     }
+
      public:
     // Shallow copy
     indexmap_storage_pair(indexmap_storage_pair const &X) = default;
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include "../indexmaps/cuboid/map.hpp"
+#include <triqs/utility/parallel.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <utility>
+
+namespace triqs {
+namespace arrays {
+
+ /**
+  * Cache blocked traversal for the copy between two arrays of different memory layouts (C <-> Fortran, transposed views, ...).
+  *
+  * foreach runs in the memory order of the LHS : when the fastest index of the RHS is another one, each read
+  * jumps by a large stride and touches a new cache line. Here, the plane of the two fastest indices (a for the destination,
+  * b for the source) is cut in tiles of block_size x block_size, which fit in the L1 cache on both sides.
+  * The other indices are run in the memory order of the destination, in the outer loop.
+  * For large arrays, the tiles are distributed over the threads (cf utility/parallel.hpp).
+  *
+  * The kernel works on the offsets only : run calls f(offset in the destination, offset in the source) for each element.
+  */
+ namespace tiled_copy {
+
+  constexpr long block_size = 32;
+  constexpr long min_size = 1024;         // below, foreach is as good
+  constexpr long parallel_size = 1 << 16; // number of elements from which the tiles are distributed over the threads
+
+  // the index with the smallest stride, among the indices of length > 1. -1 if there is none.
+  template <int R> int fastest_index(mini_vector<size_t, R> const &l, mini_vector<std::ptrdiff_t, R> const &s) {
+   int r = -1;
+   for (int u = 0; u < R; ++u)
+    if ((l[u] > 1) && ((r == -1) || (std::abs(s[u]) < std::abs(s[r])))) r = u;
+   return r;
+  }
+
+  // is the tiled traversal better than foreach for this copy ?
+  template <int R>
+  bool useful(mini_vector<size_t, R> const &l, mini_vector<std::ptrdiff_t, R> const &sd, mini_vector<std::ptrdiff_t, R> const &ss) {
+   if (R < 2) return false;
+   long n = 1;
+   for (int u = 0; u < R; ++u) n *= l[u];
+   return (n >= min_size) && (fastest_index(l, sd) != fastest_index(l, ss));
+  }
+
+  // the memory [begin, end) spanned by an array
+  template <typename T, int R> std::pair<const char *, const char *> span(T const *p, mini_vector<size_t, R> const &l, mini_vector<std::ptrdiff_t, R> const &s) {
+   std::ptrdiff_t lo = 0, hi = 0;
+   for (int u = 0; u < R; ++u) (s[u] < 0 ? lo : hi) += (long(l[u]) - 1) * s[u];
+   return {reinterpret_cast<const char *>(p + lo), reinterpret_cast<const char *>(p + hi + 1)};
+  }
+
+  // do the memory of the two arrays overlap ?
+  template <typename T1, typename T2, int R>
+  bool overlap(T1 const *p1, mini_vector<std::ptrdiff_t, R> const &s1, T2 const *p2, mini_vector<std::ptrdiff_t, R> const &s2,
+               mini_vector<size_t, R> const &l) {
+   auto x1 = span(p1, l, s1), x2 = span(p2, l, s2);
+   return (x1.first < x2.second) && (x2.first < x1.second);
+  }
+
+  /**
+   * Calls f(od, os) for all the elements, od (resp. os) being the offset of the element for the strides sd (resp. ss).
+   * Precondition : useful(l, sd, ss).
+   */
+  template <int R, typename F>
+  void run(mini_vector<size_t, R> const &l, mini_vector<std::ptrdiff_t, R> const &sd, mini_vector<std::ptrdiff_t, R> const &ss, F const &f) {
+   int a = fastest_index(l, sd), b = fastest_index(l, ss);
+   // the other indices, from the slowest to the fastest in the destination
+   std::array<int, R> others;
+   int n_others = 0;
+   long n_outer = 1;
+   for (int u = 0; u < R; ++u)
+    if ((u != a) && (u != b)) {
+     others[n_others++] = u;
+     n_outer *= l[u];
+    }
+   std::sort(others.begin(), others.begin() + n_others, [&sd](int i, int j) { return std::abs(sd[i]) > std::abs(sd[j]); });
+   long la = l[a], lb = l[b], nba = (la + block_size - 1) / block_size, nbb = (lb + block_size - 1) / block_size;
+   long n_tiles = n_outer * nba * nbb;
+   std::ptrdiff_t sda = sd[a], sdb = sd[b], ssa = ss[a], ssb = ss[b];
+
+   auto kernel = [&](long first, long last) {
+    for (long t = first; t < last; ++t) {
+     long ia = t % nba, r = t / nba, ib = r % nbb, o = r / nbb;
+     std::ptrdiff_t od = 0, os = 0;
+     for (int k = n_others - 1; k >= 0; --k) {
+      int u = others[k];
+      long i = o % long(l[u]);
+      o /= long(l[u]);
+      od += i * sd[u];
+      os += i * ss[u];
+     }
+     long a1 = std::min(la, (ia + 1) * block_size), b1 = std::min(lb, (ib + 1) * block_size);
+     for (long j = ib * block_size; j < b1; ++j)
+      for (long i = ia * block_size; i < a1; ++i) f(od + i * sda + j * sdb, os + i * ssa + j * ssb);
+    }
+   };
+   long n = n_outer * la * lb;
+   utility::parallel_for_chunks(n_tiles, kernel, (n >= parallel_size ? 2 : n_tiles + 1));
+  }
+ }
+}
+}
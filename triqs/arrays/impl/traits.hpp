@@ -52,6 +52,7 @@ namespace arrays {
   struct vector_view {};
   struct matrix_view {};
   struct matrix {};
+  struct static_matrix {};
  }
  template <typename T> struct is_array : std::is_base_of<Tag::array, T> {};
  template <typename T> struct is_array_view : std::is_base_of<Tag::array_view, T> {};
@@ -64,6 +65,7 @@ namespace arrays {
  template <typename T> struct is_matrix : std::is_base_of<Tag::matrix, T> {};
  template <typename T> struct is_matrix_view : std::is_base_of<Tag::matrix_view, T> {};
  template <typename T> struct is_matrix_or_view : _or<is_matrix<T>, is_matrix_view<T>> {};
+ template <typename T> struct is_static_matrix : std::is_base_of<Tag::static_matrix, T> {};
 
  template <class T> struct is_amv_value_class : _or<is_array<T>, is_matrix<T>, is_vector<T>> {};
  template <class T> struct is_amv_view_class : _or<is_array_view<T>, is_matrix_view<T>, is_vector_view<T>> {};
@@ -0,0 +1,179 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include <triqs/utility/parallel.hpp>
+#include "./det_and_inverse.hpp"
+#include <vector>
+
+namespace triqs {
+namespace arrays {
+
+ /**
+  * Inversion of many square matrices of the same size.
+  *
+  * The workspace (pivots, work array of getri, buffer) is allocated once in the constructor,
+  * and reused for all the matrices given to invert.
+  * Matrices of size 1, 2, 3 are inverted with explicit formulas, larger ones with lapack getrf/getri.
+  *
+  * The worker works on raw memory, hence it never creates a view of the arrays,
+  * and several workers can be used concurrently on the same array by different threads.
+  */
+ template <typename T> class batched_inverse_worker {
+  static_assert(is_blas_lapack_type<T>::value, "batched_inverse_worker : only for double and complex<double>");
+  int dim, lwork;
+  std::vector<int> ipiv;
+  std::vector<T> work, buffer;
+
+  public:
+  batched_inverse_worker(int dim_) : dim(dim_), lwork(1) {
+   if (dim <= 3) return;
+   ipiv.resize(dim);
+   buffer.resize(dim * dim);
+   // ask getri once for the optimal size of the workspace
+   T work1[2];
+   int info;
+   lapack::f77::getri(dim, buffer.data(), dim, ipiv.data(), work1, -1, info);
+   lwork = std::max(int(lapack::r_round(work1[0])), dim);
+   work.resize(lwork);
+  }
+
+  int size() const { return dim; }
+
+  /**
+   * Inverts in place the dim x dim matrix M(i,j) = p[i * s0 + j * s1].
+   * Throws matrix_inverse_exception if the matrix is singular.
+   */
+  void invert(T *p, std::ptrdiff_t s0, std::ptrdiff_t s1) {
+   switch (dim) {
+    case 0: return;
+    case 1: return _invert1(p);
+    case 2: return _invert2(p, s0, s1);
+    case 3: return _invert3(p, s0, s1);
+   }
+   // lapack works in Fortran order. For a C ordered matrix, we invert the transpose in place, which is the same.
+   if ((s1 == 1) && (s0 >= dim)) return _lapack(p, s0);
+   if ((s0 == 1) && (s1 >= dim)) return _lapack(p, s1);
+   // not contiguous : work in the buffer
+   for (int i = 0; i < dim; ++i)
+    for (int j = 0; j < dim; ++j) buffer[i + j * dim] = p[i * s0 + j * s1];
+   _lapack(buffer.data(), dim);
+   for (int i = 0; i < dim; ++i)
+    for (int j = 0; j < dim; ++j) p[i * s0 + j * s1] = buffer[i + j * dim];
+  }
+
+  private:
+  static void _check_det(T const &det) {
+   if (det == T(0)) throw matrix_inverse_exception() << "Inverse/Det error : matrix is not invertible";
+  }
+
+  static void _invert1(T *p) {
+   _check_det(p[0]);
+   p[0] = T(1) / p[0];
+  }
+
+  static void _invert2(T *p, std::ptrdiff_t s0, std::ptrdiff_t s1) {
+   T &a = p[0], &b = p[s1], &c = p[s0], &d = p[s0 + s1];
+   T det = a * d - b * c;
+   _check_det(det);
+   T x = T(1) / det;
+   T a1 = d * x, b1 = -b * x, c1 = -c * x, d1 = a * x;
+   a = a1, b = b1, c = c1, d = d1;
+  }
+
+  static void _invert3(T *p, std::ptrdiff_t s0, std::ptrdiff_t s1) {
+   auto m = [p, s0, s1](int i, int j) -> T &{ return p[i * s0 + j * s1]; };
+   T c00 = m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1);
+   T c01 = m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2);
+   T c02 = m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0);
+   T det = m(0, 0) * c00 + m(0, 1) * c01 + m(0, 2) * c02;
+   _check_det(det);
+   T x = T(1) / det;
+   T r[3][3];
+   r[0][0] = c00 * x;
+   r[1][0] = c01 * x;
+   r[2][0] = c02 * x;
+   r[0][1] = (m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2)) * x;
+   r[1][1] = (m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0)) * x;
+   r[2][1] = (m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1)) * x;
+   r[0][2] = (m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1)) * x;
+   r[1][2] = (m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2)) * x;
+   r[2][2] = (m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0)) * x;
+   for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) m(i, j) = r[i][j];
+  }
+
+  void _lapack(T *p, int ld) {
+   int info;
+   lapack::f77::getrf(dim, dim, p, ld, ipiv.data(), info);
+   if (info < 0) throw matrix_inverse_exception() << "Inverse/Det error : failure of getrf lapack routine ";
+   if (info > 0) throw matrix_inverse_exception() << "Inverse/Det error : matrix is not invertible";
+   lapack::f77::getri(dim, p, ld, ipiv.data(), work.data(), lwork, info);
+   if (info != 0) throw matrix_inverse_exception() << "Inverse/Det error : matrix is not invertible";
+  }
+ };
+
+ namespace batched_impl {
+
+  // The number of matrices : product of the first n_leading lengths
+  template <typename L> long n_matrices(L const &l, int n_leading) {
+   long n = 1;
+   for (int r = 0; r < n_leading; ++r) n *= l[r];
+   return n;
+  }
+
+  // The offset of the i-th matrix, the first n_leading indices being in C order
+  template <typename L, typename S> std::ptrdiff_t offset(L const &l, S const &s, int n_leading, long i) {
+   std::ptrdiff_t r = 0;
+   for (int u = n_leading - 1; u >= 0; --u) {
+    r += (i % l[u]) * s[u];
+    i /= l[u];
+   }
+   return r;
+  }
+ }
+
+ /**
+  * Inverts in place all the matrices a(n..., range(), range()) of an array of rank >=3 :
+  * the last two indices are the matrix indices, the first ones label the matrices.
+  *
+  * The matrices are distributed over the threads (cf triqs/utility/parallel.hpp),
+  * each thread using its own batched_inverse_worker.
+  */
+ template <typename A> void batched_inverse_in_place(A &&a) {
+  using A_t = std14::decay_t<A>;
+  using value_type = std14::remove_const_t<typename A_t::value_type>;
+  constexpr int R = A_t::rank;
+  static_assert(R >= 3, "batched_inverse_in_place : the array must be of rank >= 3");
+  auto const &l = a.indexmap().lengths();
+  auto const &s = a.indexmap().strides();
+  long dim = l[R - 1];
+  if (long(l[R - 2]) != dim) TRIQS_RUNTIME_ERROR << "Inverse : matrices are not square but of size " << l[R - 2] << " x " << dim;
+  long n = batched_impl::n_matrices(l, R - 2);
+  value_type *p = a.data_start();
+  // one inversion is O(dim^3) : no need of a large grain for large matrices
+  long grain = std::max(1l, utility::parallel_grain_size / (dim * dim));
+  utility::parallel_for_chunks(n, [&](long first, long last) {
+   batched_inverse_worker<value_type> worker(dim);
+   for (long i = first; i < last; ++i) worker.invert(p + batched_impl::offset(l, s, R - 2, i), s[R - 2], s[R - 1]);
+  }, grain);
+ }
+}
+}
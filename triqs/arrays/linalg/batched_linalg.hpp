@@ -0,0 +1,337 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include "./batched_inverse.hpp"
+#include "./eigenelements.hpp"
+#include "../blas_lapack/gemm.hpp"
+#include "../blas_lapack/getrs.hpp"
+
+/**
+ * Linear algebra on stacks of small matrices of the same size.
+ *
+ * The arrays are of rank R >= 3 : the last two indices are the matrix indices, the first ones label the matrices
+ * (e.g. a gf data array g(omega, i, j), or the Hamiltonian on a grid of k points h(k, i, j)).
+ * All arrays of a call must have the same leading lengths.
+ *
+ * The blas/lapack routine is called directly on the memory of each matrix, without any view or copy,
+ * as long as one of its strides is 1 (C or Fortran order, possibly with a leading dimension).
+ * Otherwise, the matrix is copied in a buffer of the worker.
+ * The workspaces are allocated once per thread, the matrices are distributed over the threads (cf triqs/utility/parallel.hpp).
+ */
+namespace triqs {
+namespace arrays {
+
+ namespace batched_impl {
+
+  /**
+   * Can the n0 x n1 matrix M(i,j) = p[i * s0 + j * s1] be given to blas/lapack directly ?
+   * If yes, M = op(P) with P in Fortran order, of leading dimension ld, and op = identity (trans = 'N') or transpose (trans = 'T').
+   */
+  inline bool as_fortran(std::ptrdiff_t s0, std::ptrdiff_t s1, int n0, int n1, char &trans, int &ld) {
+   // the stride of an index of length <=1 is irrelevant
+   if (n1 <= 1) {
+    if ((s0 == 1) || (n0 <= 1)) return trans = 'N', ld = std::max(1, n0), true;
+    return trans = 'T', ld = s0, (s0 >= 1);
+   }
+   if (n0 <= 1) {
+    if (s1 == 1) return trans = 'T', ld = std::max(1, n1), true;
+    return trans = 'N', ld = s1, (s1 >= 1);
+   }
+   if ((s0 == 1) && (s1 >= n0)) return trans = 'N', ld = s1, true;
+   if ((s1 == 1) && (s0 >= n1)) return trans = 'T', ld = s0, true;
+   return false;
+  }
+
+  inline char flip(char trans) { return (trans == 'N' ? 'T' : 'N'); }
+
+  // copy M(i,j) = p[i * s0 + j * s1] in buf, in Fortran order, and back
+  template <typename T>
+  void to_buffer(T const *p, std::ptrdiff_t s0, std::ptrdiff_t s1, int n0, int n1, std::vector<T> &buf) {
+   buf.resize(std::max(1, n0 * n1));
+   for (int j = 0; j < n1; ++j)
+    for (int i = 0; i < n0; ++i) buf[i + j * n0] = p[i * s0 + j * s1];
+  }
+  template <typename T>
+  void from_buffer(std::vector<T> const &buf, T *p, std::ptrdiff_t s0, std::ptrdiff_t s1, int n0, int n1) {
+   for (int j = 0; j < n1; ++j)
+    for (int i = 0; i < n0; ++i) p[i * s0 + j * s1] = buf[i + j * n0];
+  }
+
+  // Checks that the arrays have the same leading lengths, and returns the number of matrices
+  template <int NL, typename A> long check_batch(const char *, A const &a) { return n_matrices(a.indexmap().lengths(), NL); }
+  template <int NL, typename A, typename B, typename... Bs>
+  long check_batch(const char *fname, A const &a, B const &b, Bs const &... bs) {
+   for (int r = 0; r < NL; ++r)
+    if (b.indexmap().lengths()[r] != a.indexmap().lengths()[r])
+     TRIQS_RUNTIME_ERROR << fname << " : the leading lengths of the arrays do not match";
+   return check_batch<NL>(fname, a, bs...);
+  }
+
+  // lapack eigensolvers. The eigenvalues are in w, the eigenvectors (if jobz = 'V') in a.
+  inline void syev(char jobz, int n, double *a, int lda, double *w, double *work, int lwork, double *, int &info) {
+   char uplo = 'U';
+   linalg::TRIQS_FORTRAN_MANGLING(dsyev)(&jobz, &uplo, n, a, lda, w, work, lwork, info);
+  }
+  inline void syev(char jobz, int n, std::complex<double> *a, int lda, double *w, std::complex<double> *work, int lwork,
+                   double *rwork, int &info) {
+   char uplo = 'U';
+   linalg::TRIQS_FORTRAN_MANGLING(zheev)(&jobz, &uplo, n, a, lda, w, work, lwork, rwork, info);
+  }
+ }
+
+ //------------------------------------------------------------------
+
+ /// C = alpha A B + beta C for the m x k matrix A and the k x n matrix B. The buffers are used for non blas compatible matrices.
+ template <typename T> class batched_gemm_worker {
+  static_assert(is_blas_lapack_type<T>::value, "batched_gemm_worker : only for double and complex<double>");
+  int m, n, k;
+  std::vector<T> ba, bb, bc;
+
+  public:
+  batched_gemm_worker(int m_, int n_, int k_) : m(m_), n(n_), k(k_) {}
+
+  void operator()(T alpha, T const *pa, std::ptrdiff_t sa0, std::ptrdiff_t sa1, T const *pb, std::ptrdiff_t sb0,
+                  std::ptrdiff_t sb1, T beta, T *pc, std::ptrdiff_t sc0, std::ptrdiff_t sc1) {
+   using namespace batched_impl;
+   char ta, tb, tc;
+   int lda, ldb, ldc;
+   if (!as_fortran(sa0, sa1, m, k, ta, lda)) {
+    to_buffer(pa, sa0, sa1, m, k, ba);
+    pa = ba.data(), ta = 'N', lda = std::max(1, m);
+   }
+   if (!as_fortran(sb0, sb1, k, n, tb, ldb)) {
+    to_buffer(pb, sb0, sb1, k, n, bb);
+    pb = bb.data(), tb = 'N', ldb = std::max(1, k);
+   }
+   T *c = pc;
+   bool c_in_buffer = !as_fortran(sc0, sc1, m, n, tc, ldc);
+   if (c_in_buffer) {
+    to_buffer(pc, sc0, sc1, m, n, bc);
+    c = bc.data(), tc = 'N', ldc = std::max(1, m);
+   }
+   if (tc == 'N')
+    blas::f77::gemm(ta, tb, m, n, k, alpha, pa, lda, pb, ldb, beta, c, ldc);
+   else // C is stored as its transpose : compute tC = tB tA
+    blas::f77::gemm(flip(tb), flip(ta), n, m, k, alpha, pb, ldb, pa, lda, beta, c, ldc);
+   if (c_in_buffer) from_buffer(bc, pc, sc0, sc1, m, n);
+  }
+ };
+
+ /**
+  * c(n...) = alpha * a(n...) * b(n...) + beta * c(n...) for all the matrices of the arrays a, b, c of rank R >= 3.
+  * c is not resized : it must have the lengths of the product (it is typically a view).
+  */
+ template <typename A, typename B, typename C>
+ void batched_gemm(typename std14::decay_t<A>::value_type alpha, A const &a, B const &b,
+                   typename std14::decay_t<A>::value_type beta, C &&c) {
+  using value_type = std14::remove_const_t<typename std14::decay_t<A>::value_type>;
+  using C_t = std14::decay_t<C>;
+  constexpr int R = C_t::rank;
+  static_assert((A::rank == R) && (B::rank == R) && (R >= 3), "batched_gemm : the arrays must be of the same rank >= 3");
+  long n_mat = batched_impl::check_batch<R - 2>("batched_gemm", c, a, b);
+  auto const &la = a.indexmap().lengths(), &lb = b.indexmap().lengths(), &lc = c.indexmap().lengths();
+  int m = la[R - 2], k = la[R - 1], n = lb[R - 1];
+  if ((long(lb[R - 2]) != k) || (long(lc[R - 2]) != m) || (long(lc[R - 1]) != n))
+   TRIQS_RUNTIME_ERROR << "batched_gemm : dimension mismatch : " << m << " x " << k << " times " << lb[R - 2] << " x " << n
+                       << " into " << lc[R - 2] << " x " << lc[R - 1];
+  auto const &sa = a.indexmap().strides(), &sb = b.indexmap().strides(), &sc = c.indexmap().strides();
+  value_type const *pa = a.data_start(), *pb = b.data_start();
+  value_type *pc = c.data_start();
+  long grain = std::max(1l, utility::parallel_grain_size / std::max(1l, long(m) * n * k));
+  utility::parallel_for_chunks(n_mat, [&](long first, long last) {
+   batched_gemm_worker<value_type> worker(m, n, k);
+   for (long i = first; i < last; ++i)
+    worker(alpha, pa + batched_impl::offset(la, sa, R - 2, i), sa[R - 2], sa[R - 1], pb + batched_impl::offset(lb, sb, R - 2, i),
+           sb[R - 2], sb[R - 1], beta, pc + batched_impl::offset(lc, sc, R - 2, i), sc[R - 2], sc[R - 1]);
+  }, grain);
+ }
+
+ //------------------------------------------------------------------
+
+ /**
+  * Solves A X = B for the dim x dim matrix A and the dim x nrhs matrix B, with lapack getrf/getrs.
+  * A is destroyed (replaced by its LU factors), B is replaced by X.
+  */
+ template <typename T> class batched_gesv_worker {
+  static_assert(is_blas_lapack_type<T>::value, "batched_gesv_worker : only for double and complex<double>");
+  int dim, nrhs;
+  std::vector<int> ipiv;
+  std::vector<T> ba, bb;
+
+  public:
+  batched_gesv_worker(int dim_, int nrhs_) : dim(dim_), nrhs(nrhs_), ipiv(std::max(1, dim_)) {}
+
+  void operator()(T *pa, std::ptrdiff_t sa0, std::ptrdiff_t sa1, T *pb, std::ptrdiff_t sb0, std::ptrdiff_t sb1) {
+   using namespace batched_impl;
+   if (dim == 0) return;
+   char ta, tb;
+   int lda, ldb, info;
+   if (!as_fortran(sa0, sa1, dim, dim, ta, lda)) {
+    to_buffer(pa, sa0, sa1, dim, dim, ba);
+    pa = ba.data(), ta = 'N', lda = dim;
+   }
+   // For a C ordered A, lapack factorizes its transpose : we solve with trans = 'T'
+   lapack::f77::getrf(dim, dim, pa, lda, ipiv.data(), info);
+   if (info < 0) TRIQS_RUNTIME_ERROR << "batched_gesv : error code getrf : " << info;
+   if (info > 0) throw matrix_inverse_exception() << "batched_gesv : matrix is not invertible";
+   T *b = pb;
+   bool b_in_buffer = !(as_fortran(sb0, sb1, dim, nrhs, tb, ldb) && (tb == 'N'));
+   if (b_in_buffer) {
+    to_buffer(pb, sb0, sb1, dim, nrhs, bb);
+    b = bb.data(), ldb = dim;
+   }
+   lapack::f77::getrs(ta, dim, nrhs, pa, lda, ipiv.data(), b, ldb, info);
+   if (info != 0) TRIQS_RUNTIME_ERROR << "batched_gesv : error code getrs : " << info;
+   if (b_in_buffer) from_buffer(bb, pb, sb0, sb1, dim, nrhs);
+  }
+ };
+
+ /**
+  * Solves a(n...) x = b(n...) for all the matrices of the arrays a, b of rank R >= 3.
+  * b(n...) is a dim x nrhs matrix, replaced by the solution x. The content of a is destroyed.
+  * Throws matrix_inverse_exception if one of the matrices is singular.
+  */
+ template <typename A, typename B> void batched_gesv(A &&a, B &&b) {
+  using value_type = typename std14::decay_t<A>::value_type;
+  constexpr int R = std14::decay_t<A>::rank;
+  static_assert((std14::decay_t<B>::rank == R) && (R >= 3), "batched_gesv : the arrays must be of the same rank >= 3");
+  long n_mat = batched_impl::check_batch<R - 2>("batched_gesv", a, b);
+  auto const &la = a.indexmap().lengths(), &lb = b.indexmap().lengths();
+  int dim = la[R - 1], nrhs = lb[R - 1];
+  if ((long(la[R - 2]) != dim) || (long(lb[R - 2]) != dim))
+   TRIQS_RUNTIME_ERROR << "batched_gesv : dimension mismatch : " << la[R - 2] << " x " << dim << " with a right hand side "
+                       << lb[R - 2] << " x " << nrhs;
+  auto const &sa = a.indexmap().strides(), &sb = b.indexmap().strides();
+  value_type *pa = a.data_start(), *pb = b.data_start();
+  long grain = std::max(1l, utility::parallel_grain_size / std::max(1l, long(dim) * dim));
+  utility::parallel_for_chunks(n_mat, [&](long first, long last) {
+   batched_gesv_worker<value_type> worker(dim, nrhs);
+   for (long i = first; i < last; ++i)
+    worker(pa + batched_impl::offset(la, sa, R - 2, i), sa[R - 2], sa[R - 1], pb + batched_impl::offset(lb, sb, R - 2, i), sb[R - 2],
+           sb[R - 1]);
+  }, grain);
+ }
+
+ //------------------------------------------------------------------
+
+ /**
+  * Diagonalization of dim x dim hermitian (symmetric for double) matrices with lapack syev/heev.
+  * The optimal workspace is asked to lapack once, in the constructor.
+  * As in linalg::eigenelements, the eigenvectors are the rows of the matrix, which replace the original matrix.
+  */
+ template <typename T> class batched_eigen_worker {
+  static_assert(is_blas_lapack_type<T>::value, "batched_eigen_worker : only for double and complex<double>");
+  int dim, lwork;
+  char jobz;
+  std::vector<T> work, buffer;
+  std::vector<double> rwork, w;
+
+  public:
+  batched_eigen_worker(int dim_, bool compute_vectors) : dim(dim_), lwork(1), jobz(compute_vectors ? 'V' : 'N') {
+   w.resize(std::max(1, dim));
+   rwork.resize(std::max(1, 3 * dim - 2));
+   T work1[2], dummy[1];
+   int info;
+   batched_impl::syev(jobz, dim, dummy, std::max(1, dim), w.data(), work1, -1, rwork.data(), info);
+   lwork = std::max(int(lapack::r_round(work1[0])), std::max(1, 2 * dim));
+   work.resize(lwork);
+  }
+
+  /// Diagonalizes M(i,j) = p[i * s0 + j * s1]. The eigenvalues, in ascending order, are written in ev[0], ev[sev], ev[2 * sev] ...
+  void operator()(T *p, std::ptrdiff_t s0, std::ptrdiff_t s1, double *ev, std::ptrdiff_t sev) {
+   using namespace batched_impl;
+   if (dim == 0) return;
+   char trans;
+   int ld, info;
+   T *q = p;
+   bool in_buffer = !as_fortran(s0, s1, dim, dim, trans, ld);
+   if (in_buffer) {
+    to_buffer(p, s0, s1, dim, dim, buffer);
+    q = buffer.data(), trans = 'N', ld = dim;
+   }
+   // For a C ordered M, lapack diagonalizes its transpose, i.e. conj(M) : the eigenvalues are the same.
+   syev(jobz, dim, q, ld, w.data(), work.data(), lwork, rwork.data(), info);
+   if (info) TRIQS_RUNTIME_ERROR << "batched_eigenelements : error code syev/heev : " << info;
+   for (int u = 0; u < dim; ++u) ev[u * sev] = w[u];
+   if (jobz == 'N') return;
+   // In Fortran order, the k-th column of q is the k-th eigenvector (of conj(M) if trans = 'T') : make it the k-th row of M
+   if (in_buffer) {
+    for (int k = 0; k < dim; ++k)
+     for (int r = 0; r < dim; ++r) p[k * s0 + r * s1] = buffer[r + k * dim];
+   } else if (trans == 'T') {
+    if (is_complex<T>::value)
+     for (int k = 0; k < dim; ++k)
+      for (int r = 0; r < dim; ++r) p[k * s0 + r * s1] = _conj(p[k * s0 + r * s1]);
+   } else {
+    for (int k = 0; k < dim; ++k)
+     for (int r = 0; r < k; ++r) std::swap(p[k * s0 + r * s1], p[r * s0 + k * s1]);
+   }
+  }
+
+  private:
+  static double _conj(double x) { return x; }
+  static std::complex<double> _conj(std::complex<double> const &x) { return std::conj(x); }
+ };
+
+ namespace batched_impl {
+  template <typename A, typename E> void eigen(const char *fname, A &&a, E &&ev, bool compute_vectors) {
+   using value_type = typename std14::decay_t<A>::value_type;
+   constexpr int R = std14::decay_t<A>::rank;
+   static_assert(R >= 3, "batched_eigenelements : the array must be of rank >= 3");
+   static_assert(std14::decay_t<E>::rank == R - 1, "batched_eigenelements : the array of eigenvalues must be of rank R-1");
+   static_assert(std::is_same<typename std14::decay_t<E>::value_type, double>::value,
+                 "batched_eigenelements : the eigenvalues are real");
+   long n_mat = check_batch<R - 2>(fname, a, ev);
+   auto const &la = a.indexmap().lengths(), &le = ev.indexmap().lengths();
+   int dim = la[R - 1];
+   if ((long(la[R - 2]) != dim) || (long(le[R - 2]) != dim))
+    TRIQS_RUNTIME_ERROR << fname << " : the matrices must be square and the eigenvalues of the same size, found " << la[R - 2] << " x "
+                        << dim << " and " << le[R - 2];
+   auto const &sa = a.indexmap().strides(), &se = ev.indexmap().strides();
+   value_type *pa = a.data_start();
+   double *pe = ev.data_start();
+   long grain = std::max(1l, utility::parallel_grain_size / std::max(1l, long(dim) * dim));
+   utility::parallel_for_chunks(n_mat, [&](long first, long last) {
+    batched_eigen_worker<value_type> worker(dim, compute_vectors);
+    for (long i = first; i < last; ++i)
+     worker(pa + offset(la, sa, R - 2, i), sa[R - 2], sa[R - 1], pe + offset(le, se, R - 2, i), se[R - 2]);
+   }, grain);
+  }
+ }
+
+ /**
+  * Eigenvalues and eigenvectors of all the hermitian matrices of the array a of rank R >= 3.
+  * ev(n..., u) is the u-th eigenvalue of a(n...), in ascending order.
+  * a(n...) is replaced by its eigenvectors, as rows : a(n..., u, range()) is the eigenvector of ev(n..., u).
+  */
+ template <typename A, typename E> void batched_eigenelements(A &&a, E &&ev) {
+  batched_impl::eigen("batched_eigenelements", a, ev, true);
+ }
+
+ /**
+  * Eigenvalues of all the hermitian matrices of the array a of rank R >= 3.
+  * ev(n..., u) is the u-th eigenvalue of a(n...), in ascending order. The content of a is destroyed.
+  */
+ template <typename A, typename E> void batched_eigenvalues(A &&a, E &&ev) {
+  batched_impl::eigen("batched_eigenvalues", a, ev, false);
+ }
+}
+}
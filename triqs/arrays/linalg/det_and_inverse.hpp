@@ -41,8 +41,9 @@ namespace arrays {
   */
  template <typename A> struct inverse_lazy;
 
+ // static matrices have their own inverse and determinant, cf static_matrix.hpp
  template <class A>
- std14::enable_if_t<ImmutableMatrix<std14::remove_reference_t<A>>::value,
+ std14::enable_if_t<ImmutableMatrix<std14::remove_reference_t<A>>::value && !is_static_matrix<std14::decay_t<A>>::value,
                     inverse_lazy<typename utility::remove_rvalue_ref<A>::type>>
  inverse(A &&a) {
   return {std::forward<A>(a)};
@@ -189,7 +190,8 @@ namespace arrays {
 
  //------------------- det   ----------------------------------------
 
- template <typename A> typename std::remove_reference<A>::type::value_type determinant(A &&a) {
+ template <typename A>
+ std14::enable_if_t<!is_static_matrix<std14::decay_t<A>>::value, typename std::remove_reference<A>::type::value_type> determinant(A &&a) {
   // makes a temporary copy of A if A is a const &
   // If a is a matrix &&, it is moved into the worker.
   auto worker = det_and_inverse_worker<matrix<typename std::remove_reference<A>::type::value_type>>(std::forward<A>(a));
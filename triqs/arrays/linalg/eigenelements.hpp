@@ -20,6 +20,7 @@
  ******************************************************************************/
 #pragma once
 #include <type_traits>
+#include <vector>
 #include "../array.hpp"
 #include "../matrix.hpp"
 #include "../vector.hpp"
@@ -51,46 +52,191 @@ namespace arrays {
                                      double[],                // WORK2
                                      int &                    // INFO
                                      );
+
+  void TRIQS_FORTRAN_MANGLING(dsyevd)(char *, char *, int &, double[], int &, double[], // JOBZ, UPLO, N, A, LDA, W
+                                      double[], int &, int[], int &,                   // WORK, LWORK, IWORK, LIWORK
+                                      int &                                            // INFO
+                                      );
+
+  void TRIQS_FORTRAN_MANGLING(zheevd)(char *, char *, int &, std::complex<double>[], int &, double[], // JOBZ, UPLO, N, A, LDA, W
+                                      std::complex<double>[], int &, double[], int &, int[], int &,  // WORK, LWORK, RWORK, LRWORK, IWORK, LIWORK
+                                      int &                                                          // INFO
+                                      );
+
+  void TRIQS_FORTRAN_MANGLING(dsyevr)(char *, char *, char *, int &, double[], int &, // JOBZ, RANGE, UPLO, N, A, LDA
+                                      double &, double &, int &, int &, double &,     // VL, VU, IL, IU, ABSTOL
+                                      int &, double[], double[], int &, int[],        // M, W, Z, LDZ, ISUPPZ
+                                      double[], int &, int[], int &,                  // WORK, LWORK, IWORK, LIWORK
+                                      int &                                           // INFO
+                                      );
+
+  void TRIQS_FORTRAN_MANGLING(zheevr)(char *, char *, char *, int &, std::complex<double>[], int &,  // JOBZ, RANGE, UPLO, N, A, LDA
+                                      double &, double &, int &, int &, double &,                    // VL, VU, IL, IU, ABSTOL
+                                      int &, double[], std::complex<double>[], int &, int[],         // M, W, Z, LDZ, ISUPPZ
+                                      std::complex<double>[], int &, double[], int &, int[], int &, // WORK, LWORK, RWORK, LRWORK, IWORK, LIWORK
+                                      int &                                                          // INFO
+                                      );
   }
 
+  /// The lapack driver of the diagonalization
+  enum class eigen_algorithm {
+   qr,                 // syev/heev : implicit QR iterations
+   divide_and_conquer, // syevd/heevd : much faster for large matrices when the eigenvectors are computed, but needs more memory
+   mrrr                // syevr/heevr : relatively robust representations. Can compute only a subset of the spectrum
+  };
+
+  /// A part of the spectrum, for the eigen_algorithm::mrrr
+  struct eigen_subset {
+   char range = 'A'; // 'A' : all eigenvalues, 'I' : by index, 'V' : in a window of energy
+   int il = 1, iu = 1;
+   double vl = 0, vu = 0;
+
+   /// The whole spectrum
+   static eigen_subset all() { return {}; }
+
+   /// The eigenvalues number first to last (included), in ascending order, starting from 0
+   static eigen_subset by_index(int first, int last) {
+    eigen_subset s;
+    s.range = 'I', s.il = first + 1, s.iu = last + 1; // lapack counts from 1
+    return s;
+   }
+
+   /// The eigenvalues in ]vl, vu]
+   static eigen_subset in_window(double vl, double vu) {
+    eigen_subset s;
+    s.range = 'V', s.vl = vl, s.vu = vu;
+    return s;
+   }
+  };
+
   /**
    * A worker to call lapack routine with the matrices. Handles both real and complex case.
+   *
+   * The size of the workspace is asked to lapack at the first call, and kept as long as the
+   * size of the matrix, the algorithm and the computation of the eigenvectors do not change :
+   * diagonalizing many matrices of the same size with one worker allocates nothing but the results.
    */
   template <typename T> class eigenelements_worker {
    public:
    eigenelements_worker() = default;
 
    /// The eigenvalues
-   template <typename M> array<double, 1> eigenvalues(M &mat) const {
+   template <typename M> array<double, 1> eigenvalues(M &mat, eigen_algorithm algo = eigen_algorithm::qr) const {
     _prepare(mat);
-    _invoke(is_complex<T>(), 'N', mat);
+    _invoke(algo, 'N', mat, eigen_subset::all());
     return ev;
    }
 
+   /// The eigenvalues of a part of the spectrum, with the eigen_algorithm::mrrr
+   template <typename M> array<double, 1> eigenvalues(M &mat, eigen_subset const &sub) const {
+    _prepare(mat);
+    int m = _invoke(eigen_algorithm::mrrr, 'N', mat, sub);
+    return ev(range(0, m));
+   }
+
    /// The eigensystems
-   template <typename M> std::pair<array<double, 1>, matrix<T>> eigenelements(M &mat) const {
+   template <typename M>
+   std::pair<array<double, 1>, matrix<T>> eigenelements(M &mat, eigen_algorithm algo = eigen_algorithm::qr) const {
     _prepare(mat);
-    _invoke(is_complex<T>(), 'V', mat);
+    if (algo == eigen_algorithm::mrrr) return eigenelements(mat, eigen_subset::all());
+    _invoke(algo, 'V', mat, eigen_subset::all());
     return {ev, _conj(mat, is_complex<T>())};
    }
 
+   /**
+    * The eigensystems of a part of the spectrum, with the eigen_algorithm::mrrr.
+    * The i-th row of the matrix is the eigenvector of the i-th eigenvalue.
+    */
+   template <typename M> std::pair<array<double, 1>, matrix<T>> eigenelements(M &mat, eigen_subset const &sub) const {
+    _prepare(mat);
+    int m = _invoke(eigen_algorithm::mrrr, 'V', mat, sub);
+    // z is in C order, its rows are the columns of the Fortran matrix computed by lapack.
+    // If mat is in C order, lapack diagonalizes its transpose, i.e. its conjugate (cf _conj below).
+    matrix<T> vecs = z(range(0, m), range());
+    if (mat.memory_layout_is_c()) _conj_in_place(vecs, is_complex<T>());
+    return {ev(range(0, m)), vecs};
+   }
+
    private:
-   mutable array<double, 1> ev, work2; // work2 only used for T complex
-   mutable array<T, 1> work;
-   mutable int dim, lwork, info;
+   mutable array<double, 1> ev;
+   mutable matrix<T> z; // eigenvectors for syevr/heevr
+   mutable std::vector<T> work;
+   mutable std::vector<double> rwork; // only used for T complex
+   mutable std::vector<int> iwork, isuppz;
+   mutable int dim, lwork = 0, lrwork = 0, liwork = 0, info;
+   // the problem for which the workspace was computed
+   mutable int ws_dim = -1;
+   mutable char ws_jobz = ' ';
+   mutable eigen_algorithm ws_algo = eigen_algorithm::qr;
 
-   // dispatch the implementation of invoke for T = double or complex
-   void _invoke(std::false_type, char compz, matrix_view<double> mat) const { // the case double (is_complex = false)
+   // ------- lapack calls, for T = double or complex. With lwork = -1, the optimal sizes of the workspace are in work[0], ...
+   void _syev(eigen_algorithm algo, char jobz, double *a, double vl, double vu, int il, int iu, char rg, int &m, double *zz,
+              int ldz) const {
     char uplo = 'U';
-    TRIQS_FORTRAN_MANGLING(dsyev)(&compz, &uplo, dim, mat.data_start(), dim, ev.data_start(), work.data_start(), lwork, info);
-    if (info) TRIQS_RUNTIME_ERROR << "eigenelements_worker :error code dsyev : " << info << " for matrix " << mat;
+    double abstol = 0;
+    switch (algo) {
+     case eigen_algorithm::qr:
+      TRIQS_FORTRAN_MANGLING(dsyev)(&jobz, &uplo, dim, a, dim, ev.data_start(), work.data(), lwork, info);
+      break;
+     case eigen_algorithm::divide_and_conquer:
+      TRIQS_FORTRAN_MANGLING(dsyevd)(&jobz, &uplo, dim, a, dim, ev.data_start(), work.data(), lwork, iwork.data(), liwork, info);
+      break;
+     case eigen_algorithm::mrrr:
+      TRIQS_FORTRAN_MANGLING(dsyevr)(&jobz, &rg, &uplo, dim, a, dim, vl, vu, il, iu, abstol, m, ev.data_start(), zz, ldz,
+                                     isuppz.data(), work.data(), lwork, iwork.data(), liwork, info);
+    }
    }
 
-   void _invoke(std::true_type, char compz, matrix_view<std::complex<double>> mat) const { // the case complex (is_complex = true)
+   void _syev(eigen_algorithm algo, char jobz, std::complex<double> *a, double vl, double vu, int il, int iu, char rg, int &m,
+              std::complex<double> *zz, int ldz) const {
     char uplo = 'U';
-    TRIQS_FORTRAN_MANGLING(zheev)(&compz, &uplo, dim, mat.data_start(), dim, ev.data_start(), work.data_start(), lwork,
-                                  work2.data_start(), info);
-    if (info) TRIQS_RUNTIME_ERROR << "eigenelements_worker :error code zheev : " << info << " for matrix " << mat;
+    double abstol = 0;
+    switch (algo) {
+     case eigen_algorithm::qr:
+      TRIQS_FORTRAN_MANGLING(zheev)(&jobz, &uplo, dim, a, dim, ev.data_start(), work.data(), lwork, rwork.data(), info);
+      break;
+     case eigen_algorithm::divide_and_conquer:
+      TRIQS_FORTRAN_MANGLING(zheevd)(&jobz, &uplo, dim, a, dim, ev.data_start(), work.data(), lwork, rwork.data(), lrwork,
+                                     iwork.data(), liwork, info);
+      break;
+     case eigen_algorithm::mrrr:
+      TRIQS_FORTRAN_MANGLING(zheevr)(&jobz, &rg, &uplo, dim, a, dim, vl, vu, il, iu, abstol, m, ev.data_start(), zz, ldz,
+                                     isuppz.data(), work.data(), lwork, rwork.data(), lrwork, iwork.data(), liwork, info);
+    }
+   }
+
+   // ask lapack for the size of the workspace, unless it is known for this problem
+   void _workspace(eigen_algorithm algo, char jobz) const {
+    if ((ws_dim == dim) && (ws_algo == algo) && (ws_jobz == jobz)) return;
+    if (isuppz.size() < 2 * dim) isuppz.resize(2 * dim);
+    if (rwork.size() < std::max(1, 3 * dim - 2)) rwork.resize(std::max(1, 3 * dim - 2)); // for zheev, which has no query
+    if (iwork.size() < 1) iwork.resize(1);
+    work.resize(std::max(work.size(), size_t(1)));
+    T a1[1], z1[1];
+    int m;
+    lwork = lrwork = liwork = -1;
+    _syev(algo, jobz, a1, 0, 1, 1, 1, 'A', m, z1, dim);
+    if (info) TRIQS_RUNTIME_ERROR << "eigenelements_worker : error code " << info << " in the workspace query";
+    lwork = std::max(int(std::round(std::real(work[0]))), 1);
+    liwork = std::max(iwork[0], 1);
+    lrwork = (is_complex<T>::value && (algo != eigen_algorithm::qr) ? std::max(int(std::round(rwork[0])), 1) : 0);
+    if (work.size() < lwork) work.resize(lwork);
+    if (iwork.size() < liwork) iwork.resize(liwork);
+    if (rwork.size() < lrwork) rwork.resize(lrwork);
+    ws_dim = dim, ws_algo = algo, ws_jobz = jobz;
+   }
+
+   // returns the number of eigenvalues found
+   int _invoke(eigen_algorithm algo, char jobz, matrix_view<T> mat, eigen_subset const &sub) const {
+    _workspace(algo, jobz);
+    int m = dim;
+    if (algo == eigen_algorithm::mrrr) {
+     if ((jobz == 'V') && (first_dim(z) != dim || second_dim(z) != dim)) z.resize(dim, dim);
+     _syev(algo, jobz, mat.data_start(), sub.vl, sub.vu, sub.il, sub.iu, sub.range, m, (jobz == 'V' ? z.data_start() : nullptr), dim);
+    } else
+     _syev(algo, jobz, mat.data_start(), 0, 0, 1, 1, 'A', m, nullptr, 1);
+    if (info) TRIQS_RUNTIME_ERROR << "eigenelements_worker : error code " << info << " in lapack for matrix " << mat;
+    return m;
    }
 
    template <typename M> void _prepare(M const &mat) const {
@@ -99,13 +245,17 @@ namespace arrays {
     if (!mat.indexmap().is_contiguous())
      TRIQS_RUNTIME_ERROR << "eigenelements_worker : the matrix " << mat << " is not contiguous in memory";
     dim = first_dim(mat);
-    ev.resize(dim);
-    lwork = 64 * dim;
-    work.resize(lwork);
-    if (is_complex<T>::value) work2.resize(lwork);
+    if (ev.shape()[0] != dim) ev.resize(dim);
    }
 
-   template <typename M> matrix<double> _conj(M const &m, std::false_type) const { return m; }
+   // in Fortran order, the eigenvectors are the columns of m, as in the complex case below
+   template <typename M> matrix<double> _conj(M const &m, std::false_type) const {
+    if (m.memory_layout_is_c()) return m;
+    return m.transpose();
+   }
+
+   static void _conj_in_place(matrix<double> &, std::false_type) {}
+   static void _conj_in_place(matrix<std::complex<double>> &m, std::true_type) { m = conj(m); }
 
    // impl : since we call fortran lapack, if the order is C (!), the matrix is transposed, or conjugated, so we obtain
    // the conjugate of the eigenvectors... Fix #119.
@@ -126,11 +276,20 @@ namespace arrays {
    * Simple diagonalization call, return all eigenelements.
    * Handles both real and complex case.
    * @param M : the matrix or view. MUST be contiguous. It is modified by the call.
+   * @param algo : the lapack driver
    *            If you wish not to modify it, call eigenelements(make_clone(A))
    */
   template <typename M>
-  std::pair<array<double, 1>, matrix<typename std14::remove_reference_t<M>::value_type>> eigenelements(M &&m) {
-   return eigenelements_worker<typename std14::remove_reference_t<M>::value_type>().eigenelements(m);
+  std::pair<array<double, 1>, matrix<typename std14::remove_reference_t<M>::value_type>>
+  eigenelements(M &&m, eigen_algorithm algo = eigen_algorithm::qr) {
+   return eigenelements_worker<typename std14::remove_reference_t<M>::value_type>().eigenelements(m, algo);
+  }
+
+  /// Same as eigenelements, for a part of the spectrum only (with syevr/heevr)
+  template <typename M>
+  std::pair<array<double, 1>, matrix<typename std14::remove_reference_t<M>::value_type>> eigenelements(M &&m,
+                                                                                                        eigen_subset const &sub) {
+   return eigenelements_worker<typename std14::remove_reference_t<M>::value_type>().eigenelements(m, sub);
   }
 
   //--------------------------------
@@ -143,8 +302,13 @@ namespace arrays {
    *   if false : no copy is made and the content of the matrix M is destroyed.
    *   if true : a copy is made, M is preserved, but of course it is slower...
    */
-  template <typename M> array<double, 1> eigenvalues(M &&m) {
-   return eigenelements_worker<typename std14::remove_reference_t<M>::value_type>().eigenvalues(m);
+  template <typename M> array<double, 1> eigenvalues(M &&m, eigen_algorithm algo = eigen_algorithm::qr) {
+   return eigenelements_worker<typename std14::remove_reference_t<M>::value_type>().eigenvalues(m, algo);
+  }
+
+  /// Same as eigenvalues, for a part of the spectrum only (with syevr/heevr)
+  template <typename M> array<double, 1> eigenvalues(M &&m, eigen_subset const &sub) {
+   return eigenelements_worker<typename std14::remove_reference_t<M>::value_type>().eigenvalues(m, sub);
   }
  }
 }
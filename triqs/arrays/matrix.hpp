@@ -151,6 +151,12 @@ namespace arrays {
   ///
   matrix(mini_vector<size_t, 2> const& sha, memory_layout<2> ml = memory_layout<2>{}) : IMPL_TYPE(indexmap_type(sha, ml)) {}
 
+  /// Without initializing the elements (cf no_init)
+  matrix(size_t dim1, size_t dim2, no_init_t, memory_layout<2> ml = memory_layout<2>{})
+     : IMPL_TYPE(indexmap_type(mini_vector<size_t, 2>(dim1, dim2), ml), no_init) {}
+  matrix(mini_vector<size_t, 2> const& sha, no_init_t, memory_layout<2> ml = memory_layout<2>{})
+     : IMPL_TYPE(indexmap_type(sha, ml), no_init) {}
+
   /** Makes a true (deep) copy of the data. */
   matrix(const matrix& X) : IMPL_TYPE(X.indexmap(), X.storage().clone()) {}
 
@@ -77,6 +77,12 @@ namespace arrays {
  template <typename A, bool IsMatrix>
  auto get_shape(const_matrix_tensor_proxy<A, IsMatrix> const &x) DECL_AND_RETURN(get_shape(x.a).front_pop());
 
+ // blas/lapack and the matrix products see the matrix proxy as a weak view (no reference counting in the parallel loops on the gf)
+ template <typename A> struct blas_lapack_tools::as_matrix_view<const_matrix_tensor_proxy<A, true>> : std::true_type {
+  typedef matrix_view<typename const_matrix_tensor_proxy<A, true>::value_type, void, true, true> type;
+  static type invoke(const_matrix_tensor_proxy<A, true> const &x) { return x; }
+ };
+
  // factory
  template <typename A>
  const_matrix_tensor_proxy<typename _remove_rvalue_ref<A>::type, false> make_const_tensor_proxy(A &&a, long n) {
@@ -145,6 +151,11 @@ namespace arrays {
  template <typename A, bool IsMatrix>
  auto get_shape(matrix_tensor_proxy<A, IsMatrix> const &x) DECL_AND_RETURN(get_shape(x.a).front_pop());
 
+ template <typename A> struct blas_lapack_tools::as_matrix_view<matrix_tensor_proxy<A, true>> : std::true_type {
+  typedef matrix_view<typename matrix_tensor_proxy<A, true>::value_type, void, true> type;
+  static type invoke(matrix_tensor_proxy<A, true> const &x) { return x; }
+ };
+
  // factory
  template <typename A> matrix_tensor_proxy<typename _remove_rvalue_ref<A>::type, false> make_tensor_proxy(A &&a, long n) {
   return {std::forward<A>(a), n};
@@ -0,0 +1,308 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include "./matrix.hpp"
+#include "./linalg/det_and_inverse.hpp"
+#include "./h5/simple_read_write.hpp"
+#include <triqs/utility/c14.hpp>
+#include <cmath>
+
+namespace triqs {
+namespace arrays {
+
+ /// Tag for the matrices of size R x C known at compile time : matrix<T, static_shape<R,C>>
+ template <int R, int C> struct static_shape {};
+
+ namespace static_matrix_impl {
+  // Call f(0), ..., f(N-1). The loop is unrolled at compile time.
+  template <typename F, size_t... Is> FORCEINLINE void _unroll(F &&f, std14::index_sequence<Is...>) {
+   (void)std::initializer_list<int>{(f(int(Is)), 0)...};
+  }
+  template <int N, typename F> FORCEINLINE void unroll(F &&f) { _unroll(f, std14::make_index_sequence<N>()); }
+ }
+
+ /**
+  * A small matrix of size R x C known at compile time, with inline storage (C order) : no allocation.
+  *
+  * It models MutableMatrix : it can be used in the matrix expressions, assigned to/from matrix and matrix_view,
+  * used with clef and written/read in hdf5 (as a matrix).
+  * The product, inverse and determinant of static matrices are unrolled at compile time, and return static matrices.
+  * Unlike matrix, there is no view on a static matrix.
+  */
+ template <typename ValueType, int R, int C>
+ class matrix<ValueType, static_shape<R, C>> : Tag::static_matrix, TRIQS_CONCEPT_TAG_NAME(MutableMatrix) {
+  static_assert(R > 0 && C > 0, "matrix<T, static_shape<R,C>> : R and C must be > 0");
+  ValueType _data[R * C];
+
+  template <typename RHS, typename Op> void _assign(RHS const &x, Op op, std::false_type) { // RHS is an array/matrix
+   if ((first_dim(x) != R) || (second_dim(x) != C))
+    TRIQS_RUNTIME_ERROR << "Size mismatch in assignment to a static matrix " << R << " x " << C << " : got " << first_dim(x) << " x "
+                        << second_dim(x);
+   static_matrix_impl::unroll<R>([&](int i) { static_matrix_impl::unroll<C>([&](int j) { op(_data[i * C + j], x(i, j)); }); });
+  }
+  template <typename RHS, typename Op> void _assign(RHS const &x, Op op, std::true_type) { // RHS is a scalar, i.e. x * identity
+   static_matrix_impl::unroll<R>(
+       [&](int i) { static_matrix_impl::unroll<C>([&](int j) { op(_data[i * C + j], (i == j ? ValueType(x) : ValueType(0))); }); });
+  }
+  template <typename RHS, typename Op> void _assign(RHS const &x, Op op) { _assign(x, op, is_scalar_for<RHS, matrix>{}); }
+
+  struct _eq {
+   template <typename A, typename B> void operator()(A &a, B const &b) const { a = b; }
+  };
+  struct _plus_eq {
+   template <typename A, typename B> void operator()(A &a, B const &b) const { a += b; }
+  };
+  struct _minus_eq {
+   template <typename A, typename B> void operator()(A &a, B const &b) const { a -= b; }
+  };
+
+  public:
+  using value_type = ValueType;
+  using domain_type = indexmaps::cuboid::domain_t<2>;
+  using regular_type = matrix;
+  static constexpr bool is_const = false;
+  static constexpr int n_rows = R;
+  static constexpr int n_cols = C;
+
+  /// Not initialized, as matrix
+  matrix() = default;
+  matrix(matrix const &) = default;
+  matrix &operator=(matrix const &) = default;
+
+  /// From any matrix (or matrix expression) of size R x C
+  template <typename T> matrix(T const &x, TYPE_ENABLE_IF(int, ImmutableCuboidArray<T>) = 0) { _assign(x, _eq{}); }
+
+  template <typename T> matrix(std::initializer_list<std::initializer_list<T>> const &l) {
+   if (l.size() != R) TRIQS_RUNTIME_ERROR << "static matrix : initializer list of wrong size";
+   int i = 0;
+   for (auto const &l1 : l) {
+    if (l1.size() != C) TRIQS_RUNTIME_ERROR << "static matrix : initializer list of wrong size";
+    int j = 0;
+    for (auto const &x : l1) _data[i * C + j++] = x;
+    ++i;
+   }
+  }
+
+  /// Assign a matrix, an expression of the size R x C, or a scalar (i.e. scalar * identity)
+  template <typename RHS> matrix &operator=(RHS const &x) {
+   _assign(x, _eq{});
+   return *this;
+  }
+  template <typename RHS> matrix &operator+=(RHS const &x) {
+   _assign(x, _plus_eq{});
+   return *this;
+  }
+  template <typename RHS> matrix &operator-=(RHS const &x) {
+   _assign(x, _minus_eq{});
+   return *this;
+  }
+  template <typename S> TYPE_ENABLE_IF(matrix &, is_scalar_for<S, matrix>) operator*=(S const &s) {
+   for (auto &x : _data) x *= s;
+   return *this;
+  }
+  template <typename S> TYPE_ENABLE_IF(matrix &, is_scalar_for<S, matrix>) operator/=(S const &s) {
+   for (auto &x : _data) x /= s;
+   return *this;
+  }
+
+  domain_type domain() const { return domain_type(mini_vector<size_t, 2>(R, C)); }
+  mini_vector<size_t, 2> shape() const { return {R, C}; }
+  static constexpr bool is_square() { return R == C; }
+
+  ValueType *data_start() { return _data; }
+  ValueType const *data_start() const { return _data; }
+
+  ValueType &operator()(size_t i, size_t j) {
+#ifdef TRIQS_ARRAYS_ENFORCE_BOUNDCHECK
+   if ((i >= R) || (j >= C)) TRIQS_RUNTIME_ERROR << "static matrix : index (" << i << "," << j << ") out of bounds " << R << " x " << C;
+#endif
+   return _data[i * C + j];
+  }
+
+  ValueType const &operator()(size_t i, size_t j) const {
+#ifdef TRIQS_ARRAYS_ENFORCE_BOUNDCHECK
+   if ((i >= R) || (j >= C)) TRIQS_RUNTIME_ERROR << "static matrix : index (" << i << "," << j << ") out of bounds " << R << " x " << C;
+#endif
+   return _data[i * C + j];
+  }
+
+  // Interaction with the CLEF library : calling with any clef expression as argument build a new clef expression
+  template <typename... Args>
+  std14::enable_if_t<clef::is_any_lazy<Args...>::value, typename clef::_result_of::make_expr_call<matrix const &, Args...>::type>
+  operator()(Args &&... args) const & {
+   return make_expr_call(*this, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  std14::enable_if_t<clef::is_any_lazy<Args...>::value, typename clef::_result_of::make_expr_call<matrix &, Args...>::type>
+  operator()(Args &&... args) & {
+   return make_expr_call(*this, std::forward<Args>(args)...);
+  }
+
+  template <typename Fnt> friend void triqs_clef_auto_assign(matrix &x, Fnt f) {
+   for (int i = 0; i < R; ++i)
+    for (int j = 0; j < C; ++j) x._data[i * C + j] = f(i, j);
+  }
+
+  matrix<ValueType, static_shape<C, R>> transpose() const {
+   matrix<ValueType, static_shape<C, R>> r;
+   static_matrix_impl::unroll<R>([&](int i) { static_matrix_impl::unroll<C>([&](int j) { r(j, i) = _data[i * C + j]; }); });
+   return r;
+  }
+
+  friend bool operator==(matrix const &a, matrix const &b) { return std::equal(a._data, a._data + R * C, b._data); }
+  friend bool operator!=(matrix const &a, matrix const &b) { return !(a == b); }
+
+  friend std::ostream &operator<<(std::ostream &out, matrix const &a) {
+   out << "\n[";
+   for (int i = 0; i < R; ++i) {
+    out << (i == 0 ? "[" : " [");
+    for (int j = 0; j < C; ++j) out << (j > 0 ? "," : "") << a(i, j);
+    out << "]" << (i == R - 1 ? "" : "\n");
+   }
+   return out << "]";
+  }
+
+  /// Written and read as a matrix
+  friend void h5_write(h5::group g, std::string const &name, matrix const &a) { h5_write(g, name, arrays::matrix<ValueType>(a)); }
+  friend void h5_read(h5::group g, std::string const &name, matrix &a) {
+   arrays::matrix<ValueType> m;
+   h5_read(g, name, m);
+   a = m;
+  }
+
+  friend class boost::serialization::access;
+  template <class Archive> void serialize(Archive &ar, const unsigned int version) {
+   for (auto &x : _data) ar &TRIQS_MAKE_NVP("data", x);
+  }
+ };
+
+ // ---------------------- product  --------------------------------
+
+ template <typename T1, typename T2, int R, int K, int C>
+ matrix<decltype(T1{} * T2{}), static_shape<R, C>> operator*(matrix<T1, static_shape<R, K>> const &a,
+                                                             matrix<T2, static_shape<K, C>> const &b) {
+  using static_matrix_impl::unroll;
+  matrix<decltype(T1{} * T2{}), static_shape<R, C>> r;
+  unroll<R>([&](int i) {
+   unroll<C>([&](int j) {
+    auto s = a(i, 0) * b(0, j);
+    unroll<K - 1>([&](int k) { s += a(i, k + 1) * b(k + 1, j); });
+    r(i, j) = s;
+   });
+  });
+  return r;
+ }
+
+ // ---------------------- inverse and determinant --------------------------------
+
+ namespace static_matrix_impl {
+
+  // In place LU decomposition with partial pivoting (unrolled). Returns the determinant.
+  template <typename T, int N> T lu(matrix<T, static_shape<N, N>> &a, int *perm) {
+   T det = 1;
+   unroll<N>([&](int k) {
+    // pivot
+    int p = k;
+    for (int i = k + 1; i < N; ++i)
+     if (std::abs(a(i, k)) > std::abs(a(p, k))) p = i;
+    perm[k] = p;
+    if (p != k) {
+     unroll<N>([&](int j) { std::swap(a(k, j), a(p, j)); });
+     det = -det;
+    }
+    det *= a(k, k);
+    if (a(k, k) == T(0)) return;
+    for (int i = k + 1; i < N; ++i) {
+     a(i, k) /= a(k, k);
+     for (int j = k + 1; j < N; ++j) a(i, j) -= a(i, k) * a(k, j);
+    }
+   });
+   return det;
+  }
+
+  template <typename T> T det_impl(matrix<T, static_shape<1, 1>> const &a) { return a(0, 0); }
+  template <typename T> T det_impl(matrix<T, static_shape<2, 2>> const &a) { return a(0, 0) * a(1, 1) - a(0, 1) * a(1, 0); }
+  template <typename T> T det_impl(matrix<T, static_shape<3, 3>> const &a) {
+   return a(0, 0) * (a(1, 1) * a(2, 2) - a(1, 2) * a(2, 1)) - a(0, 1) * (a(1, 0) * a(2, 2) - a(1, 2) * a(2, 0)) +
+          a(0, 2) * (a(1, 0) * a(2, 1) - a(1, 1) * a(2, 0));
+  }
+  template <typename T, int N> T det_impl(matrix<T, static_shape<N, N>> a) {
+   int perm[N];
+   return lu(a, perm);
+  }
+
+  template <typename T, int N> T checked_det(matrix<T, static_shape<N, N>> const &a) {
+   T det = det_impl(a);
+   if (det == T(0)) throw matrix_inverse_exception() << "Inverse/Det error : matrix is not invertible";
+   return det;
+  }
+
+  // explicit formula by the cofactors for N <= 3
+  template <typename T> matrix<T, static_shape<1, 1>> inverse_impl(matrix<T, static_shape<1, 1>> const &a) {
+   return {{T(1) / checked_det(a)}};
+  }
+  template <typename T> matrix<T, static_shape<2, 2>> inverse_impl(matrix<T, static_shape<2, 2>> const &a) {
+   T det = checked_det(a);
+   return {{a(1, 1) / det, -a(0, 1) / det}, {-a(1, 0) / det, a(0, 0) / det}};
+  }
+  template <typename T> matrix<T, static_shape<3, 3>> inverse_impl(matrix<T, static_shape<3, 3>> const &a) {
+   T det = checked_det(a);
+   matrix<T, static_shape<3, 3>> r;
+   unroll<3>([&](int i) {
+    unroll<3>([&](int j) {
+     int i1 = (j + 1) % 3, i2 = (j + 2) % 3, j1 = (i + 1) % 3, j2 = (i + 2) % 3;
+     r(i, j) = (a(i1, j1) * a(i2, j2) - a(i1, j2) * a(i2, j1)) / det;
+    });
+   });
+   return r;
+  }
+
+  // LU, then solve for the identity
+  template <typename T, int N> matrix<T, static_shape<N, N>> inverse_impl(matrix<T, static_shape<N, N>> a) {
+   int perm[N];
+   if (lu(a, perm) == T(0)) throw matrix_inverse_exception() << "Inverse/Det error : matrix is not invertible";
+   // apply the permutation to the identity, then forward and backward substitution, column by column
+   matrix<T, static_shape<N, N>> r;
+   r = T(1);
+   for (int k = 0; k < N; ++k)
+    if (perm[k] != k)
+     for (int j = 0; j < N; ++j) std::swap(r(k, j), r(perm[k], j));
+   unroll<N>([&](int j) {
+    for (int i = 1; i < N; ++i)
+     for (int k = 0; k < i; ++k) r(i, j) -= a(i, k) * r(k, j);
+    for (int i = N - 1; i >= 0; --i) {
+     for (int k = i + 1; k < N; ++k) r(i, j) -= a(i, k) * r(k, j);
+     r(i, j) /= a(i, i);
+    }
+   });
+   return r;
+  }
+ }
+
+ /// Determinant of a static matrix
+ template <typename T, int N> T determinant(matrix<T, static_shape<N, N>> const &a) { return static_matrix_impl::det_impl(a); }
+
+ /// Inverse of a static matrix (not lazy : it returns a new static matrix)
+ template <typename T, int N> matrix<T, static_shape<N, N>> inverse(matrix<T, static_shape<N, N>> const &a) {
+  return static_matrix_impl::inverse_impl(a);
+ }
+}
+}
@@ -0,0 +1,175 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include <triqs/utility/first_include.hpp>
+#include "./allocators.hpp"
+#include "../../utility/exceptions.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace triqs {
+namespace arrays {
+ namespace storages {
+
+  namespace {
+
+   allocation_policy policy;
+
+   // ------------------ counters ------------------
+
+   // The counters of one thread. Only this thread writes them, relaxed atomics make the sum on all threads race free.
+   struct thread_counters {
+    std::atomic<long> n_allocations{0}, n_deallocations{0}, n_pool_hits{0}, bytes_in_use{0};
+   };
+
+   void incr(std::atomic<long> &x, long d) { x.store(x.load(std::memory_order_relaxed) + d, std::memory_order_relaxed); }
+
+   // All counters ever created. Never destroyed, so that they survive the threads and the end of the program.
+   std::mutex &registry_mutex() {
+    static auto *m = new std::mutex;
+    return *m;
+   }
+   std::vector<thread_counters *> &registry() {
+    static auto *r = new std::vector<thread_counters *>;
+    return *r;
+   }
+
+   thread_local thread_counters *this_thread_counters = nullptr;
+
+   thread_counters &counters() {
+    if (!this_thread_counters) {
+     this_thread_counters = new thread_counters;
+     std::lock_guard<std::mutex> lock(registry_mutex());
+     registry().push_back(this_thread_counters);
+    }
+    return *this_thread_counters;
+   }
+
+   // ------------------ pool ------------------
+
+   // size classes : 2^min_class, ..., 2^max_class bytes
+   constexpr int min_class = 6, max_class = 16, n_classes = max_class - min_class + 1;
+   constexpr int pool_depth = 32; // max number of free blocks kept per class
+
+   // -1 if the block is too large to be pooled
+   int size_class(size_t bytes) {
+    int c = min_class;
+    while ((size_t(1) << c) < bytes) ++c;
+    return (c <= max_class ? c - min_class : -1);
+   }
+
+   void *allocate_aligned(size_t bytes) {
+    void *p = nullptr;
+    if (posix_memalign(&p, memory_alignment, (bytes == 0 ? memory_alignment : bytes)) != 0)
+     TRIQS_RUNTIME_ERROR << "Memory allocation error : cannot allocate " << bytes << " bytes";
+    return p;
+   }
+
+   struct pool_t {
+    void *blocks[n_classes][pool_depth];
+    int n[n_classes] = {};
+    void release() {
+     for (int c = 0; c < n_classes; ++c) {
+      for (int i = 0; i < n[c]; ++i) std::free(blocks[c][i]);
+      n[c] = 0;
+     }
+    }
+    ~pool_t();
+   };
+
+   // The pool is destroyed at the exit of the thread, maybe before some arrays (e.g. static ones in the main thread).
+   thread_local bool pool_destroyed = false;
+   thread_local pool_t pool;
+   pool_t::~pool_t() {
+    release();
+    pool_destroyed = true;
+   }
+
+   constexpr size_t first_touch_threshold = size_t(1) << 20;
+
+   void first_touch(void *p, size_t bytes) {
+#ifdef TRIQS_WITH_OPENMP
+    char *c = static_cast<char *>(p);
+    long n_pages = (bytes + 4095) / 4096;
+#pragma omp parallel for schedule(static)
+    for (long i = 0; i < n_pages; ++i) {
+     size_t first = i * 4096;
+     std::memset(c + first, 0, std::min(size_t(4096), bytes - first));
+    }
+#endif
+   }
+  }
+
+  // -----------------------------------------------
+
+  allocation_policy get_allocation_policy() { return policy; }
+  void set_allocation_policy(allocation_policy const &p) { policy = p; }
+
+  memory_stats get_memory_stats() {
+   memory_stats r;
+   std::lock_guard<std::mutex> lock(registry_mutex());
+   for (auto c : registry()) {
+    r.n_allocations += c->n_allocations.load(std::memory_order_relaxed);
+    r.n_deallocations += c->n_deallocations.load(std::memory_order_relaxed);
+    r.n_pool_hits += c->n_pool_hits.load(std::memory_order_relaxed);
+    r.bytes_in_use += c->bytes_in_use.load(std::memory_order_relaxed);
+   }
+   return r;
+  }
+
+  void release_memory_pool() {
+   if (!pool_destroyed) pool.release();
+  }
+
+  void *allocate_bytes(size_t bytes) {
+   auto &cnt = counters();
+   incr(cnt.n_allocations, 1);
+   incr(cnt.bytes_in_use, bytes);
+   int c = size_class(bytes);
+   if (c < 0) {
+    void *p = allocate_aligned(bytes);
+    if (policy.numa_first_touch && (bytes >= first_touch_threshold)) first_touch(p, bytes);
+    return p;
+   }
+   // small blocks are always of the size of their class, so that they can be recycled
+   if (policy.use_pool && !pool_destroyed && (pool.n[c] > 0)) {
+    incr(cnt.n_pool_hits, 1);
+    return pool.blocks[c][--pool.n[c]];
+   }
+   return allocate_aligned(size_t(1) << (c + min_class));
+  }
+
+  void deallocate_bytes(void *p, size_t bytes) {
+   auto &cnt = counters();
+   incr(cnt.n_deallocations, 1);
+   incr(cnt.bytes_in_use, -long(bytes));
+   int c = size_class(bytes);
+   if ((c >= 0) && policy.use_pool && !pool_destroyed && (pool.n[c] < pool_depth)) {
+    pool.blocks[c][pool.n[c]++] = p;
+    return;
+   }
+   std::free(p);
+  }
+ }
+}
+}
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include "../impl/common.hpp"
+#include "./memcopy.hpp"
+
+namespace triqs {
+namespace arrays {
+ namespace storages {
+
+  /**
+   * The allocation policy of the memory blocks of the arrays.
+   *
+   * All blocks are aligned on memory_alignment bytes.
+   * The policy is global : change it before any parallel region, not while other threads allocate arrays.
+   */
+  struct allocation_policy {
+   bool use_pool = true;          // recycle the small blocks in a pool of the thread, by size classes (powers of 2)
+   bool numa_first_touch = false; // with OpenMP, initialize the large blocks in parallel, so that the pages are on the NUMA node
+                                  // of the thread which uses them in the parallel loops (static schedule).
+  };
+
+  /// Counters of the memory blocks of the arrays, summed on all threads
+  struct memory_stats {
+   long n_allocations = 0;   // number of blocks allocated
+   long n_deallocations = 0; // number of blocks released
+   long n_pool_hits = 0;     // number of allocations served by the pool
+   long bytes_in_use = 0;    // memory of the blocks currently allocated (in the arrays, not in the pool)
+  };
+
+  constexpr size_t memory_alignment = 64;
+
+  allocation_policy get_allocation_policy();
+  void set_allocation_policy(allocation_policy const &p);
+
+  memory_stats get_memory_stats();
+
+  /// Release the blocks kept in the pool of the calling thread
+  void release_memory_pool();
+
+  // Raw memory, aligned on memory_alignment. Implemented in allocators.cpp
+  void *allocate_bytes(size_t bytes);
+  void deallocate_bytes(void *p, size_t bytes);
+
+  // Types whose elements need neither construction nor destruction (as new T[n] for T = double, int, ...).
+  // complex is included : its default constructor zeroes it, which is not needed when the block is copied into.
+  template <typename T> using is_raw_memory = is_scalar_or_pod<T>;
+
+  /**
+   * Allocate n elements of type T.
+   * If Init, they are default-initialized as by new T[n]. Otherwise, raw memory types are left uninitialized.
+   */
+  template <typename T, bool Init = true> T *allocate_elements(size_t n) {
+   T *p = static_cast<T *>(allocate_bytes(n * sizeof(T)));
+   if (is_raw_memory<T>::value && !(Init && !std::is_pod<T>::value)) return p;
+   size_t i = 0;
+   try {
+    for (; i < n; ++i) new (p + i) T;
+   }
+   catch (...) {
+    for (size_t j = 0; j < i; ++j) p[j].~T();
+    deallocate_bytes(p, n * sizeof(T));
+    throw;
+   }
+   return p;
+  }
+
+  template <typename T> void deallocate_elements(T *p, size_t n) {
+   if (!is_raw_memory<T>::value)
+    for (size_t i = 0; i < n; ++i) p[i].~T();
+   deallocate_bytes(p, n * sizeof(T));
+  }
+ }
+}
+}
@@ -1,28 +1,29 @@
 #include <triqs/utility/first_include.hpp>
 #include "./mem_block.hpp"
 #include <exception>
+#include <iostream>
 
 namespace triqs { namespace arrays { namespace storages { 
 #ifdef TRIQS_ARRAYS_DEBUG_COUNT_MEMORY
 
-  __global_memory_allocated_from_c_t __global_memory_allocated_from_c;
-
-  void term_handler() {
+ // For debug purpose only: check at the end of the program that all the memory of the arrays has been released.
+ struct __check_memory_released_at_exit_t {
+  static void term_handler() {
    std::cerr << "[triqs:mem_block] End of program : memory still allocated for triqs::arrays : "
-             << __global_memory_allocated_from_c.count << std::endl <<"   Python initialized : "<< Py_IsInitialized() << std::endl;
-  }
-
-  __global_memory_allocated_from_c_t::__global_memory_allocated_from_c_t() {
-   std::set_terminate(*term_handler);
+             << get_memory_stats().bytes_in_use << " bytes" << std::endl;
+#ifdef TRIQS_WITH_PYTHON_SUPPORT
+   std::cerr << "   Python initialized : " << Py_IsInitialized() << std::endl;
+#endif
   }
-
-  __global_memory_allocated_from_c_t::~__global_memory_allocated_from_c_t() {
+  __check_memory_released_at_exit_t() { std::set_terminate(*term_handler); }
+  ~__check_memory_released_at_exit_t() {
    term_handler();
-   if (count != 0) {
+   if (get_memory_stats().bytes_in_use != 0) {
     std::cerr << " !=0 : this is an internal error. Terminating the code";
     std::abort();
    }
   }
+ } __check_memory_released_at_exit;
 #endif
  }
 }
@@ -33,7 +33,9 @@ typedef void PyObject;
 #endif
 
 #include "./memcopy.hpp"
+#include "./allocators.hpp"
 #include <triqs/utility/macros.hpp>
+#include <atomic>
 
 //#define TRIQS_ARRAYS_DEBUG_TRACE_MEM
 #ifdef TRIQS_ARRAYS_DEBUG_TRACE_MEM
@@ -48,6 +50,25 @@ namespace triqs { namespace arrays { namespace storages { //namespace details {
 
  template<typename ValueType> struct mem_block; // forward
 
+ /*
+  * Thread safety of the reference counting.
+  *
+  * By default, the reference count of a block is incremented/decremented with plain (relaxed) loads and stores :
+  * a block must then be shared (i.e. its views copied or destroyed) in one thread only.
+  * A thread safe block uses atomic read-modify-write operations : relaxed for the increments,
+  * release for the decrements, and an acquire fence before the deletion by the last owner.
+  * All the blocks are thread safe if TRIQS_ARRAYS_THREAD_SAFE_REF_COUNT is defined (cmake option THREAD_SAFE_ARRAYS),
+  * otherwise it is chosen per block, cf shared_block::set_thread_safe.
+  *
+  * NB : the weak references do not touch the count : a weak const view can be given to other threads at no cost,
+  * as long as the array outlives them.
+  */
+#ifdef TRIQS_ARRAYS_THREAD_SAFE_REF_COUNT
+ constexpr bool thread_safe_ref_count_by_default = true;
+#else
+ constexpr bool thread_safe_ref_count_by_default = false;
+#endif
+
 // debug only, to check also weak refs. This will slow down a bit critical loops..
 // I am not sure this is really useful ...
 //#define TRIQS_ARRAYS_CHECK_WEAK_REFS
@@ -58,7 +79,12 @@ namespace triqs { namespace arrays { namespace storages { //namespace details {
   m->weak_ref_count++;
 #endif
  }
- template<bool Weak, typename ValueType> DISABLE_IFC(Weak) inc_ref(mem_block<ValueType> * const m) { m->ref_count++;}
+ template<bool Weak, typename ValueType> DISABLE_IFC(Weak) inc_ref(mem_block<ValueType> * const m) {
+  if (m->thread_safe)
+   m->ref_count.fetch_add(1, std::memory_order_relaxed);
+  else
+   m->ref_count.store(m->ref_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+ }
 
  // force inline on gcc ?
  //template<typename ValueType> void dec_ref(mem_block<ValueType> * const m) __attribute__((always_inline));
@@ -70,7 +96,15 @@ namespace triqs { namespace arrays { namespace storages { //namespace details {
  }
 
  template<bool Weak, typename ValueType> DISABLE_IFC(Weak) dec_ref(mem_block<ValueType> * const m) {
-  m->ref_count--; if (m->ref_count ==0) {
+  size_t c;
+  if (m->thread_safe) {
+   c = m->ref_count.fetch_sub(1, std::memory_order_release) - 1;
+   if (c == 0) std::atomic_thread_fence(std::memory_order_acquire); // see all the writes of the other owners before deleting
+  } else {
+   c = m->ref_count.load(std::memory_order_relaxed) - 1;
+   m->ref_count.store(c, std::memory_order_relaxed);
+  }
+  if (c == 0) {
 #ifdef TRIQS_ARRAYS_CHECK_WEAK_REFS
   //std::cout  << " detroying "<< m->weak_ref_count <<std::endl;
   if (m->weak_ref_count !=0) TRIQS_RUNTIME_ERROR << "Deleting an memory block of an array with still "<< m->weak_ref_count<< " weak references";
@@ -79,31 +113,13 @@ namespace triqs { namespace arrays { namespace storages { //namespace details {
   }
  }
 
-#ifdef TRIQS_ARRAYS_DEBUG_COUNT_MEMORY
- // For debug purpose only: a counter of the memory allocated
- struct __global_memory_allocated_from_c_t {
-  size_t count = 0;
-  __global_memory_allocated_from_c_t();
-  ~__global_memory_allocated_from_c_t();
- };
- extern __global_memory_allocated_from_c_t __global_memory_allocated_from_c;
-#define TRIQS_MEMORY_USED_INC(s)                                                                                                 \
- __global_memory_allocated_from_c.count += s;                                                                                    \
- TRACE_MEM_DEBUG("Total memblock allocated from C++ : " << __global_memory_allocated_from_c.count);
-#define TRIQS_PRINT_MEMORY_USED                                                                                                  \
- std::cerr << "[triqs:mem_block]" << triqs::arrays::storages::__global_memory_allocated_from_c.count << std::endl;         
- #else
-#define TRIQS_MEMORY_USED_INC(s)
-#define TRIQS_PRINT_MEMORY_USED
-#endif
-
  /**
   *  This is a block of memory (pointer p and size size_).
   *  INTERNAL USE only, by shared_block only
   *
   *  The memory can be :
   *
-  *   - allocated (and deleted in C++)
+  *   - allocated (and deleted in C++), by allocate_elements (aligned, pooled, cf allocators.hpp)
   *   - owned by a numpy python object (py_numpy)
   *
   *  The block contains its own reference system, to avoid the use of shared_ptr in shared_block
@@ -142,8 +158,9 @@ namespace triqs { namespace arrays { namespace storages { //namespace details {
 
   size_t size_;                  // size of the block
   ValueType * restrict p;        // the memory block. Owned by this, except when py_numpy is not null
-  size_t ref_count;              // number of refs. :  >=1
+  std::atomic<size_t> ref_count; // number of refs. :  >=1
   size_t weak_ref_count;              // number of refs. :  >=1
+  bool thread_safe;              // atomic operations on ref_count (cf inc_ref, dec_ref)
   PyObject * py_numpy;           // if not null, an owned reference to a numpy which is the data of this block
   PyObject * py_guard;           // if not null, a BORROWED reference to the guard. If null, the guard does not exist
   static_assert(!std::is_const<ValueType>::value, "internal error");
@@ -153,14 +170,13 @@ namespace triqs { namespace arrays { namespace storages { //namespace details {
 #endif
 
   //Construct to state 0
-   mem_block() : size_(0), p(nullptr), ref_count(1), weak_ref_count(0), py_numpy(nullptr), py_guard(nullptr) {}
+   mem_block() : size_(0), p(nullptr), ref_count(1), weak_ref_count(0), thread_safe(thread_safe_ref_count_by_default), py_numpy(nullptr), py_guard(nullptr) {}
 
-  // construct to state 1 with a given size.
-  mem_block (size_t s):size_(s),py_numpy(nullptr), py_guard(nullptr){
-   try { p = new ValueType[s];}
+  // construct to state 1 with a given size. If !init, the elements of raw memory types are not initialized.
+  mem_block (size_t s, bool init = true):size_(s),thread_safe(thread_safe_ref_count_by_default),py_numpy(nullptr), py_guard(nullptr){
+   try { p = (init ? allocate_elements<ValueType>(s) : allocate_elements<ValueType, false>(s));}
    catch (std::bad_alloc& ba) { TRIQS_RUNTIME_ERROR<< "Memory allocation error in memblock construction. Size :"<<s << "  bad_alloc error : "<< ba.what();}
    TRACE_MEM_DEBUG("Allocating from C++ a block of size "<< s << " at address " <<p);
-   TRIQS_MEMORY_USED_INC(s);
    ref_count=1;
    weak_ref_count =0;
   }
@@ -177,6 +193,7 @@ namespace triqs { namespace arrays { namespace storages { //namespace details {
    p = (ValueType*)PyArray_DATA(arr);
    py_numpy = obj;
    py_guard = nullptr;
+   thread_safe = thread_safe_ref_count_by_default;
    ref_count=1;
    weak_ref_count =0;
   }
@@ -191,8 +208,7 @@ namespace triqs { namespace arrays { namespace storages { //namespace details {
    else {
     if (p) { // state 2 or state 0
      TRACE_MEM_DEBUG("Desallocating from C++ a block of size " << this->size_ << " at address " << p);
-     TRIQS_MEMORY_USED_INC(-size_);
-     delete[] p;
+     deallocate_elements(p, size_);
     }
    }
   }
@@ -201,7 +217,8 @@ namespace triqs { namespace arrays { namespace storages { //namespace details {
   mem_block & operator=(mem_block const & X) = delete;
   mem_block & operator=(mem_block && X) = delete;
   mem_block(mem_block && X) noexcept {
-   size_ = X.size_; p = X.p; ref_count = X.ref_count; weak_ref_count = X.weak_ref_count; py_numpy=X.py_numpy; py_guard = X.py_guard;
+   size_ = X.size_; p = X.p; ref_count = X.ref_count.load(); weak_ref_count = X.weak_ref_count; thread_safe = X.thread_safe;
+   py_numpy=X.py_numpy; py_guard = X.py_guard;
    X.p =nullptr; X.py_numpy= nullptr; X.py_guard = nullptr; // state 0, ready to destruct
   }
 
@@ -215,11 +232,11 @@ namespace triqs { namespace arrays { namespace storages { //namespace details {
   // copy construct into state 1, always.
   // This is a choice, even if X is state 2 (a numpy).
   // We copy a numpy into a regular C++ array, which can then be used at max speed.
-  mem_block (mem_block const & X): size_(X.size()), py_numpy(nullptr), py_guard(nullptr) {
-  try { p = new ValueType[X.size()];}
+  // The memory is not initialized before the copy (for scalar/pod types).
+  mem_block (mem_block const & X): size_(X.size()), thread_safe(X.thread_safe), py_numpy(nullptr), py_guard(nullptr) {
+  try { p = allocate_elements<ValueType, false>(X.size());}
    catch (std::bad_alloc& ba) { TRIQS_RUNTIME_ERROR<< "Memory allocation error in memblock copy construction. Size :"<<X.size() << "  bad_alloc error : "<< ba.what();}
    TRACE_MEM_DEBUG("Allocating from C++ a block of size "<< X.size() << " at address " <<p);
-   TRIQS_MEMORY_USED_INC(X.size());
    ref_count=1;
    weak_ref_count =0;
    // now we copy the data
@@ -291,7 +308,7 @@ namespace triqs { namespace arrays { namespace storages { //namespace details {
 
   size_t size() const {return size_;}
 
-  bool is_unique() const { return (ref_count + weak_ref_count) == 1; }
+  bool is_unique() const { return (ref_count.load(std::memory_order_acquire) + weak_ref_count) == 1; }
 
   template<class Archive>
    void save(Archive & ar, const unsigned int version) const {
@@ -304,14 +321,13 @@ namespace triqs { namespace arrays { namespace storages { //namespace details {
     ar >> size_;
     assert (p==nullptr);
     try {
-     p = new ValueType[size_];
+     p = allocate_elements<ValueType>(size_);
     }
     catch (std::bad_alloc& ba) {
      TRIQS_RUNTIME_ERROR << "Memory allocation error in memblock deserialization. Size :" << size_
                          << "  bad_alloc error : " << ba.what();
     }
     TRACE_MEM_DEBUG("Allocating from C++ a block of size " << size_ << " at address " << p);
-    TRIQS_MEMORY_USED_INC(size_);
     for (size_t i=0; i<size_; ++i) ar >> p[i];
    }
   BOOST_SERIALIZATION_SPLIT_MEMBER();
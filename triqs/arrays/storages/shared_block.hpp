@@ -38,10 +38,10 @@ namespace triqs { namespace arrays { namespace storages {
    ValueType * restrict data_; // for optimization on some compilers. ?? obsolete : to be removed ?
    size_t s;
 
-   void construct_delegate(size_t size) { 
+   void construct_delegate(size_t size, bool init = true) { 
     s = size;
     if (size ==0) { sptr = nullptr; data_=nullptr; }
-    else { sptr = new mem_block<ValueType>(size); data_ = sptr->p;}
+    else { sptr = new mem_block<ValueType>(size, init); data_ = sptr->p;}
    }
 
    public:
@@ -51,6 +51,9 @@ namespace triqs { namespace arrays { namespace storages {
    ///  Construct a new block of memory of given size
    explicit shared_block(size_t size) { construct_delegate(size); }
 
+   ///  Construct a new block of memory of given size, without initializing the raw memory types
+   shared_block(size_t size, no_init_t) { construct_delegate(size, false); }
+
    //explicit shared_block(size_t size, Tag::default_init) {// C++11  : delegate to previous constructor when gcc 4.6 support is out. 
    // construct_delegate(size); 
    // const auto s = this->size(); for (size_t u=0; u<s; ++u) data_[u] = ValueType(); 
@@ -83,6 +86,10 @@ namespace triqs { namespace arrays { namespace storages {
 
    bool is_unique() const { return sptr && sptr->is_unique();}
 
+   /// Atomic reference counting for this block (cf mem_block.hpp). Must be set before the block is shared between threads.
+   void set_thread_safe(bool b = true) const { if (sptr) sptr->thread_safe = b; }
+   bool is_thread_safe() const { return sptr && sptr->thread_safe; }
+
    /// True copy of the data
    shared_block clone() const { 
     shared_block res; 
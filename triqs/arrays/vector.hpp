@@ -136,6 +136,9 @@ namespace arrays {
   ///
   vector(size_t dim) : IMPL_TYPE(indexmap_type(mini_vector<size_t, 1>(dim))) {}
 
+  /// Without initializing the elements (cf no_init)
+  vector(size_t dim, no_init_t) : IMPL_TYPE(indexmap_type(mini_vector<size_t, 1>(dim)), no_init) {}
+
   /// to mimic std vector
   template <typename Arg> vector(size_t dim, Arg&& arg) : IMPL_TYPE(indexmap_type(mini_vector<size_t, 1>(dim))) {
    (*this)() = std::forward<Arg>(arg);
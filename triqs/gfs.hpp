@@ -31,13 +31,16 @@
 #include <triqs/gfs/legendre.hpp>
 #include <triqs/gfs/bz.hpp>
 #include <triqs/gfs/cyclic_lattice.hpp>
+#include <triqs/gfs/block_sparse.hpp>
 
 // multivariable gf in C++14 only
 #ifndef TRIQS_C11
 #include <triqs/gfs/product.hpp>
 #include <triqs/gfs/curry.hpp>
 #include <triqs/gfs/m_tail.hpp>
+#include <triqs/gfs/out_of_core.hpp>
 #endif
+#include <triqs/gfs/dyson.hpp>
 
 #include <triqs/gfs/local/fourier_matsubara.hpp>
 #include <triqs/gfs/local/fourier_real.hpp>
@@ -0,0 +1,455 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include "./tools.hpp"
+#include "./gf.hpp"
+#include <memory>
+#include <algorithm>
+
+namespace triqs {
+namespace gfs {
+
+ /**
+  * Target : a tensor of rank R, of which only the elements of a block_sparse_pattern are stored.
+  *
+  * E.g. for a vertex gf<cartesian_product<imfreq, imfreq, imfreq>, block_sparse_valued<4>>,
+  * only the (a,b,c,d) allowed by the symmetries are stored, each with a dense array on the mesh.
+  */
+ template <int R> struct block_sparse_valued {
+  static_assert(R > 0, "block_sparse_valued only for rank >0");
+ };
+
+ //------------------------------------------------------
+
+ /**
+  * The list of the elements of a tensor of rank R which can be non zero.
+  * It is immutable, and shared by all the gf constructed from it.
+  */
+ template <int R> class block_sparse_pattern {
+  public:
+  using index_t = arrays::mini_vector<int, R>;
+
+  private:
+  index_t _shape;
+  std::vector<index_t> _non_zeros; // sorted in lexicographic order
+  std::vector<long> _position;     // for each element of the dense tensor (C order), its position in _non_zeros or -1
+
+  long _dense_index(index_t const &ind) const {
+   long r = 0;
+   for (int d = 0; d < R; ++d) {
+    if ((ind[d] < 0) || (ind[d] >= _shape[d]))
+     TRIQS_RUNTIME_ERROR << "block_sparse_pattern : index " << ind << " out of the shape " << _shape;
+    r = r * _shape[d] + ind[d];
+   }
+   return r;
+  }
+
+  public:
+  block_sparse_pattern() = default;
+
+  /// From the shape of the tensor and the list of its non zero elements (in any order).
+  block_sparse_pattern(index_t const &shape, std::vector<index_t> non_zeros)
+     : _shape(shape), _non_zeros(std::move(non_zeros)), _position(shape.product_of_elements(), -1) {
+   auto less = [](index_t const &x, index_t const &y) { return std::lexicographical_compare(x.ptr(), x.ptr() + R, y.ptr(), y.ptr() + R); };
+   std::sort(_non_zeros.begin(), _non_zeros.end(), less);
+   for (long n = 0; n < size(); ++n) {
+    long i = _dense_index(_non_zeros[n]);
+    if (_position[i] != -1) TRIQS_RUNTIME_ERROR << "block_sparse_pattern : element " << _non_zeros[n] << " is given twice";
+    _position[i] = n;
+   }
+  }
+
+  /// Number of stored elements
+  long size() const { return _non_zeros.size(); }
+
+  /// Shape of the dense tensor
+  index_t const &shape() const { return _shape; }
+
+  /// The stored elements
+  std::vector<index_t> const &non_zeros() const { return _non_zeros; }
+
+  /// Position of the element ind in the stored elements, or -1 if it is a structural zero
+  long position(index_t const &ind) const { return _position[_dense_index(ind)]; }
+
+  template <typename... I> long position(int i0, I... i) const { return position(index_t(i0, i...)); }
+
+  friend bool operator==(block_sparse_pattern const &x, block_sparse_pattern const &y) {
+   if (&x == &y) return true;
+   for (int d = 0; d < R; ++d)
+    if (x._shape[d] != y._shape[d]) return false;
+   return x._position == y._position;
+  }
+  friend bool operator!=(block_sparse_pattern const &x, block_sparse_pattern const &y) { return !(x == y); }
+
+  friend std::ostream &operator<<(std::ostream &out, block_sparse_pattern const &p) {
+   return out << "block_sparse_pattern of shape " << p._shape << " with " << p.size() << " elements";
+  }
+
+  // HDF5 : the shape and the non zero elements as a (size, R) array
+  friend std::string get_triqs_hdf5_data_scheme(block_sparse_pattern const &) { return "BlockSparsePattern"; }
+
+  friend void h5_write(h5::group fg, std::string subgroup_name, block_sparse_pattern const &p) {
+   auto gr = fg.create_group(subgroup_name);
+   gr.write_triqs_hdf5_data_scheme(p);
+   arrays::array<int, 1> sh(R);
+   for (int d = 0; d < R; ++d) sh(d) = p._shape[d];
+   arrays::array<int, 2> nz(p.size(), R);
+   for (long n = 0; n < p.size(); ++n)
+    for (int d = 0; d < R; ++d) nz(n, d) = p._non_zeros[n][d];
+   h5_write(gr, "shape", sh);
+   h5_write(gr, "non_zeros", nz);
+  }
+
+  friend void h5_read(h5::group fg, std::string subgroup_name, block_sparse_pattern &p) {
+   auto gr = fg.open_group(subgroup_name);
+   arrays::array<int, 1> sh;
+   arrays::array<int, 2> nz;
+   h5_read(gr, "shape", sh);
+   h5_read(gr, "non_zeros", nz);
+   if (first_dim(sh) != R) TRIQS_RUNTIME_ERROR << "h5_read : block_sparse_pattern of rank " << first_dim(sh) << " instead of " << R;
+   index_t shape;
+   for (int d = 0; d < R; ++d) shape[d] = sh(d);
+   std::vector<index_t> non_zeros(first_dim(nz));
+   for (long n = 0; n < long(first_dim(nz)); ++n)
+    for (int d = 0; d < R; ++d) non_zeros[n][d] = nz(n, d);
+   p = block_sparse_pattern(shape, std::move(non_zeros));
+  }
+ };
+
+ /// The pattern of all the elements of the tensor of shape sh for which is_non_zero(index_t) is true
+ template <int R, typename F> block_sparse_pattern<R> make_block_sparse_pattern(arrays::mini_vector<int, R> const &sh, F is_non_zero) {
+  std::vector<arrays::mini_vector<int, R>> non_zeros;
+  auto ind = arrays::mini_vector<int, R>{};
+  ind = 0;
+  for (long i = 0; i < sh.product_of_elements(); ++i) {
+   if (is_non_zero(ind)) non_zeros.push_back(ind);
+   for (int d = R - 1; d >= 0; --d) { // next index in C order
+    if (++ind[d] < sh[d]) break;
+    ind[d] = 0;
+   }
+  }
+  return {sh, std::move(non_zeros)};
+ }
+
+ //------------------------------------------------------
+
+ template <typename T> struct is_block_sparse_tensor : std::false_type {};
+
+ /**
+  * The value of a block sparse gf at one point of the mesh.
+  *
+  * It is a simple pointer to the stored elements (no reference counting, it can be used in threads).
+  * (i,j,...) returns the element : for a mutable view, a reference, or an exception for a structural zero ;
+  * for a const view, a value, 0 for a structural zero.
+  */
+ template <typename T, int R> class block_sparse_tensor_view {
+  T *_start;
+  long _stride;
+  block_sparse_pattern<R> const *_pattern;
+
+  public:
+  using value_type = std14::remove_const_t<T>;
+
+  block_sparse_tensor_view(T *start, long stride, block_sparse_pattern<R> const *pattern)
+     : _start(start), _stride(stride), _pattern(pattern) {}
+
+  block_sparse_pattern<R> const &pattern() const { return *_pattern; }
+
+  /// Number of stored elements
+  long size() const { return _pattern->size(); }
+
+  /// The n-th stored element
+  T &operator[](long n) const { return _start[n * _stride]; }
+
+  private:
+  value_type _element(long n, std::true_type) const { return (n == -1 ? value_type{} : (*this)[n]); }
+  T &_element(long n, std::false_type) const {
+   if (n == -1) TRIQS_RUNTIME_ERROR << "block sparse gf : this element is not in the pattern (structural zero)";
+   return (*this)[n];
+  }
+
+  public:
+  template <typename... I>
+  auto operator()(int i0, I... i) const DECL_AND_RETURN(_element(_pattern->position(i0, i...), std::is_const<T>{}));
+
+  /// Assign the stored elements from another block sparse tensor with the same pattern, or an expression of them
+  block_sparse_tensor_view &operator=(block_sparse_tensor_view const &x) {
+   _assign(x);
+   return *this;
+  }
+
+  template <typename X> std14::enable_if_t<is_block_sparse_tensor<X>::value, block_sparse_tensor_view &> operator=(X const &x) {
+   _assign(x);
+   return *this;
+  }
+
+  /// All stored elements are set to x
+  template <typename X> std14::enable_if_t<utility::is_in_ZRC<X>::value, block_sparse_tensor_view &> operator=(X const &x) {
+   for (long n = 0; n < size(); ++n) (*this)[n] = x;
+   return *this;
+  }
+
+  private:
+  template <typename X> void _assign(X const &x) {
+   static_assert(!std::is_const<T>::value, "Cannot assign to a const view");
+   if (x.pattern() != pattern()) TRIQS_RUNTIME_ERROR << "block sparse gf : assignment with a different pattern";
+   for (long n = 0; n < size(); ++n) (*this)[n] = x[n];
+  }
+ };
+
+ template <typename T, int R> struct is_block_sparse_tensor<block_sparse_tensor_view<T, R>> : std::true_type {};
+
+ //------------------------------------------------------
+ // Lazy operations on the block sparse tensors, e.g. in gf expressions.
+ // They are evaluated element by element when assigned to a block_sparse_tensor_view.
+
+ namespace details_block_sparse {
+  template <typename X> std14::enable_if_t<!is_block_sparse_tensor<X>::value, X> _get(X const &x, long) { return x; }
+  template <typename X>
+  auto _get(X const &x, long n) -> std14::enable_if_t<is_block_sparse_tensor<X>::value, decltype(x[n])> {
+   return x[n];
+  }
+
+  template <typename X, typename Y>
+  std14::enable_if_t<is_block_sparse_tensor<X>::value && is_block_sparse_tensor<Y>::value, decltype(std::declval<X>().pattern())>
+  _pattern(X const &x, Y const &y) {
+   if (x.pattern() != y.pattern()) TRIQS_RUNTIME_ERROR << "block sparse gf : operation on tensors with different patterns";
+   return x.pattern();
+  }
+  template <typename X, typename Y>
+  std14::enable_if_t<!is_block_sparse_tensor<Y>::value, decltype(std::declval<X>().pattern())> _pattern(X const &x, Y const &) {
+   return x.pattern();
+  }
+  template <typename X, typename Y>
+  std14::enable_if_t<!is_block_sparse_tensor<X>::value, decltype(std::declval<Y>().pattern())> _pattern(X const &, Y const &y) {
+   return y.pattern();
+  }
+ }
+
+ template <typename Tag, typename L, typename R> struct block_sparse_expr {
+  L l;
+  R r;
+  auto pattern() const DECL_AND_RETURN(details_block_sparse::_pattern(l, r));
+  long size() const { return pattern().size(); }
+  auto operator[](long n) const
+      DECL_AND_RETURN(utility::operation<Tag>()(details_block_sparse::_get(l, n), details_block_sparse::_get(r, n)));
+ };
+
+ template <typename L> struct block_sparse_unary_m_expr {
+  L l;
+  auto pattern() const DECL_AND_RETURN(l.pattern());
+  long size() const { return l.size(); }
+  auto operator[](long n) const DECL_AND_RETURN(-l[n]);
+ };
+
+ template <typename Tag, typename L, typename R> struct is_block_sparse_tensor<block_sparse_expr<Tag, L, R>> : std::true_type {};
+ template <typename L> struct is_block_sparse_tensor<block_sparse_unary_m_expr<L>> : std::true_type {};
+
+#define DEFINE_OPERATOR(TAG, OP, TRAIT1, TRAIT2)                                                                                 \
+ template <typename A1, typename A2>                                                                                             \
+ std14::enable_if_t<TRAIT1<A1>::value && TRAIT2<A2>::value, block_sparse_expr<utility::tags::TAG, A1, A2>> operator OP(         \
+     A1 const &a1, A2 const &a2) {                                                                                               \
+  return {a1, a2};                                                                                                               \
+ }
+
+ DEFINE_OPERATOR(plus, +, is_block_sparse_tensor, is_block_sparse_tensor);
+ DEFINE_OPERATOR(minus, -, is_block_sparse_tensor, is_block_sparse_tensor);
+ DEFINE_OPERATOR(multiplies, *, utility::is_in_ZRC, is_block_sparse_tensor);
+ DEFINE_OPERATOR(multiplies, *, is_block_sparse_tensor, utility::is_in_ZRC);
+ DEFINE_OPERATOR(divides, /, is_block_sparse_tensor, utility::is_in_ZRC);
+#undef DEFINE_OPERATOR
+
+ template <typename A1>
+ std14::enable_if_t<is_block_sparse_tensor<A1>::value, block_sparse_unary_m_expr<A1>> operator-(A1 const &a1) {
+  return {a1};
+ }
+
+ //------------------------------------------------------
+
+ // The shape of the data of a block sparse gf : the lengths of the mesh and the pattern.
+ template <int N, int R> struct block_sparse_shape {
+  arrays::mini_vector<size_t, N> mesh_lengths;
+  std::shared_ptr<const block_sparse_pattern<R>> pattern;
+
+  friend bool operator==(block_sparse_shape const &x, block_sparse_shape const &y) {
+   for (int d = 0; d < N; ++d)
+    if (x.mesh_lengths[d] != y.mesh_lengths[d]) return false;
+   return *x.pattern == *y.pattern;
+  }
+  friend std::ostream &operator<<(std::ostream &out, block_sparse_shape const &s) {
+   return out << s.mesh_lengths << " x " << *s.pattern;
+  }
+ };
+
+ /**
+  * The data of a block sparse gf, with N variables.
+  * A is array<T, N+1> or its (const) views : values(mesh indices..., n) is the n-th stored element of the pattern.
+  */
+ template <typename A, int R> struct block_sparse_data {
+  static constexpr int N = A::rank - 1;
+  static constexpr bool is_const = A::is_const;
+
+  A values;
+  std::shared_ptr<const block_sparse_pattern<R>> pattern;
+
+  block_sparse_data() : pattern(std::make_shared<block_sparse_pattern<R>>()) {}
+  block_sparse_data(A v, std::shared_ptr<const block_sparse_pattern<R>> p) : values(std::move(v)), pattern(std::move(p)) {}
+  block_sparse_data(block_sparse_data const &) = default;
+  block_sparse_data(block_sparse_data &&) = default;
+  template <typename A2> block_sparse_data(block_sparse_data<A2, R> const &x) : values(x.values), pattern(x.pattern) {}
+  template <typename A2> block_sparse_data(block_sparse_data<A2, R> &x) : values(x.values), pattern(x.pattern) {}
+
+  block_sparse_data &operator=(block_sparse_data const &) = default;
+  block_sparse_data &operator=(block_sparse_data &&) = default;
+
+  void rebind(block_sparse_data const &x) {
+   values.rebind(x.values);
+   pattern = x.pattern;
+  }
+  template <typename A2> void rebind(block_sparse_data<A2, R> const &x) {
+   values.rebind(x.values);
+   pattern = x.pattern;
+  }
+
+  friend block_sparse_shape<N, R> get_shape(block_sparse_data const &d) { return {d.values.shape().pop(), d.pattern}; }
+
+  /// resize for a new shape. No effect if the shape is the same.
+  void resize(block_sparse_shape<N, R> const &sh) {
+   if (sh == get_shape(*this)) return;
+   values.resize(sh.mesh_lengths.append(sh.pattern->size()));
+   values() = 0;
+   pattern = sh.pattern;
+  }
+
+  friend void swap(block_sparse_data &x, block_sparse_data &y) noexcept {
+   using std::swap;
+   swap(x.values, y.values);
+   swap(x.pattern, y.pattern);
+  }
+ };
+
+ namespace gfs_implementation {
+
+  /// ---------------------------  hdf5 ---------------------------------
+
+  template <typename Variable, int R> struct h5_name<Variable, block_sparse_valued<R>, nothing> {
+   static std::string invoke() { return h5_name<Variable, matrix_valued, nothing>::invoke() + "_BlockSparse"; }
+  };
+
+  template <typename Variable, int R> struct h5_rw<Variable, block_sparse_valued<R>, nothing, void> {
+
+   static void write(h5::group gr, gf_const_view<Variable, block_sparse_valued<R>> g) {
+    h5_write(gr, "data", g._data.values);
+    h5_write(gr, "pattern", *g._data.pattern);
+    h5_write(gr, "mesh", g._mesh);
+   }
+
+   template <bool IsView> static void read(h5::group gr, gf_impl<Variable, block_sparse_valued<R>, nothing, void, IsView, false> &g) {
+    auto p = std::make_shared<block_sparse_pattern<R>>();
+    h5_read(gr, "pattern", *p);
+    h5_read(gr, "data", g._data.values);
+    if (long(g._data.values.shape()[g._data.N]) != p->size())
+     TRIQS_RUNTIME_ERROR << "h5_read : the data and the pattern of the block sparse gf have different sizes";
+    g._data.pattern = p;
+    h5_read(gr, "mesh", g._mesh);
+   }
+  };
+
+  // ---------------------------  data access  ---------------------------------
+
+  template <typename Variable, int R> struct data_proxy<Variable, block_sparse_valued<R>> {
+   static constexpr int N = get_n_variables<Variable>::value;
+
+   using storage_t = block_sparse_data<arrays::array<dcomplex, N + 1>, R>;
+   using storage_view_t = block_sparse_data<arrays::array_view<dcomplex, N + 1>, R>;
+   using storage_const_view_t = block_sparse_data<arrays::array_const_view<dcomplex, N + 1>, R>;
+
+   template <typename S> using _value_t = std14::conditional_t<std::is_const<S>::value || S::is_const, const dcomplex, dcomplex>;
+
+   private:
+   // offset of the mesh point in the data, from its linear index
+   template <typename S> static long _offset(S const &data, long i) { return i * data.values.indexmap().strides()[0]; }
+
+   template <typename S, typename Tu, size_t... Is> static long _offset_impl(S const &data, Tu const &tu, std14::index_sequence<Is...>) {
+    auto const &st = data.values.indexmap().strides();
+    long r = 0;
+    long dummy[] = {(r += std::get<Is>(tu) * st[Is])...};
+    (void)dummy;
+    return r;
+   }
+   template <typename S, typename... I> static long _offset(S const &data, std::tuple<I...> const &tu) {
+    return _offset_impl(data, tu, std14::index_sequence_for<I...>{});
+   }
+
+   public:
+   /// The data access
+   template <typename S, typename I> block_sparse_tensor_view<_value_t<S>, R> operator()(S &data, I const &i) const {
+    auto *p = const_cast<_value_t<S> *>(data.values.data_start()) + _offset(data, i);
+    return {p, data.values.indexmap().strides()[N], data.pattern.get()};
+   }
+
+   template <typename S, typename RHS> static void assign_to_scalar(S &data, RHS &&rhs) { data.values() = std::forward<RHS>(rhs); }
+   template <typename ST, typename RHS> static void rebind(ST &data, RHS &&rhs) { data.rebind(rhs.data()); }
+  };
+
+  // -------------------------------   Factory for data  --------------------------------------------------
+
+  template <typename Variable, int R> struct data_factory<Variable, block_sparse_valued<R>, nothing> {
+   using mesh_t = gf_mesh<Variable>;
+   using gf_t = gf<Variable, block_sparse_valued<R>>;
+   using target_shape_t = block_sparse_pattern<R>;
+   using aux_t = nothing;
+
+   static typename gf_t::data_t make(mesh_t const &m, target_shape_t const &p, aux_t) {
+    auto a = arrays::array<dcomplex, get_n_variables<Variable>::value + 1>{m.size_of_components().append(p.size())};
+    a() = 0;
+    return {std::move(a), std::make_shared<const block_sparse_pattern<R>>(p)};
+   }
+  };
+
+ } // gfs_implementation
+
+ /// The pattern of a block sparse gf
+ template <typename Variable, int R, typename Evaluator, bool IsView, bool IsConst>
+ block_sparse_pattern<R> const &get_pattern(gf_impl<Variable, block_sparse_valued<R>, nothing, Evaluator, IsView, IsConst> const &g) {
+  return *g.data().pattern;
+ }
+}
+
+namespace mpi {
+
+ // MPI reductions of the data of a block sparse gf : the pattern must be the same on all nodes.
+ template <typename A, int R> struct mpi_impl<gfs::block_sparse_data<A, R>> {
+  using D = gfs::block_sparse_data<A, R>;
+
+  static void reduce_in_place(communicator c, D &d, int root) { triqs::mpi::reduce_in_place(d.values, c, root); }
+  static void all_reduce_in_place(communicator c, D &d, int root) { triqs::mpi::all_reduce_in_place(d.values, c, root); }
+  static void broadcast(communicator c, D &d, int root) { triqs::mpi::broadcast(d.values, c, root); }
+
+  template <typename Tag> static void invoke2(D &lhs, Tag, communicator c, D const &rhs, int root) {
+   static_assert(std::is_same<Tag, tag::reduce>::value || std::is_same<Tag, tag::all_reduce>::value,
+                 "Only reduce and all_reduce are implemented for block sparse gf");
+   lhs.pattern = rhs.pattern;
+   mpi::_invoke2(lhs.values, Tag(), c, rhs.values, root);
+  }
+ };
+}
+}
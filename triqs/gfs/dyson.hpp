@@ -0,0 +1,183 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include "./imfreq.hpp"
+#include "./bz.hpp"
+#include <triqs/arrays/linalg/batched_inverse.hpp>
+#ifndef TRIQS_C11
+#include "./imtime.hpp"
+#include "./product.hpp"
+#include "./curry.hpp"
+#include "./m_tail.hpp"
+#endif
+
+namespace triqs {
+namespace gfs {
+
+ /**
+  * Dyson equation on a lattice : G(k, iw) = [iw + mu - eps(k) - Sigma(iw)]^{-1}
+  *
+  * The matrices are built and inverted in one pass, by batches distributed over the threads
+  * (cf triqs/utility/parallel.hpp), with a workspace allocated once per thread.
+  * All these functions only use raw pointers in the threads, no views.
+  */
+
+ namespace details_dyson {
+  // raw access to a 3d array a(n, i, j)
+  template <typename T> struct raw3 {
+   T *p;
+   std::ptrdiff_t s0, s1, s2;
+   T &operator()(long n, long i, long j) const { return p[n * s0 + i * s1 + j * s2]; }
+  };
+  template <typename T, typename A> raw3<T> make_raw3(A &&a) {
+   auto const &s = a.indexmap().strides();
+   return {a.data_start(), s[0], s[1], s[2]};
+  }
+
+  // the z = iw + mu of a Matsubara mesh
+  inline std::vector<dcomplex> make_z(gf_mesh<imfreq> const &m, double mu) {
+   std::vector<dcomplex> z;
+   z.reserve(m.size());
+   for (auto const &w : m) z.push_back(dcomplex(w) + mu);
+   return z;
+  }
+
+  // m = z - e - s for dim x dim matrices, m in C order.
+  inline void fill_dyson_matrix(dcomplex *m, long dim, dcomplex z, raw3<const dcomplex> const &e, long k,
+                                raw3<const dcomplex> const &s, long n) {
+   for (long i = 0; i < dim; ++i)
+    for (long j = 0; j < dim; ++j) m[i * dim + j] = (i == j ? z : dcomplex(0)) - e(k, i, j) - s(n, i, j);
+  }
+ }
+
+ /**
+  * Fused Dyson equation and sum over k, on the raw data.
+  *
+  *   acc(n,,) += sum_k weights[k] * [ z(n) - eps(k,,) - sigma(n,,) ]^{-1}
+  *
+  * acc and sigma have shape (nw, dim, dim), eps has shape (nk, dim, dim), z has size nw, weights has size nk.
+  * G(k, iw) is never stored : only one dim x dim matrix per thread.
+  *
+  * The frequencies are distributed over the threads and, for a given frequency, the k are
+  * always summed in the same order : the result does not depend on the number of threads.
+  * The k are taken by blocks small enough for the eps(k) of the block to stay in cache while they are
+  * used for all the frequencies of the thread.
+  */
+ inline void dyson_accumulate_sum_k(arrays::array_view<dcomplex, 3> acc, std::vector<dcomplex> const &z,
+                                    arrays::array_const_view<dcomplex, 3> eps, arrays::array_const_view<dcomplex, 3> sigma,
+                                    std::vector<double> const &weights) {
+  long nw = first_dim(acc), nk = first_dim(eps), dim = third_dim(acc);
+  if ((long(second_dim(acc)) != dim) || (long(second_dim(eps)) != dim) || (long(third_dim(eps)) != dim) ||
+      (long(second_dim(sigma)) != dim) || (long(third_dim(sigma)) != dim))
+   TRIQS_RUNTIME_ERROR << "dyson_accumulate_sum_k : the matrices do not have the same size";
+  if ((long(first_dim(sigma)) != nw) || (long(z.size()) != nw))
+   TRIQS_RUNTIME_ERROR << "dyson_accumulate_sum_k : the number of frequencies do not match";
+  if (long(weights.size()) != nk) TRIQS_RUNTIME_ERROR << "dyson_accumulate_sum_k : the number of weights and k points do not match";
+  auto A = details_dyson::make_raw3<dcomplex>(acc);
+  auto E = details_dyson::make_raw3<const dcomplex>(eps);
+  auto S = details_dyson::make_raw3<const dcomplex>(sigma);
+  long k_block = std::max(1l, 4096 / (dim * dim)); // 64kB of eps(k)
+  utility::parallel_for_chunks(nw, [&](long first, long last) {
+   arrays::batched_inverse_worker<dcomplex> worker(dim);
+   std::vector<dcomplex> m(dim * dim);
+   for (long k0 = 0; k0 < nk; k0 += k_block) {
+    long k1 = std::min(nk, k0 + k_block);
+    for (long n = first; n < last; ++n)
+     for (long k = k0; k < k1; ++k) {
+      details_dyson::fill_dyson_matrix(m.data(), dim, z[n], E, k, S, n);
+      worker.invert(m.data(), dim, 1);
+      for (long i = 0; i < dim; ++i)
+       for (long j = 0; j < dim; ++j) A(n, i, j) += weights[k] * m[i * dim + j];
+     }
+   }
+  }, 1);
+ }
+
+ /// Same with all weights equal to 1
+ inline void dyson_accumulate_sum_k(arrays::array_view<dcomplex, 3> acc, std::vector<dcomplex> const &z,
+                                    arrays::array_const_view<dcomplex, 3> eps, arrays::array_const_view<dcomplex, 3> sigma) {
+  dyson_accumulate_sum_k(acc, z, eps, sigma, std::vector<double>(first_dim(eps), 1.0));
+ }
+
+ /**
+  * Local Green function G(iw) = 1/N_k sum_k [iw + mu - eps(k) - Sigma(iw)]^{-1}, with its tail.
+  *
+  * Fused Dyson equation and k-sum : G(k, iw) is never stored (cf dyson_accumulate_sum_k).
+  */
+ inline gf<imfreq> sum_k_dyson(gf_const_view<brillouin_zone> eps, gf_const_view<imfreq> sigma, double mu) {
+  auto res = gf<imfreq>{sigma.mesh(), get_target_shape(sigma)};
+  res.data()() = 0;
+  long nk = eps.mesh().size();
+  if (nk == 0) TRIQS_RUNTIME_ERROR << "sum_k_dyson : no k points";
+  dyson_accumulate_sum_k(res.data(), details_dyson::make_z(sigma.mesh(), mu), eps.data(), sigma.data());
+  res.data() /= nk;
+
+  auto t = tail_omega(res.singularity()) + mu - sigma.singularity();
+  auto g_k = [&](long k) { return inverse(t - matrix<dcomplex>{eps.data()(k, range(), range())}); };
+  tail r = g_k(0);
+  for (long k = 1; k < nk; ++k) r += g_k(k);
+  res.singularity() = r / dcomplex(nk);
+  return res;
+ }
+
+#ifndef TRIQS_C11
+ /**
+  * Computes G(k, iw) = [iw + mu - eps(k) - Sigma(iw)]^{-1} in place in G, with its tail.
+  *
+  * The mesh of eps must be the first component of the mesh of G, the mesh of Sigma the second one.
+  */
+ inline void lattice_dyson(gf_view<cartesian_product<brillouin_zone, imfreq>, matrix_valued, m_tail<brillouin_zone>> G,
+                           gf_const_view<brillouin_zone> eps, gf_const_view<imfreq> sigma, double mu) {
+  auto const &mk = std::get<0>(G.mesh().components());
+  auto const &mw = std::get<1>(G.mesh().components());
+  if (mk != eps.mesh()) TRIQS_RUNTIME_ERROR << "lattice_dyson : the k meshes of G and eps do not match";
+  if (mw != sigma.mesh()) TRIQS_RUNTIME_ERROR << "lattice_dyson : the frequency meshes of G and Sigma do not match";
+  long nk = mk.size(), nw = mw.size(), dim = get_target_shape(G)[0];
+  if ((long(get_target_shape(eps)[0]) != dim) || (long(get_target_shape(sigma)[0]) != dim))
+   TRIQS_RUNTIME_ERROR << "lattice_dyson : the target spaces do not match";
+
+  auto z = details_dyson::make_z(mw, mu);
+  auto E = details_dyson::make_raw3<const dcomplex>(eps.data());
+  auto S = details_dyson::make_raw3<const dcomplex>(sigma.data());
+  auto const &gs = G.data().indexmap().strides();
+  dcomplex *g0 = G.data().data_start();
+  utility::parallel_for_chunks(nk * nw, [&](long first, long last) {
+   arrays::batched_inverse_worker<dcomplex> worker(dim);
+   for (long i = first; i < last; ++i) {
+    long k = i / nw, n = i % nw;
+    dcomplex *p = g0 + k * gs[0] + n * gs[1];
+    if ((gs[2] == dim) && (gs[3] == 1))
+     details_dyson::fill_dyson_matrix(p, dim, z[n], E, k, S, n);
+    else
+     for (long a = 0; a < dim; ++a)
+      for (long b = 0; b < dim; ++b) p[a * gs[2] + b * gs[3]] = (a == b ? z[n] : dcomplex(0)) - E(k, a, b) - S(n, a, b);
+    worker.invert(p, gs[2], gs[3]);
+   }
+  }, std::max(1l, utility::parallel_grain_size / (dim * dim)));
+
+  // The tails. Serial : the tail operations create views, whose reference counting is not thread safe.
+  auto gt = G.singularity();
+  auto t = tail_omega(gt.get_from_linear_index(0)) + mu - sigma.singularity();
+  for (long k = 0; k < nk; ++k) gt.get_from_linear_index(k) = inverse(t - matrix<dcomplex>{eps.data()(k, range(), range())});
+ }
+#endif
+}
+}
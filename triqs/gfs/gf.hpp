@@ -445,21 +445,36 @@ namespace gfs {
  template <typename RHS, typename Variable, typename Target, typename Singularity, typename Evaluator, bool IsView>
  void triqs_clef_auto_assign_impl(gf_impl<Variable, Target, Singularity, Evaluator, IsView, false> &g, RHS const &rhs,
                                   std::integral_constant<bool, false>) {
-  for (auto const &w : g.mesh()) {
+  using mesh_point_t = typename gf_mesh<Variable>::mesh_point_t;
+  parallel_foreach(g.mesh(), [&g, &rhs](mesh_point_t const &w) {
    triqs_gf_clef_auto_assign_impl_aux_assign(g[w], rhs(w));
    //(*this)[w] = rhs(w);
-  }
+  });
  }
 
  template <typename RHS, typename Variable, typename Target, typename Singularity, typename Evaluator, bool IsView>
  void triqs_clef_auto_assign_impl(gf_impl<Variable, Target, Singularity, Evaluator, IsView, false> &g, RHS const &rhs,
                                   std::integral_constant<bool, true>) {
-  for (auto const &w : g.mesh()) {
+  using mesh_point_t = typename gf_mesh<Variable>::mesh_point_t;
+  parallel_foreach(g.mesh(), [&g, &rhs](mesh_point_t const &w) {
    triqs_gf_clef_auto_assign_impl_aux_assign(g[w], triqs::tuple::apply(rhs, w.components_tuple()));
    //(*this)[w] = triqs::tuple::apply(rhs, w.components_tuple());
-  }
+  });
+ }
+
+ // ------------------------- Assignment of the data from a function (gf or expression) ------------------------------
+
+ // g[w] = rhs[w] for all the points of the mesh
+ template <typename G, typename RHS> void assign_data_point_by_point(G &g, RHS const &rhs) {
+  using mesh_point_t = typename G::mesh_point_t;
+  parallel_foreach(g.mesh(), [&g, &rhs](mesh_point_t const &w) { g[w] = rhs[w]; });
  }
 
+ // Specialized for the expressions which are evaluated on the whole data at once (cf gf_expr.hpp)
+ template <typename RHS, typename Enable = void> struct gf_data_assign {
+  template <typename G> static void invoke(G &g, RHS const &rhs) { assign_data_point_by_point(g, rhs); }
+ };
+
  // -------------------------The regular class of GF --------------------------------------------------------
 
  template <typename Variable, typename Target, typename Singularity, typename Evaluator> class gf : public gf_impl<Variable, Target, Singularity, Evaluator, false, false> {
@@ -531,9 +546,7 @@ namespace gfs {
   template <typename RHS> void operator=(RHS &&rhs) {
    this->_mesh = rhs.mesh();
    this->_data.resize(get_gf_data_shape(rhs));
-   for (auto const &w : this->mesh()) {
-    (*this)[w] = rhs[w];
-   }
+   gf_data_assign<std14::decay_t<RHS>>::invoke(*this, rhs);
    this->_singularity = rhs.singularity();
    // to be implemented : there is none in the gf_expr in particular....
    // this->_symmetry = rhs.symmetry();
@@ -637,7 +650,7 @@ namespace gfs {
  DISABLE_IF(arrays::is_scalar<RHS>) triqs_gf_view_assign_delegation(gf_view<Variable, Target, Singularity, Evaluator> g, RHS const &rhs) {
   if (!(g.mesh() == rhs.mesh()))
    TRIQS_RUNTIME_ERROR << "Gf Assignment in View : incompatible mesh" << g.mesh() << " vs " << rhs.mesh();
-  for (auto const &w : g.mesh()) g[w] = rhs[w];
+  gf_data_assign<RHS>::invoke(g, rhs);
   g.singularity() = rhs.singularity();
  }
 
@@ -741,12 +754,8 @@ namespace gfs {
 
  //  ---- inversion
  // auxiliary function : invert the data : one function for all matrix valued gf (save code).
- template <typename A3> void _gf_invert_data_in_place(A3 &&a) {
-  for (int i = 0; i < first_dim(a); ++i) { // Rely on the ordering
-   auto v = make_matrix_view(a(i, arrays::range(), arrays::range()));
-   v = triqs::arrays::inverse(v);
-  }
- }
+ // The matrices are the last two indices of the data, for any mesh.
+ template <typename A3> void _gf_invert_data_in_place(A3 &&a) { arrays::batched_inverse_in_place(a); }
 
  template <typename Variable, typename Singularity, typename Evaluator>
  void invert_in_place(gf_view<Variable, matrix_valued, Singularity, Evaluator> g) {
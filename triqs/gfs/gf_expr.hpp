@@ -21,6 +21,7 @@
 #ifndef TRIQS_GF_EXPR_H
 #define TRIQS_GF_EXPR_H
 #include <triqs/utility/expression_template_tools.hpp>
+#include <triqs/arrays/linalg/batched_linalg.hpp>
 namespace triqs { namespace gfs {
 
  using utility::is_in_ZRC;
@@ -152,23 +153,292 @@ namespace triqs { namespace gfs {
   return {std::forward<A1>(a1)};
  }
 
-// Now the inplace operator. Because of expression template, there are useless for speed
-// we implement them trivially.
+// ------------------- Evaluation of the matrix products on the whole mesh -----------------------------------
+//
+// For matrix valued gf, g = P, g = P + C, g = C + P, g = P - C, g = C - P,
+// where P = g1 * g2, possibly with scalar factors (s * g1 * g2, g1 * g2 / s, -g1 * g2 ...) and g1, g2, C are gf or gf_view,
+// are computed by one batched_gemm on the data arrays (cf arrays/linalg/batched_linalg.hpp), instead of a loop on the mesh
+// points with a matrix product at each point. If the data of g are the data of g1 or g2, the point by point loop is used.
 
-#define DEFINE_OPERATOR(OP1, OP2)                                                                                                \
- template <typename Variable, typename Target, typename Evaluator, typename T>                                                   \
- void operator OP1(gf_view<Variable, Target, Evaluator> g, T const &x) {                                                         \
-  g = g OP2 x;                                                                                                                   \
+ namespace gfs_expr_tools {
+  namespace batched {
+
+   using utility::tags::plus;
+   using utility::tags::minus;
+   using utility::tags::multiplies;
+   using utility::tags::divides;
+
+   template <typename Variable, typename Singularity, typename Evaluator, bool IsView, bool IsConst>
+   std::true_type _is_matrix_gf(gf_impl<Variable, matrix_valued, Singularity, Evaluator, IsView, IsConst> const *);
+   std::false_type _is_matrix_gf(...);
+
+   // a matrix valued gf, gf_view (not an expression), with its data in an array
+   template <typename G, typename Enable = void> struct leaf : std::false_type {};
+   template <typename G>
+   struct leaf<G, std14::enable_if_t<decltype(_is_matrix_gf(std::declval<G *>()))::value>>
+       : std::is_base_of<arrays::Tag::indexmap_storage_pair, typename G::data_t> {
+    using value_type = std14::remove_const_t<typename G::data_t::value_type>;
+   };
+
+   template <typename S, typename V> using is_factor = std::is_convertible<S, V>;
+
+   // an operand of the product : g, s * g, g * s or -g, with g a leaf. All types are decayed.
+   template <typename X, typename Enable = void> struct operand : std::false_type {};
+
+   template <typename X> struct operand<X, std14::enable_if_t<leaf<X>::value>> : std::true_type {
+    using value_type = typename leaf<X>::value_type;
+    static X const &get(X const &x) { return x; }
+    static value_type factor(X const &) { return 1; }
+   };
+
+   template <typename S, typename Y>
+   struct operand<gf_expr<multiplies, scalar_wrap<S>, Y>,
+                  std14::enable_if_t<leaf<std14::decay_t<Y>>::value &&is_factor<S, typename leaf<std14::decay_t<Y>>::value_type>::value>>
+       : std::true_type {
+    using value_type = typename leaf<std14::decay_t<Y>>::value_type;
+    static std14::decay_t<Y> const &get(gf_expr<multiplies, scalar_wrap<S>, Y> const &x) { return x.r; }
+    static value_type factor(gf_expr<multiplies, scalar_wrap<S>, Y> const &x) { return x.l.s; }
+   };
+
+   template <typename S, typename Y>
+   struct operand<gf_expr<multiplies, Y, scalar_wrap<S>>,
+                  std14::enable_if_t<leaf<std14::decay_t<Y>>::value &&is_factor<S, typename leaf<std14::decay_t<Y>>::value_type>::value>>
+       : std::true_type {
+    using value_type = typename leaf<std14::decay_t<Y>>::value_type;
+    static std14::decay_t<Y> const &get(gf_expr<multiplies, Y, scalar_wrap<S>> const &x) { return x.l; }
+    static value_type factor(gf_expr<multiplies, Y, scalar_wrap<S>> const &x) { return x.r.s; }
+   };
+
+   template <typename Y> struct operand<gf_unary_m_expr<Y>, std14::enable_if_t<leaf<std14::decay_t<Y>>::value>> : std::true_type {
+    using value_type = typename leaf<std14::decay_t<Y>>::value_type;
+    static std14::decay_t<Y> const &get(gf_unary_m_expr<Y> const &x) { return x.l; }
+    static value_type factor(gf_unary_m_expr<Y> const &) { return -1; }
+   };
+
+   // the product of two operands, of the same value type
+   template <typename X, typename Enable = void> struct product : std::false_type {};
+
+   template <typename L, typename R>
+   struct product<gf_expr<multiplies, L, R>,
+                  std14::enable_if_t<operand<std14::decay_t<L>>::value &&operand<std14::decay_t<R>>::value &&std::is_same<
+                      typename operand<std14::decay_t<L>>::value_type, typename operand<std14::decay_t<R>>::value_type>::value>>
+       : std::true_type {
+    using X = gf_expr<multiplies, L, R>;
+    using OL = operand<std14::decay_t<L>>;
+    using OR = operand<std14::decay_t<R>>;
+    using value_type = typename OL::value_type;
+    static auto a(X const &x) DECL_AND_RETURN(OL::get(x.l).data());
+    static auto b(X const &x) DECL_AND_RETURN(OR::get(x.r).data());
+    static value_type alpha(X const &x) { return OL::factor(x.l) * OR::factor(x.r); }
+   };
+
+   // a term : a product, possibly with a scalar factor. P is the product, alpha the factor.
+   template <typename X, typename Enable = void> struct term : std::false_type {};
+
+   template <typename X> struct term<X, std14::enable_if_t<product<X>::value>> : std::true_type {
+    using P = product<X>;
+    using value_type = typename P::value_type;
+    static X const &prod(X const &x) { return x; }
+    static value_type alpha(X const &) { return 1; }
+   };
+
+   template <typename S, typename Y>
+   struct term<gf_expr<multiplies, scalar_wrap<S>, Y>,
+               std14::enable_if_t<product<std14::decay_t<Y>>::value &&is_factor<S, typename product<std14::decay_t<Y>>::value_type>::value>>
+       : std::true_type {
+    using P = product<std14::decay_t<Y>>;
+    using value_type = typename P::value_type;
+    static std14::decay_t<Y> const &prod(gf_expr<multiplies, scalar_wrap<S>, Y> const &x) { return x.r; }
+    static value_type alpha(gf_expr<multiplies, scalar_wrap<S>, Y> const &x) { return x.l.s; }
+   };
+
+   template <typename S, typename Y>
+   struct term<gf_expr<multiplies, Y, scalar_wrap<S>>,
+               std14::enable_if_t<product<std14::decay_t<Y>>::value &&is_factor<S, typename product<std14::decay_t<Y>>::value_type>::value>>
+       : std::true_type {
+    using P = product<std14::decay_t<Y>>;
+    using value_type = typename P::value_type;
+    static std14::decay_t<Y> const &prod(gf_expr<multiplies, Y, scalar_wrap<S>> const &x) { return x.l; }
+    static value_type alpha(gf_expr<multiplies, Y, scalar_wrap<S>> const &x) { return x.r.s; }
+   };
+
+   template <typename S, typename Y>
+   struct term<gf_expr<divides, Y, scalar_wrap<S>>,
+               std14::enable_if_t<product<std14::decay_t<Y>>::value &&is_factor<S, typename product<std14::decay_t<Y>>::value_type>::value>>
+       : std::true_type {
+    using P = product<std14::decay_t<Y>>;
+    using value_type = typename P::value_type;
+    static std14::decay_t<Y> const &prod(gf_expr<divides, Y, scalar_wrap<S>> const &x) { return x.l; }
+    static value_type alpha(gf_expr<divides, Y, scalar_wrap<S>> const &x) { return value_type(1) / value_type(x.r.s); }
+   };
+
+   template <typename Y> struct term<gf_unary_m_expr<Y>, std14::enable_if_t<product<std14::decay_t<Y>>::value>> : std::true_type {
+    using P = product<std14::decay_t<Y>>;
+    using value_type = typename P::value_type;
+    static std14::decay_t<Y> const &prod(gf_unary_m_expr<Y> const &x) { return x.l; }
+    static value_type alpha(gf_unary_m_expr<Y> const &) { return -1; }
+   };
+
+   // d = sign * alpha * a * b + beta * d, for the term x. Returns false if d shares its memory with a or b
+   template <typename T, typename D, typename X>
+   bool gemm(D &d, X const &x, typename T::value_type sign, typename T::value_type beta) {
+    auto const &p = T::prod(x);
+    auto const &a = T::P::a(p);
+    auto const &b = T::P::b(p);
+    if (arrays::matmul_impl::may_alias(d, a) || arrays::matmul_impl::may_alias(d, b)) return false;
+    arrays::batched_gemm(sign * T::alpha(x) * T::P::alpha(p), a, b, beta, d);
+    return true;
+   }
+
+   // the patterns. invoke(d, x) computes d = x, or returns false (in which case d is untouched).
+   template <typename X, typename Enable = void> struct pattern : std::false_type {};
+
+   template <typename X> struct pattern<X, std14::enable_if_t<term<X>::value>> : std::true_type {
+    using value_type = typename term<X>::value_type;
+    template <typename D> static bool invoke(D &d, X const &x) { return gemm<term<X>>(d, x, 1, 0); }
+   };
+
+   // P + C, C + P, P - C, C - P
+   template <typename Tag, typename L, typename R>
+   struct pattern<gf_expr<Tag, L, R>,
+                  std14::enable_if_t<(std::is_same<Tag, plus>::value || std::is_same<Tag, minus>::value) &&
+                                     ((term<std14::decay_t<L>>::value && leaf<std14::decay_t<R>>::value) ||
+                                      (leaf<std14::decay_t<L>>::value && term<std14::decay_t<R>>::value))>> : std::true_type {
+    static constexpr bool left = term<std14::decay_t<L>>::value;
+    static constexpr bool is_plus = std::is_same<Tag, plus>::value;
+    using T = std14::conditional_t<left, term<std14::decay_t<L>>, term<std14::decay_t<R>>>;
+    using C = leaf<std14::decay_t<std14::conditional_t<left, R, L>>>;
+    using value_type = std14::conditional_t<std::is_same<typename T::value_type, typename C::value_type>::value, typename T::value_type, void>;
+
+    template <typename D> static bool invoke(D &d, gf_expr<Tag, L, R> const &x) { return _invoke(d, x, std::integral_constant<bool, left>{}); }
+
+    private:
+    template <typename D> static bool _invoke(D &d, gf_expr<Tag, L, R> const &x, std::true_type) { // P +- C
+     if (arrays::matmul_impl::may_alias(d, T::P::a(T::prod(x.l))) || arrays::matmul_impl::may_alias(d, T::P::b(T::prod(x.l)))) return false;
+     d = x.r.data();
+     return gemm<T>(d, x.l, 1, (is_plus ? 1 : -1));
+    }
+    template <typename D> static bool _invoke(D &d, gf_expr<Tag, L, R> const &x, std::false_type) { // C +- P
+     if (arrays::matmul_impl::may_alias(d, T::P::a(T::prod(x.r))) || arrays::matmul_impl::may_alias(d, T::P::b(T::prod(x.r)))) return false;
+     d = x.l.data();
+     return gemm<T>(d, x.r, (is_plus ? 1 : -1), 1);
+    }
+   };
+  }
+ }
+
+ template <typename RHS> struct gf_data_assign<RHS, std14::enable_if_t<gfs_expr_tools::batched::pattern<RHS>::value>> {
+  using pattern = gfs_expr_tools::batched::pattern<RHS>;
+
+  template <typename G> static void invoke(G &g, RHS const &rhs) {
+   using V = std14::remove_const_t<typename G::data_t::value_type>;
+   _invoke(g, rhs, std::is_same<V, typename pattern::value_type>{});
+  }
+
+  private:
+  template <typename G> static void _invoke(G &g, RHS const &rhs, std::true_type) {
+   if (!pattern::invoke(g.data(), rhs)) assign_data_point_by_point(g, rhs);
+  }
+  template <typename G> static void _invoke(G &g, RHS const &rhs, std::false_type) { assign_data_point_by_point(g, rhs); }
+ };
+
+ // ------------------- In place operators ------------------------------
+ //
+ // g OP= x, for x a gf, an expression or a scalar, is computed in the data of g, point by point, with no temporary gf :
+ //  - g[w] OP= x[w], except for the matrix valued gf
+ //  - for g *= x with matrix valued g, g[w] * x[w] is computed by gemm in a scratch matrix allocated once per thread
+ //  - g /= x with matrix valued g and x is g = g / x.
+ // The singularity is changed by its in place operator, if it exists (e.g. tail), else s = s OP x.
+ // For any other x (e.g. a matrix), g OP= x is g = g OP x.
+
+ namespace gfs_expr_tools {
+
+  template <typename Tag> struct compound;
+  template <> struct compound<utility::tags::plus> {
+   template <typename A, typename B> auto operator()(A &&a, B const &b) const DECL_AND_RETURN(std::forward<A>(a) += b);
+  };
+  template <> struct compound<utility::tags::minus> {
+   template <typename A, typename B> auto operator()(A &&a, B const &b) const DECL_AND_RETURN(std::forward<A>(a) -= b);
+  };
+  template <> struct compound<utility::tags::multiplies> {
+   template <typename A, typename B> auto operator()(A &&a, B const &b) const DECL_AND_RETURN(std::forward<A>(a) *= b);
+  };
+  template <> struct compound<utility::tags::divides> {
+   template <typename A, typename B> auto operator()(A &&a, B const &b) const DECL_AND_RETURN(std::forward<A>(a) /= b);
+  };
+
+  // s OP= x if it is defined, else s = s OP x
+  template <typename Tag, typename S, typename X>
+  auto compound_or_assign(S &&s, X const &x, int) -> decltype(compound<Tag>()(std::forward<S>(s), x), void()) {
+   compound<Tag>()(std::forward<S>(s), x);
+  }
+  template <typename Tag, typename S, typename X> void compound_or_assign(S &&s, X const &x, long) {
+   std::forward<S>(s) = utility::operation<Tag>()(s, x);
+  }
+
+  template <typename G, typename X> struct is_matrix_product : std::integral_constant<bool, std::is_same<typename G::target_t, matrix_valued>::value &&
+                                                                                                !utility::is_in_ZRC<X>::value> {};
+
+  // g[w] = g[w] * x[w], with a scratch matrix per thread
+  template <typename G, typename X> void multiply_in_place(G &g, X const &x) {
+   using V = std14::remove_const_t<typename G::data_t::value_type>;
+   auto const &m = g.mesh();
+   auto sh = get_target_shape(g);
+   utility::parallel_for_chunks(m.size(), [&](long first, long last) {
+    arrays::matrix<V> tmp(sh[0], sh[1]);
+    auto it = m.begin() + first;
+    for (long i = first; i < last; ++i, ++it) {
+     tmp = g[*it] * x[*it];
+     g[*it] = tmp;
+    }
+   });
+  }
+
+  template <int N> using case_t = std::integral_constant<int, N>;
+
+  // general case : g[w] OP= x[w]
+  template <typename Tag, typename G, typename X> void compound_assign_impl(G &g, X const &x, case_t<0>) {
+   using mesh_point_t = typename G::mesh_point_t;
+   node_t<X const &> xn(x);
+   combine_mesh()(g, static_cast<node_t<X const &> const &>(xn)); // check the meshes
+   parallel_foreach(g.mesh(), [&g, &xn](mesh_point_t const &w) { compound_or_assign<Tag>(g[w], xn[w], 0); });
+   compound_or_assign<Tag>(g.singularity(), xn.singularity(), 0);
+  }
+
+  // g *= x, g and x matrix valued
+  template <typename Tag, typename G, typename X> void compound_assign_impl(G &g, X const &x, case_t<1>) {
+   combine_mesh()(g, x);
+   multiply_in_place(g, x);
+   compound_or_assign<Tag>(g.singularity(), x.singularity(), 0);
+  }
+
+  // g = g OP x
+  template <typename Tag, typename G, typename X> void compound_assign_impl(G &g, X const &x, case_t<2>) {
+   g = utility::operation<Tag>()(g, x);
+  }
+
+  template <typename Tag, typename G, typename X> void compound_assign(G &g, X const &x) {
+   constexpr bool is_mul = std::is_same<Tag, utility::tags::multiplies>::value, is_div = std::is_same<Tag, utility::tags::divides>::value;
+   constexpr bool gf_or_scalar = ImmutableGreenFunction<X>::value || is_in_ZRC<X>::value;
+   constexpr bool mat = is_matrix_product<G, X>::value;
+   compound_assign_impl<Tag>(g, x, case_t<(!gf_or_scalar || (mat && is_div)) ? 2 : ((mat && is_mul) ? 1 : 0)>{});
+  }
+ }
+
+#define DEFINE_OPERATOR(TAG, OP1)                                                                                                \
+ template <typename Variable, typename Target, typename Singularity, typename Evaluator, typename T>                             \
+ void operator OP1(gf_view<Variable, Target, Singularity, Evaluator> g, T const &x) {                                            \
+  gfs_expr_tools::compound_assign<utility::tags::TAG>(g, x);                                                                     \
  }                                                                                                                               \
- template <typename Variable, typename Target, typename Evaluator, typename T>                                                   \
- void operator OP1(gf<Variable, Target, Evaluator> &g, T const &x) {                                                             \
-  g = g OP2 x;                                                                                                                   \
+ template <typename Variable, typename Target, typename Singularity, typename Evaluator, typename T>                             \
+ void operator OP1(gf<Variable, Target, Singularity, Evaluator> &g, T const &x) {                                                \
+  gfs_expr_tools::compound_assign<utility::tags::TAG>(g, x);                                                                     \
  }
 
- DEFINE_OPERATOR(+=, +);
- DEFINE_OPERATOR(-=, -);
- DEFINE_OPERATOR(*=, *);
- DEFINE_OPERATOR(/=, / );
+ DEFINE_OPERATOR(plus, +=);
+ DEFINE_OPERATOR(minus, -=);
+ DEFINE_OPERATOR(multiplies, *=);
+ DEFINE_OPERATOR(divides, /=);
 
 #undef DEFINE_OPERATOR
 
@@ -85,17 +85,22 @@ namespace gfs {
     a2 = B - (d + A) / 2;
     a3 = d / 6 + A / 2 + B / 3;
    }
+   // the tail subtraction is done point by point, in parallel
+   using t_point_t = gf_mesh<imtime>::mesh_point_t;
+   using w_point_t = gf_mesh<imfreq>::mesh_point_t;
    if (gw.domain().statistic == Fermion) {
-    for (auto& t : gt.mesh())
+    parallel_foreach(gt.mesh(), [&](t_point_t const& t) {
      if(t.index() < L) {
        g_in[t.index()] = fact * exp(iomega * t) *
                          (gt[t] - (oneFermion(a1, b1, t, beta) + oneFermion(a2, b2, t, beta) + oneFermion(a3, b3, t, beta)));
      }
+    });
    } else {
-    for (auto& t : gt.mesh())
+    parallel_foreach(gt.mesh(), [&](t_point_t const& t) {
      if(t.index() < L) {
        g_in[t.index()] = fact * (gt[t] - (oneBoson(a1, b1, t, beta) + oneBoson(a2, b2, t, beta) + oneBoson(a3, b3, t, beta)));
      }
+    });
    }
    details::fourier_base(g_in, g_out, L, true);
 
@@ -114,9 +119,9 @@ namespace gfs {
      }
    }
 
-   for (auto& w : gw.mesh()) {
+   parallel_foreach(gw.mesh(), [&](w_point_t const& w) {
     gw[w] = g_out(w.index()) + a1 / (w - b1) + a2 / (w - b2) + a3 / (w - b3);
-   }
+   });
 
 
 
@@ -159,9 +164,11 @@ namespace gfs {
     a3 = d / 6 + A / 2 + B / 3;
    }
    g_in() = 0;
-   for (auto& w : gw.mesh()) {
+   using t_point_t = gf_mesh<imtime>::mesh_point_t;
+   using w_point_t = gf_mesh<imfreq>::mesh_point_t;
+   parallel_foreach(gw.mesh(), [&](w_point_t const& w) {
     g_in[w.index()] = fact * (gw[w] - (a1 / (w - b1) + a2 / (w - b2) + a3 / (w - b3)));
-   }
+   });
    // for bosons GF(w=0) is divided by 2 to avoid counting it twice
    if (gw.domain().statistic == Boson && !Green_Function_Are_Complex_in_time) g_in(0) *= 0.5;
 
@@ -171,19 +178,20 @@ namespace gfs {
    typedef double gt_result_type;
    // typedef typename gf<imtime>::mesh_type::gf_result_type gt_result_type;
    if (gw.domain().statistic == Fermion) {
-    for (auto& t : gt.mesh()) {
+    parallel_foreach(gt.mesh(), [&](t_point_t const& t) {
      if (t.index() < L) {
        gt[t] =
          convert_green<gt_result_type>(g_out(t.index()) * exp(-iomega * t) + oneFermion(a1, b1, t, beta) +
                                        oneFermion(a2, b2, t, beta) + oneFermion(a3, b3, t, beta));
      }
-    }
+    });
    } else {
-    for (auto& t : gt.mesh())
+    parallel_foreach(gt.mesh(), [&](t_point_t const& t) {
      if (t.index() < L) {
        gt[t] = convert_green<gt_result_type>(g_out(t.index()) + oneBoson(a1, b1, t, beta) +
                                            oneBoson(a2, b2, t, beta) + oneBoson(a3, b3, t, beta));
      }
+    });
    }
    double pm = (gw.domain().statistic == Fermion ? -1.0 : 1.0);
    gt.on_mesh(L) = pm * (gt.on_mesh(0) + convert_green<gt_result_type>(ta(1)(0, 0)));
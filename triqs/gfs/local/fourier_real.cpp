@@ -73,14 +73,18 @@ namespace triqs { namespace gfs {
    dcomplex t1 = ta(1)(0,0), t2= ta.get_or_zero(2)(0,0);
    dcomplex a1 = (t1 + I * t2/a )/2., a2 = (t1 - I * t2/a )/2.;
    
-   for (auto const & t : gt.mesh())
+   using t_point_t = gf_mesh<retime>::mesh_point_t;
+   using w_point_t = gf_mesh<refreq>::mesh_point_t;
+   parallel_foreach(gt.mesh(), [&](t_point_t const & t) {
     g_in[t.index()] = (gt[t] - (a1*th_expo(t,a) + a2*th_expo_neg(t,a))) * std::exp(I*t*wmin);
+   });
    
    details::fourier_base(g_in, g_out, L, true);
    
-   for (auto const & w : gw.mesh())
+   parallel_foreach(gw.mesh(), [&](w_point_t const & w) {
     gw[w] = gt.mesh().delta() * std::exp(I*(w-wmin)*tmin) * g_out(w.index())
     + a1*th_expo_inv(w,a) + a2*th_expo_neg_inv(w,a);
+   });
    
    gw.singularity() = gt.singularity();// set tail
    
@@ -105,15 +109,19 @@ namespace triqs { namespace gfs {
    dcomplex a1 = (t1 + I * t2/a )/2., a2 = (t1 - I * t2/a )/2.;
    g_in() = 0;
    
-   for (auto const & w: gw.mesh())
+   using t_point_t = gf_mesh<retime>::mesh_point_t;
+   using w_point_t = gf_mesh<refreq>::mesh_point_t;
+   parallel_foreach(gw.mesh(), [&](w_point_t const & w) {
     g_in(w.index()) = (gw[w] - a1*th_expo_inv(w,a) - a2*th_expo_neg_inv(w,a)  ) * std::exp(-I*w*tmin);
+   });
    
    details::fourier_base(g_in, g_out, L, false);
    
    const double corr = 1.0/(gt.mesh().delta()*L);
-   for (auto const & t : gt.mesh())
+   parallel_foreach(gt.mesh(), [&](t_point_t const & t) {
     gt[t] = corr * std::exp(I*wmin*(tmin-t)) *
     g_out[ t.index() ] + a1 * th_expo(t,a) + a2 * th_expo_neg(t,a) ;
+   });
  
    // set tail
    gt.singularity() = gw.singularity();
@@ -67,23 +67,33 @@ namespace triqs { namespace gfs {
   tail_view t = G.singularity();
   if (!t.is_decreasing_at_infinity())  TRIQS_RUNTIME_ERROR<<" density computation : Green Function is not as 1/omega or less !!!";
   const size_t N1=sh[0], N2 = sh[1];
-  arrays::array<dcomplex,2> dens_part(sh), dens_tail(sh), dens(sh);
+  arrays::array<dcomplex,2> dens_part(sh), dens_tail(sh), dens(sh), a1(sh), a2(sh), a3(sh);
   arrays::matrix<double> res(sh);
-  dens_part()=0;dens()=0;dens_tail()=0;
+  dens()=0;
+  double b1 = 0,b2 =1, b3 =-1;
   for (size_t n1=0; n1<N1;n1++) 
    for (size_t n2=0; n2<N2;n2++) {
     dcomplex d= t(1)(n1,n2) , A=t(2)(n1,n2),B = t(3)(n1,n2) ;
-    double b1 = 0,b2 =1, b3 =-1;
-    dcomplex a1 = d-B, a2 = (A+B)/2, a3 = (B-A)/2;
-    for (auto & w : G.mesh())  dens_part(n1,n2)+= G[w](n1,n2)  -  (a1/(w - b1) + a2 / (w-b2) + a3/(w-b3)); 
-    dens_part(n1,n2) = dens_part(n1,n2)/Beta;
-    dens_tail(n1,n2) = d + F(a1,b1,Beta) + F(a2,b2,Beta)+ F(a3,b3,Beta);
-    // If  the Green function are NOT complex, then one use the symmetry property
-    // fold the sum and get a factor 2
-    //double fact = (Green_Function_Are_Complex_in_time ? 1 : 2);
-    //dens_part(n1,n2) = dens_part(n1,n2)*(fact/Beta)  + (d + F(a1,b1,Beta) + F(a2,b2,Beta)+ F(a3,b3,Beta));
-    //if (!Green_Function_Are_Complex_in_time) dens_part  = 0+real(dens_part);
+    a1(n1,n2) = d-B; a2(n1,n2) = (A+B)/2; a3(n1,n2) = (B-A)/2;
+    dens_tail(n1,n2) = d + F(a1(n1,n2),b1,Beta) + F(a2(n1,n2),b2,Beta)+ F(a3(n1,n2),b3,Beta);
    }
+  // sum over the mesh, subtracting the tail. Deterministic parallel reduction over the frequencies.
+  arrays::array<dcomplex,2> zero(sh);
+  zero() = 0;
+  using mesh_point_t = gf_mesh<imfreq>::mesh_point_t;
+  dens_part = parallel_reduce(G.mesh(), zero, [&](mesh_point_t const &w, arrays::array<dcomplex, 2> &acc) {
+   dcomplex om = w;
+   auto gw = G[w];
+   for (size_t n1 = 0; n1 < N1; n1++)
+    for (size_t n2 = 0; n2 < N2; n2++)
+     acc(n1, n2) += gw(n1, n2) - (a1(n1, n2) / (om - b1) + a2(n1, n2) / (om - b2) + a3(n1, n2) / (om - b3));
+  });
+  dens_part /= Beta;
+  // If  the Green function are NOT complex, then one use the symmetry property
+  // fold the sum and get a factor 2
+  //double fact = (Green_Function_Are_Complex_in_time ? 1 : 2);
+  //dens_part(n1,n2) = dens_part(n1,n2)*(fact/Beta)  + (d + F(a1,b1,Beta) + F(a2,b2,Beta)+ F(a3,b3,Beta));
+  //if (!Green_Function_Are_Complex_in_time) dens_part  = 0+real(dens_part);
   
   for (size_t n1=0; n1<N1;n1++) 
    for (size_t n2=n1; n2<N2;n2++) {
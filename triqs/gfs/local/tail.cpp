@@ -222,5 +222,74 @@ namespace gfs {
   return res;
  }
 
+ // In place ops
+
+ // the orders above order_max are set to 0 (as in a new tail)
+ static void set_order_max(tail_view t, int omax) {
+  int n = std::max(0, omax - t.order_min() + 1), s = t.size();
+  if (n < s) t.data()(range(n, s), ellipsis()) = 0;
+  t.mask()() = omax;
+ }
+
+ static void add_in_place(tail_view l, tail_const_view const &r, bool minus) {
+  if (l.shape() != r.shape() || l.order_min() != r.order_min() || (l.size() != r.size()))
+   TRIQS_RUNTIME_ERROR << "tail addition: shape mismatch" << l << r;
+  if (l.data().is_empty()) return;
+  int omax = std::min(l.order_max(), r.order_max()), n = omax - l.order_min() + 1;
+  if (n > 0) {
+   auto lr = l.data()(range(0, n), ellipsis());
+   auto rr = r.data()(range(0, n), ellipsis());
+   if (minus)
+    lr -= rr;
+   else
+    lr += rr;
+  }
+  set_order_max(l, omax);
+ }
+
+ void operator+=(tail_view l, tail_const_view const &r) { add_in_place(l, r, false); }
+ void operator-=(tail_view l, tail_const_view const &r) { add_in_place(l, r, true); }
+
+ void operator*=(tail_view t, dcomplex a) {
+  if (!t.data().is_empty()) t.data() *= a;
+ }
+
+ void operator*=(tail_view a, matrix<dcomplex> const &b) {
+  if (a.data().is_empty()) return;
+  if ((first_dim(b) != a.shape()[1]) || (second_dim(b) != a.shape()[1]))
+   TRIQS_RUNTIME_ERROR << "tail *= matrix : the matrix must be square, of the size of the tail";
+  int omax = a.order_max();
+  matrix<dcomplex> tmp(a.shape()[0], a.shape()[1]);
+  for (int n = a.order_min(); n <= omax; ++n) {
+   tmp = a(n) * b;
+   a(n) = tmp;
+  }
+  set_order_max(a, omax);
+ }
+
+ void operator*=(tail_view l, tail_const_view const &r) {
+  if (l.shape()[1] != r.shape()[0] || r.shape()[0] != r.shape()[1] || l.order_min() != r.order_min() || l.size() != r.size())
+   TRIQS_RUNTIME_ERROR << "tail multiplication: shape mismatch";
+  if (l.data().is_empty()) return;
+  int omin = l.order_min(), l_min = l.smallest_nonzero(), l_max = l.order_max(), r_min = r.smallest_nonzero(), r_max = r.order_max();
+  int omax1 = std::min(std::min(r_max + l_min, l_max + r_min), omin + int(r.size()) - 1);
+  // the coefficients of l are overwritten : the products use a copy of them, kept by the thread from one call to the next.
+  // For t *= t, r is read from the copy too.
+  static thread_local array<dcomplex, 3> buffer;
+  buffer.resize(l.data().shape());
+  buffer() = l.data();
+  bool r_is_l = (r.data().data_start() == l.data().data_start());
+  auto lp = [&](int p) { return matrix_view<dcomplex>{buffer(p - omin, ellipsis())}; };
+  auto rp = [&](int p) { return (r_is_l ? matrix_view<dcomplex>{buffer(p - omin, ellipsis())} : matrix_view<dcomplex>{r(p)}); };
+  l.data()() = 0;
+  l.mask()() = omax1;
+  for (int n = omin; n <= omax1; ++n) {
+   auto res = l(n);
+   const int pmin = std::max(l_min, n - r_max);
+   const int pmax = std::min(l_max, n - r_min);
+   for (int p = pmin; p <= pmax; ++p) res += lp(p) * rp(n - p);
+  }
+ }
+
 }
 }
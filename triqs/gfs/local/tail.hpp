@@ -324,14 +324,25 @@ namespace gfs {
  inline tail operator/(dcomplex a, tail_view r) { return a * inverse(r); }
 
 
-// inplace operators
+ /// ------------------- In place operations ------------------------------
+ // Same result as t = t OP x, computed in the memory of t, without a new tail.
+
+ void operator+=(tail_view t, tail_const_view const &x);
+ void operator-=(tail_view t, tail_const_view const &x);
+
+ template <typename T> std14::enable_if_t<is_scalar_or_matrix<T>::value> operator+=(tail_view t, T const &a) { t(0) += a; }
+ template <typename T> std14::enable_if_t<is_scalar_or_matrix<T>::value> operator-=(tail_view t, T const &a) { t(0) -= a; }
+
+ // *= by a tail or a matrix : the matrix must be square
+ void operator*=(tail_view t, tail_const_view const &x);
+ void operator*=(tail_view t, matrix<dcomplex> const &b);
+ template <typename T> void operator*=(tail_view t, matrix_view<T> const &b) { t *= matrix<dcomplex>(b); }
+ void operator*=(tail_view t, dcomplex a);
+
 #define DEFINE_OPERATOR(OP1, OP2)                                                                                                \
  template <typename T> void operator OP1(tail_view g, T &&x) { g = g OP2 x; }                                                    \
  template <typename T> void operator OP1(tail &g, T &&x) { g = g OP2 x; }
 
- DEFINE_OPERATOR(+=, +);
- DEFINE_OPERATOR(-=, -);
- DEFINE_OPERATOR(*=, *);
  DEFINE_OPERATOR(/=, / );
 
 #undef DEFINE_OPERATOR
@@ -143,6 +143,7 @@ namespace gfs {
   mesh_point(mesh_t const &mesh, index_t const &index_) : m(&mesh), _index(index_) {}
   mesh_point(mesh_t const &mesh) : mesh_point(mesh, 0) {}
   void advance() { ++_index; }
+  void advance(long k) { _index += k; }
   using cast_t = typename Domain::point_t;
   operator cast_t() const { return m->index_to_point(_index); }
   long linear_index() const { return _index; }
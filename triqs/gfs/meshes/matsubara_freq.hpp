@@ -204,6 +204,7 @@ namespace gfs {
      , last_index_window(mesh.last_index_window()) {}
   mesh_point(gf_mesh<imfreq> const &mesh) : mesh_point(mesh, mesh.first_index_window()) {}
   void advance() { ++n; }
+  void advance(long k) { n += k; }
   long linear_index() const { return n - first_index_window; }
   long index() const { return n; }
   bool at_end() const { return (n == last_index_window + 1); } // at_end means " one after the last one", as in STL
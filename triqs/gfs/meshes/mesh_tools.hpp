@@ -22,6 +22,7 @@
 #define TRIQS_GF_MESHTOOLS_H
 #include "../tools.hpp"
 #include <triqs/utility/arithmetic_ops_by_cast.hpp>
+#include <triqs/utility/parallel.hpp>
 
 namespace triqs {
 namespace gfs {
@@ -44,12 +45,44 @@ namespace gfs {
     void increment() { ++u; pt.advance(); }
     bool at_end() const { return (u>=mesh->size());}
     typename MeshType::domain_t::point_t to_point() const { return pt;}
-    mesh_pt_generator& operator+=(int n) {
-     for (int i = 0; i < n; ++i) increment();
+    mesh_pt_generator& operator+=(long n) {
+     u += n;
+     pt.advance(n);
      return *this;
     }
-    friend mesh_pt_generator operator+(mesh_pt_generator lhs, int n) { return lhs += n; }
+    friend mesh_pt_generator operator+(mesh_pt_generator lhs, long n) { return lhs += n; }
    };
 
+ /** \brief parallel foreach for a mesh
+  *
+  *  @param m : a mesh
+  *  @param F : a function of synopsis  F (MeshType::mesh_point_t const &)
+  *
+  *  Calls F on each point of the mesh, in arbitrary order.
+  *  The mesh is cut in contiguous chunks which are distributed over the threads (Cf utility/parallel.hpp).
+  *  F must be thread safe, e.g. write g[w] for the point w only.
+  **/
+ template <typename MeshType, typename Lambda> void parallel_foreach(MeshType const &m, Lambda const &F) {
+  utility::parallel_for_chunks(m.size(), [&m, &F](long first, long last) {
+   auto it = m.begin() + first;
+   for (long i = first; i < last; ++i, ++it) F(*it);
+  });
+ }
+
+ /** \brief deterministic parallel reduction over a mesh
+  *
+  *  @param m : a mesh
+  *  @param zero : the neutral element of the sum
+  *  @param F : a function of synopsis  F (MeshType::mesh_point_t const &, T & acc), which adds the contribution of the point to acc
+  *
+  *  The result does not depend on the number of threads (Cf utility::parallel_reduce).
+  **/
+ template <typename MeshType, typename T, typename Lambda> T parallel_reduce(MeshType const &m, T const &zero, Lambda const &F) {
+  return utility::parallel_reduce(m.size(), zero, [&m, &F](long first, long last, T &acc) {
+   auto it = m.begin() + first;
+   for (long i = first; i < last; ++i, ++it) F(*it, acc);
+  });
+ }
+
 }}
 #endif
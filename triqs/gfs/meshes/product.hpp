@@ -173,6 +173,18 @@ namespace gfs {
     _atend = !(triqs::tuple::fold(l, _c, false));
    }
 
+   // same with k : the first component is advanced by k modulo its size, the carry goes to the next one, etc.
+   void advance(long k) {
+    auto l = [](auto &p, auto const &mc, long carry) {
+     if (carry == 0) return carry;
+     long s = mc.size(), q = p.linear_index() + carry;
+     p.reset();
+     p.advance(q % s);
+     return q / s;
+    };
+    if (triqs::tuple::fold(l, _c, m->m_tuple, k) > 0) _atend = true;
+   }
+
    // index_t index() const { return _index;} // not implemented yet
    bool at_end() const { return _atend; }
 
@@ -0,0 +1,141 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include "./product.hpp"
+#include <triqs/arrays/h5/array_out_of_core.hpp>
+
+namespace triqs {
+namespace gfs {
+
+ template <typename Variable, typename Target> class gf_out_of_core;
+
+ namespace gfs_implementation {
+  // the variable of a slice of a product gf at fixed first variable
+  template <typename... Ms> struct slice_variable {
+   using type = cartesian_product<Ms...>;
+  };
+  template <typename M> struct slice_variable<M> {
+   using type = M;
+  };
+ }
+
+ /**
+  * A gf on a product mesh, stored in a HDF5 file, of which only a few slices of the first variable are kept in memory.
+  *
+  * The group has the layout of h5_write of the gf, it can be written by h5_write and read by h5_read as a whole.
+  * The data are read and written by chunks of chunk_length values of the first variable (cf array_out_of_core),
+  * cache_size chunks being kept in memory.
+  *
+  * slice(i) returns the gf of the other variables at the i-th point (linear index) of the first mesh, with a default singularity.
+  */
+ template <typename M0, typename... Ms, typename Target> class gf_out_of_core<cartesian_product<M0, Ms...>, Target> {
+  public:
+  using gf_t = gf<cartesian_product<M0, Ms...>, Target>;
+  using slice_t = gf<typename gfs_implementation::slice_variable<Ms...>::type, Target>;
+  using mesh_t = typename gf_t::mesh_t;
+  using target_shape_t = typename gf_t::target_shape_t;
+  using value_t = typename gf_t::data_t::value_type;
+  static constexpr int n_variables = 1 + sizeof...(Ms);
+  static constexpr int rank = gf_t::data_t::rank;
+
+  private:
+  mesh_t _mesh;
+  target_shape_t _target_shape;
+  arrays::array_out_of_core<value_t, rank> _data;
+
+  static arrays::mini_vector<size_t, rank> _data_shape(mesh_t const &m, target_shape_t const &shape) {
+   arrays::mini_vector<size_t, rank> r;
+   auto s = m.size_of_components();
+   for (int u = 0; u < n_variables; ++u) r[u] = s[u];
+   for (int u = n_variables; u < rank; ++u) r[u] = shape[u - n_variables];
+   return r;
+  }
+
+  // write everything but the data
+  static h5::group _create_group(h5::group fg, std::string const &name, mesh_t const &m, target_shape_t const &shape) {
+   auto gr = fg.create_group(name);
+   gr.write_triqs_hdf5_data_scheme(gf_t{});
+   h5_write(gr, "mesh", m);
+   h5_write(gr, "indices", typename gf_t::indices_t(shape));
+   return gr;
+  }
+
+  static h5::group _open_group(h5::group fg, std::string const &name) {
+   auto gr = fg.open_group(name);
+   auto tag_file = gr.read_triqs_hdf5_data_scheme();
+   auto tag_expected = get_triqs_hdf5_data_scheme(gf_t{});
+   if (tag_file != tag_expected)
+    TRIQS_RUNTIME_ERROR << "gf_out_of_core : mismatch of the tag TRIQS_HDF5_data_scheme tag in the h5 group : found " << tag_file
+                        << " while I expected " << tag_expected;
+   return gr;
+  }
+
+  template <size_t... Is> typename slice_t::mesh_t _slice_mesh(std14::index_sequence<Is...>) const {
+   return typename slice_t::mesh_t(std::get<Is + 1>(_mesh.components())...);
+  }
+
+  public:
+  /**
+   * Create the gf in the subgroup name of fg, initialized to 0.
+   * @param chunk_length : number of points of the first mesh in a chunk
+   * @param cache_size : maximal number of chunks in memory
+   */
+  gf_out_of_core(h5::group fg, std::string const &name, mesh_t m, target_shape_t shape, long chunk_length, size_t cache_size)
+     : _mesh(std::move(m)),
+       _target_shape(shape),
+       _data(_create_group(fg, name, _mesh, shape), "data", _data_shape(_mesh, shape), chunk_length, cache_size) {}
+
+  /// Open the gf stored in the subgroup name of fg
+  gf_out_of_core(h5::group fg, std::string const &name, long chunk_length, size_t cache_size)
+     : _data(_open_group(fg, name), "data", chunk_length, cache_size) {
+   h5_read(fg.open_group(name), "mesh", _mesh);
+   auto s = _mesh.size_of_components();
+   for (int u = 0; u < n_variables; ++u)
+    if (s[u] != _data.shape()[u]) TRIQS_RUNTIME_ERROR << "gf_out_of_core : the mesh and the data in the group " << name << " do not match";
+   for (int u = n_variables; u < rank; ++u) _target_shape[u - n_variables] = _data.shape()[u];
+  }
+
+  mesh_t const &mesh() const { return _mesh; }
+  target_shape_t const &target_shape() const { return _target_shape; }
+
+  /// Number of chunks read from the file so far
+  long n_chunk_reads() const { return _data.n_chunk_reads(); }
+
+  /// The gf of the other variables, at the point of linear index i of the first mesh
+  slice_t slice(long i) {
+   auto r = slice_t{_slice_mesh(std14::make_index_sequence<sizeof...(Ms)>()), _target_shape};
+   r.data() = _data(i);
+   return r;
+  }
+
+  /// Set the slice i to g, a gf on the mesh of the other variables
+  template <typename G> void set_slice(long i, G const &g) {
+   auto sh = g.data().shape();
+   for (int u = 0; u < rank - 1; ++u)
+    if (sh[u] != _data.shape()[u + 1]) TRIQS_RUNTIME_ERROR << "gf_out_of_core : set_slice with a gf of the wrong shape";
+   _data.write(i, g.data());
+  }
+
+  /// Write all modified chunks to the file
+  void flush() { _data.flush(); }
+ };
+}
+}
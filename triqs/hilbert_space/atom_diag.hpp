@@ -0,0 +1,253 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include "./imperative_operator.hpp"
+#include "./space_partition.hpp"
+#include "./state.hpp"
+#include <triqs/arrays.hpp>
+#include <triqs/arrays/linalg/eigenelements.hpp>
+#include <triqs/utility/parallel.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace triqs {
+namespace hilbert_space {
+
+/**
+ * Exact diagonalization of a Hamiltonian, block by block.
+ *
+ * The full space of the fundamental operators is partitioned by H and by all the C, C^+ (cf space_partition),
+ * so that H is block diagonal and each C, C^+ maps a block to a single block.
+ * The blocks of H are filled from its sparse matrix (imperative_operator compiled on the full space), then
+ * diagonalized by lapack, the blocks being distributed over the threads. The eigensystems are kept.
+ *
+ * The C, C^+ are written in the eigenbasis once for all, as block sparse matrices. So can be any operator which maps
+ * a block to a single block (get_op_mat). The thermal averages Tr[exp(-beta H) O_1 ... O_n] / Z are then computed
+ * from the eigenstates within energy_cutoff of the ground state only.
+ */
+template <typename ScalarType = double> class atom_diag {
+ public:
+ using scalar_t = ScalarType;
+ using many_body_op_t = utility::many_body_operator<scalar_t>;
+ using matrix_t = arrays::matrix<scalar_t>;
+
+ /// The eigensystem of a block : the energies in ascending order, and the eigenvectors, which are the columns
+ /// of unitary_matrix in the basis of the Fock states of the block
+ struct eigensystem_t {
+  std::vector<double> energies;
+  matrix_t unitary_matrix;
+ };
+
+ /// An operator in the eigenbasis : the block b is mapped to the block connection[b] (-1 if the result is 0) by blocks[b]
+ struct block_matrix_t {
+  std::vector<int> connection;
+  std::vector<matrix_t> blocks;
+ };
+
+ atom_diag(many_body_op_t const& H, fundamental_operator_set const& fops) : fops(fops), full_hs(fops) {
+  using state_t = state<hilbert_space, scalar_t, false>;
+  using op_t = imperative_operator<hilbert_space, scalar_t, false>;
+  using sp_t = space_partition<state_t, op_t>;
+
+  // partition by H, then by the C, C^+
+  op_t Hop(H, fops);
+  Hop.compile(full_hs);
+  state_t st(full_hs);
+  sp_t SP(st, Hop);
+  std::vector<typename sp_t::matrix_element_map_t> c_elements(fops.size()), c_dag_elements(fops.size());
+  for (auto const& x : fops) {
+   op_t Cd(many_body_op_t::make_canonical(true, x.index), fops), C(many_body_op_t::make_canonical(false, x.index), fops);
+   Cd.compile(full_hs);
+   C.compile(full_hs);
+   std::tie(c_dag_elements[x.linear_index], c_elements[x.linear_index]) = SP.merge_subspaces(Cd, C, true);
+  }
+
+  // the blocks, with the Fock states in increasing order
+  subspaces.reserve(SP.n_subspaces());
+  for (int b = 0; b < int(SP.n_subspaces()); ++b) subspaces.emplace_back(b);
+  block_of.resize(full_hs.size());
+  index_in_block.resize(full_hs.size());
+  for (int n = 0; n < full_hs.size(); ++n) {
+   int b = SP.lookup_basis_state(n);
+   block_of[n] = b;
+   index_in_block[n] = subspaces[b].size();
+   subspaces[b].add_fock_state(full_hs.get_fock_state(n));
+  }
+
+  // the blocks of H, diagonalized in parallel
+  std::vector<matrix_t> h(n_blocks());
+  for (int b = 0; b < n_blocks(); ++b) {
+   h[b] = matrix_t(get_block_dim(b), get_block_dim(b));
+   h[b]() = 0;
+  }
+  for (auto const& e : SP.get_sorted_matrix_elements()) h[block_of[e.i]](index_in_block[e.f], index_in_block[e.i]) += e.value;
+  eigensystems.resize(n_blocks());
+  _foreach_block([&](int b) {
+   auto eig = arrays::linalg::eigenelements(h[b], arrays::linalg::eigen_algorithm::divide_and_conquer); // eigenvectors in rows
+   eigensystems[b].energies.assign(eig.first.begin(), eig.first.end());
+   eigensystems[b].unitary_matrix = eig.second.transpose();
+  });
+  gs_energy = std::numeric_limits<double>::infinity();
+  for (auto const& es : eigensystems) gs_energy = std::min(gs_energy, es.energies[0]);
+
+  // C, C^+ in the eigenbasis
+  for (int n = 0; n < fops.size(); ++n) {
+   c_matrices.push_back(_to_eigenbasis(c_elements[n]));
+   c_dag_matrices.push_back(_to_eigenbasis(c_dag_elements[n]));
+  }
+ }
+
+ /// The fundamental operators
+ fundamental_operator_set const& get_fops() const { return fops; }
+
+ /// The full Hilbert space
+ hilbert_space const& get_full_hilbert_space() const { return full_hs; }
+
+ /// Number of blocks of H
+ int n_blocks() const { return subspaces.size(); }
+
+ /// The blocks of H, as sub_hilbert_space (the index of the sub_hilbert_space is the number of the block)
+ std::vector<sub_hilbert_space> const& get_subspaces() const { return subspaces; }
+
+ /// Dimension of the block b
+ int get_block_dim(int b) const { return subspaces[b].size(); }
+
+ /// The block of the n-th state of the full Hilbert space
+ int get_block_of_state(int n) const { return block_of[n]; }
+
+ /// The eigensystem of the block b
+ eigensystem_t const& get_eigensystem(int b) const { return eigensystems[b]; }
+ std::vector<eigensystem_t> const& get_eigensystems() const { return eigensystems; }
+
+ /// The lowest energy
+ double get_gs_energy() const { return gs_energy; }
+
+ /// C, C^+ of the fundamental operator of number n (in fops), in the eigenbasis
+ block_matrix_t const& c_matrix(int n) const { return c_matrices[n]; }
+ block_matrix_t const& c_dag_matrix(int n) const { return c_dag_matrices[n]; }
+
+ /// The operator op in the eigenbasis. It must map a block to a single block (e.g. the operators which commute with H).
+ block_matrix_t get_op_mat(many_body_op_t const& op) const {
+  imperative_operator<hilbert_space, scalar_t, false> O(op, fops);
+  O.compile(full_hs);
+  std::vector<std::pair<std::pair<long, long>, scalar_t>> elements;
+  O.foreach_matrix_element(full_hs, [&elements](long i, long j, scalar_t v) { elements.push_back({{i, j}, v}); });
+  return _to_eigenbasis(elements);
+ }
+
+ /// Z = sum of exp(-beta (E - E_0)) over the eigenstates with E - E_0 <= energy_cutoff
+ double partition_function(double beta, double energy_cutoff = std::numeric_limits<double>::infinity()) const {
+  double z = 0;
+  for (int b = 0; b < n_blocks(); ++b)
+   for (int k = 0; k < _n_kept(b, energy_cutoff); ++k) z += std::exp(-beta * (eigensystems[b].energies[k] - gs_energy));
+  return z;
+ }
+
+ /**
+  * Tr[exp(-beta H) O_1 ... O_n] / Z, the operators being in the eigenbasis (O_n acts first), and the trace and Z being
+  * restricted to the eigenstates with E - E_0 <= energy_cutoff.
+  * The product is only computed on these eigenstates : from a block, O_n ... O_1 are applied to the columns of its kept eigenstates.
+  */
+ scalar_t thermal_trace(std::vector<block_matrix_t const*> const& ops, double beta,
+                        double energy_cutoff = std::numeric_limits<double>::infinity()) const {
+  scalar_t tr = 0;
+  for (int b = 0; b < n_blocks(); ++b) {
+   int n_kept = _n_kept(b, energy_cutoff);
+   if (n_kept == 0) continue;
+   int b2 = b;
+   matrix_t P;
+   for (int u = int(ops.size()) - 1; (u >= 0) && (b2 != -1); --u) {
+    auto const& M = ops[u]->blocks[b2];
+    int next = ops[u]->connection[b2];
+    if (next != -1) P = (u == int(ops.size()) - 1 ? matrix_t(M(arrays::range(), arrays::range(0, n_kept))) : matrix_t(M * P));
+    b2 = next;
+   }
+   if (b2 != b) continue;
+   auto const& E = eigensystems[b].energies;
+   for (int k = 0; k < n_kept; ++k) tr += std::exp(-beta * (E[k] - gs_energy)) * (ops.empty() ? scalar_t(1) : P(k, k));
+  }
+  return tr / partition_function(beta, energy_cutoff);
+ }
+
+ private:
+ fundamental_operator_set fops;
+ hilbert_space full_hs;
+ std::vector<sub_hilbert_space> subspaces;
+ std::vector<int> block_of, index_in_block; // for each state of the full space
+ std::vector<eigensystem_t> eigensystems;
+ double gs_energy;
+ std::vector<block_matrix_t> c_matrices, c_dag_matrices;
+
+ // number of eigenstates of the block b within energy_cutoff of the ground state
+ int _n_kept(int b, double energy_cutoff) const {
+  auto const& E = eigensystems[b].energies;
+  return std::upper_bound(E.begin(), E.end(), gs_energy + energy_cutoff) - E.begin();
+ }
+
+ // Calls f(b) for all the blocks, distributed over the threads, the largest blocks first
+ template <typename F> void _foreach_block(F const& f) const {
+  std::vector<int> order(n_blocks());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return get_block_dim(a) > get_block_dim(b); });
+  long n_threads = std::min(long(utility::parallel_n_threads()), long(order.size()));
+  utility::parallel_for(n_threads, [&](long t) {
+   for (long k = t; k < long(order.size()); k += n_threads) f(order[k]);
+  }, 1);
+ }
+
+ static matrix_t _dagger(matrix_t const& m) {
+  matrix_t r(second_dim(m), first_dim(m));
+  for (int i = 0; i < int(first_dim(m)); ++i)
+   for (int j = 0; j < int(second_dim(m)); ++j) r(j, i) = utility::_conj(m(i, j));
+  return r;
+ }
+
+ // The operator in the eigenbasis, from its elements ((i, j), <j|op|i>) on the full space
+ template <typename Elements> block_matrix_t _to_eigenbasis(Elements const& elements) const {
+  block_matrix_t r;
+  r.connection.assign(n_blocks(), -1);
+  r.blocks.resize(n_blocks());
+  std::vector<matrix_t> fock(n_blocks()); // in the Fock basis
+  for (auto const& e : elements) {
+   long i = e.first.first, j = e.first.second;
+   if (utility::is_zero(e.second)) continue;
+   int b = block_of[i], b2 = block_of[j];
+   if (r.connection[b] == -1) {
+    r.connection[b] = b2;
+    fock[b] = matrix_t(get_block_dim(b2), get_block_dim(b));
+    fock[b]() = 0;
+   } else if (r.connection[b] != b2)
+    TRIQS_RUNTIME_ERROR << "atom_diag : the operator maps the block " << b << " to several blocks";
+   fock[b](index_in_block[j], index_in_block[i]) += e.second;
+  }
+  _foreach_block([&](int b) {
+   if (r.connection[b] == -1) return;
+   matrix_t tmp = fock[b] * eigensystems[b].unitary_matrix;
+   r.blocks[b] = matrix_t(_dagger(eigensystems[r.connection[b]].unitary_matrix) * tmp);
+  });
+  return r;
+ }
+};
+}
+}
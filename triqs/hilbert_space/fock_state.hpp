@@ -0,0 +1,194 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include <triqs/utility/first_include.hpp>
+#include <array>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <type_traits>
+
+// The maximal number of fundamental operators (cmake option HILBERT_SPACE_MAX_ORBITALS)
+#ifndef TRIQS_HILBERT_SPACE_MAX_ORBITALS
+#define TRIQS_HILBERT_SPACE_MAX_ORBITALS 64
+#endif
+
+namespace triqs {
+namespace hilbert_space {
+
+/**
+ * The occupation numbers of NWords * 64 orbitals, as a fixed size bitset : bit i of word i/64 is the orbital i.
+ *
+ * It behaves as an unsigned integer for the bit operations (&, |, ^, ~, shifts, comparison),
+ * so that the code can be written in the same way for uint64_t and for the larger Fock states.
+ */
+template <int NWords> class fock_bitset {
+ std::array<uint64_t, NWords> w;
+
+ public:
+ fock_bitset() { w.fill(0); }
+ fock_bitset(uint64_t x) {
+  w.fill(0);
+  w[0] = x;
+ }
+
+ uint64_t word(int k) const { return w[k]; }
+ uint64_t &word(int k) { return w[k]; }
+
+ explicit operator bool() const {
+  for (auto x : w)
+   if (x) return true;
+  return false;
+ }
+
+ fock_bitset &operator&=(fock_bitset const &y) {
+  for (int k = 0; k < NWords; ++k) w[k] &= y.w[k];
+  return *this;
+ }
+ fock_bitset &operator|=(fock_bitset const &y) {
+  for (int k = 0; k < NWords; ++k) w[k] |= y.w[k];
+  return *this;
+ }
+ fock_bitset &operator^=(fock_bitset const &y) {
+  for (int k = 0; k < NWords; ++k) w[k] ^= y.w[k];
+  return *this;
+ }
+ fock_bitset operator~() const {
+  fock_bitset r;
+  for (int k = 0; k < NWords; ++k) r.w[k] = ~w[k];
+  return r;
+ }
+ friend fock_bitset operator&(fock_bitset x, fock_bitset const &y) { return x &= y; }
+ friend fock_bitset operator|(fock_bitset x, fock_bitset const &y) { return x |= y; }
+ friend fock_bitset operator^(fock_bitset x, fock_bitset const &y) { return x ^= y; }
+
+ fock_bitset operator<<(int n) const {
+  fock_bitset r;
+  int q = n / 64, s = n % 64;
+  for (int k = NWords - 1; k >= q; --k) {
+   r.w[k] = w[k - q] << s;
+   if (s && (k - q - 1 >= 0)) r.w[k] |= w[k - q - 1] >> (64 - s);
+  }
+  return r;
+ }
+ fock_bitset operator>>(int n) const {
+  fock_bitset r;
+  int q = n / 64, s = n % 64;
+  for (int k = 0; k + q < NWords; ++k) {
+   r.w[k] = w[k + q] >> s;
+   if (s && (k + q + 1 < NWords)) r.w[k] |= w[k + q + 1] << (64 - s);
+  }
+  return r;
+ }
+
+ friend bool operator==(fock_bitset const &x, fock_bitset const &y) { return x.w == y.w; }
+ friend bool operator!=(fock_bitset const &x, fock_bitset const &y) { return x.w != y.w; }
+ friend bool operator<(fock_bitset const &x, fock_bitset const &y) {
+  for (int k = NWords - 1; k >= 0; --k)
+   if (x.w[k] != y.w[k]) return x.w[k] < y.w[k];
+  return false;
+ }
+
+ // as an integer, in hexadecimal if it does not hold in 64 bits
+ friend std::ostream &operator<<(std::ostream &out, fock_bitset const &x) {
+  if (fock_bitset(x.w[0]) == x) return out << x.w[0];
+  out << "0x" << std::hex << std::setfill('0');
+  for (int k = NWords - 1; k >= 0; --k) out << std::setw(16) << x.w[k];
+  return out << std::dec << std::setfill(' ');
+ }
+};
+
+/// Number of words of the Fock states
+constexpr int fock_state_n_words = (TRIQS_HILBERT_SPACE_MAX_ORBITALS + 63) / 64;
+
+/// Number of orbitals a Fock state can hold
+constexpr int fock_state_n_bits = 64 * fock_state_n_words;
+
+/// The coding of the Fock state : a 64 bits word in binary, or a fock_bitset for more than 64 orbitals
+using fock_state_t = std::conditional<fock_state_n_words == 1, uint64_t, fock_bitset<fock_state_n_words>>::type;
+
+// ------------------ bit tools ---------------------------------------
+// With the hardware popcount (e.g. -mpopcnt, -march=native), the parity is one instruction per word.
+
+/// Number of occupied orbitals
+inline int popcount(uint64_t x) { return __builtin_popcountll(x); }
+template <int N> int popcount(fock_bitset<N> const &x) {
+ int r = 0;
+ for (int k = 0; k < N; ++k) r += __builtin_popcountll(x.word(k));
+ return r;
+}
+
+/// Parity of the number of occupied orbitals
+inline bool parity(uint64_t x) { return __builtin_parityll(x); }
+template <int N> bool parity(fock_bitset<N> const &x) {
+ uint64_t r = 0;
+ for (int k = 0; k < N; ++k) r ^= x.word(k);
+ return __builtin_parityll(r);
+}
+
+/// Is the orbital i occupied ?
+inline bool test_bit(uint64_t x, int i) { return (x >> i) & 1; }
+template <int N> bool test_bit(fock_bitset<N> const &x, int i) { return (x.word(i / 64) >> (i % 64)) & 1; }
+
+/// The first occupied orbital. Precondition : x != 0
+inline int lowest_bit(uint64_t x) { return __builtin_ctzll(x); }
+template <int N> int lowest_bit(fock_bitset<N> const &x) {
+ for (int k = 0;; ++k)
+  if (x.word(k)) return 64 * k + __builtin_ctzll(x.word(k));
+}
+
+/// x without its first occupied orbital
+inline uint64_t clear_lowest_bit(uint64_t x) { return x & (x - 1); }
+template <int N> fock_bitset<N> clear_lowest_bit(fock_bitset<N> x) {
+ for (int k = 0; k < N; ++k)
+  if (x.word(k)) {
+   x.word(k) &= x.word(k) - 1;
+   break;
+  }
+ return x;
+}
+
+/// Number of occupied orbitals of x below the orbital i
+inline int popcount_below(uint64_t x, int i) { return __builtin_popcountll(x & ((uint64_t(1) << i) - 1)); }
+template <int N> int popcount_below(fock_bitset<N> const &x, int i) {
+ int r = 0, q = i / 64;
+ for (int k = 0; k < q; ++k) r += __builtin_popcountll(x.word(k));
+ return r + popcount_below(x.word(q), i % 64);
+}
+
+/// The state as an integer. Precondition : only the first 64 orbitals are occupied
+inline uint64_t to_uint64(uint64_t x) { return x; }
+template <int N> uint64_t to_uint64(fock_bitset<N> const &x) { return x.word(0); }
+
+/// A hash of the state, for a given seed (splitmix64 finalizer, word by word)
+inline uint64_t fock_state_hash(uint64_t x, uint64_t seed) {
+ uint64_t z = x + 0x9E3779B97F4A7C15ull * (seed + 1);
+ z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+ z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+ return z ^ (z >> 31);
+}
+template <int N> uint64_t fock_state_hash(fock_bitset<N> const &x, uint64_t seed) {
+ uint64_t z = seed;
+ for (int k = 0; k < N; ++k) z = fock_state_hash(x.word(k) ^ z, seed);
+ return z;
+}
+}
+}
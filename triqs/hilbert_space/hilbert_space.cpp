@@ -0,0 +1,209 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "./hilbert_space.hpp"
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+namespace triqs {
+namespace hilbert_space {
+
+ constexpr int n_bits = fock_state_n_bits;
+
+ uint64_t new_space_id() {
+  static std::atomic<uint64_t> last_id{0};
+  return ++last_id;
+ }
+
+ const std::array<std::array<long, n_bits + 1>, n_bits + 1> fock_index::binomial_table = [] {
+  std::array<std::array<long, n_bits + 1>, n_bits + 1> c;
+  const long c_max = std::numeric_limits<long>::max() / 2;
+  for (int n = 0; n <= n_bits; ++n)
+   for (int k = 0; k <= n_bits; ++k) c[n][k] = (k == 0 ? 1 : (n == 0 ? 0 : std::min(c_max, c[n - 1][k - 1] + c[n - 1][k])));
+  return c;
+ }();
+
+ namespace {
+
+  // union-find on the orbitals
+  int find_root(std::vector<int> &parent, int i) {
+   while (parent[i] != i) i = parent[i] = parent[parent[i]];
+   return i;
+  }
+ }
+
+ fock_index::fock_index(std::vector<fock_state_t> const &basis) {
+
+  // the states, sorted, with their (first) position in the basis
+  std::vector<std::pair<fock_state_t, int>> sorted;
+  for (int i = 0; i < basis.size(); ++i) sorted.emplace_back(basis[i], i);
+  std::sort(sorted.begin(), sorted.end());
+  sorted.erase(std::unique(sorted.begin(), sorted.end(),
+                           [](std::pair<fock_state_t, int> const &x, std::pair<fock_state_t, int> const &y) { return x.first == y.first; }),
+               sorted.end());
+  auto contains = [&sorted](fock_state_t f) {
+   return std::binary_search(sorted.begin(), sorted.end(), std::make_pair(f, 0),
+                             [](std::pair<fock_state_t, int> const &x, std::pair<fock_state_t, int> const &y) { return x.first < y.first; });
+  };
+  long n = sorted.size();
+
+  // ---------- combinadic ?
+  // Two varying orbitals i, j are in the same group if moving a particle from i to j in a state of the basis gives another state of the basis.
+  // From a single state f0, all the orbitals of a group are connected, so the groups are found with a union-find, in O(n_bits^2).
+  // Then the basis is the product of the occupations of the groups iff all states have the occupations of f0 in each group
+  // and the dimension is the product of the binomial coefficients.
+  auto is_combinadic = [&]() {
+   if (n == 0) return false;
+   fock_state_t all_and = ~fock_state_t(0), all_or = 0;
+   for (auto const &x : sorted) {
+    all_and &= x.first;
+    all_or |= x.first;
+   }
+   fock_state_t varying = all_and ^ all_or, f0 = sorted[0].first;
+   fixed_mask = ~varying;
+   fixed_bits = all_and;
+   std::vector<int> parent(n_bits);
+   for (int i = 0; i < n_bits; ++i) parent[i] = i;
+   for (int i = 0; i < n_bits; ++i)
+    if (test_bit(varying, i) && test_bit(f0, i))
+     for (int j = 0; j < n_bits; ++j)
+      if (test_bit(varying, j) && !test_bit(f0, j) && contains(f0 ^ (fock_state_t(1) << i) ^ (fock_state_t(1) << j)))
+       parent[find_root(parent, i)] = find_root(parent, j);
+   groups.clear();
+   std::vector<int> group_of_root(n_bits, -1);
+   for (int i = 0; i < n_bits; ++i) {
+    if (!test_bit(varying, i)) continue;
+    int r = find_root(parent, i);
+    if (group_of_root[r] == -1) {
+     group_of_root[r] = groups.size();
+     groups.push_back({0, 0, 0});
+    }
+    groups[group_of_root[r]].mask |= fock_state_t(1) << i;
+   }
+   long dim = 1;
+   for (auto &g : groups) {
+    g.n = popcount(f0 & g.mask);
+    g.stride = dim;
+    long c = binomial(popcount(g.mask), g.n);
+    if (c > n) return false;
+    dim *= c;
+    if (dim > n) return false;
+   }
+   if (dim != n) return false;
+   for (auto const &x : sorted)
+    for (auto const &g : groups)
+     if (popcount(x.first & g.mask) != g.n) return false;
+   strategy = strategy_t::combinadic; // combinadic_index can be used
+   rank_to_index.assign(n, -1);
+   for (auto const &x : sorted) {
+    long r = 0;
+    fock_state_t f = x.first;
+    for (auto const &g : groups) {
+     fock_state_t y = f & g.mask;
+     for (int j = 1; y; ++j, y = clear_lowest_bit(y)) r += binomial(popcount_below(g.mask, lowest_bit(y)), j) * g.stride;
+    }
+    if (rank_to_index[r] != -1) return false;
+    rank_to_index[r] = x.second;
+   }
+   return true;
+  };
+  if (is_combinadic()) return;
+  groups.clear();
+  rank_to_index.clear();
+
+  // ---------- perfect hash
+  // The buckets are placed from the largest to the smallest : for each, we look for the displacement d such that
+  // all its states fall in free slots. The buckets of one state are placed directly in a free slot.
+  strategy = strategy_t::perfect_hash;
+  if (n == 0) return;
+  long n_buckets = std::max(1l, n / 4);
+  displacement.assign(n_buckets, 0);
+  slot_state.assign(n, 0);
+  slot_index.assign(n, -1);
+  std::vector<std::vector<int>> buckets(n_buckets);
+  for (int u = 0; u < n; ++u) buckets[hash(sorted[u].first, 0) % n_buckets].push_back(u);
+  std::vector<int> order(n_buckets);
+  for (int b = 0; b < n_buckets; ++b) order[b] = b;
+  std::stable_sort(order.begin(), order.end(), [&buckets](int a, int b) { return buckets[a].size() > buckets[b].size(); });
+  std::vector<long> slots;
+  long next_free = 0;
+  for (int b : order) {
+   auto const &bucket = buckets[b];
+   if (bucket.size() == 0) break;
+   if (bucket.size() == 1) {
+    while (slot_index[next_free] != -1) ++next_free;
+    displacement[b] = -next_free - 1;
+    slot_state[next_free] = sorted[bucket[0]].first;
+    slot_index[next_free] = sorted[bucket[0]].second;
+    continue;
+   }
+   for (int d = 1;; ++d) {
+    slots.clear();
+    for (int u : bucket) {
+     long s = hash(sorted[u].first, d) % n;
+     if ((slot_index[s] != -1) || (std::find(slots.begin(), slots.end(), s) != slots.end())) break;
+     slots.push_back(s);
+    }
+    if (slots.size() < bucket.size()) continue;
+    displacement[b] = d;
+    for (int k = 0; k < bucket.size(); ++k) {
+     slot_state[slots[k]] = sorted[bucket[k]].first;
+     slot_index[slots[k]] = sorted[bucket[k]].second;
+    }
+    break;
+   }
+  }
+ }
+
+ // ---------------------------------------------------------------------------------------------------
+
+ // the index is built by one thread, the others wait
+ static std::mutex fock_index_mutex;
+
+ fock_index const &sub_hilbert_space::build_fock_index() const {
+  std::lock_guard<std::mutex> lock(fock_index_mutex);
+  auto p = fast_index.load(std::memory_order_acquire);
+  if (p) return *p;
+  fast_index_ptr = std::make_shared<const fock_index>(fock_states);
+  fast_index.store(fast_index_ptr.get(), std::memory_order_release);
+  return *fast_index_ptr;
+ }
+
+ sub_hilbert_space::sub_hilbert_space(sub_hilbert_space const &x)
+    : index(x.index), id(x.id), fock_states(x.fock_states), fock_to_index(x.fock_to_index) {
+  std::lock_guard<std::mutex> lock(fock_index_mutex);
+  fast_index_ptr = x.fast_index_ptr;
+  fast_index = fast_index_ptr.get();
+ }
+
+ sub_hilbert_space &sub_hilbert_space::operator=(sub_hilbert_space const &x) {
+  if (this == &x) return *this;
+  index = x.index;
+  id = x.id;
+  fock_states = x.fock_states;
+  fock_to_index = x.fock_to_index;
+  std::lock_guard<std::mutex> lock(fock_index_mutex);
+  fast_index_ptr = x.fast_index_ptr;
+  fast_index = fast_index_ptr.get();
+  return *this;
+ }
+}
+}
@@ -21,37 +21,49 @@
 #pragma once
 
 #include <set>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
 #include <triqs/utility/exceptions.hpp>
 #include "fundamental_operator_set.hpp"
+#include "fock_state.hpp"
 #include <boost/container/flat_map.hpp>
 
 namespace triqs {
 namespace hilbert_space {
 
-using fock_state_t = uint64_t; // The coding of the Fock state : 64 bits word in binary
+// a new number at each call (thread safe), to identify the bases of the spaces
+uint64_t new_space_id();
 
 /* ---------------------------------------------------------------------------------------------------
  * A *full* Hilbert space spanned from all Fock states generated by a given set of fundamental operators
  * --------------------------------------------------------------------------------------------------  */
 class hilbert_space {
  int dim; // the dimension
+ uint64_t id = new_space_id();
 
  public:
  hilbert_space() : dim(0) {}
 
  // construct for a given basis
- hilbert_space(fundamental_operator_set const &fops) : dim(1ull << fops.size()) {}
+ hilbert_space(fundamental_operator_set const &fops) : dim(1ull << fops.size()) {
+  if (fops.size() > 30) TRIQS_RUNTIME_ERROR << "hilbert_space : the full space of " << fops.size() << " operators is too large, use sub_hilbert_space";
+ }
 
  // size of the hilbert space
  int size() const { return dim; }
 
+ // identifies the basis : new at each construction, the same for the copies
+ uint64_t get_id() const { return id; }
+
  // Check if a given fock state belong to this space
  bool has_state(fock_state_t f) const { return f < dim; }
 
  // find the index of a given fock state
  int get_state_index(fock_state_t f) const {
-  if (f >= dim) TRIQS_RUNTIME_ERROR << "this index is too big";
-  return f;
+  if (!(f < dim)) TRIQS_RUNTIME_ERROR << "this index is too big";
+  return to_uint64(f);
  }
 
  // return the i^th basis element as a fock state
@@ -63,12 +75,77 @@ class hilbert_space {
  // return the basis element generated by creation operators with given indices
  fock_state_t get_fock_state(fundamental_operator_set const &fops, std::set<fundamental_operator_set::indices_t> const& indices) const {
   fock_state_t f = 0;
-  for(auto const& index : indices) f += 1 << fops[index];
+  for(auto const& index : indices) f |= fock_state_t(1) << fops[index];
   return f;
  }
 };
 
 
+/* ---------------------------------------------------------------------------------------------------
+ * Index of a set of Fock states : Fock state -> position in the basis, in O(1)
+ *
+ * The strategy is chosen at construction from the structure of the basis :
+ *  - combinadic : the basis is made of all the states with given occupation numbers n_k in some groups of orbitals G_k,
+ *    the other orbitals being fixed (e.g. a block of given number of particles, or of given numbers of up and down particles).
+ *    The rank of a state among them is computed directly in the combinatorial number system.
+ *  - perfect_hash : otherwise, a minimal perfect hash function (hash and displace).
+ * In both cases, a table then gives the position of the state in the basis, which can be in any order.
+ * --------------------------------------------------------------------------------------------------  */
+class fock_index {
+ public:
+ enum class strategy_t { combinadic, perfect_hash };
+
+ fock_index(std::vector<fock_state_t> const &basis);
+
+ // the position of f in the basis, -1 if f is not in the basis
+ int operator()(fock_state_t f) const { return (strategy == strategy_t::combinadic ? combinadic_index(f) : hash_index(f)); }
+
+ strategy_t get_strategy() const { return strategy; }
+
+ private:
+ strategy_t strategy;
+
+ // combinadic : rank = sum_k rank_k * stride_k, rank_k = sum_j C(p_j, j+1) where p_0 < p_1 < ... are the positions of the occupied
+ // orbitals of f in the group G_k.
+ struct group_t {
+  fock_state_t mask;
+  int n;
+  long stride;
+ };
+ fock_state_t fixed_mask, fixed_bits; // the orbitals which do not vary in the basis, and their occupation
+ std::vector<group_t> groups;
+ std::vector<int> rank_to_index;
+
+ int combinadic_index(fock_state_t f) const {
+  if ((f & fixed_mask) != fixed_bits) return -1;
+  long r = 0;
+  for (auto const &g : groups) {
+   fock_state_t x = f & g.mask;
+   if (popcount(x) != g.n) return -1;
+   for (int j = 1; x; ++j, x = clear_lowest_bit(x)) r += binomial(popcount_below(g.mask, lowest_bit(x)), j) * g.stride;
+  }
+  return rank_to_index[r];
+ }
+
+ // perfect hash : the state f is in bucket b = h(f,0) % n_buckets. Its slot is h(f, d) % n_slots
+ // (or -d-1 if d = displacement[b] < 0, for buckets of one state)
+ std::vector<int> displacement;
+ std::vector<fock_state_t> slot_state;
+ std::vector<int> slot_index;
+
+ static uint64_t hash(fock_state_t const &f, uint64_t seed) { return fock_state_hash(f, seed); }
+
+ int hash_index(fock_state_t f) const {
+  if (slot_state.empty()) return -1;
+  int d = displacement[hash(f, 0) % displacement.size()];
+  long s = (d < 0 ? -d - 1 : hash(f, d) % slot_state.size());
+  return (slot_state[s] == f ? slot_index[s] : -1);
+ }
+
+ static const std::array<std::array<long, fock_state_n_bits + 1>, fock_state_n_bits + 1> binomial_table; // C(n,k), 0 if k > n (saturated)
+ static long binomial(int n, int k) { return binomial_table[n][k]; }
+};
+
 /* ---------------------------------------------------------------------------------------------------
  * a subhilbert space, as a set of basis Fock states.
  * --------------------------------------------------------------------------------------------------  */
@@ -78,21 +155,39 @@ class sub_hilbert_space {
  public:
  sub_hilbert_space(int index) : index(index) {}
 
+ sub_hilbert_space(sub_hilbert_space const &x);
+ sub_hilbert_space &operator=(sub_hilbert_space const &x);
+
  // add a fock state to the hilbert space basis
  void add_fock_state(fock_state_t f) {
   int ind = fock_states.size();
   fock_states.push_back(f);
   fock_to_index.insert(std::make_pair(f, ind));
+  fast_index_ptr.reset();
+  fast_index = nullptr;
+  id = new_space_id();
  }
 
  // dimension
  int size() const { return fock_states.size(); }
 
- // find the index of a given state
- int get_state_index(fock_state_t f) const { return fock_to_index.find(f)->second; }
+ // identifies the basis and the index : new at each construction or change, the same for the copies
+ uint64_t get_id() const { return id; }
+
+ // find the index of a given state (-1 if it is not in the space)
+ int get_state_index(fock_state_t f) const { return get_fock_index()(f); }
 
  // Check if a given fock state belong to this space
- bool has_state(fock_state_t f) const { return fock_to_index.count(f) == 1; }
+ bool has_state(fock_state_t f) const {
+  auto p = fast_index.load(std::memory_order_acquire);
+  return (p ? (*p)(f) != -1 : fock_to_index.count(f) == 1);
+ }
+
+ // the index of the Fock states, built on the first call after the last change of the basis (thread safe)
+ fock_index const &get_fock_index() const {
+  auto p = fast_index.load(std::memory_order_acquire);
+  return (p ? *p : build_fock_index());
+ }
 
  // the state for a given index
  fock_state_t get_fock_state(int i) const { return fock_states[i]; }
@@ -105,18 +200,27 @@ class sub_hilbert_space {
   return index;
  };
 
- void set_index(int i) { index = i; }
+ void set_index(int i) {
+  index = i;
+  id = new_space_id();
+ }
 
  private:
  int index;
+ uint64_t id = new_space_id();
 
  // the list of all fock states
  std::vector<fock_state_t> fock_states;
 
- // reverse map to quickly find the index of a state
+ // reverse map, used while the basis is being built (has_state)
  // the boost flat_map is implemented as an ordered vector,
- // hence is it slow to insert (we don't care) but fast to look up (we do it a lot)
+ // hence is it slow to insert (we don't care) but fast to look up
  // std::map<fock_state_t, int> fock_to_index;
  boost::container::flat_map<fock_state_t, int> fock_to_index;
+
+ // the O(1) index, used for all the lookups once built. It is immutable, hence shared by the copies.
+ mutable std::shared_ptr<const fock_index> fast_index_ptr;
+ mutable std::atomic<const fock_index *> fast_index{nullptr};
+ fock_index const &build_fock_index() const;
 };
 }}
@@ -22,6 +22,8 @@
 #include "./fundamental_operator_set.hpp"
 #include "../operators/many_body_operator.hpp"
 #include "./hilbert_space.hpp"
+#include "./state.hpp"
+#include <triqs/utility/parallel.hpp>
 
 #include <vector>
 #include <utility>
@@ -69,7 +71,7 @@ template <typename HilbertType, typename ScalarType = double, bool UseMap = fals
 
  struct one_term_t {
   scalar_t coeff;
-  uint64_t d_mask, dag_mask, d_count_mask, dag_count_mask;
+  fock_state_t d_mask, dag_mask, d_count_mask, dag_count_mask;
  };
  std::vector<one_term_t> all_terms;
 
@@ -87,28 +89,31 @@ template <typename HilbertType, typename ScalarType = double, bool UseMap = fals
   sub_spaces = sub_spaces_set;
   hilbert_map = hmap;
   if ((hilbert_map.size() == 0) != !UseMap) TRIQS_RUNTIME_ERROR << "Internal error";
+  if (fops.size() > fock_state_n_bits)
+   TRIQS_RUNTIME_ERROR << "imperative_operator : " << fops.size() << " fundamental operators, but the Fock states hold at most " << fock_state_n_bits
+                       << " orbitals. Recompile with a larger HILBERT_SPACE_MAX_ORBITALS";
 
   // The goal here is to have a transcription of the many_body_operator in terms
   // of simple vectors (maybe the code below could be more elegant)
   for (auto const &term : op) {
    std::vector<int> dag, ndag;
-   uint64_t d_mask = 0, dag_mask = 0;
+   fock_state_t d_mask = 0, dag_mask = 0;
    for (auto const &canonical_op : term.monomial) {
     (canonical_op.dagger ? dag : ndag).push_back(fops[canonical_op.indices]);
-    (canonical_op.dagger ? dag_mask : d_mask) |= (uint64_t(1) << fops[canonical_op.indices]);
+    (canonical_op.dagger ? dag_mask : d_mask) |= (fock_state_t(1) << fops[canonical_op.indices]);
    }
    auto compute_count_mask = [](std::vector<int> const &d) {
-    uint64_t mask = 0;
+    fock_state_t mask = 0;
     bool is_on = (d.size() % 2 == 1);
-    for (int i = 0; i < 64; ++i) {
+    for (int i = 0; i < fock_state_n_bits; ++i) {
      if (std::find(begin(d), end(d), i) != end(d))
       is_on = !is_on;
      else if (is_on)
-      mask |= (uint64_t(1) << i);
+      mask |= (fock_state_t(1) << i);
     }
     return mask;
    };
-   uint64_t d_count_mask = compute_count_mask(ndag), dag_count_mask = compute_count_mask(dag);
+   fock_state_t d_count_mask = compute_count_mask(ndag), dag_count_mask = compute_count_mask(dag);
    all_terms.push_back(one_term_t{term.coef, d_mask, dag_mask, d_count_mask, dag_count_mask});
   }
  }
@@ -129,16 +134,8 @@ template <typename HilbertType, typename ScalarType = double, bool UseMap = fals
   return StateType(st.get_hilbert());
  }
 
- static bool parity_number_of_bits(uint64_t v) {
-  // http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetNaive
-  // v ^= v >> 16;
-  // only ok until 16 orbitals ! assert this or put the >> 16
-  v ^= v >> 8;
-  v ^= v >> 4;
-  v ^= v >> 2;
-  v ^= v >> 1;
-  return v & 0x01;
- }
+ // parity of the number of occupied orbitals, for any number of orbitals (popcount, cf fock_state.hpp)
+ static bool parity_number_of_bits(fock_state_t const &v) { return parity(v); }
 
   // Forward the call to the coefficient
 #ifdef GCC_BUG_41933_WORKAROUND
@@ -195,5 +192,280 @@ template <typename HilbertType, typename ScalarType = double, bool UseMap = fals
   }
   return target_st;
  }
+
+ /*
+   Same for a state based on a vector, e.g. in the Lanczos solver.
+   If the operator has been compiled on the space of st (cf compile below), it is a sparse matrix-vector product.
+   Otherwise, the basis states are distributed over the threads (cf triqs/utility/parallel.hpp) : each thread
+   computes the contribution of its part of the basis in its own vector, and they are added at the end.
+ */
+ template <typename HS, typename T, typename... Args>
+ state<HS, T, false> operator()(state<HS, T, false> const &st, Args&&... args) const {
+
+  auto target_hs = get_target_hilbert(st.get_hilbert(), std::integral_constant<bool, UseMap>());
+  if (target_hs == nullptr) return {};
+  state<HS, T, false> target_st(*target_hs);
+  auto const& hs = st.get_hilbert();
+
+  // the coefficients of the monomials
+  auto coeffs = get_coeffs<T>(std::forward<Args>(args)...);
+  T *res = target_st.amplitudes().data_start();
+
+  auto const *blk = get_compiled_block(hs);
+  if (blk != nullptr) {
+   T const *x = st.amplitudes().data_start();
+   utility::parallel_for_chunks(blk->n_rows(), [&](long first, long last) {
+    for (long r = first; r < last; ++r) res[r] = blk->row_times(r, coeffs.data(), x, 1);
+   }, 1024);
+   return target_st;
+  }
+
+  // add the contribution of the basis states [first, last) of hs to out
+  auto apply_on = [&](long first, long last, T *out) {
+   for (long i = first; i < last; ++i) {
+    auto amplitude = st(i);
+    if (amplitude == T(0)) continue;
+    fock_state_t f = hs.get_fock_state(i), f3;
+    bool sign_is_minus;
+    for (int t = 0; t < int(all_terms.size()); ++t) {
+     if (!act(all_terms[t], f, f3, sign_is_minus)) continue;
+     out[target_hs->get_state_index(f3)] += amplitude * coeffs[t] * (sign_is_minus ? -1.0 : 1.0);
+    }
+   }
+  };
+
+  long n = st.size();
+  std::vector<arrays::vector<T>> partial(utility::parallel_n_threads());
+  utility::parallel_for_chunks(n, [&](long first, long last) {
+   if ((first == 0) && (last == n)) return apply_on(first, last, res); // serial
+   auto &acc = partial[utility::parallel_thread_id()];
+   acc.resize(target_hs->size());
+   acc() = 0;
+   apply_on(first, last, acc.data_start());
+  }, 1024);
+  for (auto const &acc : partial)
+   if (!acc.is_empty()) target_st.amplitudes() += acc;
+  return target_st;
+ }
+
+ /*
+   Same for a sparse state : the contributions of all the amplitudes are collected, then added at once to the target state.
+   If the operator has been compiled on the space of st and the state is not too sparse (more than 1/8 of the basis states),
+   the sparse matrix is applied to a dense copy of the state.
+ */
+ template <typename HS, typename T, typename... Args>
+ state<HS, T, true> operator()(state<HS, T, true> const &st, Args&&... args) const {
+
+  auto target_hs = get_target_hilbert(st.get_hilbert(), std::integral_constant<bool, UseMap>());
+  if (target_hs == nullptr) return {};
+  state<HS, T, true> target_st(*target_hs);
+  auto const& hs = st.get_hilbert();
+  auto coeffs = get_coeffs<T>(std::forward<Args>(args)...);
+  std::vector<std::pair<std::size_t, T>> contributions;
+
+  auto const *blk = get_compiled_block(hs);
+  if ((blk != nullptr) && (8 * st.n_amplitudes() >= hs.size())) {
+   std::vector<T> x(hs.size(), T(0)), res(blk->n_rows());
+   foreach(st, [&x](int i, T amplitude) { x[i] = amplitude; });
+   utility::parallel_for_chunks(blk->n_rows(), [&](long first, long last) {
+    for (long r = first; r < last; ++r) res[r] = blk->row_times(r, coeffs.data(), x.data(), 1);
+   }, 1024);
+   for (long r = 0; r < long(res.size()); ++r)
+    if (res[r] != T(0)) contributions.emplace_back(r, res[r]);
+  } else {
+   foreach(st, [&](int i, T amplitude) {
+    fock_state_t f = hs.get_fock_state(i), f3;
+    bool sign_is_minus;
+    for (int t = 0; t < int(all_terms.size()); ++t) {
+     if (!act(all_terms[t], f, f3, sign_is_minus)) continue;
+     contributions.emplace_back(target_hs->get_state_index(f3), amplitude * coeffs[t] * (sign_is_minus ? -1.0 : 1.0));
+    }
+   });
+  }
+  target_st.add_amplitudes(contributions);
+  return target_st;
+ }
+
+ /*
+   Compiled form of the operator.
+
+   On a given source space (for UseMap, a block and its image by hilbert_map), the operator is a sparse matrix,
+   which is stored in CSR format, one row per basis state of the target space. For each non zero element, we keep
+   the index of the source basis state, the monomial, and the sign coming from the reordering of the fermionic operators.
+   The coefficients themselves are not stored : they can still be changed (update_coeffs) or depend on the arguments of operator().
+
+   Once compiled on a space, the operator acts on the states of this space (state<HS, T, false>, or a state<HS, T, true> which is not too sparse)
+   by a sparse matrix-vector product (or matrix-matrix product, cf apply_to_columns), the rows being distributed over the threads :
+   there is no more test on the Fock states, nor any search of the index of the target states.
+   The compiled form is attached to the basis of the space (get_id()), not to its address : it is used for the copies of the space,
+   while a space modified, or a new space (even at the same address), requires a new compilation.
+ */
+ private:
+ struct compiled_block_t {
+  uint64_t source_id = 0;          // the get_id() of the source space (0 for none)
+  std::vector<long> row_ptr;       // the elements of row r are [row_ptr[r], row_ptr[r+1])
+  std::vector<int> col, term;      // index of the source basis state and of the monomial
+  std::vector<signed char> minus;  // is the sign -1 ?
+
+  long n_rows() const { return long(row_ptr.size()) - 1; }
+
+  // sum of the elements of row r times x[col * stride]
+  template <typename T> T row_times(long r, T const *coeffs, T const *x, long stride) const {
+   T acc = 0;
+   for (long p = row_ptr[r]; p < row_ptr[r + 1]; ++p) {
+    T v = coeffs[term[p]] * x[col[p] * stride];
+    acc += (minus[p] ? -v : v);
+   }
+   return acc;
+  }
+ };
+ std::vector<compiled_block_t> compiled; // indexed by the index of the source block (always 0 if UseMap is false)
+
+ template <typename HS> static int block_index(HS const &hs, std::true_type use_map) { return hs.get_index(); }
+ template <typename HS> static int block_index(HS const &hs, std::false_type use_map) { return 0; }
+
+ template <typename HS> compiled_block_t const *get_compiled_block(HS const &hs) const {
+  int b = block_index(hs, std::integral_constant<bool, UseMap>());
+  if ((b < 0) || (b >= long(compiled.size())) || (compiled[b].source_id != hs.get_id())) return nullptr;
+  return &compiled[b];
+ }
+
+ compiled_block_t compile_block(HilbertType const &hs) const {
+  compiled_block_t blk;
+  auto target_hs = get_target_hilbert(hs, std::integral_constant<bool, UseMap>());
+  blk.source_id = hs.get_id();
+  if (target_hs == nullptr) return blk;
+  // the non zero elements, for all source states
+  struct element_t {
+   int row, col, term;
+   bool minus;
+  };
+  std::vector<element_t> elements;
+  for (int i = 0; i < hs.size(); ++i) {
+   fock_state_t f = hs.get_fock_state(i), f3;
+   bool sign_is_minus;
+   for (int t = 0; t < int(all_terms.size()); ++t)
+    if (act(all_terms[t], f, f3, sign_is_minus)) elements.push_back({target_hs->get_state_index(f3), i, t, sign_is_minus});
+  }
+  // sorted by rows (counting sort)
+  long n_rows = target_hs->size();
+  blk.row_ptr.assign(n_rows + 1, 0);
+  for (auto const &e : elements) ++blk.row_ptr[e.row + 1];
+  for (long r = 0; r < n_rows; ++r) blk.row_ptr[r + 1] += blk.row_ptr[r];
+  blk.col.resize(elements.size());
+  blk.term.resize(elements.size());
+  blk.minus.resize(elements.size());
+  auto pos = blk.row_ptr;
+  for (auto const &e : elements) {
+   long p = pos[e.row]++;
+   blk.col[p] = e.col;
+   blk.term[p] = e.term;
+   blk.minus[p] = e.minus;
+  }
+  return blk;
+ }
+
+ public:
+ /// Compile the operator on the space hs
+ void compile(HilbertType const &hs) {
+  int b = block_index(hs, std::integral_constant<bool, UseMap>());
+  if (long(compiled.size()) <= b) compiled.resize(b + 1);
+  compiled[b] = compile_block(hs);
+ }
+
+ /// UseMap only : compile the operator on all the blocks, in parallel
+ void compile() {
+  if (!UseMap || (sub_spaces == nullptr)) TRIQS_RUNTIME_ERROR << "imperative_operator : compile() requires the sub spaces (UseMap)";
+  compiled.resize(sub_spaces->size());
+  utility::parallel_for(sub_spaces->size(), [&](long n) { compiled[n] = compile_block((*sub_spaces)[n]); }, 2);
+ }
+
+ /// Is the operator compiled on the space hs ?
+ bool is_compiled(HilbertType const &hs) const { return get_compiled_block(hs) != nullptr; }
+
+ /// Number of non zero elements of the operator on the space hs (0 if it is not compiled on hs)
+ long n_nonzeros(HilbertType const &hs) const {
+  auto const *blk = get_compiled_block(hs);
+  return (blk == nullptr ? 0 : blk->col.size());
+ }
+
+ /// Dimension of the target space of the operator compiled on hs (0 if it is not compiled on hs)
+ long n_rows(HilbertType const &hs) const {
+  auto const *blk = get_compiled_block(hs);
+  return (blk == nullptr ? 0 : blk->n_rows());
+ }
+
+ /**
+  * Calls f(i, j, value) for the elements value = <j|op|i> of the operator compiled on hs, for the rows j in [first, last)
+  * (all the rows if last = -1), i being in hs and j in its target space. The elements of several monomials on the same (i, j) are summed.
+  * The coefficients must be numbers.
+  */
+ template <typename F> void foreach_matrix_element(HilbertType const &hs, F const &f, long first = 0, long last = -1) const {
+  auto const *blk = get_compiled_block(hs);
+  if (blk == nullptr) TRIQS_RUNTIME_ERROR << "imperative_operator : foreach_matrix_element on a space where the operator is not compiled";
+  if (last == -1) last = blk->n_rows();
+  auto coeffs = get_coeffs<scalar_t>();
+  for (long r = first; r < last; ++r)
+   for (long p = blk->row_ptr[r]; p < blk->row_ptr[r + 1];) { // in a row, the columns are sorted
+    int i = blk->col[p];
+    scalar_t v = 0;
+    for (; (p < blk->row_ptr[r + 1]) && (blk->col[p] == i); ++p) v += (blk->minus[p] ? -coeffs[blk->term[p]] : coeffs[blk->term[p]]);
+    f(i, r, v);
+   }
+ }
+
+ /**
+  * Act on several states of the space hs at once.
+  * The columns of X are the amplitudes of the states : the result is the matrix of the amplitudes of their images
+  * in the target space (with 0 rows if the operator maps hs to nothing). The operator must have been compiled on hs.
+  */
+ template <typename MatrixType, typename... Args>
+ arrays::matrix<typename MatrixType::value_type> apply_to_columns(HilbertType const &hs, MatrixType const &X, Args &&... args) const {
+  using T = typename MatrixType::value_type;
+  auto const *blk = get_compiled_block(hs);
+  if (blk == nullptr) TRIQS_RUNTIME_ERROR << "imperative_operator : apply_to_columns on a space where the operator is not compiled";
+  if (long(first_dim(X)) != hs.size()) TRIQS_RUNTIME_ERROR << "imperative_operator : apply_to_columns : the matrix has " << first_dim(X) << " rows, the space dimension is " << hs.size();
+  auto coeffs = get_coeffs<T>(std::forward<Args>(args)...);
+  long n_cols = second_dim(X);
+  arrays::matrix<T> x = X, res(blk->n_rows(), n_cols, FORTRAN_LAYOUT);
+  auto const &s = x.indexmap().strides();
+  utility::parallel_for_chunks(blk->n_rows() * n_cols, [&](long first, long last) {
+   for (long u = first; u < last; ++u) {
+    long r = u % blk->n_rows(), k = u / blk->n_rows();
+    res(r, k) = blk->row_times(r, coeffs.data(), x.data_start() + k * s[1], s[0]);
+   }
+  }, 1024);
+  return res;
+ }
+
+ private:
+ // act with the monomial M on the Fock state f : false if the result is 0, otherwise f3 is the result, with sign -1 iif sign_is_minus
+ static bool act(one_term_t const &M, fock_state_t const &f, fock_state_t &f3, bool &sign_is_minus) {
+  if ((f & M.d_mask) != M.d_mask) return false;
+  fock_state_t f2 = f & ~M.d_mask;
+  if (((f2 ^ M.dag_mask) & M.dag_mask) != M.dag_mask) return false;
+  f3 = ~(~f2 & ~M.dag_mask);
+  sign_is_minus = parity_number_of_bits((f2 & M.d_count_mask) ^ (f3 & M.dag_count_mask));
+  return true;
+ }
+
+ // the coefficients of the monomials, for the arguments args
+ template <typename T, typename... Args> std::vector<T> get_coeffs(Args &&... args) const {
+  std::vector<T> coeffs;
+#ifdef GCC_BUG_41933_WORKAROUND
+  auto args_tuple = std::make_tuple(args...);
+  for (auto const &M : all_terms) coeffs.push_back(apply_if_possible(M.coeff, args_tuple));
+#else
+  for (auto const &M : all_terms) coeffs.push_back(apply_if_possible(M.coeff, args...));
+#endif
+  return coeffs;
+ }
+
+ template <typename HS> HS const *get_target_hilbert(HS const &hs, std::true_type use_map) const {
+  auto n = hilbert_map[hs.get_index()];
+  return (n == -1 ? nullptr : &(*sub_spaces)[n]);
+ }
+
+ template <typename HS> HS const *get_target_hilbert(HS const &hs, std::false_type use_map) const { return &hs; }
 };
 }}
@@ -0,0 +1,200 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include "./atom_diag.hpp"
+#include <cstdint>
+#include <memory>
+#include <random>
+
+namespace triqs {
+namespace hilbert_space {
+
+/**
+ * The trace of a product of operators along imaginary time
+ *
+ *   Tr[exp(-(beta - tau_n) H') O_n exp(-(tau_n - tau_(n-1)) H') ... O_1 exp(-tau_1 H')],  H' = H - E_0
+ *
+ * the operators being block sparse matrices in the eigenbasis of H (atom_diag), so that the time evolutions are diagonal.
+ *
+ * The operators are kept in a treap (a binary search tree on tau, balanced by random priorities). Each node caches,
+ * for each block, the product of the operators of its subtree with the time evolutions between them.
+ * Inserting or removing an operator only recomputes the nodes on its path, i.e. O(log n) nodes, each
+ * with one product of block matrices per block. The trace itself is then read on the root.
+ */
+template <typename ScalarType = double> class imtime_trace {
+ public:
+ using scalar_t = ScalarType;
+ using atom_diag_t = atom_diag<scalar_t>;
+ using block_matrix_t = typename atom_diag_t::block_matrix_t;
+ using matrix_t = typename atom_diag_t::matrix_t;
+
+ /// The operators are in the eigenbasis of ad, which must outlive the trace
+ imtime_trace(atom_diag_t const& ad, double beta) : ad(&ad), beta(beta) {}
+
+ /// Number of operators
+ int size() const { return n_ops; }
+
+ /// Insert the operator op (kept by reference) at time tau, in [0, beta]. There must be no operator at tau already.
+ void insert(double tau, block_matrix_t const& op) {
+  if ((tau < 0) || (tau > beta)) TRIQS_RUNTIME_ERROR << "imtime_trace : tau = " << tau << " is not in [0, beta]";
+  for (node const* t = root.get(); t; t = (tau < t->tau ? t->left.get() : t->right.get()))
+   if (t->tau == tau) TRIQS_RUNTIME_ERROR << "imtime_trace : there is already an operator at tau = " << tau;
+  std::unique_ptr<node> n(new node);
+  n->tau = tau;
+  n->op = &op;
+  n->priority = rng();
+  _insert(root, std::move(n));
+  ++n_ops;
+ }
+
+ /// Remove the operator at time tau
+ void remove(double tau) {
+  _remove(root, tau);
+  --n_ops;
+ }
+
+ /// Remove all the operators
+ void clear() {
+  root.reset();
+  n_ops = 0;
+ }
+
+ /// The trace (without the normalization by the partition function)
+ scalar_t trace() const {
+  scalar_t tr = 0;
+  double dtau = (root ? beta - root->tau_max + root->tau_min : beta);
+  for (int b = 0; b < ad->n_blocks(); ++b) {
+   if (root && (root->target[b] != b)) continue;
+   auto const& E = ad->get_eigensystem(b).energies;
+   for (int k = 0; k < int(E.size()); ++k)
+    tr += std::exp(-dtau * (E[k] - ad->get_gs_energy())) * (root ? root->prod[b](k, k) : scalar_t(1));
+  }
+  return tr;
+ }
+
+ private:
+ struct node {
+  double tau, tau_min, tau_max; // tau of the node, and the extremal tau's of the subtree
+  block_matrix_t const* op;
+  uint32_t priority;
+  std::unique_ptr<node> left, right; // earlier, later operators
+  std::vector<int> target;           // the product of the subtree maps the block b to target[b] (-1 if 0)
+  std::vector<matrix_t> prod;        // by prod[b]
+ };
+
+ atom_diag_t const* ad;
+ double beta;
+ int n_ops = 0;
+ std::unique_ptr<node> root;
+ std::mt19937 rng;
+
+ // M <- exp(-dtau H') M, M being in the block b
+ void _evolve(matrix_t& M, int b, double dtau) const {
+  auto const& E = ad->get_eigensystem(b).energies;
+  for (int k = 0; k < int(E.size()); ++k) M(k, arrays::range()) *= std::exp(-dtau * (E[k] - ad->get_gs_energy()));
+ }
+
+ // recompute the product of the subtree of n, from the ones of its children
+ void _update(node& n) const {
+  node const* L = n.left.get();
+  node const* R = n.right.get();
+  n.tau_min = (L ? L->tau_min : n.tau);
+  n.tau_max = (R ? R->tau_max : n.tau);
+  int n_blocks = ad->n_blocks();
+  n.target.assign(n_blocks, -1);
+  n.prod.resize(n_blocks);
+  for (int b = 0; b < n_blocks; ++b) {
+   int b1 = (L ? L->target[b] : b);
+   if (b1 == -1) continue;
+   int b2 = n.op->connection[b1];
+   if (b2 == -1) continue;
+   int b3 = (R ? R->target[b2] : b2);
+   if (b3 == -1) continue;
+   matrix_t M;
+   if (L) {
+    M = L->prod[b];
+    _evolve(M, b1, n.tau - L->tau_max);
+    M = matrix_t(n.op->blocks[b1] * M);
+   } else
+    M = n.op->blocks[b1];
+   if (R) {
+    _evolve(M, b2, R->tau_min - n.tau);
+    M = matrix_t(R->prod[b2] * M);
+   }
+   n.target[b] = b3;
+   n.prod[b] = std::move(M);
+  }
+ }
+
+ // split t into the operators before and after tau
+ void _split(std::unique_ptr<node> t, double tau, std::unique_ptr<node>& l, std::unique_ptr<node>& r) {
+  if (!t) {
+   l.reset();
+   r.reset();
+   return;
+  }
+  if (t->tau < tau) {
+   _split(std::move(t->right), tau, t->right, r);
+   _update(*t);
+   l = std::move(t);
+  } else {
+   _split(std::move(t->left), tau, l, t->left);
+   _update(*t);
+   r = std::move(t);
+  }
+ }
+
+ std::unique_ptr<node> _merge(std::unique_ptr<node> l, std::unique_ptr<node> r) {
+  if (!l) return r;
+  if (!r) return l;
+  if (l->priority > r->priority) {
+   l->right = _merge(std::move(l->right), std::move(r));
+   _update(*l);
+   return l;
+  }
+  r->left = _merge(std::move(l), std::move(r->left));
+  _update(*r);
+  return r;
+ }
+
+ void _insert(std::unique_ptr<node>& t, std::unique_ptr<node> n) {
+  if (!t || (n->priority > t->priority)) {
+   _split(std::move(t), n->tau, n->left, n->right);
+   t = std::move(n);
+  } else {
+   auto& child = (n->tau < t->tau ? t->left : t->right);
+   _insert(child, std::move(n));
+  }
+  _update(*t);
+ }
+
+ void _remove(std::unique_ptr<node>& t, double tau) {
+  if (!t) TRIQS_RUNTIME_ERROR << "imtime_trace : no operator at tau = " << tau;
+  if (t->tau == tau) {
+   t = _merge(std::move(t->left), std::move(t->right));
+   return;
+  }
+  _remove(tau < t->tau ? t->left : t->right, tau);
+  _update(*t);
+ }
+};
+}
+}
@@ -0,0 +1,236 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include "./state.hpp"
+#include <triqs/arrays/blas_lapack/stev.hpp>
+#include <triqs/utility/exceptions.hpp>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace triqs {
+namespace hilbert_space {
+
+/*
+ Matrix free Krylov methods for a hermitian operator H acting on the states of a Hilbert space
+ (typically an imperative_operator on a block of a space_partition, with state<sub_hilbert_space, T, false>).
+
+ H is any callable with H(psi) returning H|psi> in the same Hilbert space as psi.
+ Only H|psi>, the vector space operations and dot_product of the states are used :
+ the matrix of H is never built, the memory is krylov_dim states.
+*/
+
+struct lanczos_parameters {
+ int n_eigen = 1;                       // number of eigenpairs (the lowest ones)
+ int krylov_dim = 100;                  // maximal dimension of the Krylov space, before a restart
+ int max_restarts = 100;                // maximal number of restarts, for each eigenpair
+ double tolerance = 1.e-10;             // convergence : residue || H x - e x || < tolerance, for the normalized x
+ bool full_reorthogonalization = true;  // orthogonalize each new Krylov vector against the previous ones
+ int check_period = 5;                  // lanczos checks the convergence every check_period Krylov vectors
+};
+
+template <typename State> struct lanczos_result {
+ std::vector<double> eigenvalues; // in ascending order
+ std::vector<State> eigenvectors; // normalized
+ int n_applications = 0;          // number of H|psi> computed
+};
+
+namespace lanczos_impl {
+
+ template <typename State> double norm(State const &x) { return std::sqrt(std::abs(dot_product(x, x))); }
+
+ // x -= <u|x> u, for the normalized u
+ template <typename State> void orthogonalize(State &x, std::vector<State> const &us, int n) {
+  using v_t = typename State::value_type;
+  for (int i = 0; i < n; ++i) x -= us[i] * v_t(dot_product(us[i], x));
+ }
+
+ // A Krylov space : orthonormal basis, and the tridiagonal matrix of H in this basis (diagonal alpha, off diagonal beta)
+ // beta has one more element than needed : the coupling of the last basis vector to the rest of the space (0 if invariant).
+ template <typename State> struct krylov_space {
+  std::vector<State> basis;
+  std::vector<double> alpha, beta;
+  int size() const { return alpha.size(); }
+  double last_beta() const { return beta.back(); }
+ };
+
+ /*
+  Build the Krylov space of H from v (normalized), orthogonal to the states in locked.
+  After each step, calls stop(K), which returns true to stop the construction.
+ */
+ template <typename Op, typename State, typename Stop>
+ void build(Op const &H, State v, std::vector<State> const &locked, lanczos_parameters const &p, krylov_space<State> &K, int &n_app,
+            Stop const &stop) {
+  using v_t = typename State::value_type;
+  K.basis.clear();
+  K.alpha.clear();
+  K.beta.clear();
+  for (int j = 0; j < p.krylov_dim; ++j) {
+   K.basis.push_back(v);
+   State w = H(v);
+   ++n_app;
+   double a = std::real(dot_product(v, w));
+   w -= v * v_t(a);
+   if (j > 0) w -= K.basis[j - 1] * v_t(K.beta[j - 1]);
+   orthogonalize(w, locked, locked.size());
+   // twice is enough (Kahan)
+   if (p.full_reorthogonalization)
+    for (int r = 0; r < 2; ++r) orthogonalize(w, K.basis, K.basis.size());
+   double b = norm(w);
+   K.alpha.push_back(a);
+   // invariant subspace : the Krylov space contains the exact eigenvectors
+   bool invariant = (b <= 1.e-13 * (std::abs(a) + (j > 0 ? K.beta[j - 1] : 0) + 1.e-300));
+   K.beta.push_back(invariant ? 0 : b);
+   if (invariant || stop(K)) return;
+   w /= v_t(b);
+   v = std::move(w);
+  }
+ }
+
+ // sum_i c_i K.basis[i]
+ template <typename State, typename C> State combine(krylov_space<State> const &K, C const &c) {
+  using v_t = typename State::value_type;
+  State x = K.basis[0] * v_t(c(0));
+  for (int i = 1; i < K.size(); ++i) x += K.basis[i] * v_t(c(i));
+  return x;
+ }
+
+ // diagonalize the tridiagonal matrix of K
+ template <typename State> void diagonalize(krylov_space<State> const &K, arrays::blas::tridiag_worker<false> &tri) {
+  int m = K.size();
+  arrays::vector<double> d(m), e(m - 1);
+  for (int i = 0; i < m; ++i) d(i) = K.alpha[i];
+  for (int i = 0; i < m - 1; ++i) e(i) = K.beta[i];
+  tri(d, e);
+ }
+}
+
+/**
+ * The lowest eigenvalues and eigenvectors of the hermitian operator H, with the Lanczos algorithm.
+ *
+ * The eigenpairs are computed one after the other. For each of them, the Krylov space is built from the start state
+ * (orthogonalized against the eigenvectors already found, which are deflated), up to krylov_dim vectors.
+ * After the first eigenpair, a random state is added to psi0, in order to find all the vectors of degenerate eigenspaces.
+ * If the lowest Ritz pair has not converged, the construction restarts from the Ritz vector.
+ *
+ * @param H : the operator
+ * @param psi0 : the start state. It must not be orthogonal to the eigenvectors searched for.
+ * @param p : the parameters
+ */
+template <typename Op, typename State>
+lanczos_result<State> lanczos(Op const &H, State const &psi0, lanczos_parameters const &p = lanczos_parameters{}) {
+ using namespace lanczos_impl;
+ using v_t = typename State::value_type;
+ if (p.krylov_dim < 2) TRIQS_RUNTIME_ERROR << "lanczos : krylov_dim must be at least 2";
+ if (p.check_period < 1) TRIQS_RUNTIME_ERROR << "lanczos : check_period must be at least 1";
+ if (p.n_eigen > psi0.size()) TRIQS_RUNTIME_ERROR << "lanczos : " << p.n_eigen << " eigenpairs asked in a space of dimension " << psi0.size();
+ lanczos_result<State> res;
+ krylov_space<State> K;
+ arrays::blas::tridiag_worker<false> tri(p.krylov_dim);
+ std::mt19937 rng(12345);
+ std::uniform_real_distribution<double> random(-1, 1);
+ // residue of the lowest Ritz pair, for the last diagonalization of the tridiagonal matrix
+ auto ritz_residue = [&](krylov_space<State> const &K) {
+  diagonalize(K, tri);
+  return std::abs(K.last_beta() * tri.vectors()(0, K.size() - 1));
+ };
+
+ for (int k = 0; k < p.n_eigen; ++k) {
+  State v = psi0;
+  // the Krylov space of psi0 contains only its projection on each eigenspace. The deflation of this projection leaves
+  // nothing in a degenerate eigenspace : the next start states get a random component.
+  if (k > 0)
+   for (int i = 0; i < v.size(); ++i) v(i) += v_t(norm(psi0) * random(rng) / std::sqrt(double(v.size())));
+  orthogonalize(v, res.eigenvectors, k);
+  double n = norm(v);
+  if (n < 1.e-10 * (norm(psi0) + 1.e-300)) TRIQS_RUNTIME_ERROR << "lanczos : the start state is in the space of the eigenvectors already found";
+  v /= v_t(n);
+  bool converged = false;
+  for (int r = 0; (r <= p.max_restarts) && !converged; ++r) {
+   // each check diagonalizes the tridiagonal matrix : only every check_period steps
+   build(H, v, res.eigenvectors, p, K, res.n_applications,
+         [&](krylov_space<State> const &K) { return (K.size() % p.check_period == 0) && (ritz_residue(K) < p.tolerance); });
+   converged = (ritz_residue(K) < p.tolerance);
+   v = combine(K, [&](int i) { return tri.vectors()(0, i); });
+   orthogonalize(v, res.eigenvectors, k);
+   v /= v_t(norm(v));
+  }
+  if (!converged) TRIQS_RUNTIME_ERROR << "lanczos : eigenpair " << k << " not converged after " << p.max_restarts << " restarts";
+  res.eigenvalues.push_back(tri.values()(0));
+  res.eigenvectors.push_back(std::move(v));
+ }
+ return res;
+}
+
+/**
+ * exp(-tau H) |psi>, with the Krylov method.
+ *
+ * The Krylov space of dimension krylov_dim is built from psi, and exp(-tau H) is computed in it.
+ * If the estimated error is larger than tolerance * ||psi||, tau is split in smaller steps.
+ * Throws if the step needed falls below 1e-12 tau.
+ * The method is exact (up to rounding) for krylov_dim >= the dimension of the space.
+ *
+ * Uses the parameters krylov_dim, tolerance and full_reorthogonalization.
+ */
+template <typename Op, typename State>
+State krylov_exp(Op const &H, State const &psi, double tau, lanczos_parameters const &p = lanczos_parameters{}) {
+ using namespace lanczos_impl;
+ using v_t = typename State::value_type;
+ if (p.krylov_dim < 2) TRIQS_RUNTIME_ERROR << "krylov_exp : krylov_dim must be at least 2";
+ State x = psi;
+ double t = 0, dt = tau, n = norm(x);
+ if (n == 0) return x;
+ krylov_space<State> K;
+ arrays::blas::tridiag_worker<false> tri(p.krylov_dim);
+ std::vector<State> no_lock;
+ int n_app = 0;
+ while (std::abs(t) < std::abs(tau)) {
+  x /= v_t(n);
+  build(H, x, no_lock, p, K, n_app, [](krylov_space<State> const &) { return false; });
+  diagonalize(K, tri);
+  int m = K.size();
+  auto const &Y = tri.vectors();
+  auto const &E = tri.values();
+  // c = exp(-dt T) e_0 in the Krylov basis. The error estimate is the coupling of the last vector to the rest of the space.
+  arrays::vector<double> c(m);
+  for (;;) {
+   if (std::abs(dt) > std::abs(tau - t)) dt = tau - t;
+   c() = 0;
+   for (int l = 0; l < m; ++l) {
+    double w = std::exp(-dt * E(l)) * Y(l, 0);
+    for (int i = 0; i < m; ++i) c(i) += w * Y(l, i);
+   }
+   double error = std::abs(K.last_beta() * c(m - 1)), c_norm = std::sqrt(arrays::dot(c, c));
+   if (error <= p.tolerance * c_norm) break;
+   dt /= 2;
+   if (std::abs(dt) < 1.e-12 * std::abs(tau))
+    TRIQS_RUNTIME_ERROR << "krylov_exp : no convergence at t = " << t << ", with a step below 1e-12 tau. Increase krylov_dim or the tolerance";
+  }
+  x = combine(K, [&](int i) { return c(i); });
+  x *= v_t(n);
+  n = norm(x);
+  t += dt;
+  if (n == 0) break;
+ }
+ return x;
+}
+}
+}
@@ -0,0 +1,219 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include "./fundamental_operator_set.hpp"
+#include "./hilbert_space.hpp"
+#include "./state.hpp"
+#include <triqs/operators/many_body_operator.hpp>
+#include <triqs/arrays.hpp>
+#include <triqs/arrays/linalg/eigenelements.hpp>
+#include <triqs/arrays/linalg/det_and_inverse.hpp>
+#include <triqs/utility/parallel.hpp>
+#include <cmath>
+#include <vector>
+
+namespace triqs {
+namespace hilbert_space {
+
+/// H = constant + sum_ij h(i, j) C^+_i C_j + rest, i, j being the numbers of the C in the fundamental_operator_set
+template <typename ScalarType> struct one_body_decomposition {
+ ScalarType constant;
+ arrays::matrix<ScalarType> h;
+ utility::many_body_operator<ScalarType> rest;
+};
+
+/// The constant and one body parts of H. The rest has the other monomials (interactions, C^+ C^+, C C, single C or C^+).
+template <typename ScalarType>
+one_body_decomposition<ScalarType> extract_one_body(utility::many_body_operator<ScalarType> const& H, fundamental_operator_set const& fops) {
+ using op_t = utility::many_body_operator<ScalarType>;
+ one_body_decomposition<ScalarType> r{ScalarType(0), arrays::matrix<ScalarType>(fops.size(), fops.size()), op_t{}};
+ r.h() = 0;
+ for (auto const& m : H) {
+  auto it = m.monomial.begin();
+  if (m.monomial.size() == 0) {
+   r.constant += m.coef;
+   continue;
+  }
+  if (m.monomial.size() == 2) {
+   auto c1 = *it, c2 = *(++it);
+   if (c1.dagger && !c2.dagger) {
+    r.h(fops[c1.indices], fops[c2.indices]) += m.coef;
+    continue;
+   }
+  }
+  op_t x(m.coef);
+  for (auto const& c : m.monomial) x *= op_t::make_canonical(c.dagger, c.indices);
+  r.rest += x;
+ }
+ return r;
+}
+
+/**
+ * Diagonalization of a quadratic Hamiltonian H = constant + sum_ij h(i, j) C^+_i C_j
+ *
+ * h is diagonalized in the single particle space : h = U diag(eps) U^+, and the eigen-orbitals are
+ * D^+_a = sum_i U(i, a) C^+_i. The eigenstates of H are the Slater determinants D^+_a1 ... D^+_ak |0> (a1 < ... < ak),
+ * labeled by their occupation (bit a for D_a), with the energy constant + eps_a1 + ... + eps_ak.
+ * Nothing is built in the Fock space unless asked : the energies are sums of eps, the matrix elements of the C, C^+
+ * between the eigenstates are read on U, and the Slater determinants are expanded on the Fock states in parallel.
+ */
+template <typename ScalarType = double> class quadratic_diag {
+ public:
+ using scalar_t = ScalarType;
+ using many_body_op_t = utility::many_body_operator<scalar_t>;
+ using matrix_t = arrays::matrix<scalar_t>;
+ using occupation_t = uint64_t;
+
+ /// H must be quadratic (and hermitian), on the operators of fops
+ quadratic_diag(many_body_op_t const& H, fundamental_operator_set const& fops) : fops(fops) {
+  if (fops.size() > 64) TRIQS_RUNTIME_ERROR << "quadratic_diag : more than 64 orbitals";
+  auto d = extract_one_body(H, fops);
+  if (!d.rest.is_zero()) TRIQS_RUNTIME_ERROR << "quadratic_diag : the Hamiltonian is not quadratic : " << d.rest;
+  constant = std::real(d.constant);
+  int n = fops.size();
+  for (int i = 0; i < n; ++i)
+   for (int j = 0; j < n; ++j)
+    if (std::abs(d.h(i, j) - utility::_conj(d.h(j, i))) > 1.e-12) TRIQS_RUNTIME_ERROR << "quadratic_diag : the Hamiltonian is not hermitian";
+  if (n > 0) {
+   auto eig = arrays::linalg::eigenelements(d.h); // eigenvectors in rows
+   eps.assign(eig.first.begin(), eig.first.end());
+   U = eig.second.transpose();
+  }
+  gs_occupation = 0;
+  for (int a = 0; a < n; ++a)
+   if (eps[a] < 0) gs_occupation |= occupation_t(1) << a;
+ }
+
+ /// Number of orbitals
+ int n_orbitals() const { return fops.size(); }
+
+ /// The single particle energies, in ascending order
+ std::vector<double> const& get_single_particle_energies() const { return eps; }
+
+ /// The eigen-orbitals : the column a is D^+_a on the C^+_i
+ matrix_t const& get_unitary_matrix() const { return U; }
+
+ /// The eigen-orbitals, as operators
+ many_body_op_t d_dag(int a) const {
+  many_body_op_t r;
+  for (auto const& x : fops) r += U(x.linear_index, a) * many_body_op_t::make_canonical(true, x.index);
+  return r;
+ }
+ many_body_op_t d(int a) const {
+  many_body_op_t r;
+  for (auto const& x : fops) r += utility::_conj(U(x.linear_index, a)) * many_body_op_t::make_canonical(false, x.index);
+  return r;
+ }
+
+ /// The energy of the eigenstate of given occupation
+ double energy(occupation_t occ) const {
+  double e = constant;
+  for (; occ; occ = clear_lowest_bit(occ)) e += eps[lowest_bit(occ)];
+  return e;
+ }
+
+ /// The ground state : all the negative eps filled
+ occupation_t get_gs_occupation() const { return gs_occupation; }
+ double get_gs_energy() const { return energy(gs_occupation); }
+
+ /// Z = sum of exp(-beta (E - E_0)) = prod_a (1 + exp(-beta |eps_a|))
+ double partition_function(double beta) const {
+  double z = 1;
+  for (auto e : eps) z *= 1 + std::exp(-beta * std::abs(e));
+  return z;
+ }
+
+ /// The energies of all the 2^n eigenstates, the occupation being the index. Computed in parallel, each one from
+ /// the state with one orbital less.
+ std::vector<double> fock_energies() const {
+  if (n_orbitals() > 30) TRIQS_RUNTIME_ERROR << "quadratic_diag : 2^" << n_orbitals() << " energies are too many";
+  std::vector<double> E(occupation_t(1) << n_orbitals());
+  utility::parallel_for_chunks(E.size(), [&](long first, long last) {
+   for (long s = first; s < last; ++s) {
+    occupation_t t = clear_lowest_bit(occupation_t(s));
+    E[s] = ((s > 0) && (long(t) >= first) ? E[t] + eps[lowest_bit(occupation_t(s))] : energy(s));
+   }
+  }, 1024);
+  return E;
+ }
+
+ /// The eigenstate of given occupation on the Fock states of hs (the full space of the fundamental operators) :
+ /// its amplitude on C^+_i1 ... C^+_ik |0> (i1 < ... < ik) is the determinant of U(i's, a's)
+ state<hilbert_space, scalar_t, false> slater_state(hilbert_space const& hs, occupation_t occ) const {
+  state<hilbert_space, scalar_t, false> st(hs);
+  std::vector<int> a = _orbitals(occ);
+  int k = a.size();
+  utility::parallel_for(hs.size(), [&](long n) {
+   fock_state_t f = hs.get_fock_state(n);
+   if (popcount(f) != k) return;
+   if (k == 0) {
+    st(n) = 1;
+    return;
+   }
+   matrix_t M(k, k);
+   int u = 0;
+   for (; f; f = clear_lowest_bit(f), ++u)
+    for (int v = 0; v < k; ++v) M(u, v) = U(lowest_bit(f), a[v]);
+   st(n) = arrays::determinant(M);
+  }, 256);
+  return st;
+ }
+
+ /// <to| C^+_i |from> between the eigenstates
+ scalar_t c_dag_element(int i, occupation_t to, occupation_t from) const {
+  int a;
+  if (!_one_more(to, from, a)) return 0;
+  return utility::_conj(U(i, a)) * _sign(from, a);
+ }
+
+ /// <to| C_i |from> between the eigenstates
+ scalar_t c_element(int i, occupation_t to, occupation_t from) const {
+  int a;
+  if (!_one_more(from, to, a)) return 0;
+  return U(i, a) * _sign(to, a);
+ }
+
+ private:
+ fundamental_operator_set fops;
+ double constant;
+ std::vector<double> eps;
+ matrix_t U;
+ occupation_t gs_occupation;
+
+ static std::vector<int> _orbitals(occupation_t occ) {
+  std::vector<int> r;
+  for (; occ; occ = clear_lowest_bit(occ)) r.push_back(lowest_bit(occ));
+  return r;
+ }
+
+ // is x = y + the orbital a ?
+ static bool _one_more(occupation_t x, occupation_t y, int& a) {
+  occupation_t z = x ^ y;
+  if ((popcount(z) != 1) || !(z & x)) return false;
+  a = lowest_bit(z);
+  return true;
+ }
+
+ // D^+_a |occ> = sign |occ + a>
+ static double _sign(occupation_t occ, int a) { return (popcount_below(occ, a) % 2 ? -1 : 1); }
+};
+}
+}
@@ -23,8 +23,14 @@
 
 #include <set>
 #include <map>
+#include <mutex>
 #include <utility>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
 #include <triqs/utility/draft/numeric_ops.hpp>
+#include <triqs/utility/parallel.hpp>
 #include <boost/pending/disjoint_sets.hpp>
 
 namespace triqs {
@@ -34,6 +40,15 @@ namespace hilbert_space {
 // ------------
 // * State must model StateVector
 // * StateType OperatorType::operator()(StateType const &st) must apply the operator to 'st' and return the result
+//
+// The basis states are distributed over the threads (cf triqs/utility/parallel.hpp) : operator() is called concurrently
+// and must be thread safe. If the operator is an imperative_operator compiled on the Hilbert space of the states
+// (cf imperative_operator::compile), its sparse matrix is read directly instead.
+
+// Does Op have a compiled sparse matrix on the space HS (imperative_operator) ?
+template <typename Op, typename HS, typename Enable = void> struct has_compiled_matrix : std::false_type {};
+template <typename Op, typename HS>
+struct has_compiled_matrix<Op, HS, decltype(void(std::declval<Op const &>().n_rows(std::declval<HS const &>())))> : std::true_type {};
 
 template <typename StateType, typename OperatorType> class space_partition {
 
@@ -46,28 +61,25 @@ template <typename StateType, typename OperatorType> class space_partition {
  using matrix_element_map_t =
      std::map<std::pair<index_t,index_t>, typename state_t::value_type>;
 
+ // A non zero matrix element <f|op|i>
+ struct matrix_element_t {
+  index_t i, f;
+  amplitude_t value;
+  bool operator<(matrix_element_t const &x) const { return (i < x.i) || ((i == x.i) && (f < x.f)); }
+ };
+ // Matrix elements, in a compact form : sorted by (i,f)
+ using sorted_matrix_elements_t = std::vector<matrix_element_t>;
+
  space_partition(state_t const& st, operator_t const& H, bool store_matrix_elements = true)
     : subspaces(st.size()), tmp_state(make_zero_state(st)) {
-  auto size = tmp_state.size();
-
-  // Iteration over all initial basis states
-  for (index_t i = 0; i < size; ++i) {
-   tmp_state(i) = amplitude_t(1.0);
-   state_t final_state = H(tmp_state);
-
-   // Iterate over non-zero final amplitudes
-   foreach(final_state, [&](index_t f, amplitude_t amplitude) {
-    if (triqs::utility::is_zero(amplitude)) return;
-    auto i_subspace = subspaces.find_set(i);
-    auto f_subspace = subspaces.find_set(f);
-    if (i_subspace != f_subspace) subspaces.link(i_subspace, f_subspace);
-
-    if (store_matrix_elements) matrix_elements[std::make_pair(i, f)] = amplitude;
-   });
-   tmp_state(i) = amplitude_t(0.);
-  }
+  _partition(H, store_matrix_elements, [](index_t, index_t, amplitude_t) {});
+ }
 
-  _update_index();
+ /// Same, but the matrix elements are not stored : on_matrix_element(i, f, amplitude) is called on each of them, from the threads.
+ template <typename F, typename = typename std::enable_if<!std::is_same<F, bool>::value>::type>
+ space_partition(state_t const& st, operator_t const& H, F const& on_matrix_element)
+    : subspaces(st.size()), tmp_state(make_zero_state(st)) {
+  _partition(H, false, on_matrix_element);
  }
 
  space_partition(space_partition const&) = default;
@@ -75,33 +87,32 @@ template <typename StateType, typename OperatorType> class space_partition {
  std::pair<matrix_element_map_t, matrix_element_map_t> merge_subspaces(operator_t const& Cd, operator_t const& C,
                                                                        bool store_matrix_elements = true) {
 
-  matrix_element_map_t Cd_elements, C_elements;
+  auto rep = _representatives();
   std::multimap<index_t,index_t> Cd_connections, C_connections;
-
-  auto size = tmp_state.size();
-
-  // Fill connection multimaps
-  for (index_t i = 0; i < size; ++i) {
-   tmp_state(i) = amplitude_t(1.0);
-   auto i_subspace = subspaces.find_set(i);
-
-   auto fill_conn = [this,i,i_subspace,store_matrix_elements]
-                    (operator_t const& op, std::multimap<index_t,index_t> & conn, matrix_element_map_t & elem) {
-    state_t final_state = op(tmp_state);
-    // Iterate over non-zero final amplitudes
-    foreach(final_state, [&](index_t f, amplitude_t amplitude) {
-     if (triqs::utility::is_zero(amplitude)) return;
-     auto f_subspace = subspaces.find_set(f);
-     conn.insert({i_subspace,f_subspace});
-     if (store_matrix_elements) elem[{i, f}] = amplitude;
+  sorted_matrix_elements_t Cd_sorted_elements, C_sorted_elements;
+
+  // Fill connection multimaps, with each connection between two subspaces only once
+  auto fill_conn = [&](operator_t const& op, std::multimap<index_t, index_t>& conn, sorted_matrix_elements_t& elem) {
+   std::vector<std::pair<index_t, index_t>> all_conn;
+   std::mutex mutex;
+   _scan(op, [&](long first, long last) {
+    std::vector<std::pair<index_t, index_t>> c;
+    sorted_matrix_elements_t e;
+    _foreach_matrix_element(op, first, last, [&](index_t i, index_t f, amplitude_t amplitude) {
+     c.emplace_back(rep[i], rep[f]);
+     if (store_matrix_elements) e.push_back({i, f, amplitude});
     });
-   };
-
-   fill_conn(Cd,Cd_connections,Cd_elements);
-   fill_conn(C,C_connections,C_elements);
-
-   tmp_state(i) = amplitude_t(0.);
-  }
+    _sort_unique(c);
+    std::lock_guard<std::mutex> lock(mutex);
+    all_conn.insert(all_conn.end(), c.begin(), c.end());
+    elem.insert(elem.end(), e.begin(), e.end());
+   });
+   _sort_unique(all_conn);
+   for (auto const& x : all_conn) conn.insert(conn.end(), x);
+   std::sort(elem.begin(), elem.end());
+  };
+  fill_conn(Cd, Cd_connections, Cd_sorted_elements);
+  fill_conn(C, C_connections, C_sorted_elements);
 
   // 'Zigzag' traversal algorithm
   while(!Cd_connections.empty()) {
@@ -146,7 +157,7 @@ template <typename StateType, typename OperatorType> class space_partition {
 
   _update_index();
 
-  return std::make_pair(Cd_elements, C_elements);
+  return std::make_pair(_to_map(Cd_sorted_elements), _to_map(C_sorted_elements));
  }
 
  // Access information about subspaces
@@ -158,35 +169,112 @@ template <typename StateType, typename OperatorType> class space_partition {
 
  index_t lookup_basis_state(index_t basis_state) { return representative_to_index[subspaces.find_set(basis_state)]; }
 
- // Access to matrix elements of H
- matrix_element_map_t const& get_matrix_elements() const { return matrix_elements; }
+ // Access to matrix elements of H, as a map (built on the first call)
+ matrix_element_map_t const& get_matrix_elements() const {
+  if (matrix_elements.empty() && !sorted_matrix_elements.empty()) matrix_elements = _to_map(sorted_matrix_elements);
+  return matrix_elements;
+ }
 
-  block_mapping_t find_mappings(operator_t const& op, bool diagonal_only = false) {
+ // Access to matrix elements of H, in the compact form
+ sorted_matrix_elements_t const& get_sorted_matrix_elements() const { return sorted_matrix_elements; }
 
-  block_mapping_t mapping;
+ block_mapping_t find_mappings(operator_t const& op, bool diagonal_only = false) {
 
-  // Iteration over all initial basis states
-  for (index_t i = 0; i < tmp_state.size(); ++i) {
-   state_t initial_state = tmp_state;
-   initial_state(i) = amplitude_t(1.0);
-   auto i_subspace = subspaces.find_set(i);
+  auto rep = _representatives();
+  std::vector<std::pair<index_t, index_t>> all_mappings;
+  std::mutex mutex;
+  _scan(op, [&](long first, long last) {
+   std::vector<std::pair<index_t, index_t>> mapping;
+   _foreach_matrix_element(op, first, last, [&](index_t i, index_t f, amplitude_t) {
+    auto i_subspace = rep[i], f_subspace = rep[f];
+    if ((!diagonal_only) || i_subspace == f_subspace)
+     mapping.emplace_back(representative_to_index[i_subspace], representative_to_index[f_subspace]);
+   });
+   _sort_unique(mapping);
+   std::lock_guard<std::mutex> lock(mutex);
+   all_mappings.insert(all_mappings.end(), mapping.begin(), mapping.end());
+  });
+  return block_mapping_t(all_mappings.begin(), all_mappings.end());
+ }
 
-   state_t final_state = op(initial_state);
+ private:
+ using use_compiled_t = has_compiled_matrix<operator_t, typename state_t::hilbert_space_t>;
+
+ // Partition the space with H. Each thread links the states in its own disjoint sets, which are then merged.
+ template <typename F> void _partition(operator_t const& H, bool store_matrix_elements, F const& on_matrix_element) {
+  index_t size = tmp_state.size();
+  std::mutex mutex;
+  _scan(H, [&](long first, long last) {
+   boost::disjoint_sets_with_storage<> local(size);
+   sorted_matrix_elements_t elements;
+   _foreach_matrix_element(H, first, last, [&](index_t i, index_t f, amplitude_t amplitude) {
+    local.union_set(i, f);
+    if (store_matrix_elements) elements.push_back({i, f, amplitude});
+    on_matrix_element(i, f, amplitude);
+   });
+   std::lock_guard<std::mutex> lock(mutex);
+   for (index_t n = 0; n < size; ++n) {
+    auto r = local.find_set(n);
+    if (r != n) subspaces.union_set(n, r);
+   }
+   sorted_matrix_elements.insert(sorted_matrix_elements.end(), elements.begin(), elements.end());
+  });
+  std::sort(sorted_matrix_elements.begin(), sorted_matrix_elements.end());
+  _update_index();
+ }
+
+ // The work on op is split in [0, n) : the basis states, or the rows of the compiled matrix. Calls f(first, last) on a chunk per thread.
+ template <typename F> void _scan(operator_t const& op, F const& f) const {
+  long n = (_is_compiled(op, use_compiled_t()) ? _n_rows(op, use_compiled_t()) : tmp_state.size());
+  utility::parallel_for_chunks(n, f, 128);
+ }
 
+ // Calls f(i, f, amplitude) for the non zero matrix elements <f|op|i> of the chunk [first, last) of the work
+ template <typename F> void _foreach_matrix_element(operator_t const& op, long first, long last, F const& f) const {
+  if (_is_compiled(op, use_compiled_t())) return _foreach_compiled(op, first, last, f, use_compiled_t());
+  state_t st = tmp_state;
+  for (index_t i = first; i < last; ++i) {
+   st(i) = amplitude_t(1.0);
+   state_t final_state = op(st);
    // Iterate over non-zero final amplitudes
-   foreach(final_state, [&](index_t f, amplitude_t amplitude) {
+   foreach(final_state, [&](index_t f_state, amplitude_t amplitude) {
     if (triqs::utility::is_zero(amplitude)) return;
-    auto f_subspace = subspaces.find_set(f);
-    if((!diagonal_only) || i_subspace==f_subspace)
-      mapping.insert(std::make_pair(representative_to_index[i_subspace],
-                                    representative_to_index[f_subspace]));
+    f(i, f_state, amplitude);
    });
+   st(i) = amplitude_t(0.);
   }
+ }
+
+ bool _is_compiled(operator_t const& op, std::true_type) const { return op.n_rows(tmp_state.get_hilbert()) > 0; }
+ bool _is_compiled(operator_t const&, std::false_type) const { return false; }
+ long _n_rows(operator_t const& op, std::true_type) const { return op.n_rows(tmp_state.get_hilbert()); }
+ long _n_rows(operator_t const&, std::false_type) const { return 0; }
 
-  return mapping;
+ template <typename F> void _foreach_compiled(operator_t const& op, long first, long last, F const& f, std::true_type) const {
+  op.foreach_matrix_element(tmp_state.get_hilbert(), [&f](long i, long f_state, amplitude_t amplitude) {
+   if (!triqs::utility::is_zero(amplitude)) f(i, f_state, amplitude);
+  }, first, last);
+ }
+ template <typename F> void _foreach_compiled(operator_t const&, long, long, F const&, std::false_type) const {}
+
+ // The representative of each basis state, read only in the threads
+ std::vector<index_t> _representatives() {
+  std::vector<index_t> rep(tmp_state.size());
+  for (index_t n = 0; n < rep.size(); ++n) rep[n] = subspaces.find_set(n);
+  return rep;
+ }
+
+ template <typename T> static void _sort_unique(std::vector<T>& v) {
+  std::sort(v.begin(), v.end());
+  v.erase(std::unique(v.begin(), v.end()), v.end());
+ }
+
+ static matrix_element_map_t _to_map(sorted_matrix_elements_t const& elements) {
+  matrix_element_map_t m;
+  for (auto const& x : elements) m.insert(m.end(), std::make_pair(std::make_pair(x.i, x.f), x.value));
+  return m;
  }
 
- private:
  void _update_index() {
   auto p = subspaces.parents();
   subspaces.compress_sets(p.begin(), p.end());  // parents are representatives
@@ -203,8 +291,10 @@ template <typename StateType, typename OperatorType> class space_partition {
  mutable state_t tmp_state;
  // Subspaces
  boost::disjoint_sets_with_storage<> subspaces;
- // Matrix elements of the Hamiltonian
- matrix_element_map_t matrix_elements;
+ // Matrix elements of the Hamiltonian, sorted by (i,f)
+ sorted_matrix_elements_t sorted_matrix_elements;
+ // The same as a map, built on demand
+ mutable matrix_element_map_t matrix_elements;
  // Map representative basis state to subspace index
  std::map<index_t, index_t> representative_to_index;
 };
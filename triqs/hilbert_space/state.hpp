@@ -22,7 +22,7 @@
 #include <triqs/arrays.hpp>
 #include <triqs/arrays/blas_lapack/dot.hpp>
 #include <algorithm>
-#include <unordered_map>
+#include <vector>
 #include <cmath>
 #include <boost/operators.hpp>
 #include "hilbert_space.hpp"
@@ -41,18 +41,23 @@ state<HilbertSpace, ScalarType, BasedOnMap> make_zero_state(state<HilbertSpace,
 }
 
 // -----------------------------------------------------------------------------------
-// implementation based on a map : can work
+// sparse implementation : can work
 // on huge hilbert spaces as long as there are not too
 // many components in the state and not too many monomials
 //  in the operator acting on the state...
+// The indices of the amplitudes are kept sorted, in a vector, with the amplitudes in another vector :
+// the sums and the scalar products are merges of the two sorted vectors.
+// The zero amplitudes are removed lazily (during the sums, or when too many have been added by operator()),
+// and they are skipped by foreach.
 // -----------------------------------------------------------------------------------
 template <typename HilbertSpace, typename ScalarType>
 class state<HilbertSpace, ScalarType, true> : boost::additive<state<HilbertSpace, ScalarType, true>>,
                                               boost::multiplicative<state<HilbertSpace, ScalarType, true>, ScalarType> {
  // derivations implement the vector space operations over ScalarType from the compounds operators +=, *=, ....
  const HilbertSpace* hs;
- using amplitude_t = std::unordered_map<std::size_t, ScalarType>;
- amplitude_t ampli;
+ std::vector<std::size_t> idx;  // the indices of the amplitudes, sorted
+ std::vector<ScalarType> ampli; // the amplitudes
+ std::size_t pruned_size = 0;   // the number of amplitudes after the last removal of the zeros
 
  public:
  using value_type = ScalarType;
@@ -65,53 +70,95 @@ class state<HilbertSpace, ScalarType, true> : boost::additive<state<HilbertSpace
  // What if hs == nullptr ?
  int size() const { return hs->size(); }
 
+ /// Number of amplitudes in the state (some of them may be zero)
+ std::size_t n_amplitudes() const { return idx.size(); }
+
  // Access to data
- value_type& operator()(int i) { return ampli[i]; }
- value_type const& operator()(int i) const { return ampli[i]; }
+ // The reference is valid until the next modification of the state.
+ value_type& operator()(int i) {
+  auto p = std::lower_bound(idx.begin(), idx.end(), std::size_t(i)) - idx.begin();
+  if ((p < idx.size()) && (idx[p] == std::size_t(i))) return ampli[p];
+  if (idx.size() >= 2 * pruned_size + 16) {
+   prune();
+   p = std::lower_bound(idx.begin(), idx.end(), std::size_t(i)) - idx.begin();
+  }
+  idx.insert(idx.begin() + p, i);
+  ampli.insert(ampli.begin() + p, value_type(0));
+  return ampli[p];
+ }
+
+ value_type operator()(int i) const {
+  auto it = std::lower_bound(idx.begin(), idx.end(), std::size_t(i));
+  return ((it != idx.end()) && (*it == std::size_t(i)) ? ampli[it - idx.begin()] : value_type(0));
+ }
 
  // Basic operations
  state& operator+=(state const& s2) {
-  for (auto const& aa : s2.ampli) {
-   auto r = ampli.insert(aa);
-   if (!r.second) r.first->second += aa.second;
-  }
-  prune();
+  merge(s2, value_type(1));
   return *this;
  }
 
  state& operator-=(state const& s2) {
-  for (auto const& aa : s2.ampli) {
-   auto r = ampli.insert({aa.first, -aa.second});
-   if (!r.second) r.first->second -= aa.second;
-  }
-  prune();
+  merge(s2, value_type(-1));
   return *this;
  }
 
  state& operator*=(value_type x) {
-  for (auto& a : ampli) {
-   a.second *= x;
-  }
-  prune();
+  if (triqs::utility::is_zero(x)) {
+   idx.clear();
+   ampli.clear();
+   pruned_size = 0;
+  } else
+   for (auto& a : ampli) a *= x;
   return *this;
  }
 
  state& operator/=(value_type x) { return operator*=(1 / x); }
 
+ /**
+  * Add the amplitudes x, given as (index, amplitude) in any order, with possibly several amplitudes for the same index.
+  * x is sorted in place. It is the fast way to fill a state with many amplitudes.
+  */
+ void add_amplitudes(std::vector<std::pair<std::size_t, value_type>>& x) {
+  std::sort(x.begin(), x.end(), [](std::pair<std::size_t, value_type> const& a, std::pair<std::size_t, value_type> const& b) {
+   return a.first < b.first;
+  });
+  std::vector<std::size_t> new_idx;
+  std::vector<value_type> new_ampli;
+  new_idx.reserve(idx.size() + x.size());
+  new_ampli.reserve(idx.size() + x.size());
+  std::size_t p = 0, q = 0;
+  while ((p < idx.size()) || (q < x.size())) {
+   std::size_t i = (q == x.size() || ((p < idx.size()) && (idx[p] < x[q].first)) ? idx[p] : x[q].first);
+   value_type a = 0;
+   if ((p < idx.size()) && (idx[p] == i)) a = ampli[p++];
+   for (; (q < x.size()) && (x[q].first == i); ++q) a += x[q].second;
+   if (triqs::utility::is_zero(a)) continue;
+   new_idx.push_back(i);
+   new_ampli.push_back(a);
+  }
+  set(std::move(new_idx), std::move(new_ampli));
+ }
+
  // Scalar product
  friend value_type dot_product(state const& s1, state const& s2) {
   value_type res = 0.0;
-  for (auto const& a : s1.ampli) {
-   if (s2.ampli.count(a.first) == 1) res += triqs::utility::_conj(a.second) * s2.ampli.at(a.first);
+  for (std::size_t p = 0, q = 0; (p < s1.idx.size()) && (q < s2.idx.size());) {
+   if (s1.idx[p] < s2.idx[q])
+    ++p;
+   else if (s2.idx[q] < s1.idx[p])
+    ++q;
+   else
+    res += triqs::utility::_conj(s1.ampli[p++]) * s2.ampli[q++];
   }
   return res;
  }
 
- // Lambda (fs, amplitude)
+ // Lambda (fs, amplitude), in the order of the indices
  template<typename Lambda>
  friend void foreach(state const& st, Lambda l) {
-  const_cast<state&>(st).prune();
-  for (auto const& p : st.ampli) l(p.first, p.second);
+  for (std::size_t p = 0; p < st.idx.size(); ++p)
+   if (!triqs::utility::is_zero(st.ampli[p])) l(st.idx[p], st.ampli[p]);
  }
 
  //
@@ -122,14 +169,52 @@ class state<HilbertSpace, ScalarType, true> : boost::additive<state<HilbertSpace
  void set_hilbert(HilbertSpace const& hs_) { hs = &hs_; }
 
  private:
- void prune() {
-  for(auto it=ampli.begin(); it!=ampli.end();)
-  {
-   if (triqs::utility::is_zero(it->second))
-    it = ampli.erase(it);
-   else
-    ++it;
+ void set(std::vector<std::size_t>&& new_idx, std::vector<value_type>&& new_ampli) {
+  std::swap(idx, new_idx);
+  std::swap(ampli, new_ampli);
+  pruned_size = idx.size();
+ }
+
+ // *this += alpha * s2
+ void merge(state const& s2, value_type alpha) {
+  std::vector<std::size_t> new_idx;
+  std::vector<value_type> new_ampli;
+  new_idx.reserve(idx.size() + s2.idx.size());
+  new_ampli.reserve(idx.size() + s2.idx.size());
+  std::size_t p = 0, q = 0;
+  auto push = [&](std::size_t i, value_type a) {
+   if (triqs::utility::is_zero(a)) return;
+   new_idx.push_back(i);
+   new_ampli.push_back(a);
+  };
+  while ((p < idx.size()) && (q < s2.idx.size())) {
+   if (idx[p] < s2.idx[q]) {
+    push(idx[p], ampli[p]);
+    ++p;
+   } else if (s2.idx[q] < idx[p]) {
+    push(s2.idx[q], alpha * s2.ampli[q]);
+    ++q;
+   } else {
+    push(idx[p], ampli[p] + alpha * s2.ampli[q]);
+    ++p;
+    ++q;
+   }
   }
+  for (; p < idx.size(); ++p) push(idx[p], ampli[p]);
+  for (; q < s2.idx.size(); ++q) push(s2.idx[q], alpha * s2.ampli[q]);
+  set(std::move(new_idx), std::move(new_ampli));
+ }
+
+ void prune() {
+  std::size_t n = 0;
+  for (std::size_t p = 0; p < idx.size(); ++p)
+   if (!triqs::utility::is_zero(ampli[p])) {
+    idx[n] = idx[p];
+    ampli[n++] = ampli[p];
+   }
+  idx.resize(n);
+  ampli.resize(n);
+  pruned_size = n;
  }
 };
 
@@ -229,7 +314,7 @@ TargetState project(OriginalState const& psi, hilbert_space const& proj_hs) {
  TargetState proj_psi(proj_hs);
  auto const& hs = psi.get_hilbert();
  foreach(psi,[&](int i, typename OriginalState::value_type v){
-  proj_psi(hs.get_fock_state(i)) = v;
+  proj_psi(proj_hs.get_state_index(hs.get_fock_state(i))) = v;
  });
  return proj_psi;
 }
@@ -250,7 +335,7 @@ TargetState project(OriginalState const& psi, sub_hilbert_space const& proj_hs)
 template<typename A, typename B> struct __lambda1 { 
  A& proj_psi; B const & hs;
  template<typename VT> void operator()(int i, VT const & v) { 
- proj_psi(hs.get_fock_state(i)) = v; 
+ proj_psi(proj_psi.get_hilbert().get_state_index(hs.get_fock_state(i))) = v; 
  }
 };
 template<typename A, typename B, typename C> struct __lambda2 { 
@@ -69,6 +69,7 @@ namespace lattice {
    mesh_point_t(bz_mesh const &mesh, index_t const &index_) : m(&mesh), _index(index_) {}
    mesh_point_t(bz_mesh const &mesh) : mesh_point_t(mesh, 0) {}
    void advance() { ++_index; }
+   void advance(long k) { _index += k; }
    using cast_t = domain_pt_t;
    operator cast_t() const { return m->index_to_point(_index); }
    long linear_index() const { return _index; }
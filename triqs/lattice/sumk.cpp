@@ -0,0 +1,121 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "./sumk.hpp"
+#include <triqs/gfs/dyson.hpp>
+#include <triqs/mpi/gf.hpp>
+#include <triqs/utility/parallel.hpp>
+
+namespace triqs {
+namespace lattice {
+
+ using namespace arrays;
+ using namespace gfs;
+
+ namespace {
+
+  // Number of k points treated at once
+  constexpr long k_chunk_size = 1024;
+
+  // The sum over the k points of this node.
+  // fill_eps(first, eps) fills eps(n, :, :) with t(k) for the k point first + n.
+  template <typename F>
+  gf<imfreq> sumk_impl(long n_k, long n_bands, F fill_eps, array_const_view<double, 1> weights, gf_const_view<imfreq> sigma,
+                       double mu, mpi::communicator c) {
+   if (n_k <= 0) TRIQS_RUNTIME_ERROR << "sumk : no k point";
+   if (long(first_dim(weights)) != n_k) TRIQS_RUNTIME_ERROR << "sumk : " << first_dim(weights) << " weights for " << n_k << " k points";
+   auto sh = get_target_shape(sigma);
+   if ((long(sh[0]) != n_bands) || (long(sh[1]) != n_bands))
+    TRIQS_RUNTIME_ERROR << "sumk : Sigma is a " << sh[0] << "x" << sh[1] << " matrix while t(k) is " << n_bands << "x" << n_bands;
+
+   auto res = gf<imfreq>{sigma.mesh(), sh};
+   res() = 0;
+   auto z = details_dyson::make_z(sigma.mesh(), mu);
+   auto t = tail_omega(res.singularity()) + mu - sigma.singularity();
+
+   // the k points of this node
+   auto r = mpi::slice_range(0, n_k - 1, c.size(), c.rank());
+   array<dcomplex, 3> eps(std::min(k_chunk_size, n_k), n_bands, n_bands);
+   for (long first = r.first; first <= r.second; first += k_chunk_size) {
+    long n = std::min(k_chunk_size, r.second + 1 - first);
+    auto eps_chunk = eps(range(0, n), range(), range());
+    fill_eps(first, eps_chunk);
+    auto w = std::vector<double>(n);
+    for (long k = 0; k < n; ++k) w[k] = weights(first + k);
+    dyson_accumulate_sum_k(res.data(), z, eps_chunk, sigma.data(), w);
+    for (long k = 0; k < n; ++k) res.singularity() += w[k] * inverse(t - matrix<dcomplex>{eps_chunk(k, range(), range())});
+   }
+
+   mpi::all_reduce_in_place(res, c);
+   return res;
+  }
+ }
+
+ //------------------------------------------------------
+ gf<imfreq> sumk(array_const_view<dcomplex, 3> eps_k, array_const_view<double, 1> weights, gf_const_view<imfreq> sigma,
+                 double mu, mpi::communicator c) {
+  if (second_dim(eps_k) != third_dim(eps_k)) TRIQS_RUNTIME_ERROR << "sumk : t(k) is not a square matrix";
+  auto fill_eps = [&eps_k](long first, array_view<dcomplex, 3> eps) { eps = eps_k(range(first, first + first_dim(eps)), range(), range()); };
+  return sumk_impl(first_dim(eps_k), second_dim(eps_k), fill_eps, weights, sigma, mu, c);
+ }
+
+ //------------------------------------------------------
+ gf<imfreq> sumk(tight_binding const& TB, array_const_view<double, 2> k_points, array_const_view<double, 1> weights,
+                 gf_const_view<imfreq> sigma, double mu, mpi::communicator c) {
+
+  long nb = TB.n_bands(), dim = TB.lattice().dim();
+  if (long(second_dim(k_points)) < dim)
+   TRIQS_RUNTIME_ERROR << "sumk : the k points are of dimension " << second_dim(k_points) << " instead of " << dim;
+
+  // flatten the hoppings : the Fourier transform below is run in threads, without any view
+  std::vector<long> displs;
+  std::vector<dcomplex> mats;
+  foreach(TB, [&](std::vector<long> const& displ, matrix<dcomplex> const& m) {
+   displs.insert(displs.end(), displ.begin(), displ.end());
+   for (long i = 0; i < nb; ++i)
+    for (long j = 0; j < nb; ++j) mats.push_back(m(i, j));
+  });
+  long n_hop = mats.size() / (nb * nb);
+  auto const& ks = k_points.indexmap().strides();
+  double const* k0 = k_points.data_start();
+
+  // t(k) = sum_R t(R) exp(2 i pi k.R), as in fourier(TB)
+  auto fill_eps = [&](long first, array_view<dcomplex, 3> eps) {
+   auto const& es = eps.indexmap().strides();
+   dcomplex* e0 = eps.data_start();
+   utility::parallel_for(first_dim(eps), [&](long n) {
+    dcomplex* e = e0 + n * es[0];
+    double const* k = k0 + (first + n) * ks[0];
+    for (long i = 0; i < nb; ++i)
+     for (long j = 0; j < nb; ++j) e[i * es[1] + j * es[2]] = 0;
+    for (long h = 0; h < n_hop; ++h) {
+     double dot_prod = 0;
+     for (long d = 0; d < dim; ++d) dot_prod += k[d * ks[1]] * displs[h * dim + d];
+     dcomplex phase = std::exp(dcomplex(0, 2 * M_PI * dot_prod));
+     dcomplex const* m = mats.data() + h * nb * nb;
+     for (long i = 0; i < nb; ++i)
+      for (long j = 0; j < nb; ++j) e[i * es[1] + j * es[2]] += m[i * nb + j] * phase;
+    }
+   }, 8);
+  };
+  return sumk_impl(first_dim(k_points), nb, fill_eps, weights, sigma, mu, c);
+ }
+}
+}
@@ -0,0 +1,52 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include "./tight_binding.hpp"
+#include <triqs/gfs/imfreq.hpp>
+#include <triqs/mpi/base.hpp>
+
+namespace triqs {
+namespace lattice {
+
+ /**
+   Lattice sum : G(iw) = sum_k w_k [iw + mu - t(k) - Sigma(iw)]^{-1}, with its tail.
+
+   The k points are distributed over the nodes of the communicator c (mpi::slice_range),
+   the frequencies over the threads (cf gfs::dyson_accumulate_sum_k).
+   The result is the same on all nodes.
+
+   @param eps_k : eps_k(n, :, :) is t(k) at the n-th k point
+   @param weights : weights(n) is the weight w_k of the n-th k point
+   */
+ gfs::gf<gfs::imfreq> sumk(arrays::array_const_view<dcomplex, 3> eps_k, arrays::array_const_view<double, 1> weights,
+                           gfs::gf_const_view<gfs::imfreq> sigma, double mu, mpi::communicator c = {});
+
+ /**
+   Same as above, for the Fourier transform t(k) of a tight binding Hamiltonian.
+   t(k) is computed on the fly, by chunks of k points : the t(k) for all k are never stored.
+
+   @param k_points : k_points(n, :) is the n-th k point, in the basis of the reciprocal lattice (as in hopping_stack).
+   */
+ gfs::gf<gfs::imfreq> sumk(tight_binding const& TB, arrays::array_const_view<double, 2> k_points,
+                           arrays::array_const_view<double, 1> weights, gfs::gf_const_view<gfs::imfreq> sigma, double mu,
+                           mpi::communicator c = {});
+}
+}
@@ -21,6 +21,7 @@
 #include "tight_binding.hpp"
 #include <triqs/arrays/algorithms.hpp>
 #include <triqs/arrays/linalg/eigenelements.hpp>
+#include <triqs/arrays/linalg/batched_linalg.hpp>
 #include "grid_generator.hpp"
 namespace triqs {
 namespace lattice {
@@ -84,10 +85,12 @@ namespace lattice {
   int norb = TB.lattice().n_orbitals();
   int ndim = TB.lattice().dim();
   grid_generator grid(ndim, n_pts);
-  array<double, 2> eval(norb, grid.size());
-  for (; grid; ++grid) {
-   eval(range(), grid.index()) = linalg::eigenvalues(TK((*grid)(range(0, ndim)))());
-  }
+  int n_k = grid.size();
+  // fill h(k, i, j), then diagonalize all the matrices at once
+  array<dcomplex, 3> h(n_k, norb, norb);
+  for (; grid; ++grid) h(grid.index(), range(), range()) = TK((*grid)(range(0, ndim)))();
+  array<double, 2> eval(norb, n_k);
+  batched_eigenvalues(h, transposed_view(eval(), 1, 0));
   return eval;
  }
 
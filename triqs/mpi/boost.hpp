@@ -60,6 +60,7 @@ namespace mpi {
   }
 
   static void reduce_in_place(communicator c, T &a, int root) { boost::mpi::reduce(c, a, a, std::c14::plus<>(), root); }
+  static void all_reduce_in_place(communicator c, T &a, int root) { a = invoke(tag::all_reduce(), c, a, root); }
   static void broadcast(communicator c, T &a, int root) { boost::mpi::broadcast(c, a, root); }
 
   static void scatter(communicator c, T const &, int root) = delete;
@@ -21,6 +21,7 @@
 #include "./many_body_operator.hpp"
 #include <triqs/h5.hpp>
 #include <triqs/h5/base.hpp>
+#include <unordered_map>
 
 namespace triqs {
 namespace utility {
@@ -28,24 +29,58 @@ namespace utility {
  using namespace triqs::h5;
  using hilbert_space::fundamental_operator_set;
 
-// maximum order of the monomial (here quartic operators)
-#define MAX_MONOMIAL_SIZE 4
+ /*
+  * The operator is stored in a subgroup, in CSR form :
+  *  - coefficients[m] : the coefficient of the monomial m
+  *  - operators[offsets[m], offsets[m + 1]) : its C, C^+, as int32. The operator of number n in the
+  *    fundamental_operator_set is n + 1 for C^+, -(n + 1) for C.
+  *  - the fundamental_operator_set is an attribute of the subgroup (absent for the 0 operator).
+  *
+  * The old format (a dataset of compound monomials, with at most 4 operators) can still be read.
+  */
 
  namespace {
 
-  // the type of the monomial to be stored in the h5 file
-  // the complicated indices of the C, C^ will be transformed into an int
-  // via a fundamental_operator_set
+  template <typename T> void write_vector(group g, std::string const &name, std::vector<T> const &v, hid_t type) {
+   hsize_t dim[] = {v.size()};
+   h5_object dataspace = H5Screate_simple(1, dim, NULL);
+   h5_object dataset = g.create_dataset(name, type, dataspace);
+   if (v.size() && (H5Dwrite(dataset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, v.data()) < 0))
+    TRIQS_RUNTIME_ERROR << "Error writing the many_body_operator : " << name << " in the group " << g.name();
+  }
+
+  template <typename T> std::vector<T> read_vector(group g, std::string const &name, hid_t type) {
+   dataset ds = g.open_dataset(name);
+   h5::dataspace d_space = H5Dget_space(ds);
+   mini_vector<hsize_t, 1> dims_out;
+   int ndims = H5Sget_simple_extent_dims(d_space, dims_out.ptr(), NULL);
+   if (ndims != 1) TRIQS_RUNTIME_ERROR << "Error reading the many_body_operator : " << name << " has rank " << ndims;
+   std::vector<T> v(dims_out[0]);
+   if (v.size() && (H5Dread(ds, type, d_space, H5S_ALL, H5P_DEFAULT, v.data()) < 0))
+    TRIQS_RUNTIME_ERROR << "Error reading the many_body_operator : " << name << " in the group " << g.name();
+   return v;
+  }
+
+  bool is_group(group g, std::string const &name) {
+   H5O_info_t info;
+   return (H5Oget_info_by_name(g, name.c_str(), &info, H5P_DEFAULT) >= 0) && (info.type == H5O_TYPE_GROUP);
+  }
+
+  // ---- the old format
+
+  // maximum order of the monomial (here quartic operators)
+  constexpr int max_monomial_size = 4;
+
+  // a monomial : its C, C^+ as in the CSR format, 0 meaning no operator
   struct h5_monomial {
    double scalar;
-   long op_indices[MAX_MONOMIAL_SIZE];
+   long op_indices[max_monomial_size];
   };
 
-  // create the h5 type corresponding to h5_monomial
   h5_object h5_monomial_dtype() {
    h5_object mono_id = H5Tcreate(H5T_COMPOUND, sizeof(h5_monomial));
    H5Tinsert(mono_id, "scalar", HOFFSET(h5_monomial, scalar), H5T_NATIVE_DOUBLE);
-   hsize_t array_dim[] = {MAX_MONOMIAL_SIZE};
+   hsize_t array_dim[] = {max_monomial_size};
    h5_object array_tid = H5Tarray_create(H5T_NATIVE_LONG, 1, array_dim);
    H5Tinsert(mono_id, "op_indices", HOFFSET(h5_monomial, op_indices), array_tid);
    return mono_id;
@@ -62,45 +97,31 @@ namespace utility {
 
  void h5_write(h5::group g, std::string const &name, many_body_operator<double> const &op, fundamental_operator_set const &fops) {
 
-  // first prepare the data
-  // datavec stores all monomials.
-  // In each monomial, the C, C^+ operator is labeled by an int,
-  // >0 for C^+, <0 for C. 0 means : no operator.
-  // Its abs is the unique int associated to the series of indices of the C, from the fundamental_operator_set
-  std::vector<h5_monomial> datavec;
-
-  for (auto const &m : op.monomials) { // for all monomials of the operator
-   if (m.first.size() > MAX_MONOMIAL_SIZE)
-    TRIQS_RUNTIME_ERROR << " h5 writing many_body_operator : unexpected monomial with more than " << MAX_MONOMIAL_SIZE
-                        << "operators !";
-   h5_monomial y = {m.second, {0, 0, 0, 0}}; // we want to transform it to an h5_monomial
-   int i = 0;
-   for (auto const &c_cdag_op : m.first) {       // loop over the C C^+ operators of the monomial
-    long c_number = fops[c_cdag_op.indices] + 1; // the number of the C C^+ op. 0 means "no operators" here, so we shift by 1
-    y.op_indices[i++] = (c_cdag_op.dagger ? c_number : -c_number);
+  // the number of the C, C^+, from their interned indices
+  std::unordered_map<std::vector<variant_int_string> const *, int32_t> numbers;
+  for (auto const &x : fops) numbers[intern_indices(x.index)] = x.linear_index + 1;
+
+  std::vector<double> coefficients;
+  std::vector<long> offsets(1, 0);
+  std::vector<int32_t> operators;
+  coefficients.reserve(op.monomials.size());
+  offsets.reserve(op.monomials.size() + 1);
+  operators.reserve(op.arena.size() - op.n_dead_ops);
+  for (auto const &m : op) {
+   for (auto const &c_cdag_op : m.monomial) {
+    auto it = numbers.find(&c_cdag_op.indices);
+    if (it == numbers.end()) TRIQS_RUNTIME_ERROR << "h5 writing many_body_operator : an operator is not in the fundamental_operator_set";
+    operators.push_back(c_cdag_op.dagger ? it->second : -it->second);
    }
-   datavec.push_back(y);
+   coefficients.push_back(m.coef);
+   offsets.push_back(operators.size());
   }
-  // now datavec and correspondance_table are ready.
-
-  // ----- Store datavec into the h5 file.
-
-  // datatype
-  h5_object datatype = h5_monomial_dtype();
-
-  // dataspace
-  hsize_t dim[] = {datavec.size()};
-  h5_object dataspace = H5Screate_simple(1, dim, NULL);
-
-  // dataset
-  h5_object dataset = g.create_dataset(name.c_str(), datatype, dataspace);
 
-  // write
-  herr_t status = H5Dwrite(dataset, datatype, H5S_ALL, H5S_ALL, H5P_DEFAULT, datavec.data());
-  if (status < 0) TRIQS_RUNTIME_ERROR << "Error writing the many_body_operator " << op << " in the group" << g.name();
-
-  // Store fundamental_operator_set as an attribute of the dataset
-  h5_write_attribute(dataset, "fundamental_operator_set", fops);
+  group gr = g.create_group(name);
+  write_vector(gr, "coefficients", coefficients, H5T_NATIVE_DOUBLE);
+  write_vector(gr, "offsets", offsets, H5T_NATIVE_LONG);
+  write_vector(gr, "operators", operators, H5T_NATIVE_INT32);
+  if (fops.size()) h5_write_attribute(gr, "fundamental_operator_set", fops); // an empty attribute can not be written
  }
 
  // ---------------------------  READ -----------------------------------------
@@ -114,45 +135,59 @@ namespace utility {
 
  void h5_read(h5::group g, std::string const &name, many_body_operator<double> &op, fundamental_operator_set &fops) {
 
-  // --- Read the datavec
-
-  // open the dataset
-  dataset ds = g.open_dataset(name);
-
-  // dataspace
-  h5::dataspace d_space = H5Dget_space(ds);
-
-  // recover the dimension: must be of rank 1
-  mini_vector<hsize_t, 1> dims_out;
-  int ndims = H5Sget_simple_extent_dims(d_space, dims_out.ptr(), NULL);
-  if (ndims != 1)
-   TRIQS_RUNTIME_ERROR
-       << "triqs::h5 : Trying to read many_body_operator. Rank mismatch : the array stored in the hdf5 file has rank = " << ndims;
-
-  // datatype
-  h5_object datatype = h5_monomial_dtype();
-
-  // reading
-  std::vector<h5_monomial> datavec(dims_out[0]);
-
-  herr_t status = H5Dread(ds, h5_monomial_dtype(), d_space, H5S_ALL, H5P_DEFAULT, datavec.data());
-  if (status < 0) TRIQS_RUNTIME_ERROR << "Error reading the many_body_operator " << op << " from the group" << g.name();
-
-  // --- Read correspondance_table as an attribute
-  h5_read_attribute(ds, "fundamental_operator_set", fops);
+  std::vector<double> coefficients;
+  std::vector<long> offsets(1, 0);
+  std::vector<int32_t> operators;
+
+  if (is_group(g, name)) {
+   group gr = g.open_group(name);
+   coefficients = read_vector<double>(gr, "coefficients", H5T_NATIVE_DOUBLE);
+   offsets = read_vector<long>(gr, "offsets", H5T_NATIVE_LONG);
+   operators = read_vector<int32_t>(gr, "operators", H5T_NATIVE_INT32);
+   fops = fundamental_operator_set{};
+   if (H5Aexists(gr, "fundamental_operator_set") > 0) h5_read_attribute(gr, "fundamental_operator_set", fops);
+   if ((offsets.size() != coefficients.size() + 1) || (offsets[0] != 0) || (offsets.back() != long(operators.size())))
+    TRIQS_RUNTIME_ERROR << "Error reading the many_body_operator " << name << " : inconsistent sizes";
+   for (long m = 0; m < long(coefficients.size()); ++m)
+    if (offsets[m + 1] < offsets[m]) TRIQS_RUNTIME_ERROR << "Error reading the many_body_operator " << name << " : decreasing offsets";
+  } else { // the old format, put in CSR form
+   dataset ds = g.open_dataset(name);
+   h5::dataspace d_space = H5Dget_space(ds);
+   mini_vector<hsize_t, 1> dims_out;
+   int ndims = H5Sget_simple_extent_dims(d_space, dims_out.ptr(), NULL);
+   if (ndims != 1)
+    TRIQS_RUNTIME_ERROR
+        << "triqs::h5 : Trying to read many_body_operator. Rank mismatch : the array stored in the hdf5 file has rank = " << ndims;
+   std::vector<h5_monomial> datavec(dims_out[0]);
+   herr_t status = H5Dread(ds, h5_monomial_dtype(), d_space, H5S_ALL, H5P_DEFAULT, datavec.data());
+   if (status < 0) TRIQS_RUNTIME_ERROR << "Error reading the many_body_operator " << name << " from the group" << g.name();
+   h5_read_attribute(ds, "fundamental_operator_set", fops);
+   for (auto const &mon : datavec) {
+    for (long i : mon.op_indices) {
+     if (i == 0) break; // the end of the C, C^+ list
+     operators.push_back(i);
+    }
+    coefficients.push_back(mon.scalar);
+    offsets.push_back(operators.size());
+   }
+  }
 
-  // ---- Now we must reverse the operations of write
+  // ---- Now we must reverse the operations of write, with all the room made at once
 
   auto r_fops = fops.reverse_map(); // a map int -> indices inverting fops[int] -> indices
-
-  for (auto const &mon : datavec) {
-   many_body_operator<double>::monomial_t monomial;         // vector of canonical_ops_t
-   for (int i : mon.op_indices) {                           // loop over the index of the C, C^ ops of the monomial
-    if (i == 0) break;                                      // means we have reach the end of the C,  C^+ list
-    monomial.push_back({(i > 0), r_fops[std::abs(i) - 1]}); // add one C, C^+ op to the monomial
-   }
-   op.monomials.insert({monomial, mon.scalar}); // add the monomial to the operator
+  std::vector<std::vector<variant_int_string> const *> interned(r_fops.size());
+  for (int n = 0; n < int(r_fops.size()); ++n) interned[n] = intern_indices(r_fops[n]);
+
+  std::vector<many_body_operator<double>::op_t> ops(operators.size());
+  for (long k = 0; k < long(operators.size()); ++k) {
+   int32_t i = operators[k];
+   if ((i == 0) || (std::abs(i) > long(interned.size())))
+    TRIQS_RUNTIME_ERROR << "Error reading the many_body_operator " << name << " : operator number " << i << " is not in the fundamental_operator_set";
+   ops[k] = {interned[std::abs(i) - 1], (i > 0)};
   }
+  op = many_body_operator<double>{};
+  op.reserve(coefficients.size(), ops.size());
+  for (long m = 0; m < long(coefficients.size()); ++m) op.add(ops.data() + offsets[m], offsets[m + 1] - offsets[m], coefficients[m]);
  }
 }
 }
@@ -23,9 +23,15 @@
 
 #include <ostream>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <numeric>
+#include <set>
 #include <boost/operators.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/map.hpp>
+#include <boost/serialization/split_member.hpp>
 #include <triqs/utility/draft/numeric_ops.hpp>
 #include <triqs/h5.hpp>
 
@@ -33,8 +39,42 @@
 namespace triqs {
 namespace utility {
 
+ /**
+  * The indices of the C, C^+ operators, interned : all the operators with the same indices point to the same indices_t,
+  * which is never deallocated. The monomials then compare and hash the indices by address.
+  * Thread safe.
+  */
+ namespace details {
+  // a total order on the indices, for the table of intern_indices only : int < string, then the order of variant_int_string
+  struct indices_total_less {
+   struct _is_string {
+    bool operator()(int) const { return false; }
+    bool operator()(std::string const&) const { return true; }
+   };
+   static bool less(variant_int_string const& x, variant_int_string const& y) {
+    bool sx = apply_visitor(_is_string(), x), sy = apply_visitor(_is_string(), y);
+    return (sx != sy ? sy : x < y);
+   }
+   bool operator()(std::vector<variant_int_string> const& a, std::vector<variant_int_string> const& b) const {
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), less);
+   }
+  };
+ }
+
+ inline std::vector<variant_int_string> const* intern_indices(std::vector<variant_int_string> const& indices) {
+  static std::set<std::vector<variant_int_string>, details::indices_total_less> table;
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  return &*table.insert(indices).first;
+ }
+
  /**
   * many_body_operator is a general operator in second quantification
+  *
+  * Implementation : the C, C^+ of all the monomials are packed in a single vector (the arena),
+  * and the monomials are found with an open addressing hash table.
+  * The iteration and the printing are done in the order of the monomials (cf monomial_less), which is computed
+  * on demand and kept until the next modification.
   */
  template <typename scalar_t>
  class many_body_operator :
@@ -46,44 +86,51 @@ namespace utility {
      boost::multipliable<many_body_operator<scalar_t>, scalar_t>, // op*a a*op op/a
      boost::dividable<many_body_operator<scalar_t>, scalar_t> {
 
+  template <typename S> friend class many_body_operator;
+
   public:
   /// The indices of the C, C^+ operators are a vector of int/string
   using indices_t = std::vector<variant_int_string>;
 
-  private:
-  // The canonical operator: a dagger and some indices
+  /// A C, C^+ of a monomial, as seen from the iterators : a dagger and some indices
   struct canonical_ops_t {
    bool dagger;
-   indices_t indices;
-   // Order: dagger < non dagger, and then indices
-   // Example: c+_1 < c+_2 < c+_3 < c_3 < c_2 < c_1
-   friend bool operator<(canonical_ops_t const& a, canonical_ops_t const& b) {
-    if (a.dagger != b.dagger) return (a.dagger > b.dagger);
-    if (a.dagger) // a.indices < b.indices
-     return std::lexicographical_compare(a.indices.begin(), a.indices.end(), b.indices.begin(), b.indices.end());
-    else // b.indices < a.indices
-     return std::lexicographical_compare(b.indices.begin(), b.indices.end(), a.indices.begin(), a.indices.end());
-   }
-   friend bool operator>(canonical_ops_t const& a, canonical_ops_t const& b) { return b < a; }
-   friend bool operator==(canonical_ops_t const& a, canonical_ops_t const& b) {
-    return (a.dagger == b.dagger && a.indices.size() == b.indices.size() &&
-            std::equal(a.indices.begin(), a.indices.end(), b.indices.begin()));
-   }
-   template <class Archive> void serialize(Archive& ar, const unsigned int version) { ar& dagger& indices; }
+   indices_t const& indices;
   };
 
-  // Monomial: an ordered set of creation/annihilation operators and comparison
-  using monomial_t = std::vector<canonical_ops_t>;
+  private:
+  // The packed canonical operator: a dagger and the interned indices
+  struct op_t {
+   indices_t const* indices;
+   bool dagger;
+   friend bool operator==(op_t const& a, op_t const& b) { return (a.indices == b.indices) && (a.dagger == b.dagger); }
+   friend bool operator!=(op_t const& a, op_t const& b) { return !(a == b); }
+  };
 
-  friend bool operator<(monomial_t const& m1, monomial_t const& m2) {
-   return m1.size() != m2.size() ? m1.size() < m2.size()
-                                 : std::lexicographical_compare(m1.begin(), m1.end(), m2.begin(), m2.end());
+  // Order: dagger < non dagger, and then indices
+  // Example: c+_1 < c+_2 < c+_3 < c_3 < c_2 < c_1
+  static bool op_less(op_t const& a, op_t const& b) {
+   if (a.dagger != b.dagger) return a.dagger;
+   if (a.indices == b.indices) return false;
+   return (a.dagger ? *a.indices < *b.indices : *b.indices < *a.indices);
   }
 
-  // Map of all monomials with coefficients
-  using monomials_map_t = std::map<monomial_t, scalar_t>;
+  // A monomial : its C, C^+ are arena[offset, offset + size), in the order of op_less
+  struct monomial_t {
+   long offset;
+   int size;
+   uint64_t hash;
+   scalar_t coef;
+  };
 
-  monomials_map_t monomials;
+  std::vector<op_t> arena;
+  std::vector<monomial_t> monomials;
+  std::vector<int> table; // the hash table : number of the monomial, -1 if empty. Its size is a power of 2
+  long n_dead_ops = 0;    // the C, C^+ of the erased monomials, still in the arena
+
+  // the monomials in the order of monomial_less, if order_ok
+  mutable std::vector<int> order;
+  mutable std::atomic<bool> order_ok{false};
 
   friend void h5_write(h5::group g, std::string const& name, many_body_operator<double> const& op);
   friend void h5_write(h5::group g, std::string const& name, many_body_operator<double> const& op,
@@ -95,57 +142,104 @@ namespace utility {
 
   public:
   many_body_operator() = default;
-  many_body_operator(many_body_operator const&) = default;
-  many_body_operator(many_body_operator&&) = default;
-  many_body_operator& operator=(many_body_operator const&) = default;
-  many_body_operator& operator=(many_body_operator&&) = default;
+  many_body_operator(many_body_operator const& x) : arena(x.arena), monomials(x.monomials), table(x.table), n_dead_ops(x.n_dead_ops) {}
+  many_body_operator(many_body_operator&& x) noexcept
+     : arena(std::move(x.arena)), monomials(std::move(x.monomials)), table(std::move(x.table)), n_dead_ops(x.n_dead_ops) {
+   x.clear();
+  }
+  many_body_operator& operator=(many_body_operator const& x) {
+   arena = x.arena;
+   monomials = x.monomials;
+   table = x.table;
+   n_dead_ops = x.n_dead_ops;
+   order_ok = false;
+   return *this;
+  }
+  many_body_operator& operator=(many_body_operator&& x) noexcept {
+   std::swap(arena, x.arena);
+   std::swap(monomials, x.monomials);
+   std::swap(table, x.table);
+   std::swap(n_dead_ops, x.n_dead_ops);
+   order_ok = false;
+   x.order_ok = false;
+   return *this;
+  }
 
   template <typename S> many_body_operator(many_body_operator<S> const& x) { *this = x; }
-  explicit many_body_operator(scalar_t const& x) { monomials.insert({{},x}); }
+  explicit many_body_operator(scalar_t const& x) { add(nullptr, 0, x); }
 
   template <typename S> many_body_operator& operator=(many_body_operator<S> const& x) {
-   monomials.clear();
-   for (auto const& y : x.monomials) monomials.insert({y.first, y.second});
+   clear();
+   std::vector<op_t> m;
+   for (auto const& y : x.monomials) {
+    m.clear();
+    for (int i = 0; i < y.size; ++i) m.push_back({x.arena[y.offset + i].indices, x.arena[y.offset + i].dagger});
+    add(m.data(), m.size(), y.coef);
+   }
+   return *this;
   }
 
   /// Make a minimal fundamental_operator_set with all the canonical operators of this
   hilbert_space::fundamental_operator_set make_fundamental_operator_set() const {
+   std::set<indices_t const*> all_indices;
+   for (auto const& m : monomials)
+    for (int i = 0; i < m.size; ++i) all_indices.insert(arena[m.offset + i].indices);
+   std::set<indices_t> sorted_indices;
+   for (auto p : all_indices) sorted_indices.insert(*p);
    hilbert_space::fundamental_operator_set fops;
-   for (auto const& m : monomials)        // for all monomials of the operator
-    for (auto const& c_cdag_op : m.first) // loop over the C C^+ operators of the monomial
-     fops.insert_from_indices_t(c_cdag_op.indices);
+   for (auto const& ind : sorted_indices) fops.insert_from_indices_t(ind);
    return fops;
   }
 
   // factory for c, cdag
-  static many_body_operator make_canonical(bool is_dag, indices_t indices) {
+  static many_body_operator make_canonical(bool is_dag, indices_t const& indices) {
    many_body_operator res;
-   auto m = monomial_t{canonical_ops_t{is_dag, indices}};
-   res.monomials.insert({m, scalar_t(1.0)});
+   op_t x{intern_indices(indices), is_dag};
+   res.add(&x, 1, scalar_t(1.0));
    return res;
   }
 
+  /// The C, C^+ of a monomial, in normal order
+  struct monomial_view {
+   op_t const *_b, *_e;
+   struct iterator {
+    op_t const* p;
+    canonical_ops_t operator*() const { return {p->dagger, *p->indices}; }
+    iterator& operator++() {
+     ++p;
+     return *this;
+    }
+    bool operator==(iterator const& y) const { return p == y.p; }
+    bool operator!=(iterator const& y) const { return p != y.p; }
+   };
+   iterator begin() const { return {_b}; }
+   iterator end() const { return {_e}; }
+   size_t size() const { return _e - _b; }
+  };
+
   // We use utility::dressed_iterator to dress iterators
   // _cdress is a simple struct of refs to dress the iterators (Cf doc)
   struct _cdress {
-   monomial_t const& monomial;
+   monomial_view monomial;
    scalar_t coef;
-   _cdress(typename monomials_map_t::const_iterator _it) : monomial(_it->first), coef(_it->second) {}
-   operator std::pair<std::vector<std::pair<bool,indices_t>>,scalar_t>() {
+   _cdress(std::vector<int>::const_iterator _it, many_body_operator const* op)
+      : monomial{op->arena.data() + op->monomials[*_it].offset, op->arena.data() + op->monomials[*_it].offset + op->monomials[*_it].size},
+        coef(op->monomials[*_it].coef) {}
+   operator std::pair<std::vector<std::pair<bool,indices_t>>,scalar_t>() const {
     std::vector<std::pair<bool,indices_t>> tmp_monomial;
     tmp_monomial.reserve(monomial.size());
     for(auto cop : monomial) tmp_monomial.emplace_back(cop.dagger,cop.indices);
     return {tmp_monomial,coef};
    }
   };
-  using const_iterator = utility::dressed_iterator<typename monomials_map_t::const_iterator, _cdress>;
+  using const_iterator = utility::dressed_iterator<std::vector<int>::const_iterator, _cdress, const many_body_operator>;
 
   public:
-  // Iterators (only const!)
-  const_iterator begin() const noexcept { return monomials.begin(); }
-  const_iterator end() const noexcept { return monomials.end(); }
-  const_iterator cbegin() const noexcept { return monomials.cbegin(); }
-  const_iterator cend() const noexcept { return monomials.cend(); }
+  // Iterators (only const!), in the order of the monomials
+  const_iterator begin() const noexcept { return {sorted_order().begin(), this}; }
+  const_iterator end() const noexcept { return {sorted_order().end(), this}; }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
 
   // Is zero operator ?
   bool is_zero() const { return monomials.empty(); }
@@ -153,18 +247,12 @@ namespace utility {
   // Algebraic operations involving scalar_t constants
   many_body_operator operator-() const {
    auto res = *this;
-   for (auto& m : res.monomials) m.second = -m.second;
+   for (auto& m : res.monomials) m.coef = -m.coef;
    return res;
   }
 
   many_body_operator& operator+=(scalar_t alpha) {
-   bool is_new_monomial;
-   typename monomials_map_t::iterator it;
-   std::tie(it, is_new_monomial) = monomials.insert(std::make_pair(monomial_t(0), alpha));
-   if (!is_new_monomial) {
-    it->second += alpha;
-    erase_zero_monomial(monomials, it);
-   }
+   add(nullptr, 0, alpha);
    return *this;
   }
 
@@ -175,9 +263,9 @@ namespace utility {
 
   many_body_operator& operator*=(scalar_t alpha) {
    if (triqs::utility::is_zero(alpha)) {
-    monomials.clear();
+    clear();
    } else {
-    for (auto& m : monomials) m.second *= alpha;
+    for (auto& m : monomials) m.coef *= alpha;
    }
    return *this;
   }
@@ -186,124 +274,255 @@ namespace utility {
 
   // Algebraic operations
   many_body_operator& operator+=(many_body_operator const& op) {
-   bool is_new_monomial;
-   typename monomials_map_t::iterator it;
-   for (auto const& m : op.monomials) {
-    std::tie(it, is_new_monomial) = monomials.insert(m);
-    if (!is_new_monomial) {
-     it->second += m.second;
-     erase_zero_monomial(monomials, it);
-    }
-   }
+   if (&op == this) return operator*=(scalar_t(2));
+   for (auto const& m : op.monomials) add(op.arena.data() + m.offset, m.size, m.coef);
    return *this;
   }
 
   many_body_operator& operator-=(many_body_operator const& op) {
-   bool is_new_monomial;
-   typename monomials_map_t::iterator it;
-   for (auto const& m : op.monomials) {
-    std::tie(it, is_new_monomial) = monomials.insert(std::make_pair(m.first, -m.second));
-    if (!is_new_monomial) {
-     it->second -= m.second;
-     erase_zero_monomial(monomials, it);
-    }
+   if (&op == this) {
+    clear();
+    return *this;
    }
+   for (auto const& m : op.monomials) add(op.arena.data() + m.offset, m.size, -m.coef);
    return *this;
   }
 
   many_body_operator& operator*=(many_body_operator const& op) {
-   monomials_map_t tmp_map; // product will be stored here
+   many_body_operator res; // product will be stored here
+   normal_ordering normalize;
+   std::vector<op_t> product_m;
    for (auto const& m : monomials)
     for (auto const& op_m : op.monomials) {
      // prepare an unnormalized product
-     monomial_t product_m;
-     product_m.reserve(m.first.size() + op_m.first.size());
-     for (auto const& op : m.first) product_m.push_back(op);
-     for (auto const& op : op_m.first) product_m.push_back(op);
-     // std::copy(m.first.begin(), m.first.end(), std::back_inserter(product_m));
-     // std::copy(op_m.first.begin(), op_m.first.end(), std::back_inserter(product_m));
-     normalize_and_insert(product_m, m.second * op_m.second, tmp_map);
+     product_m.assign(arena.begin() + m.offset, arena.begin() + m.offset + m.size);
+     product_m.insert(product_m.end(), op.arena.begin() + op_m.offset, op.arena.begin() + op_m.offset + op_m.size);
+     normalize(product_m, m.coef * op_m.coef, res);
     }
-   std::swap(monomials, tmp_map);
+   *this = std::move(res);
    return *this;
   }
 
-  // implementation details of dagger
-  //
-  private:
-
-  static canonical_ops_t _dagger(canonical_ops_t const& cop) {
-   return {!cop.dagger, cop.indices};
-  }
-
-  static monomial_t _dagger(monomial_t const& m) {
-   monomial_t res;
-   for (auto it = m.rbegin(); it != m.rend(); ++it) res.push_back(_dagger(*it));
-   return res;
-  }
-
   public:
   // dagger
+  // The reversed monomial, with the C and C^+ exchanged, is still in normal order.
   friend many_body_operator dagger(many_body_operator const& op) {
    many_body_operator res;
-   for (auto const& x : op) res.monomials.insert({_dagger(x.monomial), triqs::utility::_conj(x.coef)});
+   std::vector<op_t> m;
+   for (auto const& x : op.monomials) {
+    m.clear();
+    for (int i = x.size - 1; i >= 0; --i) m.push_back({op.arena[x.offset + i].indices, !op.arena[x.offset + i].dagger});
+    res.add(m.data(), m.size(), triqs::utility::_conj(x.coef));
+   }
    return res;
   }
 
   // Boost.Serialization
+  // Stored as a map monomial -> coefficient, with the indices of the C, C^+ in full.
+  private:
+  struct serialized_op_t {
+   bool dagger;
+   indices_t indices;
+   friend bool operator<(serialized_op_t const& a, serialized_op_t const& b) {
+    return (a.dagger != b.dagger ? a.dagger > b.dagger : a.indices < b.indices);
+   }
+   template <class Archive> void serialize(Archive& ar, const unsigned int version) { ar& dagger& indices; }
+  };
+  using serialized_map_t = std::map<std::vector<serialized_op_t>, scalar_t>;
+
   friend class boost::serialization::access;
-  template <class Archive> void serialize(Archive& ar, const unsigned int version) { ar& monomials; }
+  template <class Archive> void save(Archive& ar, const unsigned int version) const {
+   serialized_map_t m;
+   for (auto const& x : monomials) {
+    std::vector<serialized_op_t> v;
+    for (int i = 0; i < x.size; ++i) v.push_back({arena[x.offset + i].dagger, *arena[x.offset + i].indices});
+    m.insert({v, x.coef});
+   }
+   ar& m;
+  }
+  template <class Archive> void load(Archive& ar, const unsigned int version) {
+   serialized_map_t m;
+   ar& m;
+   clear();
+   std::vector<op_t> v;
+   for (auto const& x : m) {
+    v.clear();
+    for (auto const& y : x.first) v.push_back({intern_indices(y.indices), y.dagger});
+    add(v.data(), v.size(), x.second);
+   }
+  }
+  BOOST_SERIALIZATION_SPLIT_MEMBER();
 
   private:
-  // Normalize a monomial and insert into a map
-  static void normalize_and_insert(monomial_t& m, scalar_t coeff, monomials_map_t& target) {
-   // The normalization is done by employing a simple bubble sort algorithms.
-   // Apart from sorting elements this function keeps track of the sign and
-   // recursively calls itself if a permutation of two operators produces a new
-   // monomial
-   if (m.size() >= 2) {
-    bool is_swapped;
-    do {
-     is_swapped = false;
-     for (std::size_t n = 1; n < m.size(); ++n) {
-      canonical_ops_t& prev_index = m[n - 1];
-      canonical_ops_t& cur_index = m[n];
-      if (prev_index == cur_index) return; // The monomial is effectively zero
-      if (prev_index > cur_index) {
-       // Are we swapping C and C^+ with the same indices?
-       // A bit ugly ...
-       canonical_ops_t cur_index_flipped_type(cur_index);
-       cur_index_flipped_type.dagger = !cur_index_flipped_type.dagger;
-       if (prev_index == cur_index_flipped_type) {
-        monomial_t new_m;
-        new_m.reserve(m.size() - 2);
-        std::copy(m.begin(), m.begin() + n - 1, std::back_inserter(new_m));
-        std::copy(m.begin() + n + 1, m.end(), std::back_inserter(new_m));
-        normalize_and_insert(new_m, coeff, target);
-       }
-       coeff = -coeff;
-       std::swap(prev_index, cur_index);
-       is_swapped = true;
-      }
-     }
-    } while (is_swapped);
+  void clear() {
+   arena.clear();
+   monomials.clear();
+   table.clear();
+   n_dead_ops = 0;
+   order_ok = false;
+  }
+
+  static uint64_t hash(op_t const* p, int n) {
+   uint64_t h = 0x9E3779B97F4A7C15ull ^ uint64_t(n);
+   for (int i = 0; i < n; ++i) {
+    h ^= (reinterpret_cast<uintptr_t>(p[i].indices) << 1) | uintptr_t(p[i].dagger);
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 31;
+   }
+   return h;
+  }
+
+  // Add coef * the monomial p[0, n), which is in normal order, and not in the arena.
+  // A monomial is erased when its coefficient becomes 0.
+  void add(op_t const* p, int n, scalar_t coef) {
+   order_ok = false;
+   if (2 * (monomials.size() + 1) > table.size()) rehash(std::max(size_t(16), 2 * table.size()));
+   uint64_t h = hash(p, n);
+   long mask = table.size() - 1, slot = h & mask;
+   for (; table[slot] != -1; slot = (slot + 1) & mask) {
+    auto& x = monomials[table[slot]];
+    if ((x.hash == h) && (x.size == n) && std::equal(p, p + n, arena.begin() + x.offset)) {
+     x.coef += coef;
+     if (triqs::utility::is_zero(x.coef)) erase(slot);
+     return;
+    }
+   }
+   if (triqs::utility::is_zero(coef)) return;
+   table[slot] = monomials.size();
+   monomials.push_back({long(arena.size()), n, h, coef});
+   arena.insert(arena.end(), p, p + n);
+  }
+
+  // Room for n_monomials more monomials with n_ops C, C^+ in total, without rehashing
+  void reserve(long n_monomials, long n_ops) {
+   size_t n = monomials.size() + n_monomials;
+   monomials.reserve(n);
+   arena.reserve(arena.size() + n_ops);
+   size_t size = std::max(size_t(16), table.size());
+   while (size < 2 * (n + 1)) size *= 2;
+   if (size > table.size()) rehash(size);
+  }
+
+  void rehash(size_t size) {
+   table.assign(size, -1);
+   long mask = size - 1;
+   for (int e = 0; e < int(monomials.size()); ++e) {
+    long slot = monomials[e].hash & mask;
+    while (table[slot] != -1) slot = (slot + 1) & mask;
+    table[slot] = e;
    }
+  }
 
-   // Insert the result
-   bool is_new_monomial;
-   typename monomials_map_t::iterator it;
-   std::tie(it, is_new_monomial) = target.insert(std::make_pair(m, coeff));
-   if (!is_new_monomial) {
-    it->second += coeff;
-    erase_zero_monomial(target, it);
+  // Erase the monomial of the slot of the hash table (backward shift deletion, then the last monomial takes its place)
+  void erase(long slot) {
+   int e = table[slot];
+   long mask = table.size() - 1, i = slot;
+   for (long j = (slot + 1) & mask; table[j] != -1; j = (j + 1) & mask) {
+    long k = monomials[table[j]].hash & mask; // the slot where the monomial of j would be without collision
+    if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j))) continue;
+    table[i] = table[j];
+    i = j;
+   }
+   table[i] = -1;
+   n_dead_ops += monomials[e].size;
+   int last = monomials.size() - 1;
+   if (e != last) {
+    long s = monomials[last].hash & mask;
+    while (table[s] != last) s = (s + 1) & mask;
+    table[s] = e;
+    monomials[e] = monomials[last];
    }
+   monomials.pop_back();
+   if ((n_dead_ops > 64) && (2 * n_dead_ops > long(arena.size()))) compact();
+  }
+
+  // Remove the C, C^+ of the erased monomials from the arena
+  void compact() {
+   std::vector<op_t> new_arena;
+   new_arena.reserve(arena.size() - n_dead_ops);
+   for (auto& m : monomials) {
+    long offset = new_arena.size();
+    new_arena.insert(new_arena.end(), arena.begin() + m.offset, arena.begin() + m.offset + m.size);
+    m.offset = offset;
+   }
+   std::swap(arena, new_arena);
+   n_dead_ops = 0;
+  }
+
+  // Order of the monomials : by size, then lexicographic
+  bool monomial_less(monomial_t const& x, monomial_t const& y) const {
+   if (x.size != y.size) return x.size < y.size;
+   return std::lexicographical_compare(arena.begin() + x.offset, arena.begin() + x.offset + x.size, arena.begin() + y.offset,
+                                       arena.begin() + y.offset + y.size, op_less);
+  }
+
+  static std::mutex& order_mutex() {
+   static std::mutex m;
+   return m;
   }
 
-  // Erase a monomial with a close-to-zero coefficient.
-  static void erase_zero_monomial(monomials_map_t& m, typename monomials_map_t::iterator& it) {
-   if (triqs::utility::is_zero(it->second)) m.erase(it);
+  std::vector<int> const& sorted_order() const {
+   if (!order_ok.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(order_mutex());
+    if (!order_ok.load(std::memory_order_relaxed)) {
+     order.resize(monomials.size());
+     std::iota(order.begin(), order.end(), 0);
+     std::sort(order.begin(), order.end(), [this](int a, int b) { return monomial_less(monomials[a], monomials[b]); });
+     order_ok.store(true, std::memory_order_release);
+    }
+   }
+   return order;
   }
 
+  // Normal ordering of a product of C, C^+, added to an operator.
+  // For the closest pair C_i ... C^+_i (no C_i, C^+_i in M):  C_i M C^+_i = (-1)^|M| M - C^+_i M C_i.
+  // When there is none, the C, C^+ are sorted, and the sign is the parity of the permutation.
+  // The buffers are kept from one product to the next.
+  struct normal_ordering {
+   std::vector<std::pair<indices_t const*, int>> by_indices; // (indices, position) of the C, C^+
+   std::vector<int> perm;
+   std::vector<op_t> sorted;
+
+   void operator()(std::vector<op_t>& m, scalar_t coef, many_body_operator& target) {
+    int k = m.size();
+    // the C, C^+ with the same indices, in the order of the product
+    by_indices.resize(k);
+    for (int r = 0; r < k; ++r) by_indices[r] = {m[r].indices, r};
+    std::sort(by_indices.begin(), by_indices.end());
+    for (int r = 1; r < k; ++r) {
+     if (by_indices[r].first != by_indices[r - 1].first) continue;
+     int p = by_indices[r - 1].second, q = by_indices[r].second;
+     if (m[p].dagger == m[q].dagger) return; // C_i M C_i = 0
+     if (m[p].dagger) continue;              // C^+_i M C_i is in order
+     std::vector<op_t> contracted;
+     contracted.reserve(k - 2);
+     for (int s = 0; s < k; ++s)
+      if ((s != p) && (s != q)) contracted.push_back(m[s]);
+     operator()(contracted, ((q - p - 1) % 2 ? -coef : coef), target);
+     std::swap(m[p], m[q]);
+     operator()(m, -coef, target);
+     return;
+    }
+    // sort
+    perm.resize(k);
+    std::iota(perm.begin(), perm.end(), 0);
+    std::sort(perm.begin(), perm.end(), [&m](int a, int b) { return op_less(m[a], m[b]); });
+    sorted.resize(k);
+    int n_cycles = 0;
+    for (int r = 0; r < k; ++r) sorted[r] = m[perm[r]];
+    for (int r = 0; r < k; ++r) {
+     if (perm[r] < 0) continue;
+     ++n_cycles;
+     for (int s = r; perm[s] >= 0;) {
+      int t = perm[s];
+      perm[s] = -1;
+      s = t;
+     }
+    }
+    target.add(sorted.data(), k, ((k - n_cycles) % 2 ? -coef : coef));
+   }
+  };
+
   friend std::ostream& operator<<(std::ostream& os, canonical_ops_t const& op) {
    if (op.dagger) os << "^+";
    os << "(";
@@ -315,7 +534,7 @@ namespace utility {
    return os << ")";
   }
 
-  friend std::ostream& operator<<(std::ostream& os, monomial_t const& m) {
+  friend std::ostream& operator<<(std::ostream& os, monomial_view const& m) {
    for (auto const& c : m) {
     os << "C" << c;
    }
@@ -324,12 +543,12 @@ namespace utility {
 
   // Print many_body_operator itself
   friend std::ostream& operator<<(std::ostream& os, many_body_operator const& op) {
-   if (op.monomials.size() != 0) {
+   if (!op.is_zero()) {
     bool print_plus = false;
-    for (auto const& m : op.monomials) {
-     os << (print_plus ? " + " : "") << m.second;
-     if (m.first.size()) os << "*";
-     os << m.first;
+    for (auto const& m : op) {
+     os << (print_plus ? " + " : "") << m.coef;
+     if (m.monomial.size()) os << "*";
+     os << m.monomial;
      print_plus = true;
     }
    } else
@@ -339,6 +558,15 @@ namespace utility {
  };
 
 
+ // ---- h5 --------------
+ // Cf many_body_operator.cpp. The monomials are stored with the numbers of the C, C^+ in the fundamental_operator_set.
+
+ void h5_write(h5::group g, std::string const& name, many_body_operator<double> const& op);
+ void h5_write(h5::group g, std::string const& name, many_body_operator<double> const& op,
+               hilbert_space::fundamental_operator_set const& fops);
+ void h5_read(h5::group g, std::string const& name, many_body_operator<double>& op);
+ void h5_read(h5::group g, std::string const& name, many_body_operator<double>& op, hilbert_space::fundamental_operator_set& fops);
+
  // ---- factories --------------
 
  // Free functions to make creation/annihilation operators
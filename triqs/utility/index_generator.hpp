@@ -47,6 +47,16 @@ namespace utility {
    // i[0]=0;
    _at_end = true;
   }
+  // advance by k points at once : recompute i from the flat index
+  void advance(long k) {
+   i_flat += k;
+   long r = i_flat;
+   i[2] = r % d[2];
+   r /= d[2];
+   i[1] = r % d[1];
+   i[0] = r / d[1];
+   _at_end = (i[0] >= d[0]);
+  }
   mini_vector<long, 3> const& index() const { return i; }
   long linear_index() const { return i_flat;}
   bool at_end() const { return _at_end; }
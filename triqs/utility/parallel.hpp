@@ -0,0 +1,119 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2015 by O. Parcollet
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+#include <triqs/utility/first_include.hpp>
+#include <algorithm>
+#include <exception>
+#include <vector>
+
+#ifdef TRIQS_WITH_OPENMP
+#include <omp.h>
+#endif
+
+namespace triqs {
+namespace utility {
+
+ /**
+  * Shared memory parallelism (opt-in).
+  *
+  * If TRIQS is compiled with -DUSE_OPENMP=ON, TRIQS_WITH_OPENMP is defined and the loops below
+  * are distributed over the OpenMP threads (number of threads set as usual by OMP_NUM_THREADS).
+  * Otherwise, they are simple serial loops.
+  *
+  * The functions called in the loops must be thread safe : they should only write at distinct places.
+  * Exceptions thrown in a thread are caught and the first one is rethrown after the parallel region.
+  */
+
+ /// By default, loops of size smaller than this are run serially
+ constexpr long parallel_grain_size = 64;
+
+ /// Number of threads available for the parallel loops
+ inline int parallel_n_threads() {
+#ifdef TRIQS_WITH_OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+ }
+
+ /// Number of the calling thread in the current parallel loop
+ inline int parallel_thread_id() {
+#ifdef TRIQS_WITH_OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+ }
+
+ /**
+  * Partition [0,N[ into contiguous chunks, one per thread, and call f(first, last) on each of them.
+  * The chunks are [c*N/n_chunks, (c+1)*N/n_chunks[.
+  * If N < grain, or if called from inside a parallel region, simply call f(0,N).
+  */
+ template <typename F> void parallel_for_chunks(long N, F const &f, long grain = parallel_grain_size) {
+  if (N <= 0) return;
+#ifdef TRIQS_WITH_OPENMP
+  if ((N >= grain) && (parallel_n_threads() > 1) && !omp_in_parallel()) {
+   std::exception_ptr error;
+#pragma omp parallel
+   {
+    long n_chunks = omp_get_num_threads(), c = omp_get_thread_num();
+    try {
+     f((c * N) / n_chunks, ((c + 1) * N) / n_chunks);
+    }
+    catch (...) {
+#pragma omp critical(triqs_parallel_error)
+     if (!error) error = std::current_exception();
+    }
+   }
+   if (error) std::rethrow_exception(error);
+   return;
+  }
+#endif
+  f(0, N);
+ }
+
+ /// Call f(i) for i in [0,N[, the indices being distributed over the threads
+ template <typename F> void parallel_for(long N, F const &f, long grain = parallel_grain_size) {
+  parallel_for_chunks(N, [&f](long first, long last) {
+   for (long i = first; i < last; ++i) f(i);
+  }, grain);
+ }
+
+ /**
+  * Deterministic reduction over [0,N[.
+  *
+  * [0,N[ is cut into a number of blocks which depends only on N, *not* on the number of threads.
+  * For each block, f(first, last, acc) accumulates the contribution of [first, last[ into acc, which starts from zero.
+  * The partial results are then added in the order of the blocks.
+  * Hence the result is bitwise identical for any number of threads, including the serial code.
+  */
+ template <typename T, typename F> T parallel_reduce(long N, T const &zero, F const &f) {
+  constexpr long max_blocks = 256;
+  long n_blocks = std::max(1l, std::min(max_blocks, N / parallel_grain_size));
+  std::vector<T> partial(n_blocks, zero);
+  parallel_for(n_blocks, [&](long b) { f((b * N) / n_blocks, ((b + 1) * N) / n_blocks, partial[b]); }, 2);
+  T res = zero;
+  for (auto const &x : partial) res += x;
+  return res;
+ }
+}
+}